@@ -33,7 +33,11 @@
 #include "utils/log.h"
 #include "whiteboard/TwosixWhiteboardLink.h"
 
-PluginCommsTwoSixCpp::PluginCommsTwoSixCpp(IRaceSdkComms *raceSdkIn) : raceSdk(raceSdkIn) {
+PluginCommsTwoSixCpp::PluginCommsTwoSixCpp(IRaceSdkComms *raceSdkIn) :
+    raceSdk(raceSdkIn),
+    directReactor([this](const LinkID &linkId, RawData &&data) {
+        receiveDirectPackage(linkId, std::move(data));
+    }) {
     logDebug("PluginCommsTwoSixCpp::PluginCommsTwoSixCpp()");
     if (raceSdk == nullptr) {
         throw std::invalid_argument("Race SDK provided to Comms plugin is nullptr");
@@ -105,6 +109,9 @@ PluginResponse PluginCommsTwoSixCpp::shutdown() {
         link.second->shutdown();
     }
 
+    directReactor.stop();
+    directConnectionPool.closeAll();
+
     logInfo("shutdown: returned");
     return PLUGIN_OK;
 }
@@ -405,6 +412,23 @@ const PluginConfig &PluginCommsTwoSixCpp::getPluginConfig() const {
     return pluginConfig;
 }
 
+void PluginCommsTwoSixCpp::receiveDirectPackage(const LinkID &linkId, RawData &&data) {
+    std::shared_ptr<DirectLink> link;
+    try {
+        link = std::dynamic_pointer_cast<DirectLink>(getLink(linkId));
+    } catch (std::out_of_range &e) {
+        logWarning("receiveDirectPackage: dropping package received for unknown link: " + linkId);
+        return;
+    }
+
+    if (link == nullptr) {
+        logError("receiveDirectPackage: link is not a direct link: " + linkId);
+        return;
+    }
+
+    link->receiveFrame(std::move(data));
+}
+
 #ifndef TESTBUILD
 IRacePluginComms *createPluginComms(IRaceSdkComms *sdk) {
     return new PluginCommsTwoSixCpp(sdk);
@@ -30,6 +30,8 @@
 // #include "base/Channel.h"
 #include "base/Connection.h"
 #include "base/Link.h"
+#include "direct/DirectConnectionPool.h"
+#include "direct/DirectReactor.h"
 #include "utils/PortAllocator.h"
 #include "utils/log.h"
 
@@ -49,6 +51,12 @@ public:
 
     std::unordered_map<std::string, std::shared_ptr<Channel>> channels;
 
+    // Outgoing connections shared by all direct links
+    DirectConnectionPool directConnectionPool;
+
+    // Event loop for receiving on all direct links
+    DirectReactor directReactor;
+
     PluginConfig pluginConfig;
 
 public:
@@ -95,6 +103,14 @@ public:
 
     const PluginConfig &getPluginConfig() const;
 
+    /**
+     * @brief Pass a package received by the direct reactor to the direct link it was received on.
+     *
+     * @param linkId The ID of the link the package was received on.
+     * @param data The raw data of the package.
+     */
+    void receiveDirectPackage(const LinkID &linkId, RawData &&data);
+
 protected:
     /**
      * @brief Parse the configuration files used to initialize the plugin.
@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <iostream>
+#include <iterator>
 
 #include "../PluginCommsTwoSixCpp.h"
 #include "../utils/base64.h"
@@ -33,6 +34,7 @@ Link::Link(IRaceSdkComms *sdk, PluginCommsTwoSixCpp *plugin, Channel *channel, c
     mRnd(std::random_device{}()),
     mId(linkId),
     mProperties(linkProperties),
+    mNextSendId(0),
     mShutdown(false),
     mSendThreadShutdown(false),
     mSendPeriodLength(parser.send_period_length),
@@ -95,17 +97,6 @@ void Link::goSleep() {
         }
     }
     logDebug("Link(" + getId() + "): finished sending CONNECTION_UNAVAILABLE to connections");
-
-    // timeout packages that will timeout while we're sleeping
-    for (SendInfo &toSend : mSendQueue) {
-        if (toSend.timeoutTimestamp < mNextChange) {
-            mSdk->onPackageStatusChanged(toSend.handle, PACKAGE_FAILED_TIMEOUT, 0);
-        }
-    }
-    mSendQueue.erase(
-        std::remove_if(mSendQueue.begin(), mSendQueue.end(),
-                       [this](const SendInfo &a) { return a.timeoutTimestamp < mNextChange; }),
-        mSendQueue.end());
 }
 
 void Link::wakeUp() {
@@ -133,6 +124,41 @@ void Link::wakeUp() {
     logDebug("Link(" + getId() + "): awake until " + std::to_string(mNextChange));
 }
 
+void Link::timeoutPackage(uint64_t id) {
+    {
+        std::lock_guard<std::mutex> lock(mSendLock);
+        mTimedOutIds.push_back(id);
+    }
+    mSendThreadSignaler.notify_one();
+}
+
+void Link::failTimedOutPackages(std::unique_lock<std::mutex> &lock) {
+    std::vector<RaceHandle> handles;
+    for (uint64_t id : mTimedOutIds) {
+        auto iter = mSendQueueIndex.find(id);
+        // the send thread may have taken the package just before the timer fired
+        if (iter == mSendQueueIndex.end()) {
+            continue;
+        }
+        handles.push_back(iter->second->handle);
+        mSendQueue.erase(iter->second);
+        mSendQueueIndex.erase(iter);
+    }
+    mTimedOutIds.clear();
+    lock.unlock();
+
+    if (handles.empty()) {
+        return;
+    }
+    for (RaceHandle handle : handles) {
+        logDebug("Link(" + getId() + "): package timed out in send queue");
+        mSdk->onPackageStatusChanged(handle, PACKAGE_FAILED_TIMEOUT, 0);
+    }
+    for (auto &connection : getConnections()) {
+        mSdk->unblockQueue(connection->connectionId);
+    }
+}
+
 void Link::runSendThread(Link *link) {
     if (!link->runSendThreadInternal()) {
         logError("Link::runSendThread: Send thread failed, destroying link");
@@ -156,7 +182,8 @@ bool Link::runSendThreadInternal() {
             // wait until the next change. If waiting forever because a sendPeriod has
             // not been specified (e.g. it's 0) then wait forever
             auto pred = [this] {
-                return mShutdown || shouldSleep() || shouldWake() || shouldSend();
+                return mShutdown || !mTimedOutIds.empty() || shouldSleep() || shouldWake() ||
+                       shouldSend();
             };
 
             if (mNextChange < std::numeric_limits<double>::infinity()) {
@@ -178,6 +205,11 @@ bool Link::runSendThreadInternal() {
                 break;
             }
 
+            if (!mTimedOutIds.empty()) {
+                failTimedOutPackages(lock);
+                continue;
+            }
+
             if (shouldSleep()) {
                 goSleep();
                 continue;
@@ -195,8 +227,10 @@ bool Link::runSendThreadInternal() {
             }
 
             logDebug("Link(" + getId() + "): Sending package");
-            sendInfo = mSendQueue.front();
+            sendInfo = std::move(mSendQueue.front());
             mSendQueue.pop_front();
+            mSendQueueIndex.erase(sendInfo.id);
+            TimerWheel::shared().cancel(sendInfo.timer);
             mNextSleepAmount--;
             for (auto &connection : getConnections()) {
                 mSdk->unblockQueue(connection->connectionId);
@@ -211,8 +245,12 @@ bool Link::runSendThreadInternal() {
 
     std::unique_lock<std::mutex> lock(mSendLock);
     for (SendInfo &sendInfo : mSendQueue) {
+        TimerWheel::shared().cancel(sendInfo.timer);
         mSdk->onPackageStatusChanged(sendInfo.handle, PACKAGE_FAILED_GENERIC, 0);
     }
+    mSendQueue.clear();
+    mSendQueueIndex.clear();
+    mTimedOutIds.clear();
 
     mSendThreadShutdown = true;
     mSendThreadShutdownSignaler.notify_all();
@@ -308,7 +346,15 @@ PluginResponse Link::sendPackage(RaceHandle handle, const EncPkg &pkg, double ti
             return PLUGIN_OK;  // TODO: is this correct?
         }
 
-        mSendQueue.emplace_back(handle, pkg, timeoutTimestamp);
+        SendInfo &sendInfo = mSendQueue.emplace_back(mNextSendId++, handle, pkg, timeoutTimestamp);
+        mSendQueueIndex.emplace(sendInfo.id, std::prev(mSendQueue.end()));
+
+        // once the send thread has exited nothing would cancel the timer
+        if (!mSendThreadShutdown) {
+            uint64_t id = sendInfo.id;
+            sendInfo.timer = TimerWheel::shared().schedule(timeoutTimestamp,
+                                                           [this, id] { timeoutPackage(id); });
+        }
     }
 
     mSendThreadSignaler.notify_one();
@@ -326,6 +372,10 @@ void Link::shutdownLink() {
     std::unique_lock<std::mutex> lock(mSendLock);
     mSendThreadSignaler.notify_one();
     mSendThreadShutdownSignaler.wait(lock, [this] { return mSendThreadShutdown.load(); });
+    lock.unlock();
+
+    // the send thread cancelled the timers of any queued packages, but one may still be running
+    TimerWheel::shared().waitForCallbacks();
     mChannel->onLinkDestroyed(this);
 }
 
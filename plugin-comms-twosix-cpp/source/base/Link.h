@@ -20,15 +20,17 @@
 
 #include <IRacePluginComms.h>  // ConnectionID, LinkID, LinkProperties
 #include <IRaceSdkComms.h>
+#include <TimerWheel.h>
 
 #include <atomic>
 #include <condition_variable>  // std::condition_variable
-#include <deque>               // std::deque
+#include <list>                // std::list
 #include <memory>              // std::shared_ptr
 #include <mutex>               // std::mutex, std::lock_guard
 #include <random>              // std::default_random_engine
 #include <string>              // std::string
 #include <thread>              // std::thread
+#include <unordered_map>       // std::unordered_map
 #include <vector>              // std::vector
 
 #include "../PluginCommsTwoSixCpp.h"
@@ -40,14 +42,18 @@ class Connection;
 class Link : public std::enable_shared_from_this<Link> {
 protected:
     struct SendInfo {
-        SendInfo() : handle(0), pkg(nullptr), timeoutTimestamp(0) {}
-        SendInfo(RaceHandle _handle, const EncPkg &_pkg, double _timeoutTimestamp) :
+        SendInfo() : id(0), handle(0), pkg(nullptr), timeoutTimestamp(0) {}
+        SendInfo(uint64_t _id, RaceHandle _handle, const EncPkg &_pkg, double _timeoutTimestamp) :
+            id(_id),
             handle(_handle),
             pkg(std::make_shared<EncPkg>(_pkg)),
             timeoutTimestamp(_timeoutTimestamp) {}
+        // unique within the link. Handles may be reused, so they can't identify a queued package.
+        uint64_t id;
         RaceHandle handle;
         std::shared_ptr<EncPkg> pkg;
         double timeoutTimestamp;
+        TimerWheel::TimerId timer = TimerWheel::INVALID_TIMER;
     };
 
     IRaceSdkComms *mSdk;
@@ -67,7 +73,12 @@ protected:
     std::mutex mSendLock;
     std::condition_variable mSendThreadSignaler;
 
-    std::deque<SendInfo> mSendQueue;
+    std::list<SendInfo> mSendQueue;
+    // queued packages by id, so a timed out package can be removed without searching the queue
+    std::unordered_map<uint64_t, std::list<SendInfo>::iterator> mSendQueueIndex;
+    // ids of queued packages whose timers have fired, failed by the send thread
+    std::vector<uint64_t> mTimedOutIds;
+    uint64_t mNextSendId;
 
     std::atomic<bool> mShutdown;
 
@@ -239,11 +250,28 @@ private:
     bool shouldSend();
 
     /**
-     * @brief go to sleep and stop sending packages until sleep period has passed. Times out any
-     * packages that would timeout before waking up. Caller should hold send lock.
+     * @brief go to sleep and stop sending packages until sleep period has passed. Queued packages
+     * that time out while sleeping are failed by their timers. Caller should hold send lock.
      */
     void goSleep();
 
+    /**
+     * @brief Hand a queued package whose timeout has passed to the send thread. Called on the
+     * shared timer wheel, so it only records the id and wakes the send thread.
+     *
+     * @param id The id of the queued package
+     */
+    void timeoutPackage(uint64_t id);
+
+    /**
+     * @brief Remove the packages handed over by timeoutPackage from the send queue and report
+     * them as timed out. Called on the send thread with the send lock held, which is released
+     * before calling into the SDK.
+     *
+     * @param lock The held send lock
+     */
+    void failTimedOutPackages(std::unique_lock<std::mutex> &lock);
+
     /**
      * @brief schedule next sleep and start sending packages again.
      */
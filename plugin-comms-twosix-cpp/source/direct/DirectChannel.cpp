@@ -17,6 +17,7 @@
 
 #include "DirectChannel.h"
 
+#include <algorithm>
 #include <climits>
 #include <nlohmann/json.hpp>
 #include <stdexcept>
@@ -112,6 +113,14 @@ PluginResponse DirectChannel::activateChannelInternal(RaceHandle handle) {
     requestEndPortHandle = response.handle;
     userRequestHandles.insert(requestEndPortHandle);
 
+    response = plugin.raceSdk->requestPluginUserInput(
+        "directReceiveWorkers", "How many threads should process received packages?", true);
+    if (response.status != SDK_OK) {
+        logWarning("Failed to request direct receive worker count from user");
+    }
+    requestReceiveWorkersHandle = response.handle;
+    userRequestHandles.insert(requestReceiveWorkersHandle);
+
     return PLUGIN_OK;
 }
 
@@ -151,6 +160,20 @@ bool DirectChannel::onUserInputReceived(RaceHandle handle, bool answered,
             logWarning(logPrefix + "no answer, using default end port");
         }
         responseHandled = true;
+    } else if (handle == requestReceiveWorkersHandle) {
+        if (answered) {
+            try {
+                int numWorkers = std::max(std::stoi(response), 1);
+                logInfo(logPrefix + "using " + std::to_string(numWorkers) + " receive workers");
+                plugin.directReactor.setNumWorkers(numWorkers);
+            } catch (std::exception &e) {
+                logWarning(logPrefix + "invalid number of receive workers '" + response +
+                           "', using default");
+            }
+        } else {
+            logWarning(logPrefix + "no answer, using default number of receive workers");
+        }
+        responseHandled = true;
     }
 
     // Check if all requests have been fulfilled
@@ -46,6 +46,7 @@ protected:
     RaceHandle requestHostnameHandle{NULL_RACE_HANDLE};
     RaceHandle requestStartPortHandle{NULL_RACE_HANDLE};
     RaceHandle requestEndPortHandle{NULL_RACE_HANDLE};
+    RaceHandle requestReceiveWorkersHandle{NULL_RACE_HANDLE};
     std::string hostname;
     PortAllocator portAllocator;
     std::unordered_set<RaceHandle> userRequestHandles;
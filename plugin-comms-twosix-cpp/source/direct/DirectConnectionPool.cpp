@@ -0,0 +1,268 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "DirectConnectionPool.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>  // TCP_NODELAY
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>  // iovec
+#include <unistd.h>
+
+#include <chrono>  // std::chrono::milliseconds
+#include <thread>  // std::this_thread::sleep_for
+
+#include "../utils/log.h"
+#include "DirectFraming.h"
+
+DirectConnectionPool::~DirectConnectionPool() {
+    closeAll();
+}
+
+bool DirectConnectionPool::send(const std::string &hostname, int port,
+                                const std::vector<RawDataView> &segments,
+                                const std::string &loggingPrefix) {
+    size_t length = 0;
+    for (const auto &segment : segments) {
+        length += segment.size();
+    }
+
+    if (length > DirectFraming::MAX_FRAME_LENGTH) {
+        logError(loggingPrefix + "package of size " + std::to_string(length) +
+                 " exceeds maximum frame length");
+        return false;
+    }
+
+    auto pooled = getPooledSocket({hostname, port});
+    std::lock_guard<std::mutex> lock(pooled->lock);
+
+    if (pooled->fd != -1) {
+        // The receiver never writes to the stream, so if the socket is readable the peer has
+        // closed it (or it errored). Detect that before writing so the frame isn't lost to a
+        // write that succeeds locally but is never delivered.
+        uint8_t peek;
+        ssize_t result = recv(pooled->fd, &peek, sizeof(peek), MSG_PEEK | MSG_DONTWAIT);
+        if (result == 0 || (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            logDebug(loggingPrefix + "pooled connection to " + hostname + ":" +
+                     std::to_string(port) + " was closed by peer, reconnecting");
+            ::close(pooled->fd);
+            pooled->fd = -1;
+        }
+    }
+
+    bool reused = pooled->fd != -1;
+    if (!reused) {
+        pooled->fd = connectSocket(hostname, port, loggingPrefix);
+        if (pooled->fd == -1) {
+            return false;
+        }
+    }
+
+    if (writeFrame(pooled->fd, segments, length, loggingPrefix)) {
+        return true;
+    }
+
+    ::close(pooled->fd);
+    pooled->fd = -1;
+
+    if (!reused) {
+        return false;
+    }
+
+    // The pooled connection may have gone stale between the check above and the write, so try
+    // once more on a fresh connection
+    logInfo(loggingPrefix + "send on pooled connection to " + hostname + ":" +
+            std::to_string(port) + " failed, retrying on a new connection");
+    pooled->fd = connectSocket(hostname, port, loggingPrefix);
+    if (pooled->fd == -1) {
+        return false;
+    }
+
+    if (!writeFrame(pooled->fd, segments, length, loggingPrefix)) {
+        ::close(pooled->fd);
+        pooled->fd = -1;
+        return false;
+    }
+    return true;
+}
+
+void DirectConnectionPool::acquire(const std::string &hostname, int port) {
+    std::lock_guard<std::mutex> lock(mPoolLock);
+    auto &pooled = mSockets[{hostname, port}];
+    if (pooled == nullptr) {
+        pooled = std::make_shared<PooledSocket>();
+    }
+    pooled->leases++;
+}
+
+void DirectConnectionPool::release(const std::string &hostname, int port) {
+    std::shared_ptr<PooledSocket> pooled;
+    {
+        std::lock_guard<std::mutex> lock(mPoolLock);
+        auto it = mSockets.find({hostname, port});
+        if (it == mSockets.end()) {
+            return;
+        }
+        if (it->second->leases > 0 && --it->second->leases > 0) {
+            return;
+        }
+        pooled = it->second;
+        mSockets.erase(it);
+    }
+
+    std::lock_guard<std::mutex> lock(pooled->lock);
+    if (pooled->fd != -1) {
+        ::close(pooled->fd);
+        pooled->fd = -1;
+    }
+}
+
+void DirectConnectionPool::closeAll() {
+    std::map<Key, std::shared_ptr<PooledSocket>> sockets;
+    {
+        std::lock_guard<std::mutex> lock(mPoolLock);
+        sockets.swap(mSockets);
+    }
+
+    for (auto &entry : sockets) {
+        std::lock_guard<std::mutex> lock(entry.second->lock);
+        if (entry.second->fd != -1) {
+            ::close(entry.second->fd);
+            entry.second->fd = -1;
+        }
+    }
+}
+
+std::shared_ptr<DirectConnectionPool::PooledSocket> DirectConnectionPool::getPooledSocket(
+    const Key &key) {
+    std::lock_guard<std::mutex> lock(mPoolLock);
+    auto &pooled = mSockets[key];
+    if (pooled == nullptr) {
+        pooled = std::make_shared<PooledSocket>();
+    }
+    return pooled;
+}
+
+int DirectConnectionPool::connectSocket(const std::string &hostname, int port,
+                                        const std::string &loggingPrefix) {
+    logDebug(loggingPrefix + "Connecting to Host " + hostname + ":" + std::to_string(port));
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo *addresses = nullptr;
+    int result = getaddrinfo(hostname.c_str(), std::to_string(port).c_str(), &hints, &addresses);
+    if (result != 0 || addresses == nullptr) {
+        logError(loggingPrefix + "Failed to get host by name for: " + hostname + ": " +
+                 std::string(gai_strerror(result)));
+        return -1;
+    }
+
+    const int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        logError(loggingPrefix + "Send Failure: failed to create socket to connect to " +
+                 hostname + ":" + std::to_string(port) + ": " + std::to_string(errno) + ": " +
+                 std::string(strerror(errno)));
+        freeaddrinfo(addresses);
+        return -1;
+    }
+
+    int retries = 0;
+    while (connect(sock, addresses->ai_addr, addresses->ai_addrlen) < 0) {
+        if (errno == EADDRNOTAVAIL && retries < 50) {
+            // Connections are pooled, so running out of local ports should be rare, but back off
+            // briefly in case some other part of the process is churning through sockets
+            retries++;
+            logInfo(loggingPrefix + "Connect failed due to EADDRNOTAVAIL. retrying");
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+
+        logError(loggingPrefix + "Connect Failure: an error occurred while connecting to " +
+                 hostname + ":" + std::to_string(port) + ". connect failed with error: " +
+                 std::to_string(errno) + ": " + std::string(strerror(errno)));
+        freeaddrinfo(addresses);
+        ::close(sock);
+        return -1;
+    }
+    freeaddrinfo(addresses);
+
+    // Frames are written whole, so there's no benefit to delaying small packages
+    int opt = 1;
+    if (setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt)) != 0) {
+        logWarning(loggingPrefix + "failed to set TCP_NODELAY: " + std::string(strerror(errno)));
+    }
+
+    logDebug(loggingPrefix + "Connected to Host " + hostname + ":" + std::to_string(port) +
+             " on socket " + std::to_string(sock));
+    return sock;
+}
+
+bool DirectConnectionPool::writeFrame(int fd, const std::vector<RawDataView> &segments,
+                                      size_t length, const std::string &loggingPrefix) {
+    auto header = DirectFraming::encodeHeader(static_cast<uint32_t>(length));
+
+    std::vector<struct iovec> iov;
+    iov.reserve(segments.size() + 1);
+    iov.push_back({header.data(), header.size()});
+    for (const auto &segment : segments) {
+        if (!segment.empty()) {
+            iov.push_back({const_cast<uint8_t *>(segment.data()), segment.size()});
+        }
+    }
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov.data();
+    msg.msg_iovlen = iov.size();
+
+    size_t remaining = header.size() + length;
+    while (remaining > 0) {
+        // MSG_NOSIGNAL so a peer that went away results in EPIPE instead of SIGPIPE
+        ssize_t numBytesSent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (numBytesSent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            logError(loggingPrefix + "Send Failure: send failed with error: " +
+                     std::to_string(errno) + ": " + std::string(strerror(errno)));
+            return false;
+        }
+
+        remaining -= static_cast<size_t>(numBytesSent);
+
+        // advance the iovecs past what was sent
+        size_t sent = static_cast<size_t>(numBytesSent);
+        while (sent > 0 && msg.msg_iovlen > 0) {
+            if (sent >= msg.msg_iov->iov_len) {
+                sent -= msg.msg_iov->iov_len;
+                msg.msg_iov++;
+                msg.msg_iovlen--;
+            } else {
+                msg.msg_iov->iov_base = static_cast<uint8_t *>(msg.msg_iov->iov_base) + sent;
+                msg.msg_iov->iov_len -= sent;
+                sent = 0;
+            }
+        }
+    }
+
+    return true;
+}
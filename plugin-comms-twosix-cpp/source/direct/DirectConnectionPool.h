@@ -0,0 +1,122 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef _DIRECT_CONNECTION_POOL_H_
+#define _DIRECT_CONNECTION_POOL_H_
+
+#include <EncPkg.h>  // RawData
+
+#include <map>      // std::map
+#include <memory>   // std::shared_ptr
+#include <mutex>    // std::mutex, std::lock_guard
+#include <string>   // std::string
+#include <utility>  // std::pair
+#include <vector>   // std::vector
+
+/**
+ * @brief Pool of outgoing TCP connections used by direct links, keyed by (hostname, port).
+ *
+ * Rather than opening a new socket for every package, a single long-lived stream is kept open per
+ * destination and packages are written to it as length-prefixed frames (see DirectFraming.h). This
+ * avoids leaving a socket in TIME_WAIT for every package sent.
+ *
+ * Several links may send to the same destination, so each link holds a lease on its destination
+ * for as long as it exists and the pooled connection is only closed once the last lease is
+ * released.
+ *
+ * This class is thread-safe. Sends to the same destination are serialized so that frames are never
+ * interleaved, while sends to different destinations may proceed in parallel.
+ */
+class DirectConnectionPool {
+public:
+    DirectConnectionPool() = default;
+    DirectConnectionPool(const DirectConnectionPool &) = delete;
+    DirectConnectionPool &operator=(const DirectConnectionPool &) = delete;
+    ~DirectConnectionPool();
+
+    /**
+     * @brief Send a single frame containing the concatenation of segments to the given
+     * destination, opening a connection if one is not already pooled. If a pooled connection turns
+     * out to have been closed by the peer, it is reopened and the send is retried once.
+     *
+     * The segments are written with a single gathering write, so a package can be sent straight
+     * from its header and cipher text without first being copied into one buffer.
+     *
+     * @param hostname The hostname of the destination.
+     * @param port The port of the destination.
+     * @param segments The bytes to frame and send.
+     * @param loggingPrefix Prefix to use for log messages.
+     * @return true if the whole frame was written, false otherwise.
+     */
+    bool send(const std::string &hostname, int port, const std::vector<RawDataView> &segments,
+              const std::string &loggingPrefix);
+
+    /**
+     * @brief Take a lease on the pooled connection to the given destination. Each call must be
+     * balanced by a call to release.
+     *
+     * @param hostname The hostname of the destination.
+     * @param port The port of the destination.
+     */
+    void acquire(const std::string &hostname, int port);
+
+    /**
+     * @brief Release a lease taken by acquire. The pooled connection to the destination is closed
+     * once no leases on it remain.
+     *
+     * @param hostname The hostname of the destination.
+     * @param port The port of the destination.
+     */
+    void release(const std::string &hostname, int port);
+
+    /**
+     * @brief Close all pooled connections.
+     */
+    void closeAll();
+
+private:
+    using Key = std::pair<std::string, int>;
+
+    struct PooledSocket {
+        std::mutex lock;
+        int fd = -1;
+        size_t leases = 0;  // guarded by mPoolLock
+    };
+
+    std::shared_ptr<PooledSocket> getPooledSocket(const Key &key);
+
+    /**
+     * @brief Open a connection to the destination. Caller must hold the PooledSocket lock.
+     *
+     * @return int The connected socket, or -1 on failure.
+     */
+    static int connectSocket(const std::string &hostname, int port,
+                             const std::string &loggingPrefix);
+
+    /**
+     * @brief Write a frame header and segments to the socket, handling partial writes.
+     *
+     * @return true if the whole frame was written, false otherwise.
+     */
+    static bool writeFrame(int fd, const std::vector<RawDataView> &segments, size_t length,
+                           const std::string &loggingPrefix);
+
+    std::mutex mPoolLock;
+    std::map<Key, std::shared_ptr<PooledSocket>> mSockets;
+};
+
+#endif
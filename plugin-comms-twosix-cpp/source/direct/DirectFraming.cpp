@@ -0,0 +1,70 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "DirectFraming.h"
+
+#include <stdexcept>  // std::length_error
+#include <string>     // std::to_string
+
+std::array<uint8_t, DirectFraming::HEADER_LENGTH> DirectFraming::encodeHeader(uint32_t length) {
+    return {static_cast<uint8_t>(length >> 24), static_cast<uint8_t>(length >> 16),
+            static_cast<uint8_t>(length >> 8), static_cast<uint8_t>(length)};
+}
+
+uint32_t DirectFraming::decodeHeader(const uint8_t *header) {
+    return (static_cast<uint32_t>(header[0]) << 24) | (static_cast<uint32_t>(header[1]) << 16) |
+           (static_cast<uint32_t>(header[2]) << 8) | static_cast<uint32_t>(header[3]);
+}
+
+void DirectFrameDecoder::append(const uint8_t *data, size_t length) {
+    // Drop already consumed bytes before growing the buffer so it doesn't grow without bound on a
+    // long-lived stream
+    if (offset > 0 && offset == buffer.size()) {
+        buffer.clear();
+        offset = 0;
+    } else if (offset > buffer.size() / 2) {
+        buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(offset));
+        offset = 0;
+    }
+    buffer.insert(buffer.end(), data, data + length);
+}
+
+bool DirectFrameDecoder::nextFrame(RawData &frame) {
+    if (bufferedBytes() < DirectFraming::HEADER_LENGTH) {
+        return false;
+    }
+
+    const uint32_t length = DirectFraming::decodeHeader(buffer.data() + offset);
+    if (length > DirectFraming::MAX_FRAME_LENGTH) {
+        throw std::length_error("direct link frame length " + std::to_string(length) +
+                                " exceeds maximum");
+    }
+
+    if (bufferedBytes() < DirectFraming::HEADER_LENGTH + length) {
+        return false;
+    }
+
+    auto begin =
+        buffer.begin() + static_cast<std::ptrdiff_t>(offset + DirectFraming::HEADER_LENGTH);
+    frame.assign(begin, begin + length);
+    offset += DirectFraming::HEADER_LENGTH + length;
+    return true;
+}
+
+size_t DirectFrameDecoder::bufferedBytes() const {
+    return buffer.size() - offset;
+}
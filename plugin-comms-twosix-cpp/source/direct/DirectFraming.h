@@ -0,0 +1,94 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef _DIRECT_FRAMING_H_
+#define _DIRECT_FRAMING_H_
+
+#include <EncPkg.h>  // RawData
+
+#include <array>    // std::array
+#include <cstddef>  // size_t
+#include <cstdint>  // uint32_t
+
+/**
+ * Packages sent over a direct link are framed so that many packages can share a single long-lived
+ * TCP stream. Each frame is a 4 byte big-endian length followed by that many bytes of package raw
+ * data.
+ */
+namespace DirectFraming {
+
+const size_t HEADER_LENGTH = sizeof(uint32_t);
+
+// Frames larger than this are treated as a corrupt stream rather than allocated
+const uint32_t MAX_FRAME_LENGTH = 256 * 1024 * 1024;
+
+/**
+ * @brief Create the frame header for a payload of the given length.
+ *
+ * @param length The length of the payload in bytes.
+ * @return std::array<uint8_t, HEADER_LENGTH> The big-endian encoded length.
+ */
+std::array<uint8_t, HEADER_LENGTH> encodeHeader(uint32_t length);
+
+/**
+ * @brief Decode a frame header.
+ *
+ * @param header Pointer to HEADER_LENGTH bytes of header.
+ * @return uint32_t The payload length.
+ */
+uint32_t decodeHeader(const uint8_t *header);
+
+}  // namespace DirectFraming
+
+/**
+ * @brief Incrementally reassembles frames from a byte stream. Bytes may be appended in arbitrarily
+ * sized pieces (e.g. whatever a single read() returned) and complete frames are then pulled out in
+ * order.
+ */
+class DirectFrameDecoder {
+public:
+    /**
+     * @brief Append bytes read from the stream.
+     *
+     * @param data Pointer to the bytes.
+     * @param length The number of bytes.
+     */
+    void append(const uint8_t *data, size_t length);
+
+    /**
+     * @brief Remove the next complete frame from the decoder, if there is one.
+     *
+     * @param frame Set to the payload of the frame if one is available.
+     * @return true if a frame was returned, false if more data is needed.
+     *
+     * @throws std::length_error if the stream announces a frame larger than MAX_FRAME_LENGTH.
+     */
+    bool nextFrame(RawData &frame);
+
+    /**
+     * @brief Get the number of buffered bytes that have not yet been returned as a frame.
+     *
+     * @return size_t The number of buffered bytes.
+     */
+    size_t bufferedBytes() const;
+
+private:
+    RawData buffer;
+    size_t offset = 0;
+};
+
+#endif
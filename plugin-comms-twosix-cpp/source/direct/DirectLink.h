@@ -18,23 +18,19 @@
 #ifndef _DIRECT_LINK_H_
 #define _DIRECT_LINK_H_
 
-#include <atomic>  // std::atomic
-#include <thread>  // std::thread
-
 #include "../base/Link.h"
 #include "DirectLinkProfileParser.h"
 
 class DirectLink : public Link {
 protected:
-    void runMonitor();
-
-    std::thread mMonitorThread;
-    int mSocket;
-    std::atomic<bool> mTerminated;
-
     const std::string mHostname;
     const int mPort;
 
+    // whether this link still holds its lease on the pooled connection to mHostname:mPort
+    std::atomic<bool> mHoldsPoolLease{false};
+
+    void acquirePoolLease();
+
     virtual bool sendPackageInternal(RaceHandle handle, const EncPkg &pkg) override;
 
 public:
@@ -61,6 +57,13 @@ public:
      * @return std::string The link address.
      */
     virtual std::string getLinkAddress() override;
+
+    /**
+     * @brief Pass a package received as a single frame on one of this link's sockets to the sdk.
+     *
+     * @param data The raw data of the package.
+     */
+    void receiveFrame(RawData &&data);
 };
 
 #endif
@@ -0,0 +1,436 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "DirectReactor.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>  // std::max
+#include <stdexcept>  // std::length_error
+
+#include "../utils/log.h"
+
+// epoll user data used for the wakeup eventfd. Socket IDs start at 1 so this never collides.
+static const uint64_t WAKE_ID = 0;
+
+static const size_t READ_BUFFER_SIZE = 64 * 1024;
+static const int MAX_EVENTS = 64;
+
+/**
+ * @brief Log the sender of a package given the socket that the message was sent on. The function
+ *        will try to log the hostname of the sender, but if that fails it will fallback to just
+ *        logging the IP address.
+ *
+ * @param sock The socket that the sender used to send the package.
+ */
+static void logDirectConnectionSender(int sock) {
+    struct sockaddr_storage peerAddr;
+    socklen_t peerAddrLen = sizeof(peerAddr);
+    // Get the address of the sender so that it can be logged for debugging.
+    getpeername(sock, reinterpret_cast<struct sockaddr *>(&peerAddr), &peerAddrLen);
+    if (peerAddr.ss_family == AF_INET) {
+        struct sockaddr_in *s = reinterpret_cast<struct sockaddr_in *>(&peerAddr);
+        int peerPort = ntohs(s->sin_port);
+        char ipstr[INET6_ADDRSTRLEN];
+        inet_ntop(AF_INET, &s->sin_addr, ipstr, sizeof(ipstr));
+
+        const uint32_t hostLen = 256;
+        char host[hostLen];
+        const uint32_t serviceLen = 256;
+        char service[serviceLen];
+        // Try to get the host name from the IP address. If that fails then just log the IP.
+        if (getnameinfo(reinterpret_cast<struct sockaddr *>(&peerAddr), peerAddrLen, host, hostLen,
+                        service, serviceLen, 0) == 0) {
+            logInfo("DirectReactor: new connection from " + std::string(host) + ":" +
+                    std::string(service) + " resolves to " + std::string(ipstr) + ":" +
+                    std::to_string(peerPort));
+        } else {
+            logInfo("DirectReactor: new connection from " + std::string(ipstr) + ":" +
+                    std::to_string(peerPort));
+        }
+    } else {
+        logError("DirectReactor: failed to log sender address. Only IPv4 is supported");
+    }
+}
+
+DirectReactor::DirectReactor(PackageCallback onPackage) :
+    mOnPackage(std::move(onPackage)),
+    mNumWorkers(2),
+    mRunning(false),
+    mEpollFd(-1),
+    mWakeFd(-1),
+    mNextSocketId(1),
+    mReadBuffer(READ_BUFFER_SIZE) {}
+
+DirectReactor::~DirectReactor() {
+    stop();
+}
+
+void DirectReactor::setNumWorkers(int numWorkers) {
+    std::lock_guard<std::mutex> lock(mLock);
+    if (mRunning) {
+        logWarning("DirectReactor::setNumWorkers: reactor already running, ignoring new value " +
+                   std::to_string(numWorkers));
+        return;
+    }
+    mNumWorkers = std::max(numWorkers, 1);
+}
+
+void DirectReactor::start() {
+    const std::string loggingPrefix = "DirectReactor::start: ";
+    mEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (mEpollFd == -1) {
+        throw std::runtime_error("epoll_create1 failed: " + std::string(strerror(errno)));
+    }
+
+    mWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mWakeFd == -1) {
+        close(mEpollFd);
+        mEpollFd = -1;
+        throw std::runtime_error("eventfd failed: " + std::string(strerror(errno)));
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.u64 = WAKE_ID;
+    epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mWakeFd, &event);
+
+    logInfo(loggingPrefix + "starting with " + std::to_string(mNumWorkers) + " worker(s)");
+    mRunning = true;
+    for (int i = 0; i < mNumWorkers; ++i) {
+        mWorkers.push_back(std::make_unique<Worker>());
+        Worker *worker = mWorkers.back().get();
+        worker->thread = std::thread(&DirectReactor::runWorker, this, worker);
+    }
+    mEventThread = std::thread(&DirectReactor::runEventLoop, this);
+}
+
+void DirectReactor::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (!mRunning) {
+            return;
+        }
+        mRunning = false;
+    }
+
+    uint64_t value = 1;
+    if (write(mWakeFd, &value, sizeof(value)) != sizeof(value)) {
+        logWarning("DirectReactor::stop: failed to wake event loop: " +
+                   std::string(strerror(errno)));
+    }
+    if (mEventThread.joinable()) {
+        mEventThread.join();
+    }
+
+    for (auto &worker : mWorkers) {
+        {
+            std::lock_guard<std::mutex> lock(worker->lock);
+            worker->queue.clear();
+        }
+        worker->signaler.notify_all();
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    mWorkers.clear();
+
+    std::lock_guard<std::mutex> lock(mLock);
+    for (auto &entry : mSockets) {
+        close(entry.second.fd);
+    }
+    mSockets.clear();
+    mListeners.clear();
+    close(mWakeFd);
+    close(mEpollFd);
+    mWakeFd = -1;
+    mEpollFd = -1;
+}
+
+bool DirectReactor::addListener(const LinkID &linkId, int port) {
+    const std::string loggingPrefix = "DirectReactor::addListener (" + linkId + "): ";
+    std::lock_guard<std::mutex> lock(mLock);
+
+    if (mListeners.count(linkId) != 0) {
+        logDebug(loggingPrefix + "already listening");
+        return true;
+    }
+
+    if (!mRunning) {
+        try {
+            start();
+        } catch (std::exception &e) {
+            logError(loggingPrefix + "failed to start reactor: " + std::string(e.what()));
+            return false;
+        }
+    }
+
+    logDebug(loggingPrefix + "opening socket");
+    int server_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server_fd == -1) {
+        logError(loggingPrefix + "Receive Failure: Socket Creation: Errno: " +
+                 std::to_string(errno) + ": " + std::string(strerror(errno)));
+        return false;
+    }
+
+    int opt = 1;
+    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) ||
+        setsockopt(server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt))) {
+        logError(loggingPrefix + "Receive Failure: Setsockopt: Errno: " + std::to_string(errno) +
+                 ": " + std::string(strerror(errno)));
+        close(server_fd);
+        return false;
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = INADDR_ANY;
+    address.sin_port = htons(port);
+
+    if (bind(server_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+        logError(loggingPrefix + "Receive Failure: Bind: Errno: " + std::to_string(errno) + ": " +
+                 std::string(strerror(errno)));
+        close(server_fd);
+        return false;
+    }
+
+    const std::int32_t backlogSize = 128;
+    if (listen(server_fd, backlogSize) < 0) {
+        logError(loggingPrefix + "Receive Failure: Listen: Errno: " + std::to_string(errno) + ": " +
+                 std::string(strerror(errno)));
+        close(server_fd);
+        return false;
+    }
+
+    uint64_t id = mNextSocketId++;
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.u64 = id;
+    if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, server_fd, &event) == -1) {
+        logError(loggingPrefix + "Receive Failure: epoll_ctl: Errno: " + std::to_string(errno) +
+                 ": " + std::string(strerror(errno)));
+        close(server_fd);
+        return false;
+    }
+
+    mSockets.emplace(id, Socket{server_fd, linkId, true, {}});
+    mListeners[linkId] = id;
+    logInfo(loggingPrefix + "listening on port " + std::to_string(port));
+    return true;
+}
+
+void DirectReactor::removeListener(const LinkID &linkId) {
+    const std::string loggingPrefix = "DirectReactor::removeListener (" + linkId + "): ";
+    std::lock_guard<std::mutex> lock(mLock);
+
+    auto it = mListeners.find(linkId);
+    if (it == mListeners.end()) {
+        logWarning(loggingPrefix + "no listener found");
+        return;
+    }
+    mListeners.erase(it);
+
+    std::vector<uint64_t> toClose;
+    for (auto &entry : mSockets) {
+        if (entry.second.linkId == linkId) {
+            toClose.push_back(entry.first);
+        }
+    }
+    for (uint64_t id : toClose) {
+        closeSocket(id);
+    }
+    logDebug(loggingPrefix + "closed " + std::to_string(toClose.size()) + " socket(s)");
+}
+
+bool DirectReactor::hasListener(const LinkID &linkId) {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mListeners.count(linkId) != 0;
+}
+
+void DirectReactor::runEventLoop() {
+    const std::string loggingPrefix = "DirectReactor::runEventLoop: ";
+    logDebug(loggingPrefix + "called");
+
+    struct epoll_event events[MAX_EVENTS];
+    while (mRunning) {
+        int numEvents = epoll_wait(mEpollFd, events, MAX_EVENTS, -1);
+        if (numEvents < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            logError(loggingPrefix + "epoll_wait failed: " + std::string(strerror(errno)));
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(mLock);
+        for (int i = 0; i < numEvents && mRunning; ++i) {
+            uint64_t id = events[i].data.u64;
+            if (id == WAKE_ID) {
+                uint64_t value;
+                (void)read(mWakeFd, &value, sizeof(value));
+                continue;
+            }
+
+            auto it = mSockets.find(id);
+            if (it == mSockets.end()) {
+                // the socket was closed after this event was returned
+                continue;
+            }
+
+            if (it->second.listening) {
+                handleAccept(id, it->second);
+            } else {
+                handleRead(id, it->second);
+            }
+        }
+    }
+
+    logDebug(loggingPrefix + "returned");
+}
+
+void DirectReactor::handleAccept(uint64_t id, Socket &listener) {
+    const std::string loggingPrefix = "DirectReactor::handleAccept (" + listener.linkId + "): ";
+    while (true) {
+        int sock = accept4(listener.fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (sock == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                return;
+            }
+            if (errno == ENETDOWN || errno == EPROTO || errno == ENOPROTOOPT ||
+                errno == EHOSTDOWN || errno == ENONET || errno == EHOSTUNREACH ||
+                errno == EOPNOTSUPP || errno == ENETUNREACH || errno == ECONNABORTED) {
+                logWarning(loggingPrefix + "accept failed with errno = " + std::to_string(errno) +
+                           ". retrying...");
+                continue;
+            }
+            if (errno == EMFILE || errno == ENFILE) {
+                // Leave the pending connection in the backlog and try again on the next event
+                logError(loggingPrefix + "accept failed, out of file descriptors");
+                return;
+            }
+
+            logError(loggingPrefix + "unexpected accept failure: errno: " + std::to_string(errno) +
+                     ": " + std::string(strerror(errno)) + ". closing listener " +
+                     std::to_string(id));
+            mListeners.erase(listener.linkId);
+            closeSocket(id);
+            return;
+        }
+
+        logDebug(loggingPrefix + "New socket connection: " + std::to_string(sock));
+        logDirectConnectionSender(sock);
+
+        uint64_t sockId = mNextSocketId++;
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.u64 = sockId;
+        if (epoll_ctl(mEpollFd, EPOLL_CTL_ADD, sock, &event) == -1) {
+            logError(loggingPrefix + "epoll_ctl failed: " + std::string(strerror(errno)));
+            close(sock);
+            continue;
+        }
+        mSockets.emplace(sockId, Socket{sock, listener.linkId, false, {}});
+    }
+}
+
+void DirectReactor::handleRead(uint64_t id, Socket &socket) {
+    const std::string loggingPrefix = "DirectReactor::handleRead (" + socket.linkId + "): ";
+
+    // Only do a single read per event so that one busy sender can't starve the others. Level
+    // triggered epoll will report the socket again if there's more to read.
+    ssize_t numRead = read(socket.fd, mReadBuffer.data(), mReadBuffer.size());
+    if (numRead > 0) {
+        socket.decoder.append(mReadBuffer.data(), static_cast<size_t>(numRead));
+        try {
+            RawData data;
+            while (socket.decoder.nextFrame(data)) {
+                dispatch(socket.linkId, std::move(data));
+                data = RawData();
+            }
+        } catch (std::length_error &err) {
+            logError(loggingPrefix + err.what() + ", closing socket " + std::to_string(socket.fd));
+            closeSocket(id);
+        }
+        return;
+    }
+
+    if (numRead < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            return;
+        }
+        logError(loggingPrefix + "read failure: errno: " + std::to_string(errno) + ": " +
+                 std::string(strerror(errno)));
+    } else if (socket.decoder.bufferedBytes() > 0) {
+        logWarning(loggingPrefix + "socket " + std::to_string(socket.fd) + " closed with " +
+                   std::to_string(socket.decoder.bufferedBytes()) +
+                   " bytes of an incomplete package");
+    }
+
+    logDebug(loggingPrefix + "closing socket connection: " + std::to_string(socket.fd));
+    closeSocket(id);
+}
+
+void DirectReactor::closeSocket(uint64_t id) {
+    auto it = mSockets.find(id);
+    if (it == mSockets.end()) {
+        return;
+    }
+    epoll_ctl(mEpollFd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+    close(it->second.fd);
+    mSockets.erase(it);
+}
+
+void DirectReactor::dispatch(const LinkID &linkId, RawData &&data) {
+    Worker &worker = *mWorkers[std::hash<LinkID>{}(linkId) % mWorkers.size()];
+    {
+        std::lock_guard<std::mutex> lock(worker.lock);
+        worker.queue.emplace_back(linkId, std::move(data));
+    }
+    worker.signaler.notify_one();
+}
+
+void DirectReactor::runWorker(Worker *worker) {
+    while (true) {
+        std::pair<LinkID, RawData> item;
+        {
+            std::unique_lock<std::mutex> lock(worker->lock);
+            worker->signaler.wait(lock,
+                                  [this, worker] { return !mRunning || !worker->queue.empty(); });
+            if (!mRunning) {
+                return;
+            }
+            item = std::move(worker->queue.front());
+            worker->queue.pop_front();
+        }
+
+        try {
+            mOnPackage(item.first, std::move(item.second));
+        } catch (std::exception &e) {
+            logError("DirectReactor::runWorker: package callback threw: " + std::string(e.what()));
+        }
+    }
+}
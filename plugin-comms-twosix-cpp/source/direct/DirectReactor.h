@@ -0,0 +1,140 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef _DIRECT_REACTOR_H_
+#define _DIRECT_REACTOR_H_
+
+#include <IRacePluginComms.h>  // LinkID
+
+#include <atomic>              // std::atomic
+#include <condition_variable>  // std::condition_variable
+#include <deque>               // std::deque
+#include <functional>          // std::function
+#include <memory>              // std::unique_ptr
+#include <mutex>               // std::mutex, std::lock_guard
+#include <thread>              // std::thread
+#include <unordered_map>       // std::unordered_map
+#include <vector>              // std::vector
+
+#include "DirectFraming.h"
+
+/**
+ * @brief Plugin-wide event loop for the receive side of direct links.
+ *
+ * A single epoll thread owns every listening socket and every socket accepted from them. Reads are
+ * non-blocking and frames are decoded incrementally (see DirectFraming.h). Complete packages are
+ * handed to a small pool of worker threads which invoke the package callback. All packages for a
+ * given link are processed by the same worker so they are delivered in the order received.
+ */
+class DirectReactor {
+public:
+    using PackageCallback = std::function<void(const LinkID &linkId, RawData &&data)>;
+
+    /**
+     * @brief Construct the reactor. No threads are started until the first listener is added.
+     *
+     * @param onPackage Callback invoked on a worker thread for every complete package received.
+     */
+    explicit DirectReactor(PackageCallback onPackage);
+    DirectReactor(const DirectReactor &) = delete;
+    DirectReactor &operator=(const DirectReactor &) = delete;
+    ~DirectReactor();
+
+    /**
+     * @brief Set the number of worker threads used to deliver packages. Only takes effect if called
+     * before the reactor is started.
+     *
+     * @param numWorkers The number of worker threads. Values less than 1 are treated as 1.
+     */
+    void setNumWorkers(int numWorkers);
+
+    /**
+     * @brief Start listening for connections on the given port on behalf of a link. Starts the
+     * reactor if it is not already running.
+     *
+     * @param linkId The ID of the link packages received on this port belong to.
+     * @param port The port to listen on.
+     * @return true if the port is now being listened on, false on error.
+     */
+    bool addListener(const LinkID &linkId, int port);
+
+    /**
+     * @brief Stop listening for a link and close every connection accepted on its behalf.
+     *
+     * @param linkId The ID of the link.
+     */
+    void removeListener(const LinkID &linkId);
+
+    /**
+     * @brief Check whether the reactor is listening on behalf of a link.
+     *
+     * @param linkId The ID of the link.
+     * @return true if a listener exists for the link.
+     */
+    bool hasListener(const LinkID &linkId);
+
+    /**
+     * @brief Stop the event loop and worker threads and close all sockets. Packages that have
+     * already been decoded but not yet delivered are dropped.
+     */
+    void stop();
+
+private:
+    struct Socket {
+        int fd;
+        LinkID linkId;
+        bool listening;
+        DirectFrameDecoder decoder;
+    };
+
+    struct Worker {
+        std::mutex lock;
+        std::condition_variable signaler;
+        std::deque<std::pair<LinkID, RawData>> queue;
+        std::thread thread;
+    };
+
+    void start();
+    void runEventLoop();
+    void runWorker(Worker *worker);
+
+    // The following must be called with mLock held
+    void handleAccept(uint64_t id, Socket &listener);
+    void handleRead(uint64_t id, Socket &socket);
+    void closeSocket(uint64_t id);
+    void dispatch(const LinkID &linkId, RawData &&data);
+
+    PackageCallback mOnPackage;
+    int mNumWorkers;
+
+    std::mutex mLock;
+    std::atomic<bool> mRunning;
+    int mEpollFd;
+    int mWakeFd;
+    std::thread mEventThread;
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+
+    // Sockets are identified by a monotonically increasing ID rather than by file descriptor so
+    // that a stale epoll event can never be applied to a reused descriptor
+    uint64_t mNextSocketId;
+    std::unordered_map<uint64_t, Socket> mSockets;
+    std::unordered_map<LinkID, uint64_t> mListeners;
+
+    std::vector<uint8_t> mReadBuffer;
+};
+
+#endif
@@ -45,10 +45,20 @@ static size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *use
     return size * nmemb;
 }
 
+/**
+ * @brief libcurl progress callback that aborts a request once the monitor thread should stop, so
+ * a long poll doesn't delay shutting down.
+ */
+static int StopCallback(void *clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+    return static_cast<std::atomic<bool> *>(clientp)->load() ? 1 : 0;
+}
+
 TwosixWhiteboardLink::MonitorState::MonitorState(TwosixWhiteboardLink *link, double timestamp) :
     mLink(std::dynamic_pointer_cast<TwosixWhiteboardLink>(link->shared_from_this())),
     mShouldStop(false),
-    mTimestamp(timestamp) {}
+    mTimestamp(timestamp),
+    mRequests(0),
+    mPackagesReceived(0) {}
 
 TwosixWhiteboardLink::TwosixWhiteboardLink(IRaceSdkComms *sdk, PluginCommsTwoSixCpp *plugin,
                                            Channel *channel, const LinkID &linkId,
@@ -60,6 +70,7 @@ TwosixWhiteboardLink::TwosixWhiteboardLink(IRaceSdkComms *sdk, PluginCommsTwoSix
     mTag(parser.hashtag),
     mConfigPeriod(parser.checkFrequency),
     mCheckPeriod(0),
+    mLongPollTimeout(parser.longPollTimeout),
     mLinkTimestamp(parser.timestamp),
     maxTries(parser.maxTries) {
     mProperties.linkAddress = this->TwosixWhiteboardLink::getLinkAddress();
@@ -216,7 +227,7 @@ bool TwosixWhiteboardLink::sendPackageInternal(RaceHandle handle, const EncPkg &
     RawData rawData = pkg.getRawData();
 
     uint64_t base64Length = 4 * ((rawData.size() + 1) / 3);  // pessimistic approximation
-    std::string pkgData = base64::encode(pkg.getRawData());
+    std::string pkgData = base64::encode(rawData);
     std::size_t pkgHash = std::hash<std::string>()(pkgData);
     std::string postData;
     postData.reserve(base64Length + 14);
@@ -231,7 +242,12 @@ bool TwosixWhiteboardLink::sendPackageInternal(RaceHandle handle, const EncPkg &
     int tries = 0;
     for (; tries < maxTries; tries++) {
         try {
-            CurlWrap curl;
+            // Reuse the handle so the connection to the whiteboard is kept alive between posts.
+            // Every option that points at a local is set again before each request.
+            if (!mSendCurl) {
+                mSendCurl = std::make_unique<CurlWrap>();
+            }
+            CurlWrap &curl = *mSendCurl;
             std::string response;
 
             logDebug(loggingPrefix + "Attempting to post to: " + postUrl);
@@ -302,7 +318,20 @@ void TwosixWhiteboardLink::runMonitor(std::shared_ptr<MonitorState> monitorState
 bool TwosixWhiteboardLink::runMonitorInternal(MonitorState &monitorState) {
     const std::string loggingPrefix = "TwosixWhiteboardLink::runMonitorInternal (" + mId + "): ";
     logInfo(loggingPrefix + ": called. hostname: " + mHostname + ", tag: " + mTag +
-            ", checkPeriod: " + std::to_string(mCheckPeriod));
+            ", checkPeriod: " + std::to_string(mCheckPeriod) +
+            ", longPollTimeout: " + std::to_string(mLongPollTimeout));
+
+    // One handle is used for every request, so the connection to the whiteboard is kept alive
+    std::unique_ptr<CurlWrap> curl;
+    try {
+        curl = std::make_unique<CurlWrap>();
+        curl->setopt(CURLOPT_XFERINFOFUNCTION, StopCallback);
+        curl->setopt(CURLOPT_XFERINFODATA, &monitorState.mShouldStop);
+        curl->setopt(CURLOPT_NOPROGRESS, 0L);
+    } catch (curl_exception &error) {
+        logError(loggingPrefix + "curl exception: " + std::string(error.what()));
+        return false;
+    }
 
     // Read last recorded timestamp - if there is none, use the value of the LinkAddress or Hint
     // If there is nothing, then just start from <now>
@@ -318,15 +347,21 @@ bool TwosixWhiteboardLink::runMonitorInternal(MonitorState &monitorState) {
         logDebug(loggingPrefix +
                  "Using timestamp hint/address value: " + std::to_string(monitorState.mTimestamp));
     }
-    int latest = getIndexFromTimestamp(monitorState.mTimestamp);
+    int latest = getIndexFromTimestamp(*curl, monitorState.mTimestamp);
 
     auto period = std::chrono::milliseconds(mCheckPeriod);
+    int waitTimeout = mLongPollTimeout;
+    // Once a wait request has succeeded, a 404 is an error from the whiteboard rather than a
+    // missing route, so it no longer turns off long polling
+    bool waitSupported = false;
     int tries = 0;
     while (!monitorState.mShouldStop) {
         auto checkTime = std::chrono::system_clock::now();
+        bool waitRejected = false;
 
         try {
-            auto [posts, newLatest, serverTimestamp] = getNewPosts(latest);
+            monitorState.mRequests++;
+            auto [posts, newLatest, serverTimestamp] = getNewPosts(*curl, latest, waitTimeout);
 
             int numPosts = static_cast<int>(posts.size());
             if (numPosts < newLatest - latest) {
@@ -355,6 +390,7 @@ bool TwosixWhiteboardLink::runMonitorInternal(MonitorState &monitorState) {
                         EncPkg package(base64::decode(post));
                         logDebug(loggingPrefix + ": Received encrypted package");
                         receivePackageWithCorruption(package, connIds, RACE_BLOCKING);
+                        monitorState.mPackagesReceived++;
                     } else {
                         logDebug(loggingPrefix + ": Received post from self, ignoring");
                         mOwnPostHashes.erase(mOwnPostHashes.begin(), hashPos + 1);
@@ -368,15 +404,36 @@ bool TwosixWhiteboardLink::runMonitorInternal(MonitorState &monitorState) {
                 psh::saveValue(mSdk, prependIdentifier("lastTimestamp"), serverTimestamp);
             }
 
+            if (waitTimeout > 0) {
+                waitSupported = true;
+            }
             tries = 0;
         } catch (curl_exception &error) {
+            if (monitorState.mShouldStop) {
+                // the request was aborted to stop the thread
+                break;
+            }
             if (tries % 30 == 0) {
                 logWarning(loggingPrefix + "curl exception: " + std::string(error.what()));
             }
             tries++;
         } catch (json::exception &error) {
-            logError(loggingPrefix + "json exception: " + std::string(error.what()));
-            tries++;
+            long responseCode = curl->getinfo<long>(CURLINFO_RESPONSE_CODE);
+            if (waitTimeout > 0 && !waitSupported && responseCode == 404) {
+                logWarning(loggingPrefix +
+                           "whiteboard does not support waiting for posts, polling instead");
+                waitTimeout = 0;
+                continue;
+            }
+            if (waitTimeout > 0 && responseCode == 503) {
+                // the whiteboard already has as many requests waiting as it allows, so check again
+                // after the usual period rather than treating it as an error
+                logDebug(loggingPrefix + "whiteboard is busy, retrying wait later");
+                waitRejected = true;
+            } else {
+                logError(loggingPrefix + "json exception: " + std::string(error.what()));
+                tries++;
+            }
         } catch (std::exception &error) {
             logError(loggingPrefix + "std exception: " + std::string(error.what()));
             tries++;
@@ -387,19 +444,26 @@ bool TwosixWhiteboardLink::runMonitorInternal(MonitorState &monitorState) {
             break;
         }
 
+        // When long polling, the whiteboard has already waited for new posts, so only wait here to
+        // back off after an error or when the whiteboard rejected the wait
+        auto nextCheckTime =
+            (waitTimeout > 0 && tries == 0 && !waitRejected) ? checkTime : checkTime + period;
+
         std::unique_lock<std::mutex> lock(monitorState.mStopMutex);
-        if (monitorState.mStopCV.wait_until(lock, checkTime + period, [&monitorState] {
+        if (monitorState.mStopCV.wait_until(lock, nextCheckTime, [&monitorState] {
                 return monitorState.mShouldStop.load();
             })) {
             break;
         }
     }
 
+    logInfo(loggingPrefix + "made " + std::to_string(monitorState.mRequests) +
+            " requests to receive " + std::to_string(monitorState.mPackagesReceived) + " packages");
     logInfo(loggingPrefix + " returned");
     return monitorState.mShouldStop;
 }
 
-int TwosixWhiteboardLink::getIndexFromTimestamp(double secondsSinceEpoch) {
+int TwosixWhiteboardLink::getIndexFromTimestamp(CurlWrap &curl, double secondsSinceEpoch) {
     const std::string loggingPrefix = "TwosixWhiteboardLink::getIndexFromTimestamp (" + mId + "): ";
 
     std::string postUrl = "http://" + mHostname + ":" + std::to_string(mPort) + "/after/" + mTag +
@@ -408,11 +472,12 @@ int TwosixWhiteboardLink::getIndexFromTimestamp(double secondsSinceEpoch) {
     // return 0 if error
     int index = 0;
     try {
-        CurlWrap curl;
         std::string response;
 
         logDebug(loggingPrefix + "Attempting to get post by timestamp from: " + postUrl);
 
+        curl.setopt(CURLOPT_HTTPGET, 1L);
+        curl.setopt(CURLOPT_TIMEOUT, 0L);
         curl.setopt(CURLOPT_URL, postUrl.c_str());
         curl.setopt(CURLOPT_WRITEFUNCTION, WriteCallback);
         curl.setopt(CURLOPT_WRITEDATA, &response);
@@ -432,17 +497,25 @@ int TwosixWhiteboardLink::getIndexFromTimestamp(double secondsSinceEpoch) {
     return index;
 }
 
-std::tuple<std::vector<std::string>, int, double> TwosixWhiteboardLink::getNewPosts(int oldest) {
+std::tuple<std::vector<std::string>, int, double> TwosixWhiteboardLink::getNewPosts(
+    CurlWrap &curl, int oldest, int waitTimeout) {
     // get all posts after (and including) oldest
-    std::string postUrl = "http://" + mHostname + ":" + std::to_string(mPort) + "/get/" + mTag +
-                          "/" + std::to_string(oldest) + "/-1";
+    std::string postUrl = "http://" + mHostname + ":" + std::to_string(mPort);
+    if (waitTimeout > 0) {
+        postUrl += "/wait/" + mTag + "/" + std::to_string(oldest) +
+                   "?timeout=" + std::to_string(waitTimeout);
+    } else {
+        postUrl += "/get/" + mTag + "/" + std::to_string(oldest) + "/-1";
+    }
 
-    CurlWrap curl;
     std::string response;
 
     // logDebug("TwosixWhiteboardLink::getNewPosts (" + mId + "): Attempting to get posts from: " +
     // postUrl);
 
+    curl.setopt(CURLOPT_HTTPGET, 1L);
+    // allow for the whiteboard waiting, but not indefinitely in case the connection is lost
+    curl.setopt(CURLOPT_TIMEOUT, waitTimeout > 0 ? static_cast<long>(waitTimeout) + 10 : 0L);
     curl.setopt(CURLOPT_URL, postUrl.c_str());
     curl.setopt(CURLOPT_WRITEFUNCTION, WriteCallback);
     curl.setopt(CURLOPT_WRITEDATA, &response);
@@ -450,7 +523,15 @@ std::tuple<std::vector<std::string>, int, double> TwosixWhiteboardLink::getNewPo
 
     auto responseJson = json::parse(response);
 
-    return {responseJson.at("data"), responseJson.at("length"),
+    // move the posts out of the parsed json rather than copying them
+    std::vector<std::string> posts;
+    auto &data = responseJson.at("data");
+    posts.reserve(data.size());
+    for (auto &post : data) {
+        posts.push_back(std::move(post.get_ref<std::string &>()));
+    }
+
+    return {std::move(posts), responseJson.at("length"),
             std::stod(responseJson.at("timestamp").get<std::string>())};
 }
 
@@ -466,5 +547,6 @@ std::string TwosixWhiteboardLink::getLinkAddress() {
     address["hashtag"] = mTag;
     address["timestamp"] = mLinkTimestamp;
     address["maxTries"] = maxTries;
+    address["longPollTimeout"] = mLongPollTimeout;
     return address.dump();
 }
@@ -20,6 +20,7 @@
 
 #include <atomic>  // std::atomic
 #include <deque>   // std::deque
+#include <memory>  // std::unique_ptr
 #include <mutex>   // std::mutex, std::lock_guard
 #include <thread>  // std::thread
 #include <tuple>   // std::vector
@@ -29,6 +30,8 @@
 #include "../base/Link.h"
 #include "TwosixWhiteboardLinkProfileParser.h"
 
+class CurlWrap;
+
 class TwosixWhiteboardLink : public Link {
 protected:
     struct MonitorState {
@@ -44,6 +47,11 @@ protected:
         // The timestamp to start reading from
         double mTimestamp;
 
+        // The number of requests made to the whiteboard for posts, and the number of packages
+        // received from them
+        std::uint64_t mRequests;
+        std::uint64_t mPackagesReceived;
+
         MonitorState(TwosixWhiteboardLink *link, double timestamp);
     };
 
@@ -69,21 +77,27 @@ protected:
      * @brief get the index of the first post after timestamp, or the next post if there are no
      * posts after timestamp
      *
+     * @param curl The handle to make the request with
      * @param double secondsSinceEpoch The timestamp in seconds. May be fractional
      * @return int The index of the first post to the whiteboard after timestamp
      *
      */
-    int getIndexFromTimestamp(double secondsSinceEpoch);
+    int getIndexFromTimestamp(CurlWrap &curl, double secondsSinceEpoch);
 
     /**
      * @brief Get any posts after index oldest
      *
+     * @param curl The handle to make the request with. Reusing a handle keeps the connection to
+     * the whiteboard open between requests.
      * @param oldest The index of the oldest post to fetch
+     * @param waitTimeout If greater than zero, the most seconds the whiteboard should wait for a
+     * post when there are none after oldest. Otherwise, it responds immediately.
      * @return tuple containing the list of posts, the total number of posts since oldest, and the
      * server timestamp. The length of the list may not equal the number of posts since oldest in
      * the case that the whiteboard has dropped posts in order to prevent itself from filling up
      */
-    std::tuple<std::vector<std::string>, int, double> getNewPosts(int oldest);
+    std::tuple<std::vector<std::string>, int, double> getNewPosts(CurlWrap &curl, int oldest,
+                                                                  int waitTimeout);
 
     /**
      * @brief Prepend a string that uniquely identifies this link. This identifier is not based on
@@ -110,6 +124,10 @@ protected:
     // posts
     std::atomic<int> mCheckPeriod;
 
+    // The most seconds to wait for new posts in each request to the whiteboard, or 0 to poll every
+    // check period instead
+    const int mLongPollTimeout;
+
     // The start timestamp for which to check for messages (can be overridden for specific
     // connections with link hints)
     const double mLinkTimestamp;
@@ -124,6 +142,9 @@ protected:
     std::deque<std::size_t> mOwnPostHashes;
     std::mutex hashMutex;
 
+    // The handle used to post to the whiteboard. Only used on the send thread.
+    std::unique_ptr<CurlWrap> mSendCurl;
+
     /**
      * @brief Send a package using this link.
      *
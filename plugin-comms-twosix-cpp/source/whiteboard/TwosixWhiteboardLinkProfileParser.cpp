@@ -61,6 +61,9 @@ TwosixWhiteboardLinkProfileParser::TwosixWhiteboardLinkProfileParser(
         logDebug("TwosixWhiteboardLinkProfileParser: maxTries: " + std::to_string(maxTries));
 
         timestamp = linkProfileJson.value("timestamp", -1.0);
+
+        // seconds to wait for new posts in each request. 0 polls every checkFrequency ms instead
+        longPollTimeout = linkProfileJson.value("longPollTimeout", 0);
     } catch (std::exception &error) {
         logError("TwosixWhiteboardLinkProfileParser: failed to parse link profile: " +
                  std::string(error.what()));
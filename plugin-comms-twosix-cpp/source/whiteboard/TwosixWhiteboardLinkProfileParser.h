@@ -33,6 +33,7 @@ public:
     std::string hashtag;
     int maxTries;
     double timestamp;
+    int longPollTimeout;
 
 public:
     // default constructor for testing
@@ -0,0 +1,108 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "../../source/direct/DirectFraming.h"
+
+#include "gtest/gtest.h"
+
+static RawData frame(const RawData &payload) {
+    auto header = DirectFraming::encodeHeader(static_cast<uint32_t>(payload.size()));
+    RawData result(header.begin(), header.end());
+    result.insert(result.end(), payload.begin(), payload.end());
+    return result;
+}
+
+TEST(DirectFraming, header_round_trip) {
+    for (uint32_t length : {0u, 1u, 255u, 256u, 65536u, 0x01020304u}) {
+        auto header = DirectFraming::encodeHeader(length);
+        EXPECT_EQ(DirectFraming::decodeHeader(header.data()), length);
+    }
+}
+
+TEST(DirectFraming, header_is_big_endian) {
+    auto header = DirectFraming::encodeHeader(0x01020304u);
+    EXPECT_EQ(header[0], 0x01);
+    EXPECT_EQ(header[1], 0x02);
+    EXPECT_EQ(header[2], 0x03);
+    EXPECT_EQ(header[3], 0x04);
+}
+
+TEST(DirectFrameDecoder, returns_nothing_when_empty) {
+    DirectFrameDecoder decoder;
+    RawData result;
+    EXPECT_FALSE(decoder.nextFrame(result));
+    EXPECT_EQ(decoder.bufferedBytes(), 0u);
+}
+
+TEST(DirectFrameDecoder, decodes_multiple_frames_from_one_append) {
+    RawData stream = frame({1, 2, 3});
+    RawData second = frame({4, 5});
+    stream.insert(stream.end(), second.begin(), second.end());
+
+    DirectFrameDecoder decoder;
+    decoder.append(stream.data(), stream.size());
+
+    RawData result;
+    ASSERT_TRUE(decoder.nextFrame(result));
+    EXPECT_EQ(result, RawData({1, 2, 3}));
+    ASSERT_TRUE(decoder.nextFrame(result));
+    EXPECT_EQ(result, RawData({4, 5}));
+    EXPECT_FALSE(decoder.nextFrame(result));
+    EXPECT_EQ(decoder.bufferedBytes(), 0u);
+}
+
+// Bytes may arrive one at a time, splitting both the header and the payload
+TEST(DirectFrameDecoder, decodes_frame_split_across_appends) {
+    RawData payload(1000);
+    for (size_t i = 0; i < payload.size(); ++i) {
+        payload[i] = static_cast<uint8_t>(i);
+    }
+    RawData stream = frame(payload);
+    stream.insert(stream.end(), stream.begin(), stream.end());
+
+    DirectFrameDecoder decoder;
+    RawData result;
+    int framesDecoded = 0;
+    for (uint8_t byte : stream) {
+        decoder.append(&byte, 1);
+        while (decoder.nextFrame(result)) {
+            EXPECT_EQ(result, payload);
+            ++framesDecoded;
+        }
+    }
+    EXPECT_EQ(framesDecoded, 2);
+    EXPECT_EQ(decoder.bufferedBytes(), 0u);
+}
+
+TEST(DirectFrameDecoder, decodes_empty_frame) {
+    RawData stream = frame({});
+    DirectFrameDecoder decoder;
+    decoder.append(stream.data(), stream.size());
+
+    RawData result = {1};
+    ASSERT_TRUE(decoder.nextFrame(result));
+    EXPECT_TRUE(result.empty());
+}
+
+TEST(DirectFrameDecoder, throws_on_oversized_frame) {
+    auto header = DirectFraming::encodeHeader(DirectFraming::MAX_FRAME_LENGTH + 1);
+    DirectFrameDecoder decoder;
+    decoder.append(header.data(), header.size());
+
+    RawData result;
+    EXPECT_THROW(decoder.nextFrame(result), std::length_error);
+}
@@ -0,0 +1,150 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "../../source/direct/DirectReactor.h"
+
+#include <arpa/inet.h>   // htonl, htons
+#include <netinet/in.h>  // sockaddr_in
+#include <sys/socket.h>
+#include <unistd.h>  // close
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "../../source/direct/DirectConnectionPool.h"
+#include "gtest/gtest.h"
+
+class DirectReactorTest : public ::testing::Test {
+public:
+    DirectReactorTest() :
+        reactor([this](const LinkID &linkId, RawData &&data) {
+            std::lock_guard<std::mutex> lock(mutex);
+            received[linkId].push_back(std::move(data));
+            cv.notify_all();
+        }) {}
+
+    bool waitForPackages(const LinkID &linkId, size_t count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_for(lock, std::chrono::seconds(10),
+                           [&] { return received[linkId].size() >= count; });
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::unordered_map<LinkID, std::vector<RawData>> received;
+    DirectReactor reactor;
+    DirectConnectionPool pool;
+};
+
+// Packages sent over a pooled connection are delivered in order
+TEST_F(DirectReactorTest, receives_packages_in_order) {
+    const int port = 29101;
+    ASSERT_TRUE(reactor.addListener("LinkID0", port));
+    EXPECT_TRUE(reactor.hasListener("LinkID0"));
+
+    const size_t numPackages = 100;
+    for (size_t i = 0; i < numPackages; ++i) {
+        RawData payload(i * 100, static_cast<uint8_t>(i));
+        ASSERT_TRUE(pool.send("localhost", port, {payload}, "test: "));
+    }
+
+    ASSERT_TRUE(waitForPackages("LinkID0", numPackages));
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < numPackages; ++i) {
+        EXPECT_EQ(received["LinkID0"][i], RawData(i * 100, static_cast<uint8_t>(i)));
+    }
+}
+
+// Packages are attributed to the link whose port they were received on
+TEST_F(DirectReactorTest, multiple_listeners) {
+    reactor.setNumWorkers(3);
+    ASSERT_TRUE(reactor.addListener("LinkID0", 29102));
+    ASSERT_TRUE(reactor.addListener("LinkID1", 29103));
+
+    ASSERT_TRUE(pool.send("localhost", 29102, {RawData{0}}, "test: "));
+    ASSERT_TRUE(pool.send("localhost", 29103, {RawData{1}}, "test: "));
+    ASSERT_TRUE(pool.send("localhost", 29103, {RawData{2}}, "test: "));
+
+    ASSERT_TRUE(waitForPackages("LinkID0", 1));
+    ASSERT_TRUE(waitForPackages("LinkID1", 2));
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_EQ(received["LinkID0"], std::vector<RawData>({{0}}));
+    EXPECT_EQ(received["LinkID1"], std::vector<RawData>({{1}, {2}}));
+}
+
+// Removing a listener closes accepted connections, and the pool reconnects once the link listens
+// again
+TEST_F(DirectReactorTest, remove_listener_and_reconnect) {
+    const int port = 29104;
+    ASSERT_TRUE(reactor.addListener("LinkID0", port));
+    ASSERT_TRUE(pool.send("localhost", port, {RawData{0}}, "test: "));
+    ASSERT_TRUE(waitForPackages("LinkID0", 1));
+
+    reactor.removeListener("LinkID0");
+    EXPECT_FALSE(reactor.hasListener("LinkID0"));
+
+    ASSERT_TRUE(reactor.addListener("LinkID0", port));
+    ASSERT_TRUE(pool.send("localhost", port, {RawData{1}}, "test: "));
+    ASSERT_TRUE(waitForPackages("LinkID0", 2));
+}
+
+TEST_F(DirectReactorTest, stop_is_idempotent) {
+    ASSERT_TRUE(reactor.addListener("LinkID0", 29105));
+    reactor.stop();
+    reactor.stop();
+    EXPECT_FALSE(reactor.hasListener("LinkID0"));
+}
+
+// The pooled connection stays open until every link to the destination has released its lease
+TEST(DirectConnectionPoolTest, release_closes_only_after_last_lease) {
+    const int port = 29106;
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_GE(listener, 0);
+    int opt = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    ASSERT_EQ(bind(listener, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)), 0);
+    ASSERT_EQ(listen(listener, 1), 0);
+
+    DirectConnectionPool pool;
+    pool.acquire("localhost", port);
+    pool.acquire("localhost", port);
+    ASSERT_TRUE(pool.send("localhost", port, {RawData{0}}, "test: "));
+
+    int accepted = accept(listener, nullptr, nullptr);
+    ASSERT_GE(accepted, 0);
+    struct timeval timeout = {5, 0};
+    setsockopt(accepted, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // drain the frame that was sent
+    uint8_t buffer[64];
+    ASSERT_GT(recv(accepted, buffer, sizeof(buffer), 0), 0);
+
+    pool.release("localhost", port);
+    EXPECT_EQ(recv(accepted, buffer, sizeof(buffer), MSG_DONTWAIT), -1);
+    EXPECT_TRUE(errno == EAGAIN || errno == EWOULDBLOCK);
+
+    pool.release("localhost", port);
+    EXPECT_EQ(recv(accepted, buffer, sizeof(buffer), 0), 0);
+
+    close(accepted);
+    close(listener);
+}
@@ -21,6 +21,7 @@
 
 #include <future>
 #include <memory>
+#include <thread>
 
 #include "MockChannel.h"
 #include "MockLink.h"
@@ -242,6 +243,89 @@ TEST(Link, sendPackage_link_calls_package_timeout_on_send_amount_sleep) {
     promise2.get_future().wait();
 }
 
+TEST(Link, sendPackage_timeout_removes_only_that_package) {
+    LinkProperties linkProperties;
+
+    linkProperties.linkType = LT_SEND;
+
+    MockRaceSdkComms sdk;
+    MockPluginComms plugin(sdk);
+    MockChannel channel(plugin);
+    LinkProfileParser parser;
+    parser.send_period_length = 0;
+    parser.send_period_amount = 1;
+    parser.sleep_period_length = 10;
+    TestLink testLink(&sdk, &plugin, &channel, {}, linkProperties, parser);
+
+    std::promise<void> promise;
+    std::promise<void> promise2;
+
+    EncPkg pkg(0, 0, {0, 1, 2, 3});
+    EXPECT_CALL(sdk, onPackageStatusChanged(3, PACKAGE_FAILED_TIMEOUT, _))
+        .Times(1)
+        .WillOnce([&promise2](RaceHandle, PackageStatus, int32_t) {
+            promise2.set_value();
+            return SDK_OK;
+        });
+    // the packages queued around the one that timed out are failed when the link shuts down
+    EXPECT_CALL(sdk, onPackageStatusChanged(2, PACKAGE_FAILED_GENERIC, 0)).Times(1);
+    EXPECT_CALL(sdk, onPackageStatusChanged(4, PACKAGE_FAILED_GENERIC, 0)).Times(1);
+    EXPECT_CALL(testLink, sendPackageInternal(1, _))
+        .Times(1)
+        .WillOnce([&promise](RaceHandle, const EncPkg &) {
+            promise.set_value();
+            return true;
+        });
+    testLink.sendPackage(1, pkg, std::numeric_limits<double>::infinity());
+    testLink.sendPackage(2, pkg, std::numeric_limits<double>::infinity());
+    testLink.sendPackage(3, pkg, 0);
+    testLink.sendPackage(4, pkg, std::numeric_limits<double>::infinity());
+    promise.get_future().wait();
+    promise2.get_future().wait();
+
+    EXPECT_EQ(testLink.getSendQueueSize(), 2);
+}
+
+TEST(Link, sendPackage_timeout_is_reported_off_the_timer_wheel) {
+    LinkProperties linkProperties;
+
+    linkProperties.linkType = LT_SEND;
+
+    MockRaceSdkComms sdk;
+    MockPluginComms plugin(sdk);
+    MockChannel channel(plugin);
+    LinkProfileParser parser;
+    parser.send_period_length = 0;
+    parser.send_period_amount = 1;
+    parser.sleep_period_length = 10;
+    TestLink testLink(&sdk, &plugin, &channel, {}, linkProperties, parser);
+
+    std::promise<void> promise;
+    std::promise<std::thread::id> timeoutThread;
+    std::promise<std::thread::id> wheelThread;
+
+    EncPkg pkg(0, 0, {0, 1, 2, 3});
+    EXPECT_CALL(sdk, onPackageStatusChanged(2, PACKAGE_FAILED_TIMEOUT, _))
+        .Times(1)
+        .WillOnce([&timeoutThread](RaceHandle, PackageStatus, int32_t) {
+            timeoutThread.set_value(std::this_thread::get_id());
+            return SDK_OK;
+        });
+    EXPECT_CALL(testLink, sendPackageInternal(1, _))
+        .Times(1)
+        .WillOnce([&promise](RaceHandle, const EncPkg &) {
+            promise.set_value();
+            return true;
+        });
+    testLink.sendPackage(1, pkg, std::numeric_limits<double>::infinity());
+    testLink.sendPackage(2, pkg, 0);
+    promise.get_future().wait();
+    TimerWheel::shared().schedule(
+        0, [&wheelThread] { wheelThread.set_value(std::this_thread::get_id()); });
+
+    EXPECT_NE(timeoutThread.get_future().get(), wheelThread.get_future().get());
+}
+
 TEST(Link, sendPackage_link_sleeps_after_time) {
     LinkProperties linkProperties;
 
@@ -195,6 +195,39 @@ TEST(LinkProfileParser, parse_twosix_whiteboard_fix_tag_success) {
     ASSERT_NE(dynamic_cast<TwosixWhiteboardLink *>(link.get()), nullptr);
 }
 
+TEST(LinkProfileParser, parse_twosix_whiteboard_long_poll_success) {
+    const std::string linkProfile = R"({
+        "multicast": true,
+        "service_name": "twosix-whiteboard",
+        "hostname": "test-host",
+        "port": 1234,
+        "hashtag": "tag",
+        "longPollTimeout": 20
+    })";
+
+    LinkConfig linkConfig;
+    linkConfig.linkProfile = linkProfile;
+    linkConfig.linkProps.linkType = LT_RECV;
+    linkConfig.linkProps.transmissionType = TT_MULTICAST;
+    linkConfig.linkProps.connectionType = CT_INDIRECT;
+
+    auto linkParser = LinkProfileParser::parse(linkProfile);
+    ASSERT_NE(linkParser, nullptr);
+    auto linkParser2 = dynamic_cast<TwosixWhiteboardLinkProfileParser *>(linkParser.get());
+    ASSERT_NE(linkParser2, nullptr);
+    EXPECT_EQ(linkParser2->longPollTimeout, 20);
+
+    MockRaceSdkComms sdk;
+    MockPluginComms plugin(sdk);
+    MockChannel channel(plugin);
+    auto link = linkParser->createLink(&sdk, &plugin, &channel, linkConfig, "testChannelGid");
+    ASSERT_NE(dynamic_cast<TwosixWhiteboardLink *>(link.get()), nullptr);
+
+    // the link address includes the timeout, so links created from it also long poll
+    auto linkAddress = nlohmann::json::parse(link->getLinkAddress());
+    EXPECT_EQ(linkAddress.at("longPollTimeout"), 20);
+}
+
 TEST(LinkProfileParser, parse_twosix_whiteboard_missing_optional_success) {
     const std::string linkProfile = R"({
         "multicast": true,
@@ -218,6 +251,7 @@ TEST(LinkProfileParser, parse_twosix_whiteboard_missing_optional_success) {
     EXPECT_EQ(linkParser2->port, 12345);
     EXPECT_EQ(linkParser2->hashtag, "tag2");
     EXPECT_EQ(linkParser2->checkFrequency, 1000);
+    EXPECT_EQ(linkParser2->longPollTimeout, 0);
 
     MockRaceSdkComms sdk;
     MockPluginComms plugin(sdk);
@@ -143,7 +143,7 @@ void Link::shutdown() {
 
 void Link::runActionThread() {
     TRACE_METHOD(linkId);
-    logPrefix += linkId + ": ";
+    const std::string prefix = logPrefix + linkId + ": ";
 
     int latest = getInitialIndex();
 
@@ -152,7 +152,7 @@ void Link::runActionThread() {
         conditionVariable.wait(lock, [this] { return isShutdown or not actionQueue.empty(); });
 
         if (isShutdown) {
-            logDebug(logPrefix + "shutting down");
+            logDebug(prefix + "shutting down");
             break;
         }
 
@@ -169,20 +169,20 @@ void Link::runActionThread() {
 
 int Link::getInitialIndex() {
     TRACE_METHOD(linkId);
-    logPrefix += linkId + ": ";
+    const std::string prefix = logPrefix + linkId + ": ";
 
     // TODO check link hints for timestamp
     double timestamp = psh::readValue(sdk, prependIdentifier("lastTimestamp"), -1.0);
     if (timestamp > 0) {
-        logDebug(logPrefix + "using last recorded timestamp: " + std::to_string(timestamp));
+        logDebug(prefix + "using last recorded timestamp: " + std::to_string(timestamp));
     } else if (address.timestamp <= 0) {
         std::chrono::duration<double> sinceEpoch =
             std::chrono::high_resolution_clock::now().time_since_epoch();
         timestamp = sinceEpoch.count();
-        logDebug(logPrefix + "using now for timestamp: " + std::to_string(timestamp));
+        logDebug(prefix + "using now for timestamp: " + std::to_string(timestamp));
     } else {
         timestamp = address.timestamp;
-        logDebug(logPrefix + "using address timestamp: " + std::to_string(timestamp));
+        logDebug(prefix + "using address timestamp: " + std::to_string(timestamp));
     }
 
     return getIndexFromTimestamp(timestamp);
@@ -190,14 +190,14 @@ int Link::getInitialIndex() {
 
 int Link::fetchOnActionThread(int latestIndex) {
     TRACE_METHOD(linkId, latestIndex);
-    logPrefix += linkId + ": ";
+    const std::string prefix = logPrefix + linkId + ": ";
 
     try {
         auto [posts, newLatestIndex, serverTimestamp] = getNewPosts(latestIndex);
 
         int numPosts = static_cast<int>(posts.size());
         if (numPosts < newLatestIndex - latestIndex) {
-            logError(logPrefix + "expected " + std::to_string(newLatestIndex - latestIndex) +
+            logError(prefix + "expected " + std::to_string(newLatestIndex - latestIndex) +
                      " posts, but only got " + std::to_string(numPosts) + ". " +
                      std::to_string(newLatestIndex - latestIndex - numPosts) +
                      " posts may have been lost.");
@@ -205,9 +205,9 @@ int Link::fetchOnActionThread(int latestIndex) {
 
         for (const auto &post : posts) {
             if (postedMessageHashes.findAndRemoveMessage(post)) {
-                logDebug(logPrefix + "received post from self, ignoring");
+                logDebug(prefix + "received post from self, ignoring");
             } else {
-                logDebug(logPrefix + "received encrypted package");
+                logDebug(prefix + "received encrypted package");
                 std::vector<uint8_t> message = base64::decode(post);
                 sdk->onReceive(linkId, {linkId, "*/*", false, {}}, message);
             }
@@ -221,16 +221,16 @@ int Link::fetchOnActionThread(int latestIndex) {
 
         return newLatestIndex;
     } catch (curl_exception &error) {
-        logError(logPrefix + "curl exception: " + std::string(error.what()));
+        logError(prefix + "curl exception: " + std::string(error.what()));
     } catch (nlohmann::json::exception &error) {
-        logError(logPrefix + "json exception: " + std::string(error.what()));
+        logError(prefix + "json exception: " + std::string(error.what()));
     } catch (std::exception &error) {
-        logError(logPrefix + "std exception: " + std::string(error.what()));
+        logError(prefix + "std exception: " + std::string(error.what()));
     }
 
     ++fetchAttempts;
     if (fetchAttempts >= address.maxTries) {
-        logError(logPrefix + "Retry limit reached. Giving up.");
+        logError(prefix + "Retry limit reached. Giving up.");
         sdk->updateState(COMPONENT_STATE_FAILED);
     }
 
@@ -249,7 +249,7 @@ static size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *use
 
 int Link::getIndexFromTimestamp(double secondsSinceEpoch) {
     TRACE_METHOD(linkId, secondsSinceEpoch);
-    logPrefix += linkId + ": ";
+    const std::string prefix = logPrefix + linkId + ": ";
 
     std::string url = "http://" + address.hostname + ":" + std::to_string(address.port) +
                       "/after/" + address.hashtag + "/" + std::to_string(secondsSinceEpoch);
@@ -260,7 +260,7 @@ int Link::getIndexFromTimestamp(double secondsSinceEpoch) {
         CurlWrap curl;
         std::string response;
 
-        logDebug(logPrefix + "Attempting to get post by timestamp from: " + url);
+        logDebug(prefix + "Attempting to get post by timestamp from: " + url);
 
         curl.setopt(CURLOPT_URL, url.c_str());
         curl.setopt(CURLOPT_WRITEFUNCTION, WriteCallback);
@@ -268,14 +268,14 @@ int Link::getIndexFromTimestamp(double secondsSinceEpoch) {
         curl.perform();
 
         index = nlohmann::json::parse(response).at("index").get<int>();
-        logDebug(logPrefix + "Got index: " + std::to_string(index));
+        logDebug(prefix + "Got index: " + std::to_string(index));
 
     } catch (curl_exception &error) {
-        logError(logPrefix + "curl exception: " + std::string(error.what()));
+        logError(prefix + "curl exception: " + std::string(error.what()));
     } catch (nlohmann::json::exception &error) {
-        logError(logPrefix + "json exception: " + std::string(error.what()));
+        logError(prefix + "json exception: " + std::string(error.what()));
     } catch (std::exception &error) {
-        logError(logPrefix + "std exception: " + std::string(error.what()));
+        logError(prefix + "std exception: " + std::string(error.what()));
     }
 
     return index;
@@ -283,7 +283,6 @@ int Link::getIndexFromTimestamp(double secondsSinceEpoch) {
 
 std::tuple<std::vector<std::string>, int, double> Link::getNewPosts(int latestIndex) {
     TRACE_METHOD(linkId, latestIndex);
-    logPrefix += linkId + ": ";
 
     // Get all posts after (and including) oldest
     std::string url = "http://" + address.hostname + ":" + std::to_string(address.port) + "/get/" +
@@ -305,13 +304,13 @@ std::tuple<std::vector<std::string>, int, double> Link::getNewPosts(int latestIn
 
 void Link::postOnActionThread(const std::vector<RaceHandle> &handles, uint64_t actionId) {
     TRACE_METHOD(linkId, handles, actionId);
-    logPrefix += linkId + ": ";
+    const std::string prefix = logPrefix + linkId + ": ";
 
     auto iter = contentQueue.find(actionId);
     if (iter == contentQueue.end()) {
         // We really shouldn't get here, since we already check for this before queueing the action,
         // but just in case...
-        logError(logPrefix +
+        logError(prefix +
                  "no enqueued content for given action ID: " + std::to_string(actionId));
         updatePackageStatus(handles, PACKAGE_FAILED_GENERIC);
         return;
@@ -328,7 +327,7 @@ void Link::postOnActionThread(const std::vector<RaceHandle> &handles, uint64_t a
     }
 
     if (tries == address.maxTries) {
-        logError(logPrefix + "retry limit exceeded: post failed");
+        logError(prefix + "retry limit exceeded: post failed");
         postedMessageHashes.removeHash(msgHash);
         updatePackageStatus(handles, PACKAGE_FAILED_GENERIC);
     } else {
@@ -344,7 +343,7 @@ void Link::updatePackageStatus(const std::vector<RaceHandle> &handles, PackageSt
 
 bool Link::postToWhiteboard(const std::string &message) {
     TRACE_METHOD(linkId);
-    logPrefix += linkId + ": ";
+    const std::string prefix = logPrefix + linkId + ": ";
     bool success = false;
 
     std::string url = "http://" + address.hostname + ":" + std::to_string(address.port) + "/post/" +
@@ -364,7 +363,7 @@ bool Link::postToWhiteboard(const std::string &message) {
         CurlWrap curl;
         std::string response;
 
-        logDebug(logPrefix + "Attempting to post to: " + url);
+        logDebug(prefix + "Attempting to post to: " + url);
 
         curl.setopt(CURLOPT_URL, url.c_str());
         curl.setopt(CURLOPT_HTTPPOST, 1L);
@@ -381,13 +380,13 @@ bool Link::postToWhiteboard(const std::string &message) {
         curl.perform();
 
         if (response.find("index") != std::string::npos) {
-            logDebug(logPrefix + "Post successful: " + response);
+            logDebug(prefix + "Post successful: " + response);
             success = true;
         } else {
-            logWarning(logPrefix + "Unknown reponse: " + response);
+            logWarning(prefix + "Unknown reponse: " + response);
         }
     } catch (curl_exception &error) {
-        logWarning(logPrefix + "curl exception: " + std::string(error.what()));
+        logWarning(prefix + "curl exception: " + std::string(error.what()));
     }
 
     curl_slist_free_all(headers);
@@ -610,7 +610,7 @@ RaceHandle BootstrapManager::sendBootstrapMsg(const BootstrapMessage &bMsg,
                                               const std::string &destination) {
     TRACE_METHOD();
     ExtClrMsg msg = createClrMsg(bMsg, destination);
-    std::string msgString = plugin->getEncryptor().formatDelimitedMessage(msg);
+    std::string msgString = plugin->formatMessage(msg);
     return plugin->sendFormattedMsg(destination, msgString, msg.getTraceId(), msg.getSpanId());
 }
 
@@ -619,7 +619,7 @@ void BootstrapManager::sendBootstrapPkg(const BootstrapMessage &bMsg,
                                         const ConnectionID &connId) {
     TRACE_METHOD();
     ExtClrMsg msg = createClrMsg(bMsg, destination);
-    std::string msgString = plugin->getEncryptor().formatDelimitedMessage(msg);
+    std::string msgString = plugin->formatMessage(msg);
     plugin->sendBootstrapPkg(connId, destination, msgString);
 }
 
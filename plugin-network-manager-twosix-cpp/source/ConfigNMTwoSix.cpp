@@ -37,6 +37,10 @@ void base_to_json(json &destJson, const ConfigNMTwoSixBase &srcConfig) {
         {"useLinkWizard", srcConfig.useLinkWizard},
         {"lookbackSeconds", srcConfig.lookbackSeconds},
         {"otherConnections", srcConfig.otherConnections},
+        {"maxResendBytes", srcConfig.maxResendBytes},
+        {"maxResendAgeSeconds", srcConfig.maxResendAgeSeconds},
+        {"adaptiveLinkSelection", srcConfig.adaptiveLinkSelection},
+        {"splitTraffic", srcConfig.splitTraffic},
     };
 
     if (srcConfig.bootstrapHandle != 0u && !srcConfig.bootstrapIntroducer.empty()) {
@@ -54,6 +58,12 @@ void base_from_json(const json &srcJson, ConfigNMTwoSixBase &destConfig) {
         srcJson.value("bootstrapIntroducer", destConfig.bootstrapIntroducer);
     destConfig.lookbackSeconds = srcJson.value("lookbackSeconds", destConfig.lookbackSeconds);
     destConfig.otherConnections = srcJson.value("otherConnections", destConfig.otherConnections);
+    destConfig.maxResendBytes = srcJson.value("maxResendBytes", destConfig.maxResendBytes);
+    destConfig.maxResendAgeSeconds =
+        srcJson.value("maxResendAgeSeconds", destConfig.maxResendAgeSeconds);
+    destConfig.adaptiveLinkSelection =
+        srcJson.value("adaptiveLinkSelection", destConfig.adaptiveLinkSelection);
+    destConfig.splitTraffic = srcJson.value("splitTraffic", destConfig.splitTraffic);
 }
 
 // Client config
@@ -125,6 +135,9 @@ void to_json(json &destJson, const ConfigNMTwoSixServer &srcConfig) {
         {"maxFloodedUuids", srcConfig.maxFloodedUuids},
         {"floodingFactor", srcConfig.floodingFactor},
         {"rings", srcConfig.rings},
+        {"ringStrategy", srcConfig.ringStrategy},
+        {"erasureDataRings", srcConfig.erasureDataRings},
+        {"erasureMinBytes", srcConfig.erasureMinBytes},
     });
 }
 
@@ -139,6 +152,9 @@ void from_json(const json &srcJson, ConfigNMTwoSixServer &destConfig) {
     destConfig.maxFloodedUuids = srcJson.value("maxFloodedUuids", destConfig.maxFloodedUuids);
     destConfig.floodingFactor = srcJson.value("floodingFactor", destConfig.floodingFactor);
     destConfig.rings = srcJson.value("rings", destConfig.rings);
+    destConfig.ringStrategy = srcJson.value("ringStrategy", destConfig.ringStrategy);
+    destConfig.erasureDataRings = srcJson.value("erasureDataRings", destConfig.erasureDataRings);
+    destConfig.erasureMinBytes = srcJson.value("erasureMinBytes", destConfig.erasureMinBytes);
 }
 
 bool loadServerConfig(IRaceSdkNM &sdk, ConfigNMTwoSixServer &destConfig) {
@@ -38,6 +38,10 @@ struct ConfigNMTwoSixBase {
     std::string bootstrapIntroducer;
     double lookbackSeconds{60.0};
     PersonaSet otherConnections;
+    size_t maxResendBytes{16 * 1024 * 1024};
+    double maxResendAgeSeconds{600.0};
+    bool adaptiveLinkSelection{false};
+    bool splitTraffic{false};
 };
 
 /** Expected multicast link configuration */
@@ -103,6 +107,13 @@ struct ConfigNMTwoSixServer : public ConfigNMTwoSixBase {
     size_t maxFloodedUuids{1000000};
     size_t floodingFactor{2};
     RingVector rings;
+    // How a message is spread across rings: "redundant", "failover" or "erasure"
+    std::string ringStrategy{"redundant"};
+    // Number of rings whose fragments are needed to rebuild an erasure coded message. 0 means one
+    // fewer than the number of rings.
+    size_t erasureDataRings{0};
+    // Smaller messages are sent redundantly even with the erasure strategy
+    size_t erasureMinBytes{1024};
 };
 
 // Enable automatic conversion to/from json
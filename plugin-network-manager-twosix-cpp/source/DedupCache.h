@@ -0,0 +1,206 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef __NETWORK_MANAGER_TWOSIX_DEDUP_CACHE_H__
+#define __NETWORK_MANAGER_TWOSIX_DEDUP_CACHE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @brief Fixed-capacity set of the most recently inserted values, used to drop duplicate
+ * messages.
+ *
+ * Values are kept in a ring buffer in insertion order and indexed by an open-addressing (linear
+ * probing) hash table of ring positions. Inserting into a full cache evicts the oldest value.
+ * Insert, evict and lookup are all O(1) expected, and memory is bounded by the capacity: at most
+ * capacity values plus a table of 4-byte slots no larger than four times the capacity. Storage
+ * grows as values are inserted, so a large capacity costs nothing until it is used.
+ *
+ * This class is not thread-safe.
+ *
+ * @tparam T The value type
+ * @tparam Hash Hash function for T
+ */
+template <typename T, typename Hash = std::hash<T>>
+class DedupCache {
+public:
+    /**
+     * @brief Construct a cache holding at most capacity values
+     *
+     * @param capacity The maximum number of values to remember. A capacity of 0 remembers nothing.
+     */
+    explicit DedupCache(size_t capacity = 0) {
+        reset(capacity);
+    }
+
+    /**
+     * @brief Remove all values and change the capacity
+     *
+     * @param capacity The maximum number of values to remember
+     */
+    void reset(size_t capacity) {
+        if (capacity >= std::numeric_limits<std::uint32_t>::max() / 4) {
+            throw std::length_error("DedupCache capacity too large");
+        }
+        maxSize = capacity;
+        ring.clear();
+        ring.shrink_to_fit();
+        oldest = 0;
+        table.assign(MIN_TABLE_SIZE, EMPTY);
+        mask = MIN_TABLE_SIZE - 1;
+    }
+
+    /**
+     * @brief Check whether a value is in the cache
+     *
+     * @param value The value to look for
+     * @return true if the value was inserted and has not been evicted
+     */
+    bool contains(const T &value) const {
+        return find(value) != NOT_FOUND;
+    }
+
+    /**
+     * @brief Insert a value, evicting the oldest value if the cache is full
+     *
+     * @param value The value to insert
+     * @return true if the value was inserted, false if it was already present
+     */
+    bool insert(const T &value) {
+        if (maxSize == 0 || contains(value)) {
+            return false;
+        }
+
+        if (ring.size() < maxSize) {
+            // Still filling up: append and grow the table to keep the load factor at most 1/2
+            if ((ring.size() + 1) * 2 > table.size()) {
+                rehash(table.size() * 2);
+            }
+            ring.push_back(value);
+            place(static_cast<std::uint32_t>(ring.size() - 1));
+            return true;
+        }
+
+        // Full: overwrite the oldest entry in place
+        erase(find(ring[oldest]));
+        ring[oldest] = value;
+        place(static_cast<std::uint32_t>(oldest));
+        oldest = (oldest + 1) % maxSize;
+        return true;
+    }
+
+    /**
+     * @brief Get the number of values in the cache
+     *
+     * @return The number of values
+     */
+    size_t size() const {
+        return ring.size();
+    }
+
+    /**
+     * @brief Get the maximum number of values the cache will hold
+     *
+     * @return The capacity
+     */
+    size_t capacity() const {
+        return maxSize;
+    }
+
+private:
+    static constexpr std::uint32_t EMPTY = std::numeric_limits<std::uint32_t>::max();
+    static constexpr size_t NOT_FOUND = std::numeric_limits<size_t>::max();
+    static constexpr size_t MIN_TABLE_SIZE = 16;
+
+    size_t home(const T &value) const {
+        // Fibonacci hashing spreads out hash functions that are the identity (e.g. std::hash of
+        // integers) before masking
+        return static_cast<size_t>((static_cast<std::uint64_t>(Hash{}(value)) *
+                                    0x9E3779B97F4A7C15ull) >>
+                                   32) &
+               mask;
+    }
+
+    /**
+     * @brief Find the table slot holding value, or NOT_FOUND
+     */
+    size_t find(const T &value) const {
+        for (size_t slot = home(value);; slot = (slot + 1) & mask) {
+            if (table[slot] == EMPTY) {
+                return NOT_FOUND;
+            }
+            if (ring[table[slot]] == value) {
+                return slot;
+            }
+        }
+    }
+
+    /**
+     * @brief Add the ring entry at index to the table
+     */
+    void place(std::uint32_t index) {
+        size_t slot = home(ring[index]);
+        while (table[slot] != EMPTY) {
+            slot = (slot + 1) & mask;
+        }
+        table[slot] = index;
+    }
+
+    /**
+     * @brief Empty a table slot, shifting later entries of the probe sequence back so that no
+     * tombstones are needed
+     */
+    void erase(size_t slot) {
+        size_t next = slot;
+        while (true) {
+            next = (next + 1) & mask;
+            if (table[next] == EMPTY) {
+                break;
+            }
+            // The entry at next can move into the hole unless its home lies cyclically in
+            // (slot, next]
+            size_t nextHome = home(ring[table[next]]);
+            if ((next > slot && (nextHome <= slot || nextHome > next)) ||
+                (next < slot && (nextHome <= slot && nextHome > next))) {
+                table[slot] = table[next];
+                slot = next;
+            }
+        }
+        table[slot] = EMPTY;
+    }
+
+    void rehash(size_t newSize) {
+        table.assign(newSize, EMPTY);
+        mask = newSize - 1;
+        for (size_t index = 0; index < ring.size(); ++index) {
+            place(static_cast<std::uint32_t>(index));
+        }
+    }
+
+    size_t maxSize{0};
+    std::vector<T> ring;
+    size_t oldest{0};
+    std::vector<std::uint32_t> table;
+    size_t mask{0};
+};
+
+#endif
@@ -0,0 +1,210 @@
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "ErasureCode.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+/**
+ * @brief Log and exp tables for GF(2^8) with the polynomial x^8 + x^4 + x^3 + x^2 + 1 and
+ * generator 2. The exp table is doubled so that a product never has to be reduced mod 255.
+ */
+struct GaloisTables {
+    GaloisTables() {
+        std::uint32_t value = 1;
+        for (size_t i = 0; i < 255; ++i) {
+            exp[i] = static_cast<std::uint8_t>(value);
+            exp[i + 255] = static_cast<std::uint8_t>(value);
+            log[value] = static_cast<std::uint8_t>(i);
+            value <<= 1;
+            if (value & 0x100) {
+                value ^= 0x11d;
+            }
+        }
+    }
+
+    std::uint8_t exp[510]{};
+    std::uint8_t log[256]{};
+};
+
+const GaloisTables &tables() {
+    static const GaloisTables instance;
+    return instance;
+}
+
+std::uint8_t mul(std::uint8_t a, std::uint8_t b) {
+    if (a == 0 || b == 0) {
+        return 0;
+    }
+    const GaloisTables &gf = tables();
+    return gf.exp[gf.log[a] + gf.log[b]];
+}
+
+std::uint8_t inv(std::uint8_t a) {
+    const GaloisTables &gf = tables();
+    return gf.exp[255 - gf.log[a]];
+}
+
+/**
+ * @brief The coefficient of data fragment col in fragment row. Data fragments are the identity;
+ * parity fragments are rows of the Cauchy matrix 1 / (row + col), where addition is xor and row >=
+ * dataCount > col, so the denominator is never zero.
+ */
+std::uint8_t coefficient(size_t row, size_t col, size_t dataCount) {
+    if (row < dataCount) {
+        return row == col ? 1 : 0;
+    }
+    return inv(static_cast<std::uint8_t>(row ^ col));
+}
+
+/**
+ * @brief out ^= coef * in, byte by byte
+ */
+void mulAdd(std::string &out, std::string_view in, std::uint8_t coef) {
+    if (coef == 0) {
+        return;
+    }
+    const GaloisTables &gf = tables();
+    const unsigned logCoef = gf.log[coef];
+    for (size_t b = 0; b < in.size(); ++b) {
+        const auto value = static_cast<std::uint8_t>(in[b]);
+        if (value != 0) {
+            out[b] = static_cast<char>(static_cast<std::uint8_t>(out[b]) ^
+                                       gf.exp[logCoef + gf.log[value]]);
+        }
+    }
+}
+
+void checkCounts(size_t dataCount, size_t totalCount) {
+    if (dataCount == 0 || dataCount > totalCount || totalCount > ErasureCode::MAX_FRAGMENTS) {
+        throw std::invalid_argument("Invalid erasure code: " + std::to_string(dataCount) + " of " +
+                                    std::to_string(totalCount) + " fragments");
+    }
+}
+
+/**
+ * @brief Invert a square matrix in place with Gauss-Jordan elimination
+ */
+void invert(std::vector<std::vector<std::uint8_t>> &matrix) {
+    const size_t size = matrix.size();
+    std::vector<std::vector<std::uint8_t>> result(size, std::vector<std::uint8_t>(size, 0));
+    for (size_t i = 0; i < size; ++i) {
+        result[i][i] = 1;
+    }
+
+    for (size_t col = 0; col < size; ++col) {
+        size_t pivot = col;
+        while (pivot < size && matrix[pivot][col] == 0) {
+            ++pivot;
+        }
+        if (pivot == size) {
+            throw std::invalid_argument("Invalid erasure code: singular matrix");
+        }
+        std::swap(matrix[col], matrix[pivot]);
+        std::swap(result[col], result[pivot]);
+
+        const std::uint8_t scale = inv(matrix[col][col]);
+        for (size_t j = 0; j < size; ++j) {
+            matrix[col][j] = mul(matrix[col][j], scale);
+            result[col][j] = mul(result[col][j], scale);
+        }
+        for (size_t row = 0; row < size; ++row) {
+            const std::uint8_t factor = matrix[row][col];
+            if (row == col || factor == 0) {
+                continue;
+            }
+            for (size_t j = 0; j < size; ++j) {
+                matrix[row][j] ^= mul(factor, matrix[col][j]);
+                result[row][j] ^= mul(factor, result[col][j]);
+            }
+        }
+    }
+    matrix = std::move(result);
+}
+
+}  // namespace
+
+std::vector<std::string> ErasureCode::encode(std::string_view data, size_t dataCount,
+                                             size_t totalCount) {
+    checkCounts(dataCount, totalCount);
+    const size_t fragmentSize = (data.size() + dataCount - 1) / dataCount;
+
+    std::vector<std::string> fragments;
+    fragments.reserve(totalCount);
+    for (size_t i = 0; i < dataCount; ++i) {
+        const size_t offset = std::min(i * fragmentSize, data.size());
+        std::string fragment(data.substr(offset, fragmentSize));
+        fragment.resize(fragmentSize, '\0');
+        fragments.push_back(std::move(fragment));
+    }
+    for (size_t row = dataCount; row < totalCount; ++row) {
+        std::string parity(fragmentSize, '\0');
+        for (size_t col = 0; col < dataCount; ++col) {
+            mulAdd(parity, fragments[col], coefficient(row, col, dataCount));
+        }
+        fragments.push_back(std::move(parity));
+    }
+    return fragments;
+}
+
+std::string ErasureCode::decode(const std::vector<std::optional<std::string>> &fragments,
+                                size_t dataCount, size_t length) {
+    checkCounts(dataCount, fragments.size());
+    const size_t fragmentSize = (length + dataCount - 1) / dataCount;
+
+    // Use the first k usable fragments, preferring data fragments since they need no decoding
+    std::vector<size_t> rows;
+    rows.reserve(dataCount);
+    for (size_t i = 0; i < fragments.size() && rows.size() < dataCount; ++i) {
+        if (fragments[i].has_value() && fragments[i]->size() == fragmentSize) {
+            rows.push_back(i);
+        }
+    }
+    if (rows.size() < dataCount) {
+        throw std::invalid_argument("Invalid erasure code: only " + std::to_string(rows.size()) +
+                                    " of " + std::to_string(dataCount) + " fragments");
+    }
+
+    std::vector<std::vector<std::uint8_t>> matrix(dataCount,
+                                                  std::vector<std::uint8_t>(dataCount, 0));
+    for (size_t r = 0; r < dataCount; ++r) {
+        for (size_t col = 0; col < dataCount; ++col) {
+            matrix[r][col] = coefficient(rows[r], col, dataCount);
+        }
+    }
+    invert(matrix);
+
+    std::string data;
+    data.reserve(fragmentSize * dataCount);
+    for (size_t col = 0; col < dataCount; ++col) {
+        if (fragments[col].has_value() && fragments[col]->size() == fragmentSize) {
+            data.append(*fragments[col]);
+            continue;
+        }
+        std::string recovered(fragmentSize, '\0');
+        for (size_t r = 0; r < dataCount; ++r) {
+            mulAdd(recovered, *fragments[rows[r]], matrix[col][r]);
+        }
+        data.append(recovered);
+    }
+    data.resize(length);
+    return data;
+}
@@ -0,0 +1,67 @@
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef __NETWORK_MANAGER_TWOSIX_ERASURE_CODE_H__
+#define __NETWORK_MANAGER_TWOSIX_ERASURE_CODE_H__
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Systematic k-of-n erasure code over GF(2^8), used to split a sealed payload across
+ * committee rings.
+ *
+ * The data is padded to a multiple of k bytes and cut into k data fragments, which are followed by
+ * n - k parity fragments. Parity is computed with a Cauchy matrix, so the data can be recovered
+ * from any k of the n fragments. Every fragment is ceil(length / k) bytes long.
+ */
+namespace ErasureCode {
+
+/**
+ * @brief The maximum number of fragments (n)
+ */
+const size_t MAX_FRAGMENTS = 255;
+
+/**
+ * @brief Split data into fragments
+ *
+ * @param data The data to split
+ * @param dataCount The number of data fragments (k), at least 1
+ * @param totalCount The total number of fragments (n), at least k and at most MAX_FRAGMENTS
+ * @return The n fragments, data fragments first. On invalid counts an invalid_argument exception is
+ * thrown.
+ */
+std::vector<std::string> encode(std::string_view data, size_t dataCount, size_t totalCount);
+
+/**
+ * @brief Recover data from its fragments
+ *
+ * @param fragments The fragment at each index, or nullopt for a missing fragment. Must have
+ * totalCount entries.
+ * @param dataCount The number of data fragments (k)
+ * @param length The length of the original data
+ * @return The original data. If fewer than k fragments are present, or they do not have the
+ * expected size, an invalid_argument exception is thrown.
+ */
+std::string decode(const std::vector<std::optional<std::string>> &fragments, size_t dataCount,
+                   size_t length);
+
+}  // namespace ErasureCode
+
+#endif
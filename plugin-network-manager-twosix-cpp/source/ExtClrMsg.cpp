@@ -222,6 +222,44 @@ void ExtClrMsg::clearCommitteesSent() {
     committeesSent.clear();
 }
 
+/**
+ * @brief Attach the sealed payload this message was received with so that it can be forwarded
+ * without being decrypted and re-encrypted
+ *
+ * @param value The sealed payload
+ */
+void ExtClrMsg::setSealedPayload(std::shared_ptr<const SealedPayload> value) {
+    sealedPayload = std::move(value);
+}
+
+/**
+ * @brief Get the sealed payload this message was received with, if any
+ *
+ * @return The sealed payload, or nullptr if the msg body has not been sealed
+ */
+std::shared_ptr<const SealedPayload> ExtClrMsg::getSealedPayload() const {
+    return sealedPayload;
+}
+
+/**
+ * @brief Mark the sealed payload as one fragment of the full sealed payload, or as the full payload
+ * if value is nullopt
+ *
+ * @param value The fragment
+ */
+void ExtClrMsg::setFragment(const std::optional<PayloadFragment> &value) {
+    fragment = value;
+}
+
+/**
+ * @brief Get which fragment of the full sealed payload this message carries, if any
+ *
+ * @return The fragment, or nullopt if the message carries its full sealed payload
+ */
+const std::optional<PayloadFragment> &ExtClrMsg::getFragment() const {
+    return fragment;
+}
+
 /**
  * @brief Remove the extra fields and return this message as ClrMsg. Used to obtain the message to
  * forward to a client
@@ -247,5 +285,7 @@ ExtClrMsg ExtClrMsg::copy() const {
                                  getCommitteesVisited(), getCommitteesSent());
     result.setTraceId(getTraceId());
     result.setSpanId(getSpanId());
+    result.setSealedPayload(getSealedPayload());
+    result.setFragment(getFragment());
     return result;
 }
@@ -18,6 +18,8 @@
 #ifndef __EXT_CLR_MSG_H__
 #define __EXT_CLR_MSG_H__
 
+#include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -36,6 +38,27 @@ enum MsgType {
     MSG_BOOTSTRAPPING = 3,  // bootstrapping new node message
 };
 
+/**
+ * @brief A msg body encrypted once by the originator with its own random key. Servers forwarding
+ * the message pass it along without decrypting it (see MessageFormat.h).
+ */
+struct SealedPayload {
+    std::vector<std::uint8_t> key;
+    std::string cipherText;
+};
+
+/**
+ * @brief Identifies which piece of an erasure coded sealed payload a message carries, when the
+ * payload has been split across committee rings (see ErasureCode.h)
+ */
+struct PayloadFragment {
+    std::uint8_t index{0};
+    std::uint8_t dataCount{0};
+    std::uint8_t totalCount{0};
+    // Length of the whole sealed payload
+    std::uint32_t payloadLength{0};
+};
+
 /**
  * @brief the ExtClrMsg class extends the SDK-defined ClrMsg class to
  * enable additional record-keeping needed by the TwoSix network manager stub
@@ -168,6 +191,37 @@ public:
      */
     void clearCommitteesSent();
 
+    /**
+     * @brief Attach the sealed payload this message was received with so that it can be forwarded
+     * without being decrypted and re-encrypted. A message with a sealed payload may have an empty
+     * msg body.
+     *
+     * @param value The sealed payload
+     */
+    void setSealedPayload(std::shared_ptr<const SealedPayload> value);
+
+    /**
+     * @brief Get the sealed payload this message was received with, if any
+     *
+     * @return The sealed payload, or nullptr if the msg body has not been sealed
+     */
+    std::shared_ptr<const SealedPayload> getSealedPayload() const;
+
+    /**
+     * @brief Mark the sealed payload as one fragment of the full sealed payload, or as the full
+     * payload if value is nullopt
+     *
+     * @param value The fragment
+     */
+    void setFragment(const std::optional<PayloadFragment> &value);
+
+    /**
+     * @brief Get which fragment of the full sealed payload this message carries, if any
+     *
+     * @return The fragment, or nullopt if the message carries its full sealed payload
+     */
+    const std::optional<PayloadFragment> &getFragment() const;
+
     /**
      * @brief Remove the extra fields and return this message as ClrMsg. Used to obtain the message
      * to forward to a client
@@ -204,6 +258,8 @@ private:
     MsgType msgType;
     std::vector<std::string> committeesVisited;
     std::vector<std::string> committeesSent;
+    std::shared_ptr<const SealedPayload> sealedPayload;
+    std::optional<PayloadFragment> fragment;
 };
 
 #endif
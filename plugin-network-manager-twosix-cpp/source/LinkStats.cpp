@@ -0,0 +1,170 @@
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "LinkStats.h"
+
+#include <algorithm>
+
+// Lower bound on the delivery probability, so that a lossy connection is penalized but its
+// prediction stays finite
+static constexpr double MIN_DELIVERY_PROBABILITY = 0.05;
+
+LinkStats::LinkStats() : alpha(DEFAULT_ALPHA), maxAge(DEFAULT_MAX_AGE) {}
+
+void LinkStats::setParameters(double newAlpha, Clock::duration newMaxAge) {
+    alpha = std::min(std::max(newAlpha, 0.0), 1.0);
+    maxAge = newMaxAge;
+}
+
+void LinkStats::onSent(RaceHandle handle, const ConnectionID &connId, double queueUtilization,
+                       Clock::time_point now) {
+    expire(now);
+
+    Stats &connStats = stats[connId];
+    sample(connStats.queueUtilization, queueUtilization, connStats.numSamples == 0);
+    ++connStats.numSamples;
+
+    inFlight[handle] = {connId, now};
+    sendOrder.emplace_back(now, handle);
+}
+
+void LinkStats::onRejected(const ConnectionID &connId, double queueUtilization) {
+    Stats &connStats = stats[connId];
+    sample(connStats.queueUtilization, queueUtilization, connStats.numSamples == 0);
+    ++connStats.numSamples;
+    sampleLoss(connId, true);
+}
+
+void LinkStats::onPackageStatus(RaceHandle handle, PackageStatus status, Clock::time_point now) {
+    auto it = inFlight.find(handle);
+    if (it != inFlight.end()) {
+        if (status == PACKAGE_SENT or status == PACKAGE_RECEIVED) {
+            auto found = stats.find(it->second.connId);
+            if (found != stats.end()) {
+                const double latencyMs =
+                    std::chrono::duration<double, std::milli>(now - it->second.sent).count();
+                Stats &connStats = found->second;
+                sample(connStats.latencyMs, latencyMs, connStats.latencyMs < 0);
+            }
+            sampleLoss(it->second.connId, false);
+            inFlight.erase(it);
+        } else if (status == PACKAGE_FAILED_GENERIC or status == PACKAGE_FAILED_NETWORK_ERROR or
+                   status == PACKAGE_FAILED_TIMEOUT) {
+            sampleLoss(it->second.connId, true);
+            inFlight.erase(it);
+        }
+    }
+    expire(now);
+}
+
+void LinkStats::remove(const ConnectionID &connId) {
+    stats.erase(connId);
+}
+
+const LinkStats::Stats *LinkStats::find(const ConnectionID &connId) const {
+    auto it = stats.find(connId);
+    return it == stats.end() ? nullptr : &it->second;
+}
+
+double LinkStats::predictDeliveryMs(const RouteTable::Hop &hop) const {
+    const Stats *connStats = find(hop.connId);
+    double latencyMs = connStats != nullptr ? connStats->latencyMs : -1.0;
+    if (latencyMs < 0) {
+        if (hop.sendLatencyMs <= 0) {
+            return -1.0;
+        }
+        latencyMs = hop.sendLatencyMs;
+    }
+    if (connStats == nullptr) {
+        return latencyMs;
+    }
+
+    const double delivery = std::max(1.0 - connStats->loss, MIN_DELIVERY_PROBABILITY);
+    return latencyMs / delivery * (1.0 + connStats->queueUtilization);
+}
+
+std::size_t LinkStats::select(const std::vector<RouteTable::Hop> &hops, bool split) {
+    if (hops.size() < 2 or predictDeliveryMs(hops.front()) < 0) {
+        return 0;
+    }
+
+    if (!split) {
+        std::size_t best = 0;
+        double bestMs = predictDeliveryMs(hops.front());
+        for (std::size_t i = 1; i < hops.size(); ++i) {
+            const double ms = predictDeliveryMs(hops[i]);
+            if (ms >= 0 and ms < bestMs) {
+                best = i;
+                bestMs = ms;
+            }
+        }
+        return best;
+    }
+
+    // Smooth weighted round-robin: each connection earns credit in proportion to its weight and
+    // the one with the most credit is charged the total. The first connection always has a
+    // prediction, so it is always a candidate.
+    std::size_t best = 0;
+    double bestCredit = 0.0;
+    double total = 0.0;
+    for (std::size_t i = 0; i < hops.size(); ++i) {
+        const double ms = predictDeliveryMs(hops[i]);
+        if (ms < 0) {
+            continue;
+        }
+        const double weight = 1.0 / std::max(ms, 1.0);
+        Stats &connStats = stats[hops[i].connId];
+        connStats.credit += weight;
+        total += weight;
+        if (i == 0 or connStats.credit > bestCredit) {
+            best = i;
+            bestCredit = connStats.credit;
+        }
+    }
+    stats[hops[best].connId].credit -= total;
+    return best;
+}
+
+std::size_t LinkStats::expire(Clock::time_point now) {
+    // Also drops packages that already have a status from the front, so that sendOrder stays
+    // short while statuses arrive in order
+    std::size_t count = 0;
+    while (!sendOrder.empty()) {
+        const auto &[sent, handle] = sendOrder.front();
+        auto it = inFlight.find(handle);
+        if (it != inFlight.end() && it->second.sent == sent) {
+            if (sent + maxAge > now) {
+                break;
+            }
+            sampleLoss(it->second.connId, true);
+            inFlight.erase(it);
+            ++count;
+        }
+        sendOrder.pop_front();
+    }
+    return count;
+}
+
+void LinkStats::sample(double &average, double value, bool first) const {
+    average = first ? value : alpha * value + (1.0 - alpha) * average;
+}
+
+void LinkStats::sampleLoss(const ConnectionID &connId, bool lost) {
+    auto it = stats.find(connId);
+    if (it != stats.end()) {
+        sample(it->second.loss, lost ? 1.0 : 0.0, false);
+    }
+}
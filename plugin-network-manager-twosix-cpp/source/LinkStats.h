@@ -0,0 +1,180 @@
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef __NETWORK_MANAGER_TWOSIX_LINK_STATS_H__
+#define __NETWORK_MANAGER_TWOSIX_LINK_STATS_H__
+
+#include <PackageStatus.h>
+#include <SdkResponse.h>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "RouteTable.h"
+
+/**
+ * @brief Observed performance of each send connection, used to pick the connection a package is
+ * predicted to be delivered on soonest.
+ *
+ * Latency (send to the first package status), loss (failed or unanswered packages) and queue
+ * utilization (as reported by the SDK when sending) are tracked as exponentially weighted moving
+ * averages. A connection without a latency sample falls back to the expected send latency of its
+ * link.
+ *
+ * This class is not thread-safe.
+ */
+class LinkStats {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Observations of one connection
+     */
+    struct Stats {
+        // Negative until the first latency sample
+        double latencyMs{-1.0};
+        double loss{0.0};
+        double queueUtilization{0.0};
+        std::uint64_t numSamples{0};
+        // Smooth weighted round-robin state used when splitting traffic
+        double credit{0.0};
+    };
+
+    static constexpr double DEFAULT_ALPHA = 0.2;
+    static constexpr std::chrono::seconds DEFAULT_MAX_AGE{600};
+
+    /**
+     * @brief Construct with the default smoothing factor and maximum package age
+     */
+    LinkStats();
+
+    /**
+     * @brief Change the smoothing factor and the age after which a package without a status
+     * counts as lost
+     *
+     * @param alpha The weight of each new sample, in (0, 1]
+     * @param maxAge The maximum age of a package
+     */
+    void setParameters(double alpha, Clock::duration maxAge);
+
+    /**
+     * @brief Record a package accepted by the SDK for sending
+     *
+     * @param handle The handle of the package
+     * @param connId The connection the package was sent on
+     * @param queueUtilization The queue utilization reported by the SDK
+     * @param now The current time
+     */
+    void onSent(RaceHandle handle, const ConnectionID &connId, double queueUtilization,
+                Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Record a package the SDK refused to send, e.g. because the queue was full
+     *
+     * @param connId The connection the package was sent on
+     * @param queueUtilization The queue utilization reported by the SDK
+     */
+    void onRejected(const ConnectionID &connId, double queueUtilization);
+
+    /**
+     * @brief Record the status of a package. The first sent or received status gives a latency
+     * sample; a failure counts as lost. Later statuses of the same package are ignored.
+     *
+     * @param handle The handle of the package
+     * @param status The new status of the package
+     * @param now The current time
+     */
+    void onPackageStatus(RaceHandle handle, PackageStatus status,
+                         Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Forget a connection, e.g. once it is closed
+     *
+     * @param connId The connection
+     */
+    void remove(const ConnectionID &connId);
+
+    /**
+     * @brief Get the observations of a connection
+     *
+     * @param connId The connection
+     * @return The observations, or nullptr if nothing was sent on the connection
+     */
+    const Stats *find(const ConnectionID &connId) const;
+
+    /**
+     * @brief Predict how long a package sent on a connection takes to be delivered: the latency,
+     * scaled up by the expected number of attempts and by the queue utilization.
+     *
+     * @param hop The connection
+     * @return The predicted delivery time in milliseconds, or a negative value if the latency is
+     * unknown
+     */
+    double predictDeliveryMs(const RouteTable::Hop &hop) const;
+
+    /**
+     * @brief Choose the connection to send a package on. The connection with the lowest predicted
+     * delivery time is chosen, unless the best ranked connection (the first) has no prediction. If
+     * split is set, packages are instead spread across the connections with a prediction in inverse
+     * proportion to it.
+     *
+     * @param hops The ranked connections to the destination
+     * @param split Whether to spread packages across connections
+     * @return The index of the chosen connection in hops
+     */
+    std::size_t select(const std::vector<RouteTable::Hop> &hops, bool split);
+
+    /**
+     * @brief Count packages older than the maximum age without a status as lost
+     *
+     * @param now The current time
+     * @return The number of packages counted as lost
+     */
+    std::size_t expire(Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Get the number of packages awaiting a status
+     *
+     * @return The number of packages
+     */
+    std::size_t numInFlight() const {
+        return inFlight.size();
+    }
+
+private:
+    struct Pending {
+        ConnectionID connId;
+        Clock::time_point sent;
+    };
+
+    void sample(double &average, double value, bool first) const;
+    void sampleLoss(const ConnectionID &connId, bool lost);
+
+    std::unordered_map<ConnectionID, Stats> stats;
+    std::unordered_map<RaceHandle, Pending> inFlight;
+    // Handles in the order they were sent, so that the oldest can be expired
+    std::deque<std::pair<Clock::time_point, RaceHandle>> sendOrder;
+
+    double alpha;
+    Clock::duration maxAge;
+};
+
+#endif
@@ -377,7 +377,7 @@ bool LinkWizard::querySupportedChannels(const std::string &uuid) {
         MSG_LINKS);  // Using arbitrary/0 Nonce and Timestamp because this information is not used
 
     setOpenTracing(msg, "querySupportedChannels");
-    std::string msgString = encryptor.formatDelimitedMessage(msg);
+    std::string msgString = plugin->formatMessage(msg);
     logDebug("  ━☆ LinkWizard::querySupportedChannels: sending msg");
     bool success = plugin->sendFormattedMsg(uuid, msgString, msg.getTraceId(), msg.getSpanId());
     if (not success) {
@@ -414,7 +414,7 @@ bool LinkWizard::respondSupportedChannels(
         MSG_LINKS);  // Using arbitrary/0 Nonce and Timestamp because this information is not used
     setOpenTracing(msg, "respondSupportedChannels", ctx.get());
     logDebug("  ━☆ LinkWizard::respondSupportedChannels: " + msgJson.dump());
-    std::string msgString = encryptor.formatDelimitedMessage(msg);
+    std::string msgString = plugin->formatMessage(msg);
     bool success = plugin->sendFormattedMsg(uuid, msgString, msg.getTraceId(), msg.getSpanId());
     if (not success) {
         sendingMessageQueue.push_back({uuid, msgString, msg.getTraceId(), msg.getSpanId()});
@@ -431,7 +431,7 @@ bool LinkWizard::requestCreateUnicastLink(const std::string &uuid, const std::st
         "{\"requestCreateUnicastLink\": \"" + channelGid + "\"}", raceUuid, uuid, 1, 0, 0, 0, 0, 0,
         MSG_LINKS);  // Using arbitrary/0 Nonce and Timestamp because this information is not used
     setOpenTracing(msg, "requestCreateUnicastLink");
-    std::string msgString = encryptor.formatDelimitedMessage(msg);
+    std::string msgString = plugin->formatMessage(msg);
     bool success = plugin->sendFormattedMsg(uuid, msgString, msg.getTraceId(), msg.getSpanId());
     if (not success) {
         sendingMessageQueue.push_back({uuid, msgString, msg.getTraceId(), msg.getSpanId()});
@@ -483,7 +483,7 @@ bool LinkWizard::requestLoadLinkAddress(const std::string &uuid, const std::stri
         msgJson.dump(), raceUuid, uuid, 1, 0, 0, 0, 0, 0,
         MSG_LINKS);  // Using arbitrary/0 Nonce and Timestamp because this information is not used
     setOpenTracing(msg, "requestLoadLinkAddress");
-    std::string msgString = encryptor.formatDelimitedMessage(msg);
+    std::string msgString = plugin->formatMessage(msg);
     bool success = plugin->sendFormattedMsg(uuid, msgString, msg.getTraceId(), msg.getSpanId());
     if (not success) {
         sendingMessageQueue.push_back({uuid, msgString, msg.getTraceId(), msg.getSpanId()});
@@ -548,7 +548,7 @@ bool LinkWizard::requestCreateMulticastRecvLink(const std::vector<std::string> &
                       MSG_LINKS);  // Using arbitrary/0 Nonce and Timestamp because this information
                                    // is not used
         setOpenTracing(msg, "requestCreateMulticastRecvLink");
-        std::string msgString = encryptor.formatDelimitedMessage(msg);
+        std::string msgString = plugin->formatMessage(msg);
         auto handle = plugin->sendFormattedMsg(uuid, msgString, msg.getTraceId(), msg.getSpanId());
         success &= handle != NULL_RACE_HANDLE;
         if (not success) {
@@ -605,7 +605,7 @@ bool LinkWizard::respondRequestedCreateMulticastRecv(const std::string &uuid,
         msgJson.dump(), raceUuid, uuid, 1, 0, 0, 0, 0, 0,
         MSG_LINKS);  // Using arbitrary/0 Nonce and Timestamp because this information is not used
     setOpenTracing(msg, "responseRequestedCreateMulticastRecv");
-    std::string msgString = encryptor.formatDelimitedMessage(msg);
+    std::string msgString = plugin->formatMessage(msg);
     bool success = plugin->sendFormattedMsg(uuid, msgString, msg.getTraceId(), msg.getSpanId());
     if (not success) {
         sendingMessageQueue.push_back({uuid, msgString, msg.getTraceId(), msg.getSpanId()});
@@ -36,8 +36,8 @@
 #include <utility>
 #include <vector>
 
+#include "ExtClrMsg.h"
 #include "Persona.h"
-#include "RaceCrypto.h"
 
 class PluginNMTwoSix;
 
@@ -413,7 +413,6 @@ private:
 
     // External classes to call to
     PluginNMTwoSix *plugin;
-    RaceCrypto encryptor;
 
     // Internal variables
     const std::string raceUuid;
@@ -39,6 +39,10 @@ void logError(const std::string &message) {
 constexpr std::size_t MAX_MSG_LEN = 256;
 
 void logMessage(const std::string &prefix, const std::string &message) {
+    if (!RACE_LOG_ENABLED(RaceLog::LL_DEBUG)) {
+        return;
+    }
+
     if (message.size() <= MAX_MSG_LEN) {
         logDebug(prefix + message);
     } else {
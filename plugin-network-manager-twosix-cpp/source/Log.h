@@ -31,6 +31,17 @@ void logError(const std::string &message);
 
 void logMessage(const std::string &prefix, const std::string &message);
 
+/**
+ * @brief Call logDebug only if debug messages are being written, so that the message isn't built
+ * otherwise. Use this for messages that are expensive to build on hot paths.
+ */
+#define LOG_DEBUG(message)                         \
+    do {                                           \
+        if (RACE_LOG_ENABLED(RaceLog::LL_DEBUG)) { \
+            logDebug(message);                     \
+        }                                          \
+    } while (0)
+
 #define TRACE_FUNCTION(...) TRACE_FUNCTION_BASE(PluginNMTwoSixCpp, ##__VA_ARGS__)
 #define TRACE_METHOD(...) TRACE_METHOD_BASE(PluginNMTwoSixCpp, ##__VA_ARGS__)
 
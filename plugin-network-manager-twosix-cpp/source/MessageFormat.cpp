@@ -0,0 +1,305 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "MessageFormat.h"
+
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+/**
+ * @brief Size in bytes of the fixed-width fields of an encoded ClrMsg header (preamble, two string
+ * lengths, time, nonce, ampIndex, payload key length)
+ */
+const size_t CLR_MSG_FIXED_SIZE = MessageFormat::PREAMBLE_LENGTH + 2 * 4 + 8 + 4 + 1 + 4;
+
+/**
+ * @brief Size in bytes of the additional fixed-width fields of an encoded ExtClrMsg header (uuid,
+ * ringTtl, ringIdx, msgType, two list counts)
+ */
+const size_t EXT_CLR_MSG_FIXED_SIZE = 8 + 4 + 4 + 1 + 2 * 4;
+
+/**
+ * @brief Size in bytes of the additional fields of an encoded fragment header (fragmentIndex,
+ * dataCount, totalCount, payloadLength)
+ */
+const size_t FRAGMENT_FIXED_SIZE = 1 + 1 + 1 + 4;
+
+class Writer {
+public:
+    explicit Writer(size_t size) {
+        buffer.reserve(size);
+    }
+
+    template <typename T>
+    void writeInt(T value) {
+        auto unsignedValue = static_cast<std::make_unsigned_t<T>>(value);
+        for (size_t shift = sizeof(T) * 8; shift > 0; shift -= 8) {
+            buffer.push_back(static_cast<char>((unsignedValue >> (shift - 8)) & 0xff));
+        }
+    }
+
+    void writeString(std::string_view value) {
+        if (value.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::invalid_argument("String too long to format");
+        }
+        writeInt(static_cast<std::uint32_t>(value.size()));
+        buffer.append(value);
+    }
+
+    void writeStrings(const std::vector<std::string> &values) {
+        writeInt(static_cast<std::uint32_t>(values.size()));
+        for (auto &value : values) {
+            writeString(value);
+        }
+    }
+
+    /**
+     * @brief Overwrite a previously written uint32
+     */
+    void patchInt(size_t offset, std::uint32_t value) {
+        for (size_t i = 0; i < 4; ++i) {
+            buffer[offset + i] = static_cast<char>((value >> (24 - 8 * i)) & 0xff);
+        }
+    }
+
+    std::string buffer;
+};
+
+class Reader {
+public:
+    explicit Reader(std::string_view formatted) : remaining(formatted) {}
+
+    template <typename T>
+    T readInt() {
+        require(sizeof(T));
+        std::make_unsigned_t<T> value = 0;
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            value = static_cast<std::make_unsigned_t<T>>(
+                (value << 8) | static_cast<std::uint8_t>(remaining[i]));
+        }
+        remaining.remove_prefix(sizeof(T));
+        return static_cast<T>(value);
+    }
+
+    std::string_view readString() {
+        auto length = readInt<std::uint32_t>();
+        return readBytes(length);
+    }
+
+    std::vector<std::string_view> readStrings() {
+        auto count = readInt<std::uint32_t>();
+        // each entry needs at least its length prefix, so reject counts that can't possibly fit
+        // before reserving space for them
+        if (count > remaining.size() / 4) {
+            throw std::invalid_argument("Invalid message to parse: truncated");
+        }
+        std::vector<std::string_view> values;
+        values.reserve(count);
+        for (std::uint32_t i = 0; i < count; ++i) {
+            values.push_back(readString());
+        }
+        return values;
+    }
+
+    std::string_view readBytes(size_t length) {
+        require(length);
+        std::string_view value = remaining.substr(0, length);
+        remaining.remove_prefix(length);
+        return value;
+    }
+
+    std::string_view rest() const {
+        return remaining;
+    }
+
+private:
+    void require(size_t length) const {
+        if (remaining.size() < length) {
+            throw std::invalid_argument("Invalid message to parse: truncated");
+        }
+    }
+
+    std::string_view remaining;
+};
+
+/**
+ * @brief Read and check the preamble, returning the kind and header length
+ */
+std::pair<MessageFormat::Kind, std::uint32_t> readPreamble(Reader &reader) {
+    if (reader.readInt<std::uint8_t>() != MessageFormat::MAGIC) {
+        throw std::invalid_argument("Invalid message to parse: not a binary message");
+    }
+    auto version = reader.readInt<std::uint8_t>();
+    if (version != MessageFormat::VERSION) {
+        throw std::invalid_argument("Invalid message to parse: unsupported version " +
+                                    std::to_string(version));
+    }
+    auto kind = reader.readInt<std::uint8_t>();
+    if (kind != MessageFormat::KIND_CLR_MSG && kind != MessageFormat::KIND_EXT_CLR_MSG &&
+        kind != MessageFormat::KIND_EXT_CLR_MSG_FRAGMENT) {
+        throw std::invalid_argument("Invalid message to parse: unknown kind " +
+                                    std::to_string(kind));
+    }
+    auto headerLength = reader.readInt<std::uint32_t>();
+    if (headerLength < MessageFormat::PREAMBLE_LENGTH) {
+        throw std::invalid_argument("Invalid message to parse: bad header length");
+    }
+    return {static_cast<MessageFormat::Kind>(kind), headerLength};
+}
+
+std::string encodeMessage(MessageFormat::Kind kind, const ClrMsg &msg, const ExtClrMsg *ext,
+                          const SealedPayload &payload) {
+    const std::string from = msg.getFrom();
+    const std::string to = msg.getTo();
+    std::vector<std::string> committeesVisited;
+    std::vector<std::string> committeesSent;
+
+    size_t headerLength = CLR_MSG_FIXED_SIZE + from.size() + to.size() + payload.key.size();
+    if (ext != nullptr) {
+        committeesVisited = ext->getCommitteesVisited();
+        committeesSent = ext->getCommitteesSent();
+        headerLength += EXT_CLR_MSG_FIXED_SIZE;
+        for (auto &committee : committeesVisited) {
+            headerLength += 4 + committee.size();
+        }
+        for (auto &committee : committeesSent) {
+            headerLength += 4 + committee.size();
+        }
+        if (ext->getFragment().has_value()) {
+            headerLength += FRAGMENT_FIXED_SIZE;
+        }
+    }
+
+    Writer writer(headerLength + payload.cipherText.size());
+    writer.writeInt(MessageFormat::MAGIC);
+    writer.writeInt(MessageFormat::VERSION);
+    writer.writeInt(static_cast<std::uint8_t>(kind));
+    writer.writeInt(std::uint32_t{0});  // header length, filled in below
+    writer.writeString(from);
+    writer.writeString(to);
+    writer.writeInt(msg.getTime());
+    writer.writeInt(msg.getNonce());
+    writer.writeInt(msg.getAmpIndex());
+    if (ext != nullptr) {
+        writer.writeInt(ext->getUuid());
+        writer.writeInt(ext->getRingTtl());
+        writer.writeInt(ext->getRingIdx());
+        writer.writeInt(static_cast<std::uint8_t>(ext->getMsgType()));
+        writer.writeStrings(committeesVisited);
+        writer.writeStrings(committeesSent);
+        if (kind == MessageFormat::KIND_EXT_CLR_MSG_FRAGMENT) {
+            const PayloadFragment &fragment = *ext->getFragment();
+            writer.writeInt(fragment.index);
+            writer.writeInt(fragment.dataCount);
+            writer.writeInt(fragment.totalCount);
+            writer.writeInt(fragment.payloadLength);
+        }
+    }
+    writer.writeString(std::string_view(reinterpret_cast<const char *>(payload.key.data()),
+                                        payload.key.size()));
+
+    if (writer.buffer.size() > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::invalid_argument("Header too long to format");
+    }
+    writer.patchInt(3, static_cast<std::uint32_t>(writer.buffer.size()));
+    writer.buffer.append(payload.cipherText);
+    return std::move(writer.buffer);
+}
+
+std::vector<std::string> toStrings(const std::vector<std::string_view> &views) {
+    return std::vector<std::string>(views.begin(), views.end());
+}
+
+}  // namespace
+
+ExtClrMsg MessageFormat::ExtClrMsgView::toExtClrMsg(const std::string &msg) const {
+    if (kind == KIND_CLR_MSG) {
+        return ExtClrMsg(ClrMsg(msg, std::string(from), std::string(to), time, nonce, ampIndex));
+    }
+    ExtClrMsg result(msg, std::string(from), std::string(to), time, nonce, ampIndex, uuid, ringTtl,
+                     ringIdx, msgType, toStrings(committeesVisited), toStrings(committeesSent));
+    result.setFragment(fragment);
+    return result;
+}
+
+bool MessageFormat::isBinary(std::string_view formatted) {
+    return !formatted.empty() && static_cast<std::uint8_t>(formatted[0]) == MAGIC;
+}
+
+size_t MessageFormat::getHeaderLength(std::string_view formatted) {
+    Reader reader(formatted);
+    auto headerLength = readPreamble(reader).second;
+    if (headerLength > formatted.size()) {
+        throw std::invalid_argument("Invalid message to parse: truncated");
+    }
+    return headerLength;
+}
+
+std::string MessageFormat::encode(const ClrMsg &msg, const SealedPayload &payload) {
+    return encodeMessage(KIND_CLR_MSG, msg, nullptr, payload);
+}
+
+std::string MessageFormat::encode(const ExtClrMsg &msg, const SealedPayload &payload) {
+    return encodeMessage(
+        msg.getFragment().has_value() ? KIND_EXT_CLR_MSG_FRAGMENT : KIND_EXT_CLR_MSG, msg, &msg,
+        payload);
+}
+
+MessageFormat::ExtClrMsgView MessageFormat::decode(std::string_view formatted) {
+    Reader reader(formatted);
+    auto preamble = readPreamble(reader);
+
+    ExtClrMsgView view;
+    view.kind = preamble.first;
+    view.from = reader.readString();
+    view.to = reader.readString();
+    view.time = reader.readInt<std::int64_t>();
+    view.nonce = reader.readInt<std::int32_t>();
+    view.ampIndex = reader.readInt<std::int8_t>();
+
+    if (view.kind != KIND_CLR_MSG) {
+        view.uuid = reader.readInt<MsgUuid>();
+        view.ringTtl = reader.readInt<std::int32_t>();
+        view.ringIdx = reader.readInt<std::int32_t>();
+        view.msgType = static_cast<MsgType>(reader.readInt<std::uint8_t>());
+        view.committeesVisited = reader.readStrings();
+        view.committeesSent = reader.readStrings();
+    }
+    if (view.kind == KIND_EXT_CLR_MSG_FRAGMENT) {
+        PayloadFragment fragment;
+        fragment.index = reader.readInt<std::uint8_t>();
+        fragment.dataCount = reader.readInt<std::uint8_t>();
+        fragment.totalCount = reader.readInt<std::uint8_t>();
+        fragment.payloadLength = reader.readInt<std::uint32_t>();
+        if (fragment.dataCount == 0 || fragment.dataCount > fragment.totalCount ||
+            fragment.index >= fragment.totalCount) {
+            throw std::invalid_argument("Invalid message to parse: bad fragment");
+        }
+        view.fragment = fragment;
+    }
+    view.payloadKey = reader.readString();
+
+    if (formatted.size() - reader.rest().size() != preamble.second) {
+        throw std::invalid_argument("Invalid message to parse: header length mismatch");
+    }
+    view.sealedPayload = reader.rest();
+    return view;
+}
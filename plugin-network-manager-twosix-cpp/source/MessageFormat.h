@@ -0,0 +1,158 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef __NETWORK_MANAGER_TWOSIX_MESSAGE_FORMAT_H__
+#define __NETWORK_MANAGER_TWOSIX_MESSAGE_FORMAT_H__
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ExtClrMsg.h"
+
+/**
+ * @brief Binary wire format for ClrMsg and ExtClrMsg.
+ *
+ * A formatted message is a routing header followed by the sealed payload. The payload is the msg
+ * body encrypted once by the originator with a random payload key. The payload key travels in the
+ * header, wrapped with the key of the persona the message is addressed to, so only the destination
+ * can open the payload. When the message is sent, only the header is encrypted for the next hop
+ * (see RaceCrypto::encryptMessage), so servers forwarding a message only decrypt and re-encrypt the
+ * header and pass the wrapped payload key and sealed payload through unchanged.
+ *
+ * All integers are big-endian and every string is prefixed with its uint32 length.
+ *
+ *   uint8  MAGIC (0x00, never the first byte of a legacy delimited message)
+ *   uint8  VERSION
+ *   uint8  kind (KIND_CLR_MSG, KIND_EXT_CLR_MSG or KIND_EXT_CLR_MSG_FRAGMENT)
+ *   uint32 headerLength (length of the whole header, including the fields above)
+ *   string from, string to
+ *   int64  time, int32 nonce, int8 ampIndex
+ *
+ * ExtClrMsg then adds:
+ *
+ *   int64  uuid, int32 ringTtl, int32 ringIdx, uint8 msgType
+ *   uint32 count, string committeesVisited[count]
+ *   uint32 count, string committeesSent[count]
+ *
+ * and KIND_EXT_CLR_MSG_FRAGMENT, whose sealed payload is one fragment of the full sealed payload
+ * (see ExtClrMsg::getFragment), further adds:
+ *
+ *   uint8  fragmentIndex, uint8 dataCount, uint8 totalCount, uint32 payloadLength
+ *
+ * Every kind ends the header with:
+ *
+ *   string payloadKey (IV, tag and payload key encrypted with the key of the destination)
+ *
+ * and the sealed payload takes up the rest of the message.
+ */
+namespace MessageFormat {
+
+const std::uint8_t MAGIC = 0x00;
+const std::uint8_t VERSION = 2;
+
+/**
+ * @brief Size of the magic, version, kind and header length fields at the start of the header
+ */
+const size_t PREAMBLE_LENGTH = 7;
+
+enum Kind : std::uint8_t {
+    KIND_CLR_MSG = 1,
+    KIND_EXT_CLR_MSG = 2,
+    KIND_EXT_CLR_MSG_FRAGMENT = 3,
+};
+
+/**
+ * @brief Fields of a binary formatted message. The string fields point into the buffer that was
+ * decoded, so the view is only valid as long as that buffer is alive and unmodified.
+ */
+struct ExtClrMsgView {
+    Kind kind{KIND_CLR_MSG};
+    std::string_view from;
+    std::string_view to;
+    std::int64_t time{0};
+    std::int32_t nonce{0};
+    std::int8_t ampIndex{0};
+    MsgUuid uuid{UNSET_UUID};
+    std::int32_t ringTtl{UNSET_RING_TTL};
+    std::int32_t ringIdx{0};
+    MsgType msgType{MSG_UNDEF};
+    std::vector<std::string_view> committeesVisited;
+    std::vector<std::string_view> committeesSent;
+    std::optional<PayloadFragment> fragment;
+    std::string_view payloadKey;
+    std::string_view sealedPayload;
+
+    /**
+     * @brief Copy the viewed fields into an ExtClrMsg. A message encoded as a plain ClrMsg is
+     * converted the same way as ExtClrMsg(const ClrMsg &), including generating its UUID.
+     *
+     * @param msg The msg body, i.e. the opened payload
+     * @return The decoded message
+     */
+    ExtClrMsg toExtClrMsg(const std::string &msg) const;
+};
+
+/**
+ * @brief Check whether formatted holds a binary formatted message (as opposed to a legacy delimited
+ * one). This only inspects the leading magic byte.
+ *
+ * @param formatted The formatted message
+ * @return true if the message uses the binary format
+ */
+bool isBinary(std::string_view formatted);
+
+/**
+ * @brief Get the length of the header of a binary formatted message, i.e. the part that is
+ * encrypted per hop.
+ *
+ * @param formatted The formatted message
+ * @return The header length. On failure an invalid_argument exception is thrown.
+ */
+size_t getHeaderLength(std::string_view formatted);
+
+/**
+ * @brief Encode a ClrMsg in the binary format
+ *
+ * @param msg The message whose header fields to encode. The msg body is not used.
+ * @param payload The payload key and sealed msg body
+ * @return The encoded message
+ */
+std::string encode(const ClrMsg &msg, const SealedPayload &payload);
+
+/**
+ * @brief Encode an ExtClrMsg in the binary format
+ *
+ * @param msg The message whose header fields to encode. The msg body is not used.
+ * @param payload The payload key and sealed msg body
+ * @return The encoded message
+ */
+std::string encode(const ExtClrMsg &msg, const SealedPayload &payload);
+
+/**
+ * @brief Decode a binary formatted message without copying any of its fields.
+ *
+ * @param formatted The formatted message. Must outlive the returned view.
+ * @return A view of the decoded fields. On failure an invalid_argument exception is thrown.
+ */
+ExtClrMsgView decode(std::string_view formatted);
+
+}  // namespace MessageFormat
+
+#endif
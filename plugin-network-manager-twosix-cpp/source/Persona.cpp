@@ -39,7 +39,7 @@ void Persona::setPersonaType(PersonaType _personaType) {
     personaType = _personaType;
 }
 
-std::vector<uint8_t> Persona::getAesKey() const {
+const std::vector<uint8_t> &Persona::getAesKey() const {
     return aesKey;
 }
 
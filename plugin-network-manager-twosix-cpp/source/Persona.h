@@ -38,7 +38,7 @@ public:
     void setDisplayName(const std::string &displayName);
     void setRaceUuid(const std::string &raceUuid);
     void setPersonaType(PersonaType personaType);
-    std::vector<uint8_t> getAesKey() const;
+    const std::vector<uint8_t> &getAesKey() const;
     std::string getAesKeyFile() const;
     std::string getDisplayName() const;
     std::string getRaceUuid() const;
@@ -21,8 +21,10 @@
 #include <fstream>
 #include <iostream>
 #include <nlohmann/json.hpp>
+#include <optional>
 #include <set>
 #include <sstream>
+#include <stdexcept>
 
 #include "ConfigPersonas.h"
 #include "ExtClrMsg.h"
@@ -41,6 +43,8 @@ PluginNMTwoSix::PluginNMTwoSix(IRaceSdkNM *sdk, PersonaType personaType) :
     useLinkWizard(true),
     linkWizardInitialized(false),
     lookbackSeconds(60.0),
+    adaptiveLinkSelection(false),
+    splitTraffic(false),
     bootstrap(this),
     linkManager(this) {}
 
@@ -109,6 +113,10 @@ bool PluginNMTwoSix::openRecvConns(std::vector<std::string> uuids) {
 }
 
 std::vector<uint8_t> PluginNMTwoSix::getAesKeyForSelf() {
+    return getSelfAesKeyRef();
+}
+
+const std::vector<uint8_t> &PluginNMTwoSix::getSelfAesKeyRef() const {
     auto it = uuidToPersonaMap.find(raceUuid);
     if (it == uuidToPersonaMap.end()) {
         logError("Failed to find aes key for self: " + raceUuid + ". This is not a valid state");
@@ -117,14 +125,106 @@ std::vector<uint8_t> PluginNMTwoSix::getAesKeyForSelf() {
     return it->second.getAesKey();
 }
 
+const std::vector<uint8_t> &PluginNMTwoSix::getAesKeyRef(const std::string &uuid) const {
+    auto it = uuidToPersonaMap.find(uuid);
+    if (it == uuidToPersonaMap.end()) {
+        logError("Failed to find aes key for " + uuid);
+        throw std::invalid_argument("Failed to find aes key for " + uuid);
+    }
+    return it->second.getAesKey();
+}
+
+std::string PluginNMTwoSix::formatMessage(const ExtClrMsg &msg) const {
+    // A received msg keeps its sealed payload, which does not need the key of the destination
+    if (msg.getSealedPayload() != nullptr) {
+        return encryptor.formatMessage(msg, {});
+    }
+    auto persona = uuidToPersonaMap.find(msg.getTo());
+    if (persona == uuidToPersonaMap.end()) {
+        // The msg body can not be sealed for the destination without its key, so the whole
+        // message is encrypted for each hop instead
+        logWarning("No aes key for " + msg.getTo() + ", sending the msg body unsealed");
+        return encryptor.formatDelimitedMessage(msg);
+    }
+    return encryptor.formatMessage(msg, persona->second.getAesKey());
+}
+
+std::string PluginNMTwoSix::formatClrMessage(const ExtClrMsg &msg) const {
+    if (msg.getSealedPayload() != nullptr) {
+        return encryptor.formatClrMessage(msg, {});
+    }
+    auto persona = uuidToPersonaMap.find(msg.getTo());
+    if (persona == uuidToPersonaMap.end()) {
+        logWarning("No aes key for " + msg.getTo() + ", sending the msg body unsealed");
+        return encryptor.formatDelimitedMessage(static_cast<const ClrMsg &>(msg));
+    }
+    return encryptor.formatClrMessage(msg, persona->second.getAesKey());
+}
+
+void PluginNMTwoSix::updateRoute(const std::string &uuidStr) {
+    auto conns = uuidToConnectionsMap.find(uuidStr);
+    if (conns == uuidToConnectionsMap.end()) {
+        routeTable.remove(uuidStr);
+        return;
+    }
+
+    // Only single personas have a key, multicast groups are keyed per member
+    std::shared_ptr<const std::vector<uint8_t>> key;
+    auto persona = uuidToPersonaMap.find(uuidStr);
+    if (persona != uuidToPersonaMap.end()) {
+        key = std::make_shared<const std::vector<uint8_t>>(persona->second.getAesKey());
+    }
+    routeTable.update(uuidStr, conns->second, std::move(key));
+}
+
+std::vector<std::size_t> PluginNMTwoSix::hopOrder(const RouteTable::Route &route,
+                                                  std::size_t linkRank,
+                                                  const ConnectionID &failedConnId) {
+    std::vector<std::size_t> order;
+    order.reserve(route.hops.size());
+    if (not failedConnId.empty()) {
+        // a resend tries every other connection before the one that failed
+        std::optional<std::size_t> failedHop;
+        for (std::size_t i = 0; i < route.hops.size(); ++i) {
+            if (route.hops[i].connId == failedConnId) {
+                failedHop = i;
+            } else {
+                order.push_back(i);
+            }
+        }
+        if (failedHop) {
+            order.push_back(*failedHop);
+        }
+        return order;
+    }
+    if (linkRank == 0 and adaptiveLinkSelection) {
+        const std::size_t pick = linkStats.select(route.hops, splitTraffic);
+        order.push_back(pick);
+        for (std::size_t i = 0; i < route.hops.size(); ++i) {
+            if (i != pick) {
+                order.push_back(i);
+            }
+        }
+        return order;
+    }
+    order.push_back(linkRank % route.hops.size());
+    for (std::size_t i = linkRank + 1; i < route.hops.size(); ++i) {
+        order.push_back(i);
+    }
+    return order;
+}
+
 ExtClrMsg PluginNMTwoSix::parseMsg(const EncPkg &ePkg) {
+    return parseMsg(ePkg, encryptor.decryptMessage(ePkg.getCipherTextView(), getSelfAesKeyRef()));
+}
+
+ExtClrMsg PluginNMTwoSix::parseMsg(const EncPkg &ePkg, const std::string &decryptedPkg) {
     TRACE_METHOD();
-    auto key = getAesKeyForSelf();
+    const auto &key = getSelfAesKeyRef();
 
-    std::string decryptedPkg = encryptor.decryptEncPkg(ePkg.getCipherText(), key);
     ExtClrMsg parsedMsg("", "", "", 1, 0, 0, UNSET_UUID, UNSET_RING_TTL, 0, MSG_UNDEF, {}, {});
     try {
-        parsedMsg = encryptor.parseDelimitedExtMessage(decryptedPkg);
+        parsedMsg = encryptor.parseExtMessage(decryptedPkg, key);
         parsedMsg.setTraceId(ePkg.getTraceId());
         parsedMsg.setSpanId(ePkg.getSpanId());
     } catch (...) {
@@ -132,17 +232,48 @@ ExtClrMsg PluginNMTwoSix::parseMsg(const EncPkg &ePkg) {
         return parsedMsg;
     }
 
-    logDebug("MsgType: " + std::to_string(parsedMsg.getMsgType()));
-    logDebug("processEncPkg Got Message:");
-    logMessage("    Message: ", parsedMsg.getMsg());
-    logDebug("    from: " + parsedMsg.getFrom());
-    logDebug("    to: " + parsedMsg.getTo());
-    logDebug("    timestamp: " + std::to_string(parsedMsg.getTime()));
-    logDebug("    nonce: " + std::to_string(parsedMsg.getNonce()));
+    if (RACE_LOG_ENABLED(RaceLog::LL_DEBUG)) {
+        logDebug("MsgType: " + std::to_string(parsedMsg.getMsgType()));
+        logDebug("processEncPkg Got Message:");
+        logMessage("    Message: ", parsedMsg.getMsg());
+        logDebug("    from: " + parsedMsg.getFrom());
+        logDebug("    to: " + parsedMsg.getTo());
+        logDebug("    timestamp: " + std::to_string(parsedMsg.getTime()));
+        logDebug("    nonce: " + std::to_string(parsedMsg.getNonce()));
+    }
 
     return parsedMsg;
 }
 
+bool PluginNMTwoSix::parseMsgHeader(const EncPkg &ePkg, ExtClrMsg &parsedMsg,
+                                    std::string &decryptedPkg) {
+    TRACE_METHOD();
+    decryptedPkg = encryptor.decryptMessage(ePkg.getCipherTextView(), getSelfAesKeyRef());
+    if (decryptedPkg.empty()) {
+        return false;
+    }
+
+    try {
+        parsedMsg = encryptor.parseExtMessageHeader(decryptedPkg);
+        parsedMsg.setTraceId(ePkg.getTraceId());
+        parsedMsg.setSpanId(ePkg.getSpanId());
+    } catch (...) {
+        logDebug("failed to parse message header.");
+        return false;
+    }
+
+    if (RACE_LOG_ENABLED(RaceLog::LL_DEBUG)) {
+        logDebug("MsgType: " + std::to_string(parsedMsg.getMsgType()));
+        logDebug("processEncPkg Got Message Header:");
+        logDebug("    from: " + parsedMsg.getFrom());
+        logDebug("    to: " + parsedMsg.getTo());
+        logDebug("    timestamp: " + std::to_string(parsedMsg.getTime()));
+        logDebug("    nonce: " + std::to_string(parsedMsg.getNonce()));
+    }
+
+    return true;
+}
+
 /**
  * @brief Receive notification about a change to the LinkProperties of a Link
  *
@@ -151,13 +282,40 @@ ExtClrMsg PluginNMTwoSix::parseMsg(const EncPkg &ePkg) {
  * @return PluginResponse the status of the Plugin in response to this call
  */
 PluginResponse PluginNMTwoSix::onLinkPropertiesChanged(LinkID linkId,
-                                                       LinkProperties /*linkProperties*/) {
-    // NOTE TO PERFORMERS: this callback will be triggered to notify you that the link properties
-    // have changed. Our stub implementation has no use for this information and simply logs the
-    // event. However, depending on the change in properties for a link you may want to adapt, e.g.
-    // adjust your routing scheme or priority. Note that the link property information will also be
-    // update in subsequent calls to `getLinkProperties()`.
+                                                       LinkProperties linkProperties) {
     TRACE_METHOD(linkId);
+
+    // Re-rank the send connections on this link and rebuild the routes that use them
+    for (const auto &[connId, connLinkId] : connectionToLinkMap) {
+        if (connLinkId != linkId) {
+            continue;
+        }
+        auto uuids = connectionToUuidMap.find(connId);
+        if (uuids == connectionToUuidMap.end() || uuids->second.empty()) {
+            continue;
+        }
+        const std::string uuidStr = personasToString(uuids->second);
+        auto conns = uuidToConnectionsMap.find(uuidStr);
+        if (conns == uuidToConnectionsMap.end()) {
+            continue;
+        }
+        auto &connPropsList = conns->second;
+        auto it = std::find_if(connPropsList.begin(), connPropsList.end(),
+                               [&](const std::pair<ConnectionID, LinkProperties> &connProps) {
+                                   return connProps.first == connId;
+                               });
+        if (it == connPropsList.end()) {
+            continue;
+        }
+        connPropsList.erase(it);
+
+        // Multicast groups of mixed node types are rejected when the connection opens
+        auto persona = uuidToPersonaMap.find(uuids->second.front());
+        PersonaType personaType =
+            persona == uuidToPersonaMap.end() ? P_UNDEF : persona->second.getPersonaType();
+        insertConnection(connPropsList, connId, linkProperties, personaType);
+        updateRoute(uuidStr);
+    }
     return PLUGIN_OK;
 }
 
@@ -172,40 +330,38 @@ PluginResponse PluginNMTwoSix::onLinkPropertiesChanged(LinkID linkId,
 PluginResponse PluginNMTwoSix::onPackageStatusChanged(RaceHandle handle, PackageStatus status) {
     TRACE_METHOD(handle, status);
 
+    linkStats.onPackageStatus(handle, status);
     RaceHandle resendHandle = NULL_RACE_HANDLE;
 
     if (status == PACKAGE_FAILED_GENERIC or status == PACKAGE_FAILED_NETWORK_ERROR or
         status == PACKAGE_FAILED_TIMEOUT) {
-        auto iter = resendMap.find(handle);
-        if (iter == resendMap.end()) {
+        std::vector<ResendTracker::Entry> entries = resendTracker.take(handle);
+        if (entries.empty()) {
             logError("onPackageStatusChanged: (handle=" + std::to_string(handle) +
                      ") Package failed but we did not have a resend entry");
         } else {
             logError("onPackageStatusChanged: (handle=" + std::to_string(handle) +
                      ") Package failed, reopening and queueing to send");
-            const AddressedMsg addrMsg = iter->second;
-            resendMap.erase(iter);
-            resendHandle = sendFormattedMsg(addrMsg.dst, addrMsg.msg, addrMsg.traceId,
-                                            addrMsg.spanId, addrMsg.linkRank + 1);
-        }
-    } else if (status == PACKAGE_SENT) {  // if link was unreliable this is the final status
-        auto iter = resendMap.find(handle);
-        if (iter != resendMap.end()) {
-            const AddressedMsg addrMsg = iter->second;
-            if (!addrMsg.reliable) {
-                resendMap.erase(iter);
+            // A multicast package has an entry for each of its recipients
+            for (const ResendTracker::Entry &entry : entries) {
+                resendHandle = sendFormattedMsg(entry.dst, entry.msg, entry.traceId, entry.spanId,
+                                                BEST_LINK, entry.connId);
             }
         }
+    } else if (status == PACKAGE_SENT) {  // if link was unreliable this is the final status
+        resendTracker.removeIfUnreliable(handle);
     } else if (status == PACKAGE_RECEIVED) {
-        auto iter = resendMap.find(handle);
-        if (iter != resendMap.end()) {
-            resendMap.erase(iter);
-        }
+        resendTracker.remove(handle);
     } else {
         logWarning("onPackageStatusChanged: (handle=" + std::to_string(handle) +
                    ") received PACKAGE_INVALID status");
     }
 
+    LOG_DEBUG("resend tracker: " + std::to_string(resendTracker.size()) + " packages, " +
+              std::to_string(resendTracker.getBytesRetained()) + " bytes retained, " +
+              std::to_string(resendTracker.getNumEvicted()) + " evicted, " +
+              std::to_string(resendTracker.getNumExpired()) + " expired");
+
     bootstrap.onPackageStatusChanged(handle, status, resendHandle);
 
     logInfo("onPackageStatusChanged: returned");
@@ -237,73 +393,162 @@ RaceHandle PluginNMTwoSix::sendFormattedMsg(const std::string &dstUuid,
                                             const std::string &msgString,
                                             const std::uint64_t traceId,
                                             const std::uint64_t spanId) {
-    return sendFormattedMsg(dstUuid, msgString, traceId, spanId, 0);
+    return sendFormattedMsg(dstUuid, std::make_shared<const std::string>(msgString), traceId,
+                            spanId, 0);
 }
 
 RaceHandle PluginNMTwoSix::sendFormattedMsg(const std::string &dstUuid,
-                                            const std::string &msgString,
+                                            const ResendTracker::MsgPtr &msg,
                                             const std::uint64_t traceId, const std::uint64_t spanId,
-                                            const std::size_t linkRank = 0) {
+                                            const std::size_t linkRank,
+                                            const ConnectionID &failedConnId) {
     TRACE_METHOD(dstUuid);
-    try {
-        ExtClrMsg parsedMsg = encryptor.parseDelimitedExtMessage(msgString);
-        logDebug("  sendMsg: msg: " + parsedMsg.getMsg());
-        logDebug("           type: " + std::to_string(parsedMsg.getMsgType()));
-    } catch (...) {
-        logDebug("failed to parse message I am sending.");
+    const std::string &msgString = *msg;
+    // the header is only parsed to log it. The msg body is sealed, so only its size is logged.
+    if (RACE_LOG_ENABLED(RaceLog::LL_DEBUG)) {
+        try {
+            ExtClrMsg parsedMsg = encryptor.parseExtMessageHeader(msgString);
+            logDebug("  sendMsg: uuid: " + std::to_string(parsedMsg.getUuid()) +
+                     ", size: " + std::to_string(msgString.size()));
+            logDebug("           type: " + std::to_string(parsedMsg.getMsgType()));
+        } catch (...) {
+            logDebug("failed to parse message I am sending.");
+        }
     }
 
-    Persona dstPersona;
-    try {
-        dstPersona = uuidToPersonaMap.at(dstUuid);
-    } catch (std::invalid_argument &err) {
+    std::shared_ptr<const RouteTable::Route> route = routeTable.find(dstUuid);
+    if (route == nullptr || route->hops.empty()) {
+        logError("No connection to send to destination: " + dstUuid);
+        return NULL_RACE_HANDLE;
+    }
+    if (route->key == nullptr) {
         logError("Failed to find destination UUID " + dstUuid + " in uuidToPersonaMap");
         return NULL_RACE_HANDLE;
     }
 
-    EncPkg ePkg(traceId, spanId, encryptor.encryptClrMsg(msgString, dstPersona.getAesKey()));
+    EncPkg ePkg(traceId, spanId, encryptor.encryptMessage(msgString, *route->key));
     logMessageOverhead(msgString, ePkg);
 
-    try {
-        auto rankedConns = uuidToConnectionsMap.at(dstUuid);
-        if (rankedConns.size() == 0) {
-            throw std::out_of_range("rankedConns is empty");
+    return sendOnHops(dstUuid, msg, ePkg, *route, hopOrder(*route, linkRank, failedConnId));
+}
+
+RaceHandle PluginNMTwoSix::sendOnHops(const std::string &dstUuid, const ResendTracker::MsgPtr &msg,
+                                      const EncPkg &ePkg, const RouteTable::Route &route,
+                                      const std::vector<std::size_t> &order) {
+    for (std::size_t attempt = 0; attempt < order.size(); ++attempt) {
+        const std::size_t hopIndex = order[attempt];
+        const RouteTable::Hop &hop = route.hops[hopIndex];
+        LOG_DEBUG("Sending package on " + hop.connId);
+        SdkResponse response =
+            raceSdk->sendEncryptedPackage(ePkg, hop.connId, RACE_BATCH_ID_NULL, 0);
+        if (response.status == SDK_OK) {
+            linkStats.onSent(response.handle, hop.connId, response.queueUtilization);
+            resendTracker.add(response.handle,
+                              {dstUuid, msg, ePkg.getTraceId(), ePkg.getSpanId(), hop.reliable,
+                               hop.connId},
+                              resendTracker.maxAgeForLatency(hop.sendLatencyMs));
+            return response.handle;
         }
-        uint8_t finalLinkRank = linkRank % rankedConns.size();
-        ConnectionID connId = rankedConns.at(finalLinkRank).first;
-        logDebug("Sending package on " + connId);
-        SdkResponse response = raceSdk->sendEncryptedPackage(ePkg, connId, RACE_BATCH_ID_NULL, 0);
-        if (response.status != SDK_OK) {
-            logError("sendFormattedMsg failed to send: " +
-                     std::to_string(static_cast<int>(response.handle)));
 
-            if (linkRank + 1 < rankedConns.size()) {
+        linkStats.onRejected(hop.connId, response.queueUtilization);
+        logError("sendFormattedMsg failed to send on " + hop.connId + ": " +
+                 std::to_string(static_cast<int>(response.handle)));
+        if (attempt + 1 < order.size()) {
+            logInfo("retrying on next connection");
+        }
+    }
+    return NULL_RACE_HANDLE;
+}
+
+std::vector<RaceHandle> PluginNMTwoSix::sendFormattedMsgs(
+    const std::vector<std::pair<std::string, ResendTracker::MsgPtr>> &msgs,
+    const std::uint64_t traceId, const std::uint64_t spanId) {
+    TRACE_METHOD(msgs.size());
+    std::vector<RaceHandle> handles(msgs.size(), NULL_RACE_HANDLE);
+
+    // Encrypt each message for its destination and pick the best connection to it
+    std::vector<std::pair<EncPkg, ConnectionID>> packages;
+    std::vector<std::shared_ptr<const RouteTable::Route>> routes;
+    std::vector<std::vector<size_t>> hopOrders;
+    std::vector<size_t> indices;
+    packages.reserve(msgs.size());
+    routes.reserve(msgs.size());
+    hopOrders.reserve(msgs.size());
+    indices.reserve(msgs.size());
+    for (size_t i = 0; i < msgs.size(); ++i) {
+        const std::string &dstUuid = msgs[i].first;
+        std::shared_ptr<const RouteTable::Route> route = routeTable.find(dstUuid);
+        if (route == nullptr || route->hops.empty()) {
+            logError("No connection to send to destination: " + dstUuid);
+            continue;
+        }
+        if (route->key == nullptr) {
+            logError("Failed to find destination UUID " + dstUuid + " in uuidToPersonaMap");
+            continue;
+        }
+
+        EncPkg ePkg(traceId, spanId, encryptor.encryptMessage(*msgs[i].second, *route->key));
+        logMessageOverhead(*msgs[i].second, ePkg);
+        std::vector<size_t> order = hopOrder(*route, 0);
+        packages.emplace_back(std::move(ePkg), route->hops[order.front()].connId);
+        routes.push_back(std::move(route));
+        hopOrders.push_back(std::move(order));
+        indices.push_back(i);
+    }
+
+    if (packages.empty()) {
+        return handles;
+    }
+
+    LOG_DEBUG("Sending " + std::to_string(packages.size()) + " packages");
+    std::vector<SdkResponse> responses =
+        raceSdk->sendEncryptedPackages(packages, RACE_BATCH_ID_NULL, 0);
+    if (responses.size() != packages.size()) {
+        logError("sendFormattedMsgs: expected " + std::to_string(packages.size()) +
+                 " responses but got " + std::to_string(responses.size()));
+        responses.resize(packages.size(), SdkResponse(SDK_INVALID));
+    }
+
+    for (size_t j = 0; j < packages.size(); ++j) {
+        const size_t i = indices[j];
+        const std::string &dstUuid = msgs[i].first;
+        const size_t hopIndex = hopOrders[j].front();
+        const RouteTable::Hop &hop = routes[j]->hops[hopIndex];
+        if (responses[j].status != SDK_OK) {
+            linkStats.onRejected(hop.connId, responses[j].queueUtilization);
+            logError("sendFormattedMsgs failed to send to " + dstUuid + " on " + hop.connId);
+            if (hopOrders[j].size() > 1) {
                 logInfo("retrying on next connection");
-                return sendFormattedMsg(dstUuid, msgString, traceId, spanId, linkRank + 1);
+                // the rest of the connections, in the order chosen for the first attempt
+                hopOrders[j].erase(hopOrders[j].begin());
+                handles[i] = sendOnHops(dstUuid, msgs[i].second, packages[j].first, *routes[j],
+                                        hopOrders[j]);
             }
-            return NULL_RACE_HANDLE;
+            continue;
         }
-        // get LinkProperties to record whether this is reliable or not
-        LinkProperties props = raceSdk->getLinkProperties(raceSdk->getLinkForConnection(connId));
-        resendMap.emplace(response.handle, AddressedMsg{dstUuid, msgString, traceId, spanId,
-                                                        props.reliable, finalLinkRank});
 
-        return response.handle;
-    } catch (const std::out_of_range &) {
-        logError("No connection to send to destination: " + dstUuid);
-        return NULL_RACE_HANDLE;
+        linkStats.onSent(responses[j].handle, hop.connId, responses[j].queueUtilization);
+        resendTracker.add(responses[j].handle,
+                          {dstUuid, msgs[i].second, traceId, spanId, hop.reliable, hop.connId},
+                          resendTracker.maxAgeForLatency(hop.sendLatencyMs));
+        handles[i] = responses[j].handle;
     }
+
+    return handles;
 }
 
 bool PluginNMTwoSix::sendBootstrapPkg(const ConnectionID &connId, const std::string &dstUuid,
                                       const std::string &msgString) {
     TRACE_METHOD(dstUuid);
-    try {
-        ExtClrMsg parsedMsg = encryptor.parseDelimitedExtMessage(msgString);
-        logDebug("  sendBootstrapMsg: msg: " + parsedMsg.getMsg());
-        logDebug("              type: " + std::to_string(parsedMsg.getMsgType()));
-    } catch (...) {
-        logDebug("failed to parse message I am sending.");
+    if (RACE_LOG_ENABLED(RaceLog::LL_DEBUG)) {
+        try {
+            ExtClrMsg parsedMsg = encryptor.parseExtMessageHeader(msgString);
+            logDebug("  sendBootstrapMsg: uuid: " + std::to_string(parsedMsg.getUuid()) +
+                     ", size: " + std::to_string(msgString.size()));
+            logDebug("              type: " + std::to_string(parsedMsg.getMsgType()));
+        } catch (...) {
+            logDebug("failed to parse message I am sending.");
+        }
     }
 
     Persona dstPersona;
@@ -316,7 +561,7 @@ bool PluginNMTwoSix::sendBootstrapPkg(const ConnectionID &connId, const std::str
 
     logDebug("Sending package on " + connId);
     SdkResponse response = raceSdk->sendBootstrapPkg(
-        connId, raceUuid, encryptor.encryptClrMsg(msgString, dstPersona.getAesKey()), 0);
+        connId, raceUuid, encryptor.encryptMessage(msgString, dstPersona.getAesKey()), 0);
     if (response.status != SDK_OK) {
         logError("sendFormattedMsg failed to send: ");
         return false;
@@ -386,6 +631,7 @@ PluginResponse PluginNMTwoSix::handleConnectionOpened(RaceHandle handle, const C
 
             // Updates the ranked connections by-reference
             insertConnection(uuidToConnectionsMap[uuidStr], connId, properties, personaType);
+            updateRoute(uuidStr);
             logDebug(logPrefix + "send opened: " + connId + " to " + uuidStr);
         }
         // if it is a bidirectional link but no associated persona,
@@ -445,6 +691,7 @@ PluginResponse PluginNMTwoSix::handleConnectionClosed(RaceHandle handle, const C
                                  return connProps.first == connId;
                              }));
             // TODO: if connPropsList.size() == 0 should it be removed from uuidToConnectionsMap?
+            updateRoute(uuidStr);
 
             // Link availability may have changed, so reselect in case a better one exists
             std::vector<LinkID> potentialLinks = raceSdk->getLinksForPersonas(uuidList, connType);
@@ -515,6 +762,7 @@ PluginResponse PluginNMTwoSix::onConnectionStatusChanged(RaceHandle handle, Conn
 
     PluginResponse response = PLUGIN_OK;
     if (status == CONNECTION_OPEN) {
+        connectionToLinkMap[connId] = linkId;
         response = handleConnectionOpened(handle, connId, properties);
 
         if (useLinkWizard) {
@@ -523,6 +771,8 @@ PluginResponse PluginNMTwoSix::onConnectionStatusChanged(RaceHandle handle, Conn
             }
         }
     } else if (status == CONNECTION_CLOSED) {
+        connectionToLinkMap.erase(connId);
+        linkStats.remove(connId);
         response = handleConnectionClosed(handle, connId, linkId, properties);
     } else if (status == CONNECTION_AVAILABLE) {
         logDebug("connection available for connection: " + connId);
@@ -782,8 +1032,12 @@ LinkManager *PluginNMTwoSix::getLinkManager() {
  */
 void PluginNMTwoSix::logMessageOverhead(const std::string &formattedMessage,
                                         const EncPkg &package) {
+    if (!RACE_LOG_ENABLED(RaceLog::LL_INFO)) {
+        return;
+    }
+
     const size_t messageSizeInBytes = encryptor.getMsgLength(formattedMessage);
-    const size_t packageSizeInBytes = package.getRawData().size();
+    const size_t packageSizeInBytes = package.getSize();
     const size_t overhead = packageSizeInBytes - messageSizeInBytes;
 
     std::stringstream messageToLog;
@@ -35,20 +35,14 @@
 #include "LinkWizard.h"
 #include "Persona.h"
 #include "RaceCrypto.h"
+#include "LinkStats.h"
+#include "ResendTracker.h"
+#include "RouteTable.h"
 
 #define BEST_LINK 0
 
 class PluginNMTwoSix : public IRacePluginNM {
 public:
-    struct AddressedMsg {
-        const std::string dst;
-        const std::string msg;
-        std::uint64_t traceId;
-        std::uint64_t spanId;
-        bool reliable;
-        std::size_t linkRank;
-    };
-
     PluginResponse shutdown() override;
 
     /**
@@ -110,6 +104,28 @@ public:
      */
     ExtClrMsg parseMsg(const EncPkg &ePkg);
 
+    /**
+     * @brief Parse an ExtClrMsg out of an ePkg that has already been decrypted, e.g. by
+     * parseMsgHeader
+     *
+     * @param ePkg The encrypted package, for its trace and span IDs
+     * @param decryptedPkg The decrypted contents of ePkg
+     * @return The parsed cleartext message
+     */
+    ExtClrMsg parseMsg(const EncPkg &ePkg, const std::string &decryptedPkg);
+
+    /**
+     * @brief Parse only the routing header of an ePkg, leaving the msg body sealed (see
+     * RaceCrypto::parseExtMessageHeader). Used to forward a message without decrypting its body.
+     *
+     * @param ePkg The encrypted package to parse
+     * @param parsedMsg Set to the parsed message header on success
+     * @param decryptedPkg Set to the decrypted contents of ePkg, so that parseMsg can open the msg
+     * body without decrypting ePkg again
+     * @return true if the package was decrypted and parsed, false otherwise
+     */
+    bool parseMsgHeader(const EncPkg &ePkg, ExtClrMsg &parsedMsg, std::string &decryptedPkg);
+
     /**
      * @brief Notify network manager about a change in package status. The handle will correspond to
      * a handle returned inside an SdkResponse to a previous sendEncryptedPackage call.
@@ -367,6 +383,26 @@ public:
      */
     virtual std::vector<uint8_t> getAesKeyForSelf();
 
+    /**
+     * @brief Format a msg for sending (see RaceCrypto::formatMessage). A msg body that has not been
+     * sealed yet is sealed for the persona the msg is addressed to. If that persona's key is
+     * unknown, e.g. for a client bootstrapped by another node, the msg is formatted with
+     * RaceCrypto::formatDelimitedMessage instead, so the whole msg is encrypted for each hop.
+     *
+     * @param msg The msg to format
+     * @return the formatted version of msg
+     */
+    std::string formatMessage(const ExtClrMsg &msg) const;
+
+    /**
+     * @brief Format only the ClrMsg fields of a msg for sending, in the same way as formatMessage
+     * (see RaceCrypto::formatClrMessage)
+     *
+     * @param msg The msg to format
+     * @return the formatted version of msg as a ClrMsg
+     */
+    std::string formatClrMessage(const ExtClrMsg &msg) const;
+
 protected:
     PluginNMTwoSix(IRaceSdkNM *sdk, PersonaType personaType);
 
@@ -374,17 +410,93 @@ protected:
      * @brief Sends a stringified message to the specified destination persona.
      *
      * @param dstUuid The uuid of the persona to send to
-     * @param msgString The stringified message to encrypt and send
+     * @param msgString The stringified message to encrypt and send. It is kept in resendTracker
+     * until the package reaches a final status, so share it between destinations where possible.
      * @param traceId The OpenTracing traceId of the original received EncPkg to continue on
      * @param spanId The OpenTracing spanId of the original received EncPkg to continue on
      * @param linkRank The rank of the link to use, zero being highest rank.
+     * @param failedConnId When resending a failed package, the connection it failed on (see
+     * hopOrder). Empty for a first attempt.
      *
      * @return The RaceHandle associated with the sent encrypted package, or NULL_RACE_HANDLE if the
      * function fails.
      */
-    RaceHandle sendFormattedMsg(const std::string &dstUuid, const std::string &msgString,
+    RaceHandle sendFormattedMsg(const std::string &dstUuid, const ResendTracker::MsgPtr &msgString,
                                 const std::uint64_t traceId, const std::uint64_t spanId,
-                                const std::size_t linkRank);
+                                const std::size_t linkRank, const ConnectionID &failedConnId = {});
+
+    /**
+     * @brief Sends stringified messages to several destination personas with a single call to
+     * sendEncryptedPackages. Each message goes out on the best link to its destination. Any message
+     * the SDK fails to accept is retried on the rest of the links to its destination.
+     *
+     * @param msgs The uuid of the persona to send to and the stringified message to encrypt and
+     * send, for each message. Destinations getting the same message should share it.
+     * @param traceId The OpenTracing traceId of the original received EncPkg to continue on
+     * @param spanId The OpenTracing spanId of the original received EncPkg to continue on
+     *
+     * @return The RaceHandle associated with each sent encrypted package, or NULL_RACE_HANDLE for
+     * any that failed, in the same order as msgs
+     */
+    std::vector<RaceHandle> sendFormattedMsgs(
+        const std::vector<std::pair<std::string, ResendTracker::MsgPtr>> &msgs,
+        const std::uint64_t traceId, const std::uint64_t spanId);
+
+    /**
+     * @brief Get the aes key used to encrypt messages for this node without copying it. The
+     * reference is valid until uuidToPersonaMap is modified.
+     *
+     * @return the key
+     */
+    const std::vector<uint8_t> &getSelfAesKeyRef() const;
+
+    /**
+     * @brief Get the aes key of a persona without copying it. The reference is valid until
+     * uuidToPersonaMap is modified.
+     *
+     * @param uuid The persona
+     * @return the key. If the persona is unknown, an invalid_argument exception is thrown.
+     */
+    const std::vector<uint8_t> &getAesKeyRef(const std::string &uuid) const;
+
+    /**
+     * @brief Rebuild the route to a destination from its ranked connections in
+     * uuidToConnectionsMap and its persona. Must be called whenever either changes.
+     *
+     * @param uuidStr The destination UUID, or personasToString of a multicast group
+     */
+    void updateRoute(const std::string &uuidStr);
+
+    /**
+     * @brief Choose the order in which to try the connections of a route. A resend of a failed
+     * package tries the other connections in rank order and the one it failed on last. A first
+     * attempt (linkRank zero) with adaptive link selection enabled starts on the connection picked
+     * by observed performance and falls back on the others in rank order. Otherwise the order
+     * starts at linkRank and goes down the ranked connections.
+     *
+     * @param route The route to the destination
+     * @param linkRank The rank of the link to start on, zero being highest rank. Ignored for a
+     * resend.
+     * @param failedConnId The connection a resent package failed on, or empty for a first attempt
+     * @return The indices into route.hops to try, in order. Each connection appears at most once.
+     */
+    std::vector<std::size_t> hopOrder(const RouteTable::Route &route, std::size_t linkRank,
+                                      const ConnectionID &failedConnId = {});
+
+    /**
+     * @brief Send an encrypted package on the first connection of order that the SDK accepts,
+     * and track it for resending.
+     *
+     * @param dstUuid The uuid of the persona to send to
+     * @param msg The stringified message ePkg was encrypted from, kept for resending
+     * @param ePkg The encrypted package
+     * @param route The route to the destination
+     * @param order The indices into route.hops to try, in order
+     * @return The RaceHandle of the sent package, or NULL_RACE_HANDLE if every connection failed
+     */
+    RaceHandle sendOnHops(const std::string &dstUuid, const ResendTracker::MsgPtr &msg,
+                          const EncPkg &ePkg, const RouteTable::Route &route,
+                          const std::vector<std::size_t> &order);
 
     IRaceSdkNM *raceSdk;
     std::unordered_map<std::string, Persona> uuidToPersonaMap;
@@ -394,10 +506,13 @@ protected:
     std::unordered_map<std::string, std::vector<std::pair<ConnectionID, LinkProperties>>>
         uuidToConnectionsMap;
     std::unordered_map<ConnectionID, std::vector<std::string>> connectionToUuidMap;
+    std::unordered_map<ConnectionID, LinkID> connectionToLinkMap;
+    // Read by the send paths instead of uuidToConnectionsMap and uuidToPersonaMap
+    RouteTable routeTable;
     std::mutex connectionLock;
 
     RaceCrypto encryptor;
-    std::unordered_map<RaceHandle, const AddressedMsg> resendMap;
+    ResendTracker resendTracker;
     std::unordered_map<std::string, Persona> uuidsToSendTo;
     std::string raceUuid;
     PersonaType myPersonaType;
@@ -405,6 +520,9 @@ protected:
     bool useLinkWizard;
     bool linkWizardInitialized;
     double lookbackSeconds;
+    LinkStats linkStats;
+    bool adaptiveLinkSelection;
+    bool splitTraffic;
     PluginConfig config;
 
     BootstrapManager bootstrap;
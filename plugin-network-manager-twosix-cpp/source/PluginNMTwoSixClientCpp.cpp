@@ -252,15 +252,7 @@ bool PluginNMTwoSixClientCpp::rankLinkProperties(const LinkProperties &prop1,
 
 void PluginNMTwoSixClientCpp::addSeenMessage(MsgHash hash) {
     TRACE_METHOD();
-    if (seenMessages.size() > clientConfig.maxSeenMessages) {
-        logDebug("    trimming seenMessages from " + std::to_string(seenMessages.size()));
-        std::int32_t trimEnd = (clientConfig.maxSeenMessages / 10) + 1;
-        auto end = seenMessages.begin();
-        std::advance(end, trimEnd);
-        seenMessages.erase(seenMessages.begin(), end);
-        logDebug("    trimmed seenMessages to " + std::to_string(seenMessages.size()));
-    }
-    seenMessages.push_back(hash);
+    seenMessages.insert(hash);
 }
 
 PluginResponse PluginNMTwoSixClientCpp::processClrMsg(RaceHandle handle, const ClrMsg &msg) {
@@ -278,7 +270,7 @@ PluginResponse PluginNMTwoSixClientCpp::processClrMsg(RaceHandle handle, const C
     }
 
     MsgHash md = encryptor.getMessageHash(msg);
-    if (seenMessages.get<unique>().count(md) == 0) {
+    if (!seenMessages.contains(md)) {
         addSeenMessage(md);
     } else {
         logError("new ClrMsg is identical to previously sent message");
@@ -305,7 +297,7 @@ PluginResponse PluginNMTwoSixClientCpp::processClrMsg(RaceHandle handle, const C
 
 PluginResponse PluginNMTwoSixClientCpp::handleReceivedMsg(const ExtClrMsg &parsedMsg) {
     MsgHash md = encryptor.getMessageHash(parsedMsg);
-    if (seenMessages.get<unique>().count(md) == 0) {
+    if (!seenMessages.contains(md)) {
         addSeenMessage(md);
     } else {
         logInfo("Package duplicate to one already seen. Ignoring");
@@ -354,6 +346,7 @@ void PluginNMTwoSixClientCpp::loadConfigs() {
     if (!loadClientConfig(*raceSdk, clientConfig)) {
         throw std::logic_error("failed to parse network manager config file.");
     }
+    seenMessages.reset(clientConfig.maxSeenMessages);
 
     // Build the uuidsToSendTo map
     for (auto uuid : clientConfig.entranceCommittee) {
@@ -369,6 +362,14 @@ void PluginNMTwoSixClientCpp::loadConfigs() {
     // Set base config values
     useLinkWizard = clientConfig.useLinkWizard;
     lookbackSeconds = clientConfig.lookbackSeconds;
+    resendTracker.setLimits(clientConfig.maxResendBytes,
+                            std::chrono::duration_cast<ResendTracker::Clock::duration>(
+                                std::chrono::duration<double>(clientConfig.maxResendAgeSeconds)));
+    adaptiveLinkSelection = clientConfig.adaptiveLinkSelection;
+    splitTraffic = clientConfig.splitTraffic;
+    linkStats.setParameters(LinkStats::DEFAULT_ALPHA,
+                            std::chrono::duration_cast<LinkStats::Clock::duration>(
+                                std::chrono::duration<double>(clientConfig.maxResendAgeSeconds)));
 
     // Log parsed configuration
     nlohmann::json jsonConfig = clientConfig;
@@ -380,69 +381,81 @@ bool PluginNMTwoSixClientCpp::sendMulticastMsg(const std::vector<std::string> &u
     auto uuidStr = personasToString(uuidList);
     TRACE_METHOD(uuidStr, msg.getMsg());
 
-    std::string formattedMsg = encryptor.formatDelimitedMessage(msg);
-
+    // Every recipient shares the one copy kept for resending. It is sent as an ExtClrMsg so that
+    // relays, which can not open the payload, get its UUID.
+    ResendTracker::MsgPtr formattedMsg;
     try {
-        auto rankedConns = uuidToConnectionsMap.at(uuidStr);
-        if (rankedConns.size() == 0) {
-            throw std::out_of_range("rankedConns is empty");
+        formattedMsg = std::make_shared<const std::string>(formatMessage(ExtClrMsg(msg)));
+    } catch (const std::exception &e) {
+        logError(logPrefix + "Failed to format message for " + msg.getTo() + ": " + e.what());
+        return false;
+    }
+
+    std::shared_ptr<const RouteTable::Route> route = routeTable.find(uuidStr);
+    if (route == nullptr || route->hops.empty()) {
+        logError(logPrefix + "No connection to send to destination: " + uuidStr);
+        return false;
+    }
+    // Encrypt the message once for the whole group. Each recipient unwraps its own copy of the
+    // content key.
+    std::vector<std::vector<uint8_t>> keys;
+    keys.reserve(uuidList.size());
+    for (const auto &uuid : uuidList) {
+        auto persona = uuidToPersonaMap.find(uuid);
+        if (persona == uuidToPersonaMap.end()) {
+            logError(logPrefix + "Failed to find destination UUID " + uuid +
+                     " in uuidToPersonaMap");
+            return false;
         }
-        uint8_t finalLinkRank = linkRank % rankedConns.size();
-        ConnectionID connId = rankedConns.at(finalLinkRank).first;
-        logDebug(logPrefix + "Sending package on " + connId);
+        keys.push_back(persona->second.getAesKey());
+    }
 
-        LinkProperties props = raceSdk->getLinkProperties(raceSdk->getLinkForConnection(connId));
-        uint64_t batchId = props.isFlushable ? ++nextBatchId : RACE_BATCH_ID_NULL;
+    EncPkg ePkg(msg.getTraceId(), msg.getSpanId(),
+                encryptor.encryptMulticastMessage(*formattedMsg, keys));
+    logMessageOverhead(*formattedMsg, ePkg);
 
-        bool anyError = false;
-        for (const auto &uuid : uuidList) {
-            Persona persona;
-            try {
-                persona = uuidToPersonaMap.at(uuid);
-            } catch (std::invalid_argument &err) {
-                logError(logPrefix + "Failed to find destination UUID " + uuid +
-                         " in uuidToPersonaMap");
-                anyError = true;
-                break;
-            }
+    const std::vector<size_t> order = hopOrder(*route, linkRank);
+    for (size_t attempt = 0; attempt < order.size(); ++attempt) {
+        const RouteTable::Hop &hop = route->hops[order[attempt]];
+        logDebug(logPrefix + "Sending package on " + hop.connId);
 
-            EncPkg ePkg(msg.getTraceId(), msg.getSpanId(),
-                        encryptor.encryptClrMsg(formattedMsg, persona.getAesKey()));
-            logMessageOverhead(formattedMsg, ePkg);
+        uint64_t batchId = hop.isFlushable ? ++nextBatchId : RACE_BATCH_ID_NULL;
 
-            SdkResponse response = raceSdk->sendEncryptedPackage(ePkg, connId, batchId, 0);
-            if (response.status != SDK_OK) {
-                logError(logPrefix +
-                         "Failed to send: " + std::to_string(static_cast<int>(response.handle)));
-                anyError = true;
-                break;
-            }
-            // If this package fails, it'll end up getting re-sent to this persona over a unicast
+        bool anyError = false;
+        SdkResponse response = raceSdk->sendEncryptedPackage(ePkg, hop.connId, batchId, 0);
+        if (response.status != SDK_OK) {
+            linkStats.onRejected(hop.connId, response.queueUtilization);
+            logError(logPrefix +
+                     "Failed to send: " + std::to_string(static_cast<int>(response.handle)));
+            anyError = true;
+        } else {
+            linkStats.onSent(response.handle, hop.connId, response.queueUtilization);
+            // If this package fails, it'll end up getting re-sent to each persona over a unicast
             // link rather than a multicast link
-            resendMap.emplace(response.handle, AddressedMsg{uuid, formattedMsg, msg.getTraceId(),
-                                                            msg.getSpanId(), props.reliable, 0});
+            for (const auto &uuid : uuidList) {
+                resendTracker.add(
+                    response.handle,
+                    {uuid, formattedMsg, msg.getTraceId(), msg.getSpanId(), hop.reliable,
+                     hop.connId},
+                    resendTracker.maxAgeForLatency(hop.sendLatencyMs));
+            }
         }
 
-        if (props.isFlushable) {
-            SdkResponse response = raceSdk->flushChannel(props.channelGid, batchId, 0);
-            if (response.status != SDK_OK) {
-                logError(logPrefix + "Failed to flush channel " + props.channelGid);
+        if (hop.isFlushable) {
+            SdkResponse flushResponse = raceSdk->flushChannel(hop.channelGid, batchId, 0);
+            if (flushResponse.status != SDK_OK) {
+                logError(logPrefix + "Failed to flush channel " + hop.channelGid);
                 anyError = true;
             }
         }
 
-        if (anyError) {
-            if (linkRank + 1 < rankedConns.size()) {
-                logInfo(logPrefix + "retrying on next connection");
-                return sendMulticastMsg(uuidList, msg, linkRank + 1);
-            }
-            return false;
+        if (!anyError) {
+            return true;
+        }
+        if (attempt + 1 < order.size()) {
+            logInfo(logPrefix + "retrying on next connection");
         }
-        return true;
-    } catch (const std::out_of_range &) {
-        logError(logPrefix + "No connection to send to destination: " + uuidStr);
     }
-
     return false;
 }
 
@@ -455,7 +468,14 @@ bool PluginNMTwoSixClientCpp::sendMulticastMsg(const std::vector<std::string> &u
  * @return The RaceHandle associated with the sent encrypted package.
  */
 RaceHandle PluginNMTwoSixClientCpp::sendMsg(const std::string &dstUuid, const ClrMsg &msg) {
-    std::string formattedMsg = encryptor.formatDelimitedMessage(msg);
+    // Sent as an ExtClrMsg so that relays, which can not open the payload, get its UUID
+    ResendTracker::MsgPtr formattedMsg;
+    try {
+        formattedMsg = std::make_shared<const std::string>(formatMessage(ExtClrMsg(msg)));
+    } catch (const std::exception &e) {
+        logError("sendMsg: failed to format message for " + msg.getTo() + ": " + e.what());
+        return NULL_RACE_HANDLE;
+    }
     return sendFormattedMsg(dstUuid, formattedMsg, msg.getTraceId(), msg.getSpanId(), BEST_LINK);
 }
 
@@ -19,20 +19,12 @@
 #define __PLUGIN_NETWORK_MANAGER_TWOSIX_CLIENT_CPP_H__
 
 #include <atomic>
-#include <boost/multi_index/identity.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/sequenced_index.hpp>
-#include <boost/multi_index_container.hpp>
 
 #include "ClearMessagePackageTracker.h"
 #include "ConfigNMTwoSix.h"
+#include "DedupCache.h"
 #include "PluginNMTwoSix.h"
 
-namespace bmi = boost::multi_index;
-using OrderedHashSet = bmi::multi_index_container<
-    MsgHash, bmi::indexed_by<bmi::sequenced<>,
-                             bmi::ordered_unique<bmi::tag<struct unique>, bmi::identity<MsgHash>>>>;
-
 class PluginNMTwoSixClientCpp : public PluginNMTwoSix {
 public:
     explicit PluginNMTwoSixClientCpp(IRaceSdkNM *sdk);
@@ -121,8 +113,8 @@ public:
     std::vector<std::string> getExpectedChannels(const std::string &uuid) override;
 
     /**
-     * @brief Packs a ClrMsg into a string to call sendFormattedMsg(..., std::string &msgString,
-     * ...) for each destination in the multicast group
+     * @brief Packs a ClrMsg into a string and sends it to every destination in the multicast group
+     * as a single package (see RaceCrypto::encryptMulticastMessage)
      *
      * @param uuidList The UUIDs of the personas in the multicast group
      * @param msg The ClrMsg to process
@@ -210,13 +202,13 @@ protected:
 
 private:
     ConfigNMTwoSixClient clientConfig;
-    OrderedHashSet seenMessages;
+    DedupCache<MsgHash> seenMessages{clientConfig.maxSeenMessages};
     ClearMessagePackageTracker messageStatusTracker;
     std::atomic<uint64_t> nextBatchId{0};
 
     /**
-     * @brief Adds the hash to the seenMessages structure; trims 10% of the oldest hashes if the
-     * size exceeds maxSeenMessages
+     * @brief Adds the hash to the seenMessages structure; evicts the oldest hash if it already
+     * holds maxSeenMessages
      *
      * @param hash The MsgHash to add to seenMessages
      */
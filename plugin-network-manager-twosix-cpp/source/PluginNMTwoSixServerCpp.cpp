@@ -19,12 +19,14 @@
 
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>  // std::chrono::seconds
 #include <cstring>
 #include <ctime>
 #include <exception>
 #include <functional>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <nlohmann/json.hpp>
 #include <random>
@@ -33,6 +35,7 @@
 #include <thread>  // std::this_thread::sleep_for
 
 #include "ConfigPersonas.h"
+#include "ErasureCode.h"
 #include "ExtClrMsg.h"
 #include "JsonIO.h"
 #include "Log.h"
@@ -40,6 +43,9 @@
 
 #define FULL_FLOODING 0
 
+// Number of erasure coded ring msgs to keep fragments of while waiting for the rest
+static const size_t MAX_PENDING_FRAGMENTED_MSGS = 1000;
+
 using json = nlohmann::json;
 
 PluginNMTwoSixServerCpp::PluginNMTwoSixServerCpp(IRaceSdkNM *sdk) : PluginNMTwoSix(sdk, P_SERVER) {
@@ -208,15 +214,24 @@ PluginResponse PluginNMTwoSixServerCpp::processEncPkg(
     RaceHandle /*handle*/, const EncPkg &recEncPkg, const std::vector<std::string> & /*connIDs*/) {
     TRACE_METHOD();
 
-    // Try and decrypt and parse the message. If it does not parse, return and do nothing
-    ExtClrMsg parsedMsg = parseMsg(recEncPkg);
-    if (parsedMsg.getMsg() == "") {
+    // Try and decrypt and parse the message header. If it does not parse, return and do nothing.
+    // The msg body is only decrypted if the message is for this node; otherwise it is forwarded
+    // still sealed.
+    ExtClrMsg parsedMsg;
+    std::string decryptedPkg;
+    if (!parseMsgHeader(recEncPkg, parsedMsg, decryptedPkg)) {
         logInfo("Package Not Decrypted (Not for Me)");
         return PLUGIN_OK;
     }
 
     // If it's for this node and from a known sender, process the message
     if (parsedMsg.getTo() == raceUuid) {
+        parsedMsg = parseMsg(recEncPkg, decryptedPkg);
+        if (parsedMsg.getMsg() == "") {
+            logInfo("Package Not Decrypted (Not for Me)");
+            return PLUGIN_OK;
+        }
+
         if (uuidToPersonaMap.count(parsedMsg.getFrom()) == 0) {
             logWarning("Received message for unknown UUID: " + parsedMsg.getFrom());
             return PLUGIN_OK;
@@ -251,6 +266,8 @@ void PluginNMTwoSixServerCpp::loadConfigs() {
     if (!loadServerConfig(*raceSdk, serverConfig)) {
         throw std::logic_error("failed to parse network manager config file.");
     }
+    staleUuids.reset(serverConfig.maxStaleUuids);
+    floodedUuids.reset(serverConfig.maxFloodedUuids);
 
     // Build the uuidsToSendTo map
     for (auto uuid : serverConfig.exitClients) {
@@ -274,6 +291,26 @@ void PluginNMTwoSixServerCpp::loadConfigs() {
     // Set base config values
     useLinkWizard = serverConfig.useLinkWizard;
     lookbackSeconds = serverConfig.lookbackSeconds;
+    resendTracker.setLimits(serverConfig.maxResendBytes,
+                            std::chrono::duration_cast<ResendTracker::Clock::duration>(
+                                std::chrono::duration<double>(serverConfig.maxResendAgeSeconds)));
+    adaptiveLinkSelection = serverConfig.adaptiveLinkSelection;
+    splitTraffic = serverConfig.splitTraffic;
+    linkStats.setParameters(LinkStats::DEFAULT_ALPHA,
+                            std::chrono::duration_cast<LinkStats::Clock::duration>(
+                                std::chrono::duration<double>(serverConfig.maxResendAgeSeconds)));
+
+    if (serverConfig.ringStrategy == "redundant") {
+        ringStrategy = RING_REDUNDANT;
+    } else if (serverConfig.ringStrategy == "failover") {
+        ringStrategy = RING_FAILOVER;
+    } else if (serverConfig.ringStrategy == "erasure") {
+        ringStrategy = RING_ERASURE;
+    } else {
+        logWarning(logPrefix + "Unknown ring strategy " + serverConfig.ringStrategy +
+                   ", using redundant");
+        ringStrategy = RING_REDUNDANT;
+    }
 
     // Log parsed configuration
     nlohmann::json jsonConfig = serverConfig;
@@ -390,45 +427,29 @@ bool PluginNMTwoSixServerCpp::rankLinkProperties(const LinkProperties &prop1,
 }
 
 /**
- * @brief Adds the UUID to the staleUuids structure; trims 10% of the oldest UUIDs if the size
- * exceeeds maxStaleUuids
+ * @brief Adds the UUID to the staleUuids structure; evicts the oldest UUID if it already holds
+ * maxStaleUuids
  *
  * @param uuid The MsgUuid uuid to add to staleUuids
  */
 void PluginNMTwoSixServerCpp::addStaleUuid(MsgUuid uuid) {
     TRACE_METHOD(uuid);
-    if (staleUuids.size() > serverConfig.maxStaleUuids) {
-        logDebug("    trimming staleUuids from " + std::to_string(staleUuids.size()));
-        std::int32_t trimEnd = (serverConfig.maxStaleUuids / 10) + 1;
-        auto end = staleUuids.begin();
-        std::advance(end, trimEnd);
-        staleUuids.erase(staleUuids.begin(), end);
-        logDebug("    trimmed staleUuids to " + std::to_string(staleUuids.size()));
-    }
     if (uuid != UNSET_UUID) {
-        staleUuids.push_back(uuid);
+        staleUuids.insert(uuid);
         logDebug("  addStaleUuid: returned");
     }
 }
 
 /**
- * @brief Adds the UUID to the floodedUuids structure; trims 10% of the oldest UUIDs if the size
- * exceeeds maxFloodedUuids.
+ * @brief Adds the UUID to the floodedUuids structure; evicts the oldest UUID if it already holds
+ * maxFloodedUuids.
  *
  * @param uuid The MsgUuid uuid to add to floodedUuids
  */
 void PluginNMTwoSixServerCpp::addFloodedUuid(MsgUuid uuid) {
     TRACE_METHOD(uuid);
-    if (floodedUuids.size() > serverConfig.maxFloodedUuids) {
-        logDebug("    trimming floodedUuids from " + std::to_string(floodedUuids.size()));
-        std::int32_t trimEnd = (serverConfig.maxStaleUuids / 10) + 1;
-        auto end = floodedUuids.begin();
-        std::advance(end, trimEnd);
-        floodedUuids.erase(floodedUuids.begin(), end);
-        logDebug("    trimmed to " + std::to_string(floodedUuids.size()));
-    }
     if (uuid != UNSET_UUID) {
-        floodedUuids.push_back(uuid);
+        floodedUuids.insert(uuid);
         logDebug("  addFloodedUuid: returned");
     }
 }
@@ -460,7 +481,7 @@ void PluginNMTwoSixServerCpp::routeMsg(ExtClrMsg &msg) {
  */
 void PluginNMTwoSixServerCpp::startRingMsg(const ExtClrMsg &msg) {
     TRACE_METHOD();
-    if (staleUuids.get<unique>().count(msg.getUuid()) > 0) {
+    if (staleUuids.contains(msg.getUuid())) {
         // already saw this msg previously
         logInfo("Received additional copy of msg with uuid=" + std::to_string(msg.getUuid()));
         return;
@@ -482,17 +503,172 @@ void PluginNMTwoSixServerCpp::sendToRings(const ExtClrMsg &msg) {
         logError("Attempted to append a second Ring-TTL message, bad logic, ignoring");
         return;
     }
+    const size_t numRings = serverConfig.rings.size();
+    if (numRings == 0) {
+        return;
+    }
+
+    // Seal the msg body once so that every ring carries the same sealed payload. The ring fields
+    // are overwritten for each ring before formatting, so one copy serves every ring. Without the
+    // key of the destination the body stays unsealed (see formatMessage).
+    ExtClrMsg ringMsg = msg.copy();
+    auto dstPersona = uuidToPersonaMap.find(ringMsg.getTo());
+    if (ringMsg.getSealedPayload() == nullptr and dstPersona != uuidToPersonaMap.end()) {
+        ringMsg.setSealedPayload(std::make_shared<const SealedPayload>(
+            encryptor.sealPayload(ringMsg.getMsg(), dstPersona->second.getAesKey())));
+    }
+    std::shared_ptr<const SealedPayload> sealed = ringMsg.getSealedPayload();
+
+    if (ringStrategy == RING_FAILOVER) {
+        // Spread messages across the rings by UUID, moving on to the next ring if sending fails
+        const size_t first = static_cast<size_t>(static_cast<std::uint64_t>(msg.getUuid())) %
+                             numRings;
+        for (size_t attempt = 0; attempt < numRings; ++attempt) {
+            const size_t idx = (first + attempt) % numRings;
+            const RingEntry &ring = serverConfig.rings[idx];
+            logDebug("      sending along ring of length " + std::to_string(ring.length) +
+                     " to " + ring.next);
+            ringMsg.setRingTtl(ring.length - 1);  // so that it ttl=0 when it reaches me
+            ringMsg.setRingIdx(static_cast<int32_t>(idx));
+            auto formattedMsg = std::make_shared<const std::string>(formatMessage(ringMsg));
+            if (sendFormattedMsg(ring.next, formattedMsg, msg.getTraceId(), msg.getSpanId(),
+                                 BEST_LINK) != NULL_RACE_HANDLE) {
+                return;
+            }
+            logWarning("      failed to send along ring to " + ring.next + ", trying next ring");
+        }
+        logError("Failed to send msg along any ring");
+        return;
+    }
+
+    std::vector<std::pair<std::string, ResendTracker::MsgPtr>> ringMsgs;
+    ringMsgs.reserve(numRings);
+
+    // Each ring carries one fragment, any dataCount of which rebuild the sealed payload
+    if (ringStrategy == RING_ERASURE and sealed != nullptr and numRings >= 2 and
+        numRings <= ErasureCode::MAX_FRAGMENTS and
+        sealed->cipherText.size() >= serverConfig.erasureMinBytes and
+        sealed->cipherText.size() <= std::numeric_limits<std::uint32_t>::max()) {
+        const size_t dataCount =
+            (serverConfig.erasureDataRings == 0 or serverConfig.erasureDataRings >= numRings) ?
+                numRings - 1 :
+                serverConfig.erasureDataRings;
+        std::vector<std::string> fragments =
+            ErasureCode::encode(sealed->cipherText, dataCount, numRings);
+
+        PayloadFragment fragment;
+        fragment.dataCount = static_cast<std::uint8_t>(dataCount);
+        fragment.totalCount = static_cast<std::uint8_t>(numRings);
+        fragment.payloadLength = static_cast<std::uint32_t>(sealed->cipherText.size());
+        for (size_t idx = 0; idx < numRings; ++idx) {
+            const RingEntry &ring = serverConfig.rings[idx];
+            logDebug("      sending fragment " + std::to_string(idx) + " along ring of length " +
+                     std::to_string(ring.length) + " to " + ring.next);
+            auto fragmentPayload = std::make_shared<SealedPayload>();
+            fragmentPayload->key = sealed->key;
+            fragmentPayload->cipherText = std::move(fragments[idx]);
+            fragment.index = static_cast<std::uint8_t>(idx);
+            ringMsg.setSealedPayload(std::move(fragmentPayload));
+            ringMsg.setFragment(fragment);
+            ringMsg.setRingTtl(ring.length - 1);  // so that it ttl=0 when it reaches me
+            ringMsg.setRingIdx(static_cast<int32_t>(idx));
+            ringMsgs.emplace_back(
+                ring.next, std::make_shared<const std::string>(formatMessage(ringMsg)));
+        }
+        sendFormattedMsgs(ringMsgs, msg.getTraceId(), msg.getSpanId());
+        return;
+    }
+
     int32_t idx = 0;
-    for (auto ring : serverConfig.rings) {
+    for (auto &ring : serverConfig.rings) {
         logDebug("      sending along ring of length " + std::to_string(ring.length) + " to " +
                  ring.next);
-        ExtClrMsg ringMsg = msg.copy();
-        // logDebug("Copied message, copy's traceId: " + std::to_string(ringMsg.getTraceId()));
         ringMsg.setRingTtl(ring.length - 1);  // so that it ttl=0 when it reaches me
         ringMsg.setRingIdx(idx);
-        sendMsg(ring.next, ringMsg);
+        ringMsgs.emplace_back(
+            ring.next, std::make_shared<const std::string>(formatMessage(ringMsg)));
         idx++;
     }
+    sendFormattedMsgs(ringMsgs, msg.getTraceId(), msg.getSpanId());
+}
+
+/**
+ * @brief Collects the payload fragment of a ring msg that has come back around its ring. Once
+ * enough fragments of the message have arrived, rebuilds its full sealed payload.
+ *
+ * @param msg The fragment to collect. Holds the rebuilt message on return if it is complete.
+ * @return true if msg now holds the full message, false if more fragments are needed
+ */
+bool PluginNMTwoSixServerCpp::assembleFragments(ExtClrMsg &msg) {
+    TRACE_METHOD(msg.getUuid());
+    const PayloadFragment fragment = *msg.getFragment();
+    std::shared_ptr<const SealedPayload> sealed = msg.getSealedPayload();
+    if (sealed == nullptr) {
+        logError("    received fragment without a payload, ignoring");
+        return false;
+    }
+
+    auto it = pendingFragments.find(msg.getUuid());
+    if (it == pendingFragments.end()) {
+        if (pendingFragmentOrder.size() >= MAX_PENDING_FRAGMENTED_MSGS) {
+            // give up on the oldest message still waiting for fragments
+            pendingFragments.erase(pendingFragmentOrder.front());
+            pendingFragmentOrder.pop_front();
+        }
+        it = pendingFragments
+                 .emplace(msg.getUuid(),
+                          std::vector<std::optional<std::string>>(fragment.totalCount))
+                 .first;
+        pendingFragmentOrder.push_back(msg.getUuid());
+    }
+
+    std::vector<std::optional<std::string>> &fragments = it->second;
+    if (fragment.totalCount != fragments.size()) {
+        logError("    received fragment of " + std::to_string(fragment.totalCount) +
+                 " but expected " + std::to_string(fragments.size()) + ", ignoring");
+        return false;
+    }
+    fragments[fragment.index] = sealed->cipherText;
+
+    const auto received = static_cast<size_t>(
+        std::count_if(fragments.begin(), fragments.end(),
+                      [](const std::optional<std::string> &f) { return f.has_value(); }));
+    if (received < fragment.dataCount) {
+        logDebug("    received fragment " + std::to_string(received) + " of " +
+                 std::to_string(fragment.dataCount) + " needed, waiting for more");
+        return false;
+    }
+
+    try {
+        auto payload = std::make_shared<SealedPayload>();
+        payload->key = sealed->key;
+        payload->cipherText = ErasureCode::decode(fragments, fragment.dataCount,
+                                                  fragment.payloadLength);
+        msg.setSealedPayload(std::move(payload));
+        msg.setFragment(std::nullopt);
+    } catch (const std::invalid_argument &error) {
+        logError("    failed to rebuild fragmented msg: " + std::string(error.what()));
+        dropPendingFragments(msg.getUuid());
+        return false;
+    }
+    dropPendingFragments(msg.getUuid());
+    return true;
+}
+
+/**
+ * @brief Forgets the fragments of a msg that has been rebuilt or could not be, so it no longer
+ * counts toward MAX_PENDING_FRAGMENTED_MSGS
+ *
+ * @param uuid The UUID of the msg
+ */
+void PluginNMTwoSixServerCpp::dropPendingFragments(MsgUuid uuid) {
+    pendingFragments.erase(uuid);
+    // msgs are mostly rebuilt in the order their first fragments arrived, so this is usually found
+    // near the front
+    auto it = std::find(pendingFragmentOrder.begin(), pendingFragmentOrder.end(), uuid);
+    if (it != pendingFragmentOrder.end()) {
+        pendingFragmentOrder.erase(it);
+    }
 }
 
 /**
@@ -512,12 +688,16 @@ void PluginNMTwoSixServerCpp::handleRingMsg(ExtClrMsg &msg) {
         msg.decRingTtl();
         // get the nextNode entry for this right ring
         sendMsg(serverConfig.rings.at(static_cast<size_t>(msg.getRingIdx())).next, msg);
-    } else if (floodedUuids.get<unique>().count(msg.getUuid()) == 0) {
+    } else if (!floodedUuids.contains(msg.getUuid())) {
+        // An erasure coded msg is only forwarded once enough of its rings have come back around
+        if (msg.getFragment().has_value() and !assembleFragments(msg)) {
+            return;
+        }
         addFloodedUuid(msg.getUuid());
         std::string dst_client = msg.getTo();
         if (serverConfig.exitClients.count(dst_client) > 0) {
             logDebug("    client is in exitClients, forwarding to: " + dst_client);
-            sendMsg(dst_client, msg.asClrMsg());
+            sendClrMsg(dst_client, msg);
         }
         if (serverConfig.committeeClients.count(dst_client) > 0 and serverConfig.rings.size() > 0) {
             // someone in our committee can reach it, send it around this ring
@@ -565,8 +745,15 @@ void PluginNMTwoSixServerCpp::forwardToNewCommittees(ExtClrMsg &msg) {
     }
 
     logDebug("        forwarding to " + std::to_string(intercom_dsts.size()));
-    for (auto dst : intercom_dsts) {
-        sendMsg(dst, intercomMsg);
+    if (!intercom_dsts.empty()) {
+        // The message is the same for every destination, so only format (and keep) it once
+        auto formattedMsg = std::make_shared<const std::string>(formatMessage(intercomMsg));
+        std::vector<std::pair<std::string, ResendTracker::MsgPtr>> intercomMsgs;
+        intercomMsgs.reserve(intercom_dsts.size());
+        for (auto &dst : intercom_dsts) {
+            intercomMsgs.emplace_back(dst, formattedMsg);
+        }
+        sendFormattedMsgs(intercomMsgs, intercomMsg.getTraceId(), intercomMsg.getSpanId());
     }
 
     // Special-case of floodingFactor <= 0 --> flood to every committee our _committee_ can reach
@@ -591,7 +778,20 @@ void PluginNMTwoSixServerCpp::forwardToNewCommittees(ExtClrMsg &msg) {
  * @param msg The ExtClrMsg to process
  */
 void PluginNMTwoSixServerCpp::sendMsg(const std::string &dstUuid, const ExtClrMsg &msg) {
-    std::string formattedMsg = encryptor.formatDelimitedMessage(msg);
+    auto formattedMsg = std::make_shared<const std::string>(formatMessage(msg));
+    sendFormattedMsg(dstUuid, formattedMsg, msg.getTraceId(), msg.getSpanId(), BEST_LINK);
+}
+
+/**
+ * @brief Packs the ClrMsg fields of an ExtClrMsg into a string to call sendFormattedMsg(...,
+ * std::string &msgString, ...) on. Equivalent to sendMsg(dstUuid, msg.asClrMsg()) except that a
+ * sealed payload is forwarded without being decrypted.
+ *
+ * @param dstUuid The UUID of the persona to send to
+ * @param msg The ExtClrMsg to process
+ */
+void PluginNMTwoSixServerCpp::sendClrMsg(const std::string &dstUuid, const ExtClrMsg &msg) {
+    auto formattedMsg = std::make_shared<const std::string>(formatClrMessage(msg));
     sendFormattedMsg(dstUuid, formattedMsg, msg.getTraceId(), msg.getSpanId(), BEST_LINK);
 }
 
@@ -602,7 +802,14 @@ void PluginNMTwoSixServerCpp::sendMsg(const std::string &dstUuid, const ExtClrMs
  * @param msg The ClrMsg to process
  */
 RaceHandle PluginNMTwoSixServerCpp::sendMsg(const std::string &dstUuid, const ClrMsg &msg) {
-    std::string formattedMsg = encryptor.formatDelimitedMessage(msg);
+    // Sent as an ExtClrMsg so that relays, which can not open the payload, get its UUID
+    ResendTracker::MsgPtr formattedMsg;
+    try {
+        formattedMsg = std::make_shared<const std::string>(formatMessage(ExtClrMsg(msg)));
+    } catch (const std::exception &e) {
+        logError("sendMsg: failed to format message for " + msg.getTo() + ": " + e.what());
+        return NULL_RACE_HANDLE;
+    }
     return sendFormattedMsg(dstUuid, formattedMsg, msg.getTraceId(), msg.getSpanId(), BEST_LINK);
 }
 
@@ -642,6 +849,8 @@ void PluginNMTwoSixServerCpp::addClient(const std::string &persona, const RawDat
     client.setDisplayName(persona);
 
     uuidToPersonaMap[client.getRaceUuid()] = client;
+    routeTable.updateKey(client.getRaceUuid(),
+                         std::make_shared<const std::vector<uint8_t>>(client.getAesKey()));
 
     serverConfig.exitClients.emplace(persona);
     serverConfig.committeeClients.emplace(persona);
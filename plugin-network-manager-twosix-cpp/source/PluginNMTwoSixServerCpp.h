@@ -18,23 +18,18 @@
 #ifndef __PLUGIN_NETWORK_MANAGER_TWOSIX_SERVER_CPP_H__
 #define __PLUGIN_NETWORK_MANAGER_TWOSIX_SERVER_CPP_H__
 
-#include <boost/multi_index/identity.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/sequenced_index.hpp>
-#include <boost/multi_index_container.hpp>
+#include <deque>
+#include <optional>
+#include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "ConfigNMTwoSix.h"
+#include "DedupCache.h"
 #include "ExtClrMsg.h"
 #include "PluginNMTwoSix.h"
 
-namespace bmi = boost::multi_index;
-using OrderedUuidSet = bmi::multi_index_container<
-    MsgUuid, bmi::indexed_by<bmi::sequenced<>,
-                             bmi::ordered_unique<bmi::tag<struct unique>, bmi::identity<MsgUuid>>>>;
-
 class PluginNMTwoSixServerCpp : public PluginNMTwoSix {
 public:
     explicit PluginNMTwoSixServerCpp(IRaceSdkNM *sdk);
@@ -169,16 +164,16 @@ public:
     std::vector<std::string> getExpectedChannels(const std::string &uuid) override;
 
     /**
-     * @brief Adds the UUID to the staleUuids structure; trims 10% of the oldest UUIDs if the size
-     * exceeeds maxStaleUuids
+     * @brief Adds the UUID to the staleUuids structure; evicts the oldest UUID if it already holds
+     * maxStaleUuids
      *
      * @param uuid The MsgUuid uuid to add to staleUuids
      */
     void addStaleUuid(MsgUuid uuid);
 
     /**
-     * @brief Adds the UUID to the floodedUuids structure; trims 10% of the oldest UUIDs if the size
-     * exceeeds maxFloodedUuids.
+     * @brief Adds the UUID to the floodedUuids structure; evicts the oldest UUID if it already
+     * holds maxFloodedUuids.
      *
      * @param uuid The MsgUuid uuid to add to floodedUuids
      */
@@ -205,13 +200,24 @@ public:
     void startRingMsg(const ExtClrMsg &msg);
 
     /**
-     * @brief Sends the msg out on each ring this node knows about, setting the ringTtl and ringIdx
-     * variables appropriately for each.
+     * @brief Sends the msg out on the rings this node knows about, setting the ringTtl and ringIdx
+     * variables appropriately for each. Depending on the ring strategy, a full copy goes around
+     * every ring, a single ring is used (failing over to the next ring if sending fails), or the
+     * sealed payload is erasure coded so that each ring carries one fragment of it.
      *
      * @param msg The ExtClrMsg to process
      */
     void sendToRings(const ExtClrMsg &msg);
 
+    /**
+     * @brief Collects the payload fragment of a ring msg that has come back around its ring. Once
+     * enough fragments of the message have arrived, rebuilds its full sealed payload.
+     *
+     * @param msg The fragment to collect. Holds the rebuilt message on return if it is complete.
+     * @return true if msg now holds the full message, false if more fragments are needed
+     */
+    bool assembleFragments(ExtClrMsg &msg);
+
     /**
      * @brief Handles a received ring msg to either forward it along the ring (if ringTtl > 0),
      * forward to other committees, or forward to a client.
@@ -238,6 +244,15 @@ public:
      */
     void sendMsg(const std::string &dstUuid, const ExtClrMsg &msg);
 
+    /**
+     * @brief Sends only the ClrMsg fields of a message to the specified destination persona,
+     * forwarding its sealed payload (if any) without decrypting it.
+     *
+     * @param dstUuid The uuid of the persona to send to
+     * @param msg The message to send
+     */
+    void sendClrMsg(const std::string &dstUuid, const ExtClrMsg &msg);
+
     /**
      * @brief Packs a ClrMsg into a string to call sendFormattedMsg(..., std::string &msgString,
      * ...) on
@@ -290,9 +305,27 @@ public:
     virtual void addClient(const std::string &persona, const RawData &key) override;
 
 private:
+    enum RingStrategy {
+        RING_REDUNDANT,
+        RING_FAILOVER,
+        RING_ERASURE,
+    };
+
     ConfigNMTwoSixServer serverConfig;
-    OrderedUuidSet staleUuids;
-    OrderedUuidSet floodedUuids;
+    DedupCache<MsgUuid> staleUuids{serverConfig.maxStaleUuids};
+    DedupCache<MsgUuid> floodedUuids{serverConfig.maxFloodedUuids};
+    RingStrategy ringStrategy{RING_REDUNDANT};
+    // Fragments of erasure coded ring msgs that have not been rebuilt yet, and their UUIDs oldest
+    // first
+    std::unordered_map<MsgUuid, std::vector<std::optional<std::string>>> pendingFragments;
+    std::deque<MsgUuid> pendingFragmentOrder;
+
+    /**
+     * @brief Forgets the fragments of a msg that has been rebuilt or could not be
+     *
+     * @param uuid The UUID of the msg
+     */
+    void dropPendingFragments(MsgUuid uuid);
 };
 
 #endif
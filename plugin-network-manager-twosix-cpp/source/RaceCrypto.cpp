@@ -17,10 +17,12 @@
 
 #include "RaceCrypto.h"
 
+#include <openssl/crypto.h>
 #include <openssl/err.h>
 #include <openssl/evp.h>
 #include <openssl/rand.h>
 
+#include <algorithm>
 #include <boost/io/ios_state.hpp>
 #include <cstring>
 #include <iomanip>
@@ -28,16 +30,23 @@
 #include <memory>
 #include <nlohmann/json.hpp>
 #include <sstream>
+#include <unordered_map>
 #include <vector>
 
 #include "ExtClrMsg.h"
 #include "Log.h"
+#include "MessageFormat.h"
 #include "RaceLog.h"
 
 using json = nlohmann::json;
 
 #define IV_LENGTH 12
 #define TAG_LENGTH 16
+#define KEY_LENGTH 32
+#define ENVELOPE_LENGTH_SIZE 4
+#define MULTICAST_MARKER 0xFFFFFFFF
+#define MULTICAST_COUNT_SIZE 4
+#define WRAPPED_KEY_LENGTH (IV_LENGTH + TAG_LENGTH + KEY_LENGTH)
 
 RaceCrypto::RaceCrypto() : delimiter(":::") {
     TRACE_METHOD();
@@ -58,6 +67,115 @@ static void handleOpensslError() {
     throw std::logic_error("Error with OpenSSL call");
 }
 
+namespace {
+
+using AesKey = std::array<uint8_t, KEY_LENGTH>;
+
+struct AesKeyHash {
+    size_t operator()(const AesKey &key) const noexcept {
+        // Keys are random, so any of their bytes make a good hash
+        size_t hash;
+        std::memcpy(&hash, key.data(), sizeof(hash));
+        return hash;
+    }
+};
+
+using CipherCtxPtr = std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)>;
+
+/**
+ * @brief Per-thread cache of AES-256-GCM cipher contexts with their key schedules already set up.
+ *
+ * Creating a context and expanding the key is most of the cost of encrypting a small message. A
+ * context initialized with a key keeps its key schedule, so each operation only has to set a new
+ * IV. Contexts are looked up by the key itself rather than by persona, so a rotated key can never
+ * be used with a stale schedule; the old entry is simply no longer hit and is dropped when the
+ * cache fills up. Contexts are not thread-safe, hence one cache per thread.
+ */
+class CipherContextCache {
+public:
+    /**
+     * @brief Get a context for the key, ready for a new operation once the IV is set
+     *
+     * @param key The 32-byte key
+     * @param encrypt true for an encryption context, false for decryption
+     * @return The context, or nullptr if openssl failed to create it
+     */
+    EVP_CIPHER_CTX *get(const uint8_t *key, bool encrypt) {
+        AesKey aesKey;
+        std::memcpy(aesKey.data(), key, KEY_LENGTH);
+        auto it = contexts.find(aesKey);
+        if (it == contexts.end()) {
+            if (contexts.size() >= MAX_KEYS) {
+                contexts.clear();
+            }
+            it = contexts.emplace(aesKey, Contexts()).first;
+        }
+
+        CipherCtxPtr &ctx = encrypt ? it->second.encrypt : it->second.decrypt;
+        if (ctx == nullptr) {
+            ctx = create(key, encrypt);
+        }
+        return ctx.get();
+    }
+
+    /**
+     * @brief Create a context for the key without caching it. Used for single-use keys, which would
+     * otherwise push the keys of other personas out of the cache.
+     *
+     * @param key The 32-byte key
+     * @param encrypt true for an encryption context, false for decryption
+     * @return The context, or nullptr if openssl failed to create it
+     */
+    static CipherCtxPtr create(const uint8_t *key, bool encrypt) {
+        CipherCtxPtr ctx(EVP_CIPHER_CTX_new(), &EVP_CIPHER_CTX_free);
+        if (ctx == nullptr ||
+            1 != EVP_CipherInit_ex(ctx.get(), EVP_aes_256_gcm(), NULL, key, NULL,
+                                   encrypt ? 1 : 0)) {
+            return CipherCtxPtr(nullptr, &EVP_CIPHER_CTX_free);
+        }
+        return ctx;
+    }
+
+    /**
+     * @brief Drop the contexts for a key, e.g. after an openssl error left them in an unknown state
+     *
+     * @param key The 32-byte key
+     */
+    void discard(const uint8_t *key) {
+        AesKey aesKey;
+        std::memcpy(aesKey.data(), key, KEY_LENGTH);
+        contexts.erase(aesKey);
+    }
+
+private:
+    // A node only talks to a handful of personas, so this is plenty while still bounding the
+    // amount of key material kept around
+    static constexpr size_t MAX_KEYS = 256;
+
+    struct Contexts {
+        CipherCtxPtr encrypt{nullptr, &EVP_CIPHER_CTX_free};
+        CipherCtxPtr decrypt{nullptr, &EVP_CIPHER_CTX_free};
+    };
+
+    std::unordered_map<AesKey, Contexts, AesKeyHash> contexts;
+};
+
+thread_local CipherContextCache cipherContexts;
+
+}  // namespace
+
+/**
+ * @brief Check that a key can be used for AES-256-GCM
+ *
+ * @throws std::logic_error if the key is not 32 bytes long
+ * @param key The key
+ */
+static void checkKey(const std::vector<uint8_t> &key) {
+    if (key.size() != KEY_LENGTH) {
+        throw std::logic_error("Invalid AES key length: " + std::to_string(key.size()));
+    }
+}
+
 /**
  * @brief Encrypt the input string using AES-GCM with a random 12-byte IV and a 32-byte key.
  * The key must be 32 bytes long.
@@ -69,60 +187,57 @@ static void handleOpensslError() {
  * authentication tag
  */
 RawData RaceCrypto::encryptClrMsg(const std::string &input, const std::vector<uint8_t> &key) const {
-    unsigned char iv[IV_LENGTH];
-    RAND_bytes(iv, IV_LENGTH);
-
-    // AES-GCM does not change length of ciphertext
-    std::unique_ptr<unsigned char[]> ciphertext(new unsigned char[input.length()]);
-    unsigned char tag[TAG_LENGTH];
-    std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> ctx(EVP_CIPHER_CTX_new(),
-                                                                        &EVP_CIPHER_CTX_free);
+    checkKey(key);
+    RawData output(IV_LENGTH + TAG_LENGTH + input.length());
+    encrypt(reinterpret_cast<const uint8_t *>(input.data()), input.length(), key.data(),
+            output.data());
+    return output;
+}
 
-    if (ctx == nullptr) {
+/**
+ * @brief Encrypt input using AES-GCM with a random 12-byte IV, writing the IV, tag and ciphertext
+ * to output.
+ *
+ * @throws std::logic_error if openssl encounters an error
+ * @param input The input to encrypt
+ * @param length The length of input
+ * @param key The 32-byte key
+ * @param output The buffer to write to. Must have room for length + 28 bytes.
+ * @param cacheKey Whether to keep the key schedule for later operations with the same key
+ * @param aad Additional data covered by the tag but not encrypted or written to output
+ */
+void RaceCrypto::encrypt(const uint8_t *input, size_t length, const uint8_t *key, uint8_t *output,
+                         bool cacheKey, const RawDataView &aad) {
+    uint8_t *iv = output;
+    uint8_t *tag = output + IV_LENGTH;
+    uint8_t *ciphertext = output + IV_LENGTH + TAG_LENGTH;
+    if (RAND_bytes(iv, IV_LENGTH) != 1) {
         handleOpensslError();
     }
 
-    /* Initialise the encryption operation. */
-    if (1 != EVP_EncryptInit_ex(ctx.get(), EVP_aes_256_gcm(), NULL, NULL, NULL)) {
-        handleOpensslError();
+    CipherCtxPtr oneShotCtx(nullptr, &EVP_CIPHER_CTX_free);
+    if (!cacheKey) {
+        oneShotCtx = CipherContextCache::create(key, true);
     }
-
-    /* Initialise key and IV */
-    if (1 != EVP_EncryptInit_ex(ctx.get(), NULL, NULL, key.data(),
-                                reinterpret_cast<unsigned char *>(iv))) {
+    EVP_CIPHER_CTX *ctx = cacheKey ? cipherContexts.get(key, true) : oneShotCtx.get();
+    if (ctx == nullptr) {
         handleOpensslError();
     }
 
     int curLength;
-    /*
-     * Provide the message to be encrypted, and obtain the encrypted output.
-     * EVP_EncryptUpdate can be called multiple times if necessary
-     */
-    if (1 != EVP_EncryptUpdate(ctx.get(), ciphertext.get(), &curLength,
-                               reinterpret_cast<const unsigned char *>(input.data()),
-                               input.length())) {
-        handleOpensslError();
-    }
-
-    /*
-     * Finalise the encryption. Normally ciphertext bytes may be written at
-     * this stage, but this does not occur in GCM mode
-     */
-    if (1 != EVP_EncryptFinal_ex(ctx.get(), ciphertext.get() + curLength, &curLength)) {
-        handleOpensslError();
-    }
-
-    /* Get the tag */
-    if (1 != EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_GET_TAG, TAG_LENGTH, tag)) {
+    // Set the IV. The key schedule set up when the context was created is kept. AES-GCM does not
+    // change the length of the ciphertext, and never writes any in the final step.
+    if (1 != EVP_EncryptInit_ex(ctx, NULL, NULL, NULL, iv) ||
+        (aad.size() > 0 &&
+         1 != EVP_EncryptUpdate(ctx, NULL, &curLength, aad.data(), static_cast<int>(aad.size()))) ||
+        1 != EVP_EncryptUpdate(ctx, ciphertext, &curLength, input, static_cast<int>(length)) ||
+        1 != EVP_EncryptFinal_ex(ctx, ciphertext + curLength, &curLength) ||
+        1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, TAG_LENGTH, tag)) {
+        if (cacheKey) {
+            cipherContexts.discard(key);
+        }
         handleOpensslError();
     }
-
-    RawData output = RawData();
-    output.reserve(static_cast<size_t>(IV_LENGTH + TAG_LENGTH + input.length()));
-    output.insert(output.end(), std::begin(iv), std::end(iv));
-    output.insert(output.end(), std::begin(tag), std::end(tag));
-    output.insert(output.end(), ciphertext.get(), ciphertext.get() + input.length());
-    return output;
 }
 
 /**
@@ -137,54 +252,85 @@ RawData RaceCrypto::encryptClrMsg(const std::string &input, const std::vector<ui
  * @return The decrypted ciphertext as a string or the empty string if decryption verification fails
  */
 std::string RaceCrypto::decryptEncPkg(RawData input, const std::vector<uint8_t> &key) const {
-    int curLength;
-    int plaintextLength;
-    int ret;
-    std::unique_ptr<unsigned char[]> plaintext(new unsigned char[input.size()]);
-
-    int ciphertextLength = static_cast<int>(input.size()) - IV_LENGTH - TAG_LENGTH;
-    auto end = input.begin();
-    std::advance(end, IV_LENGTH);
-    RawData rawIv = RawData(input.begin(), end);
-
-    auto start = input.begin();
-    std::advance(start, IV_LENGTH);
-    end = input.begin();
-    std::advance(end, IV_LENGTH + TAG_LENGTH);
-    RawData rawTag = RawData(start, end);
-
-    start = input.begin();
-    std::advance(start, IV_LENGTH + TAG_LENGTH);
-    RawData rawCiphertext = RawData(start, input.end());
-
-    std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> ctx(EVP_CIPHER_CTX_new(),
-                                                                        &EVP_CIPHER_CTX_free);
-    if (ctx == nullptr) {
-        handleOpensslError();
+    checkKey(key);
+    std::string result;
+    if (!decrypt(input.data(), input.size(), key.data(), result)) {
+        return std::string();
     }
+    return result;
+}
 
-    /* Initialise the decryption operation. */
-    if (!EVP_DecryptInit_ex(ctx.get(), EVP_aes_256_gcm(), NULL, NULL, NULL)) {
-        handleOpensslError();
-    }
+/**
+ * @brief Decrypt input encrypted with encryptClrMsg into a caller-provided buffer.
+ *
+ * @throws std::logic_error if openssl encounters an error
+ * @param input The input to decrypt
+ * @param key The 32-byte key
+ * @param output The buffer to write the plaintext to. Must have room for
+ * getPlaintextLength(input.size()) bytes. May point to the ciphertext within input to decrypt in
+ * place. The contents are unspecified if verification fails.
+ * @return true if the input was long enough and the tag was verified, false otherwise
+ */
+bool RaceCrypto::decryptInto(const RawDataView &input, const std::vector<uint8_t> &key,
+                             uint8_t *output) const {
+    checkKey(key);
+    return decrypt(input.data(), input.size(), key.data(), output);
+}
 
-    /* Initialise key and IV */
-    if (!EVP_DecryptInit_ex(ctx.get(), NULL, NULL, key.data(), rawIv.data())) {
-        handleOpensslError();
+/**
+ * @brief Get the length of the plaintext of input encrypted with encryptClrMsg
+ *
+ * @param length The length of the encrypted input
+ * @return The plaintext length, or 0 if the input is too short to be valid
+ */
+size_t RaceCrypto::getPlaintextLength(size_t length) {
+    return length < IV_LENGTH + TAG_LENGTH ? 0 : length - IV_LENGTH - TAG_LENGTH;
+}
+
+/**
+ * @brief Decrypt AES-GCM input laid out as a 12-byte IV, 16-byte tag and ciphertext.
+ *
+ * @throws std::logic_error if openssl encounters an error
+ * @param input The input to decrypt
+ * @param length The length of input
+ * @param key The 32-byte key
+ * @param output The buffer to write the plaintext to. Must have room for length - 28 bytes. May be
+ * input + 28 to decrypt in place.
+ * @param cacheKey Whether to keep the key schedule for later operations with the same key
+ * @param aad Additional data that was passed to encrypt, which the tag is also verified against
+ * @return true if the input was long enough and the tag was verified, false otherwise
+ */
+bool RaceCrypto::decrypt(const uint8_t *input, size_t length, const uint8_t *key, uint8_t *output,
+                         bool cacheKey, const RawDataView &aad) {
+    if (length < IV_LENGTH + TAG_LENGTH) {
+        return false;
     }
 
-    /*
-     * Provide the message to be decrypted, and obtain the plaintext output.
-     * EVP_DecryptUpdate can be called multiple times if necessary
-     */
-    if (!EVP_DecryptUpdate(ctx.get(), plaintext.get(), &curLength, rawCiphertext.data(),
-                           ciphertextLength)) {
+    const uint8_t *iv = input;
+    const uint8_t *tag = input + IV_LENGTH;
+    const uint8_t *ciphertext = input + IV_LENGTH + TAG_LENGTH;
+    const int ciphertextLength = static_cast<int>(length) - IV_LENGTH - TAG_LENGTH;
+
+    CipherCtxPtr oneShotCtx(nullptr, &EVP_CIPHER_CTX_free);
+    if (!cacheKey) {
+        oneShotCtx = CipherContextCache::create(key, false);
+    }
+    EVP_CIPHER_CTX *ctx = cacheKey ? cipherContexts.get(key, false) : oneShotCtx.get();
+    if (ctx == nullptr) {
         handleOpensslError();
     }
-    plaintextLength = curLength;
 
-    /* Set expected tag value. Works in OpenSSL 1.0.1d and later */
-    if (!EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_TAG, TAG_LENGTH, rawTag.data())) {
+    // Set the IV, keeping the key schedule, and the expected tag
+    int curLength;
+    if (1 != EVP_DecryptInit_ex(ctx, NULL, NULL, NULL, iv) ||
+        (aad.size() > 0 &&
+         1 != EVP_DecryptUpdate(ctx, NULL, &curLength, aad.data(), static_cast<int>(aad.size()))) ||
+        1 != EVP_DecryptUpdate(ctx, output, &curLength, ciphertext, ciphertextLength) ||
+        1 != EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, TAG_LENGTH,
+                                 const_cast<uint8_t *>(tag))) {
+        if (cacheKey) {
+            cipherContexts.discard(key);
+        }
         handleOpensslError();
     }
 
@@ -192,17 +338,415 @@ std::string RaceCrypto::decryptEncPkg(RawData input, const std::vector<uint8_t>
      * Finalise the decryption. A positive return value indicates success,
      * anything else is a failure - the plaintext is not trustworthy.
      */
-    ret = EVP_DecryptFinal_ex(ctx.get(), plaintext.get() + curLength, &curLength);
+    return EVP_DecryptFinal_ex(ctx, output + curLength, &curLength) > 0;
+}
 
-    if (ret > 0) {
-        /* Success */
-        plaintextLength += curLength;
-        std::string result = std::string(plaintext.get(), plaintext.get() + plaintextLength);
-        return result;
-    } else {
-        /* Verify failed */
+/**
+ * @brief Decrypt AES-GCM input laid out as a 12-byte IV, 16-byte tag and ciphertext into a string.
+ *
+ * @throws std::logic_error if openssl encounters an error
+ * @param input The input to decrypt
+ * @param length The length of input
+ * @param key The 32-byte key
+ * @param output Set to the plaintext on success. Its existing capacity is reused.
+ * @param cacheKey Whether to keep the key schedule for later operations with the same key
+ * @return true if the input was long enough and the tag was verified, false otherwise
+ */
+bool RaceCrypto::decrypt(const uint8_t *input, size_t length, const uint8_t *key,
+                         std::string &output, bool cacheKey) {
+    if (length < IV_LENGTH + TAG_LENGTH) {
+        return false;
+    }
+    output.resize(length - IV_LENGTH - TAG_LENGTH);
+    if (!decrypt(input, length, key, reinterpret_cast<uint8_t *>(&output[0]), cacheKey)) {
+        output.clear();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Encrypt a formatted message for the next hop. For a binary formatted message only the
+ * header is encrypted and the already sealed payload is appended unchanged, giving
+ *
+ *   uint32 encrypted header length (big-endian) | encrypted header | sealed payload
+ *
+ * The sealed payload is passed to AES-GCM as additional authenticated data, so the tag of the
+ * encrypted header covers it and a payload swapped or altered in transit is rejected along with
+ * the header. Any other message is encrypted whole with encryptClrMsg.
+ *
+ * @throws std::logic_error if openssl encounters an error
+ * @param formatted The formatted message to encrypt
+ * @param key The key of the next hop
+ * @return the encrypted message
+ */
+RawData RaceCrypto::encryptMessage(const std::string &formatted,
+                                   const std::vector<uint8_t> &key) const {
+    checkKey(key);
+    RawData output;
+    encryptEnvelope(formatted, key.data(), true, output);
+    return output;
+}
+
+/**
+ * @brief Encrypt a formatted message as described in encryptMessage, appending it to output
+ *
+ * @throws std::logic_error if openssl encounters an error
+ * @param formatted The formatted message to encrypt
+ * @param key The 32-byte key
+ * @param cacheKey Whether to keep the key schedule for later operations with the same key
+ * @param output The buffer to append the encrypted message to
+ */
+void RaceCrypto::encryptEnvelope(const std::string &formatted, const uint8_t *key, bool cacheKey,
+                                 RawData &output) {
+    const size_t offset = output.size();
+    if (!MessageFormat::isBinary(formatted)) {
+        output.resize(offset + IV_LENGTH + TAG_LENGTH + formatted.size());
+        encrypt(reinterpret_cast<const uint8_t *>(formatted.data()), formatted.size(), key,
+                output.data() + offset, cacheKey);
+        return;
+    }
+
+    const size_t headerLength = MessageFormat::getHeaderLength(formatted);
+    const uint32_t encryptedHeaderLength =
+        static_cast<uint32_t>(IV_LENGTH + TAG_LENGTH + headerLength);
+
+    output.resize(offset + ENVELOPE_LENGTH_SIZE + encryptedHeaderLength + formatted.size() -
+                  headerLength);
+    for (size_t i = 0; i < ENVELOPE_LENGTH_SIZE; ++i) {
+        output[offset + i] = static_cast<uint8_t>(encryptedHeaderLength >> (24 - 8 * i));
+    }
+    const RawDataView payload(reinterpret_cast<const uint8_t *>(formatted.data()) + headerLength,
+                              formatted.size() - headerLength);
+    encrypt(reinterpret_cast<const uint8_t *>(formatted.data()), headerLength, key,
+            output.data() + offset + ENVELOPE_LENGTH_SIZE, cacheKey, payload);
+    std::copy(payload.begin(), payload.end(),
+              output.begin() + static_cast<std::ptrdiff_t>(offset + ENVELOPE_LENGTH_SIZE +
+                                                           encryptedHeaderLength));
+}
+
+/**
+ * @brief Encrypt a formatted message once for every recipient of a multicast link. The message is
+ * encrypted as in encryptMessage with a new random content key, and the content key is wrapped
+ * with the key of each recipient, giving
+ *
+ *   uint32 0xFFFFFFFF | uint32 recipient count | wrapped content key[count] | encrypted message
+ *
+ * where each wrapped content key is the 12-byte IV, 16-byte tag and 32-byte encrypted key. The
+ * marker can not be mistaken for the header length of an encryptMessage envelope.
+ *
+ * @throws std::logic_error if openssl encounters an error
+ * @param formatted The formatted message to encrypt
+ * @param keys The key of each recipient
+ * @return the encrypted message
+ */
+RawData RaceCrypto::encryptMulticastMessage(const std::string &formatted,
+                                            const std::vector<std::vector<uint8_t>> &keys) const {
+    for (const auto &key : keys) {
+        checkKey(key);
+    }
+
+    AesKey contentKey;
+    if (RAND_bytes(contentKey.data(), KEY_LENGTH) != 1) {
+        handleOpensslError();
+    }
+
+    RawData output(ENVELOPE_LENGTH_SIZE + MULTICAST_COUNT_SIZE + keys.size() * WRAPPED_KEY_LENGTH);
+    const uint32_t count = static_cast<uint32_t>(keys.size());
+    for (size_t i = 0; i < ENVELOPE_LENGTH_SIZE; ++i) {
+        output[i] = static_cast<uint8_t>(MULTICAST_MARKER >> (24 - 8 * i));
+        output[ENVELOPE_LENGTH_SIZE + i] = static_cast<uint8_t>(count >> (24 - 8 * i));
+    }
+    uint8_t *wrappedKey = output.data() + ENVELOPE_LENGTH_SIZE + MULTICAST_COUNT_SIZE;
+    for (const auto &key : keys) {
+        encrypt(contentKey.data(), KEY_LENGTH, key.data(), wrappedKey);
+        wrappedKey += WRAPPED_KEY_LENGTH;
+    }
+
+    // The content key is never used again, so don't let it evict the keys of other personas
+    encryptEnvelope(formatted, contentKey.data(), false, output);
+    OPENSSL_cleanse(contentKey.data(), contentKey.size());
+    return output;
+}
+
+/**
+ * @brief Decrypt a package produced by encryptMessage or encryptMulticastMessage, returning the
+ * formatted message. Packages encrypted whole with encryptClrMsg are also accepted. Only the header
+ * of a binary formatted message is decrypted; its sealed payload is returned as is.
+ *
+ * @throws std::logic_error if openssl encounters an error
+ * @param input The encrypted package
+ * @param key The key of this node
+ * @return The formatted message or the empty string if decryption verification fails
+ */
+std::string RaceCrypto::decryptMessage(const RawDataView &input,
+                                       const std::vector<uint8_t> &key) const {
+    checkKey(key);
+    if (input.size() >= ENVELOPE_LENGTH_SIZE + MULTICAST_COUNT_SIZE &&
+        readLength(input.data()) == MULTICAST_MARKER) {
+        const size_t count = readLength(input.data() + ENVELOPE_LENGTH_SIZE);
+        const size_t keysOffset = ENVELOPE_LENGTH_SIZE + MULTICAST_COUNT_SIZE;
+        if (count <= (input.size() - keysOffset) / WRAPPED_KEY_LENGTH) {
+            // Only the wrapped keys are tried with our key. The message itself is decrypted once,
+            // with whichever content key unwraps.
+            const size_t messageOffset = keysOffset + count * WRAPPED_KEY_LENGTH;
+            AesKey contentKey;
+            for (size_t i = 0; i < count; ++i) {
+                if (decrypt(input.data() + keysOffset + i * WRAPPED_KEY_LENGTH, WRAPPED_KEY_LENGTH,
+                            key.data(), contentKey.data())) {
+                    std::string formatted =
+                        decryptEnvelope(input.slice(messageOffset, input.size() - messageOffset),
+                                        contentKey.data(), false);
+                    OPENSSL_cleanse(contentKey.data(), contentKey.size());
+                    return formatted;
+                }
+            }
+            OPENSSL_cleanse(contentKey.data(), contentKey.size());
+            return std::string();
+        }
+    }
+
+    return decryptEnvelope(input, key.data(), true);
+}
+
+/**
+ * @brief Decrypt a message encrypted by encryptEnvelope
+ *
+ * @throws std::logic_error if openssl encounters an error
+ * @param input The encrypted message
+ * @param key The 32-byte key
+ * @param cacheKey Whether to keep the key schedule for later operations with the same key
+ * @return The formatted message or the empty string if decryption verification fails
+ */
+std::string RaceCrypto::decryptEnvelope(const RawDataView &input, const uint8_t *key,
+                                        bool cacheKey) {
+    if (input.size() >= ENVELOPE_LENGTH_SIZE) {
+        const size_t encryptedHeaderLength = readLength(input.data());
+        if (encryptedHeaderLength >= IV_LENGTH + TAG_LENGTH &&
+            encryptedHeaderLength <= input.size() - ENVELOPE_LENGTH_SIZE) {
+            // Decrypt the header straight into the result, followed by the sealed payload
+            const size_t headerLength = getPlaintextLength(encryptedHeaderLength);
+            const size_t payloadOffset = ENVELOPE_LENGTH_SIZE + encryptedHeaderLength;
+            const RawDataView payload = input.slice(payloadOffset, input.size() - payloadOffset);
+            std::string formatted(headerLength + payload.size(), '\0');
+            uint8_t *output = reinterpret_cast<uint8_t *>(&formatted[0]);
+            if (decrypt(input.data() + ENVELOPE_LENGTH_SIZE, encryptedHeaderLength, key, output,
+                        cacheKey, payload) &&
+                MessageFormat::isBinary(formatted)) {
+                std::copy(payload.begin(), payload.end(), output + headerLength);
+                return formatted;
+            }
+        }
+    }
+
+    // Not an envelope (or not for us). Try the whole package as a single encrypted message.
+    std::string formatted;
+    if (!decrypt(input.data(), input.size(), key, formatted, cacheKey)) {
         return std::string();
     }
+    return formatted;
+}
+
+/**
+ * @brief Read a big-endian uint32 length field
+ *
+ * @param input The first byte of the field
+ * @return The length
+ */
+size_t RaceCrypto::readLength(const uint8_t *input) {
+    return (static_cast<size_t>(input[0]) << 24) | (static_cast<size_t>(input[1]) << 16) |
+           (static_cast<size_t>(input[2]) << 8) | static_cast<size_t>(input[3]);
+}
+
+/**
+ * @brief Encrypt a msg body with a new random payload key so it can be forwarded without being
+ * decrypted. The payload key is wrapped with the key of the destination, so relays only ever see
+ * the wrapped key.
+ *
+ * @throws std::logic_error if openssl encounters an error
+ * @param msg The msg body to seal
+ * @param dstKey The key of the persona the msg is addressed to
+ * @return The wrapped payload key and sealed msg body
+ */
+SealedPayload RaceCrypto::sealPayload(const std::string &msg,
+                                      const std::vector<uint8_t> &dstKey) const {
+    checkKey(dstKey);
+    AesKey payloadKey;
+    if (RAND_bytes(payloadKey.data(), KEY_LENGTH) != 1) {
+        handleOpensslError();
+    }
+
+    SealedPayload payload;
+    payload.cipherText.resize(IV_LENGTH + TAG_LENGTH + msg.size());
+    // The payload key is only used once, so it is not cached alongside the persona keys
+    encrypt(reinterpret_cast<const uint8_t *>(msg.data()), msg.size(), payloadKey.data(),
+            reinterpret_cast<uint8_t *>(&payload.cipherText[0]), false);
+    payload.key.resize(WRAPPED_KEY_LENGTH);
+    encrypt(payloadKey.data(), KEY_LENGTH, dstKey.data(), payload.key.data());
+    OPENSSL_cleanse(payloadKey.data(), payloadKey.size());
+    return payload;
+}
+
+/**
+ * @brief Decrypt the sealed payload of a decoded binary message
+ *
+ * @throws std::invalid_argument if the payload can not be opened, e.g. because the message is not
+ * addressed to the owner of key
+ * @param view The decoded message
+ * @param key The key of this node
+ * @return The msg body
+ */
+std::string RaceCrypto::openPayload(const MessageFormat::ExtClrMsgView &view,
+                                    const std::vector<uint8_t> &key) {
+    checkKey(key);
+    if (view.fragment.has_value()) {
+        throw std::invalid_argument("Invalid message to parse: payload is a fragment");
+    }
+    if (view.payloadKey.size() != WRAPPED_KEY_LENGTH) {
+        throw std::invalid_argument("Invalid message to parse: bad payload key");
+    }
+    AesKey payloadKey;
+    if (!decrypt(reinterpret_cast<const uint8_t *>(view.payloadKey.data()), WRAPPED_KEY_LENGTH,
+                 key.data(), payloadKey.data())) {
+        throw std::invalid_argument("Invalid message to parse: payload key failed verification");
+    }
+    std::string msg;
+    const bool opened =
+        decrypt(reinterpret_cast<const uint8_t *>(view.sealedPayload.data()),
+                view.sealedPayload.size(), payloadKey.data(), msg, false);
+    OPENSSL_cleanse(payloadKey.data(), payloadKey.size());
+    if (!opened) {
+        throw std::invalid_argument("Invalid message to parse: payload failed verification");
+    }
+    return msg;
+}
+
+/**
+ * @brief Keep the sealed payload of a decoded binary message so the message can be forwarded
+ * without sealing the msg body again
+ *
+ * @param view The decoded message
+ * @return The sealed payload
+ */
+static std::shared_ptr<const SealedPayload> keepPayload(const MessageFormat::ExtClrMsgView &view) {
+    auto payload = std::make_shared<SealedPayload>();
+    payload->key.assign(view.payloadKey.begin(), view.payloadKey.end());
+    payload->cipherText.assign(view.sealedPayload);
+    return payload;
+}
+
+/**
+ * @brief Format a ClrMsg for sending using the binary format (see MessageFormat.h). The msg body
+ * is sealed for the destination with a new payload key.
+ *
+ * @param msg The ClrMsg to format
+ * @param dstKey The key of the persona the msg is addressed to
+ * @return the binary formatted version of msg
+ */
+std::string RaceCrypto::formatMessage(const ClrMsg &msg, const std::vector<uint8_t> &dstKey) const {
+    return MessageFormat::encode(msg, sealPayload(msg.getMsg(), dstKey));
+}
+
+/**
+ * @brief Format an ExtClrMsg for sending using the binary format (see MessageFormat.h). If the
+ * message was received with a sealed payload, that payload is reused as is. Otherwise the msg body
+ * is sealed for the destination.
+ *
+ * @param msg The ExtClrMsg to format
+ * @param dstKey The key of the persona the msg is addressed to. Only used if the msg body has not
+ * been sealed yet.
+ * @return the binary formatted version of msg
+ */
+std::string RaceCrypto::formatMessage(const ExtClrMsg &msg,
+                                      const std::vector<uint8_t> &dstKey) const {
+    auto payload = msg.getSealedPayload();
+    if (payload != nullptr) {
+        return MessageFormat::encode(msg, *payload);
+    }
+    return MessageFormat::encode(msg, sealPayload(msg.getMsg(), dstKey));
+}
+
+/**
+ * @brief Format only the ClrMsg fields of an ExtClrMsg using the binary format. If the message was
+ * received with a sealed payload, that payload is reused as is. Used to forward a message to a
+ * client.
+ *
+ * @param msg The ExtClrMsg to format
+ * @param dstKey The key of the persona the msg is addressed to. Only used if the msg body has not
+ * been sealed yet.
+ * @return the binary formatted version of msg as a ClrMsg
+ */
+std::string RaceCrypto::formatClrMessage(const ExtClrMsg &msg,
+                                         const std::vector<uint8_t> &dstKey) const {
+    auto payload = msg.getSealedPayload();
+    if (payload != nullptr) {
+        return MessageFormat::encode(static_cast<const ClrMsg &>(msg), *payload);
+    }
+    return MessageFormat::encode(static_cast<const ClrMsg &>(msg),
+                                 sealPayload(msg.getMsg(), dstKey));
+}
+
+/**
+ * @brief Parse a formatted message into an ExtClrMsg, opening its sealed payload. Both the binary
+ * format and the legacy delimited format are accepted.
+ *
+ * @param msg The string to parse an ExtClrMsg from.
+ * @param key The key of this node, which the payload key of a binary message is wrapped with
+ * @return the parsed ExtClrMsg. On failure an invalid_argument exception is thrown.
+ */
+ExtClrMsg RaceCrypto::parseExtMessage(const std::string &msg,
+                                      const std::vector<uint8_t> &key) const {
+    if (MessageFormat::isBinary(msg)) {
+        MessageFormat::ExtClrMsgView view = MessageFormat::decode(msg);
+        return view.toExtClrMsg(openPayload(view, key));
+    }
+    return parseDelimitedExtMessage(msg);
+}
+
+/**
+ * @brief Parse only the header of a formatted message into an ExtClrMsg. The sealed payload is
+ * attached to the result instead of being opened, so the msg body is empty. Legacy delimited
+ * messages are parsed in full.
+ *
+ * A plain ClrMsg carries no UUID and its payload can only be opened by its destination, so its
+ * UUID is derived from its header fields and sealed payload instead of from its msg body.
+ * Originators that need the usual UUID (see ExtClrMsg(const ClrMsg &)) send an ExtClrMsg.
+ *
+ * @param msg The string to parse an ExtClrMsg from.
+ * @return the parsed ExtClrMsg. On failure an invalid_argument exception is thrown.
+ */
+ExtClrMsg RaceCrypto::parseExtMessageHeader(const std::string &msg) const {
+    if (!MessageFormat::isBinary(msg)) {
+        return parseDelimitedExtMessage(msg);
+    }
+
+    MessageFormat::ExtClrMsgView view = MessageFormat::decode(msg);
+    ExtClrMsg parsedMsg = view.toExtClrMsg("");
+    if (view.kind == MessageFormat::KIND_CLR_MSG) {
+        parsedMsg.setUuid(view.toExtClrMsg(std::string(view.sealedPayload)).getUuid());
+    }
+    parsedMsg.setSealedPayload(keepPayload(view));
+    return parsedMsg;
+}
+
+/**
+ * @brief Split a delimited message into its fields in a single pass
+ *
+ * @param msg The delimited message
+ * @param delimiter The delimiter separating fields
+ * @return the fields of the message
+ */
+static std::vector<std::string> splitDelimited(const std::string &msg,
+                                               const std::string &delimiter) {
+    std::vector<std::string> tokens;
+    size_t start = 0;
+    size_t pos = 0;
+    while ((pos = msg.find(delimiter, start)) != std::string::npos) {
+        tokens.emplace_back(msg, start, pos - start);
+        start = pos + delimiter.length();
+    }
+    tokens.emplace_back(msg, start);
+    return tokens;
 }
 
 /**
@@ -237,13 +781,22 @@ std::string RaceCrypto::formatDelimitedMessage(const ExtClrMsg &msg) const {
 }
 
 /**
- * @brief Get the size of the msg component of a formatted ClrMsg (or ExtClrMsg). This is the first
- * field after a delimiter
+ * @brief Get the size of the msg component of a formatted ClrMsg (or ExtClrMsg), in either the
+ * binary or the delimited format
  *
  * @param formatted The string to parse the msg length from
  * @return the length of the msg
  */
-std::size_t RaceCrypto::getMsgLength(std::string formatted) const {
+std::size_t RaceCrypto::getMsgLength(const std::string &formatted) const {
+    if (MessageFormat::isBinary(formatted)) {
+        try {
+            size_t sealedLength = MessageFormat::decode(formatted).sealedPayload.size();
+            return sealedLength < IV_LENGTH + TAG_LENGTH ? 0
+                                                         : sealedLength - IV_LENGTH - TAG_LENGTH;
+        } catch (std::invalid_argument &) {
+            return 0;
+        }
+    }
     size_t msg_start = formatted.find(delimiter) + delimiter.length();
     size_t msg_end = formatted.find(delimiter, msg_start);
     return msg_end - msg_start;
@@ -255,15 +808,8 @@ std::size_t RaceCrypto::getMsgLength(std::string formatted) const {
  * @param msg The string to parse a ClrMsg from.
  * @return the parsed ClrMsg. On failure an invalid_argument exception is thrown.
  */
-ClrMsg RaceCrypto::parseDelimitedMessage(std::string msg) const {
-    std::vector<std::string> tokens;
-    size_t pos = 0;
-    while ((pos = msg.find(delimiter)) != std::string::npos) {
-        std::string token = msg.substr(0, pos);
-        tokens.push_back(token);
-        msg.erase(0, pos + delimiter.length());
-    }
-    tokens.push_back(msg);
+ClrMsg RaceCrypto::parseDelimitedMessage(const std::string &msg) const {
+    std::vector<std::string> tokens = splitDelimited(msg, delimiter);
 
     if (tokens.size() == 7 and tokens[0] == "clrMsg") {
         return ClrMsg(tokens[1], tokens[2], tokens[3], std::stol(tokens[4]), std::stoi(tokens[5]),
@@ -281,15 +827,8 @@ ClrMsg RaceCrypto::parseDelimitedMessage(std::string msg) const {
  * @param msg The string to parse an ExtClrMsg from.
  * @return the parsed ExtClrMsg. On failure an invalid_argument exception is thrown.
  */
-ExtClrMsg RaceCrypto::parseDelimitedExtMessage(std::string msg) const {
-    std::vector<std::string> tokens;
-    size_t pos = 0;
-    while ((pos = msg.find(delimiter)) != std::string::npos) {
-        std::string token = msg.substr(0, pos);
-        tokens.push_back(token);
-        msg.erase(0, pos + delimiter.length());
-    }
-    tokens.push_back(msg);
+ExtClrMsg RaceCrypto::parseDelimitedExtMessage(const std::string &msg) const {
+    std::vector<std::string> tokens = splitDelimited(msg, delimiter);
 
     if (tokens.size() == 7) {
         return ExtClrMsg(ClrMsg(tokens[1], tokens[2], tokens[3], std::stol(tokens[4]),
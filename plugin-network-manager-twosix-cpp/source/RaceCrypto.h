@@ -27,6 +27,10 @@
 #include "ClrMsg.h"
 #include "EncPkg.h"
 class ExtClrMsg;  // Forward declaration to fix circular dependency
+struct SealedPayload;
+namespace MessageFormat {
+struct ExtClrMsgView;
+}
 
 constexpr std::size_t MsgHashSize = 32;  // 256 bits = 32 bytes
 
@@ -51,6 +55,20 @@ class RaceCrypto {
 private:
     std::string delimiter;
 
+    static void encrypt(const uint8_t *input, size_t length, const uint8_t *key, uint8_t *output,
+                        bool cacheKey = true, const RawDataView &aad = RawDataView());
+    static bool decrypt(const uint8_t *input, size_t length, const uint8_t *key, uint8_t *output,
+                        bool cacheKey = true, const RawDataView &aad = RawDataView());
+    static bool decrypt(const uint8_t *input, size_t length, const uint8_t *key,
+                        std::string &output, bool cacheKey = true);
+    static void encryptEnvelope(const std::string &formatted, const uint8_t *key, bool cacheKey,
+                                RawData &output);
+    static std::string decryptEnvelope(const RawDataView &input, const uint8_t *key,
+                                       bool cacheKey);
+    static size_t readLength(const uint8_t *input);
+    static std::string openPayload(const MessageFormat::ExtClrMsgView &view,
+                                   const std::vector<uint8_t> &key);
+
 public:
     RaceCrypto();
 
@@ -80,6 +98,137 @@ public:
      */
     std::string decryptEncPkg(RawData input, const std::vector<uint8_t> &key) const;
 
+    /**
+     * @brief Decrypt input encrypted with encryptClrMsg into a caller-provided buffer, avoiding any
+     * allocation. The key must be 32 bytes long.
+     *
+     * @throws std::logic_error if openssl encounters an error
+     * @param input The input to decrypt
+     * @param key The 32-byte key
+     * @param output The buffer to write the plaintext to. Must have room for
+     * getPlaintextLength(input.size()) bytes. May point to the ciphertext within input to decrypt
+     * in place. The contents are unspecified if verification fails.
+     * @return true if the input was long enough and the tag was verified, false otherwise
+     */
+    bool decryptInto(const RawDataView &input, const std::vector<uint8_t> &key,
+                     uint8_t *output) const;
+
+    /**
+     * @brief Get the length of the plaintext of input encrypted with encryptClrMsg
+     *
+     * @param length The length of the encrypted input
+     * @return The plaintext length, or 0 if the input is too short to be valid
+     */
+    static size_t getPlaintextLength(size_t length);
+
+    /**
+     * @brief Encrypt a formatted message for the next hop. For a binary formatted message only the
+     * header is encrypted and the already sealed payload is appended unchanged. Any other message
+     * is encrypted whole with encryptClrMsg.
+     *
+     * @throws std::logic_error if openssl encounters an error
+     * @param formatted The formatted message to encrypt
+     * @param key The key of the next hop
+     * @return the encrypted message
+     */
+    RawData encryptMessage(const std::string &formatted, const std::vector<uint8_t> &key) const;
+
+    /**
+     * @brief Encrypt a formatted message once for all recipients of a multicast link. The message
+     * is encrypted as in encryptMessage with a new random content key, which is then wrapped with
+     * the key of each recipient. Each recipient only has to unwrap its copy of the content key, so
+     * the message goes out in a single package regardless of the number of recipients.
+     *
+     * @throws std::logic_error if openssl encounters an error
+     * @param formatted The formatted message to encrypt
+     * @param keys The key of each recipient
+     * @return the encrypted message
+     */
+    RawData encryptMulticastMessage(const std::string &formatted,
+                                    const std::vector<std::vector<uint8_t>> &keys) const;
+
+    /**
+     * @brief Decrypt a package produced by encryptMessage or encryptMulticastMessage, returning the
+     * formatted message. Packages encrypted whole with encryptClrMsg are also accepted. Only the
+     * header of a binary formatted message is decrypted; its sealed payload is returned as is.
+     *
+     * @throws std::logic_error if openssl encounters an error
+     * @param input The encrypted package
+     * @param key The key of this node
+     * @return The formatted message or the empty string if decryption verification fails
+     */
+    std::string decryptMessage(const RawDataView &input, const std::vector<uint8_t> &key) const;
+
+    /**
+     * @brief Encrypt a msg body with a new random payload key so it can be forwarded without being
+     * decrypted. The payload key is wrapped with the key of the destination, so relays only ever
+     * see the wrapped key.
+     *
+     * @throws std::logic_error if openssl encounters an error
+     * @param msg The msg body to seal
+     * @param dstKey The key of the persona the msg is addressed to
+     * @return The wrapped payload key and sealed msg body
+     */
+    SealedPayload sealPayload(const std::string &msg, const std::vector<uint8_t> &dstKey) const;
+
+    /**
+     * @brief Format a ClrMsg for sending using the binary format (see MessageFormat.h). The msg
+     * body is sealed for the destination with a new payload key.
+     *
+     * @param msg The ClrMsg to format
+     * @param dstKey The key of the persona the msg is addressed to
+     * @return the binary formatted version of msg
+     */
+    std::string formatMessage(const ClrMsg &msg, const std::vector<uint8_t> &dstKey) const;
+
+    /**
+     * @brief Format an ExtClrMsg for sending using the binary format (see MessageFormat.h). If the
+     * message was received with a sealed payload, that payload is reused as is. Otherwise the msg
+     * body is sealed for the destination.
+     *
+     * @param msg The ExtClrMsg to format
+     * @param dstKey The key of the persona the msg is addressed to. Only used if the msg body has
+     * not been sealed yet.
+     * @return the binary formatted version of msg
+     */
+    std::string formatMessage(const ExtClrMsg &msg, const std::vector<uint8_t> &dstKey) const;
+
+    /**
+     * @brief Format only the ClrMsg fields of an ExtClrMsg using the binary format. If the message
+     * was received with a sealed payload, that payload is reused as is. Used to forward a message
+     * to a client.
+     *
+     * @param msg The ExtClrMsg to format
+     * @param dstKey The key of the persona the msg is addressed to. Only used if the msg body has
+     * not been sealed yet.
+     * @return the binary formatted version of msg as a ClrMsg
+     */
+    std::string formatClrMessage(const ExtClrMsg &msg, const std::vector<uint8_t> &dstKey) const;
+
+    /**
+     * @brief Parse a formatted message into an ExtClrMsg, opening its sealed payload. Both the
+     * binary format and the legacy delimited format are accepted.
+     *
+     * @param msg The string to parse an ExtClrMsg from.
+     * @param key The key of this node, which the payload key of a binary message is wrapped with
+     * @return the parsed ExtClrMsg. On failure an invalid_argument exception is thrown.
+     */
+    ExtClrMsg parseExtMessage(const std::string &msg, const std::vector<uint8_t> &key) const;
+
+    /**
+     * @brief Parse only the header of a formatted message into an ExtClrMsg. The sealed payload is
+     * attached to the result instead of being opened, so the msg body is empty. Legacy delimited
+     * messages are parsed in full.
+     *
+     * A plain ClrMsg carries no UUID and its payload can only be opened by its destination, so its
+     * UUID is derived from its header fields and sealed payload instead of from its msg body.
+     * Originators that need the usual UUID (see ExtClrMsg(const ClrMsg &)) send an ExtClrMsg.
+     *
+     * @param msg The string to parse an ExtClrMsg from.
+     * @return the parsed ExtClrMsg. On failure an invalid_argument exception is thrown.
+     */
+    ExtClrMsg parseExtMessageHeader(const std::string &msg) const;
+
     /**
      * @brief Stringify a ClrMsg into a series of string values separated by a delimiter string.
      *
@@ -98,13 +247,13 @@ public:
     std::string formatDelimitedMessage(const ExtClrMsg &msg) const;
 
     /**
-     * @brief Get the size of the msg component of a formatted ClrMsg (or ExtClrMsg). This is the
-     * first field after a delimiter
+     * @brief Get the size of the msg component of a formatted ClrMsg (or ExtClrMsg), in either the
+     * binary or the delimited format
      *
      * @param formatted The string to parse the msg length from
      * @return the length of the msg
      */
-    std::size_t getMsgLength(std::string formatted) const;
+    std::size_t getMsgLength(const std::string &formatted) const;
 
     /**
      * @brief Parse the passed string into a ClrMsg (if possible)
@@ -112,7 +261,7 @@ public:
      * @param msg The string to parse a ClrMsg from.
      * @return the parsed ClrMsg. On failure an invalid_argument exception is thrown.
      */
-    ClrMsg parseDelimitedMessage(std::string msg) const;
+    ClrMsg parseDelimitedMessage(const std::string &msg) const;
 
     /**
      * @brief Parse the passed string into an ExtClrMsg (if possible). If msg is actually a valid
@@ -122,7 +271,7 @@ public:
      * @param msg The string to parse an ExtClrMsg from.
      * @return the parsed ExtClrMsg. On failure an invalid_argument exception is thrown.
      */
-    ExtClrMsg parseDelimitedExtMessage(std::string msg) const;
+    ExtClrMsg parseDelimitedExtMessage(const std::string &msg) const;
 
     /**
      * @brief Get the SHA256 of a ClrMsg or throws a logic_error
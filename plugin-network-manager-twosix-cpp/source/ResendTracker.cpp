@@ -0,0 +1,144 @@
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "ResendTracker.h"
+
+#include <algorithm>
+
+// A package is given this many times the expected latency of its link to reach a final status
+static constexpr std::int64_t LATENCY_FACTOR = 10;
+// Lower bound on the age derived from the link latency, so that fast links still tolerate delays
+static constexpr std::chrono::seconds MIN_LINK_AGE{30};
+
+ResendTracker::ResendTracker() :
+    maxBytes(DEFAULT_MAX_BYTES),
+    maxAge(DEFAULT_MAX_AGE),
+    bytesRetained(0),
+    numEvicted(0),
+    numExpired(0) {}
+
+void ResendTracker::setLimits(std::size_t newMaxBytes, Clock::duration newMaxAge) {
+    maxBytes = newMaxBytes;
+    maxAge = newMaxAge;
+    evict();
+}
+
+ResendTracker::Clock::duration ResendTracker::maxAgeForLink(const LinkProperties &props) const {
+    return maxAgeForLatency(props.expected.send.latency_ms);
+}
+
+ResendTracker::Clock::duration ResendTracker::maxAgeForLatency(std::int32_t latency) const {
+    if (latency <= 0) {
+        return maxAge;
+    }
+    Clock::duration age = std::chrono::milliseconds(LATENCY_FACTOR * latency);
+    return std::min(std::max(age, Clock::duration(MIN_LINK_AGE)), maxAge);
+}
+
+void ResendTracker::add(RaceHandle handle, Entry entry, Clock::duration age,
+                        Clock::time_point now) {
+    expire(now);
+
+    retain(entry.msg);
+    const Clock::time_point deadline = now + age;
+    auto it = packages.find(handle);
+    if (it == packages.end()) {
+        Package package;
+        package.lruPos = lru.insert(lru.end(), handle);
+        package.deadlinePos = deadlines.emplace(deadline, handle);
+        it = packages.emplace(handle, std::move(package)).first;
+    } else {
+        lru.splice(lru.end(), lru, it->second.lruPos);
+        if (it->second.deadlinePos->first < deadline) {
+            deadlines.erase(it->second.deadlinePos);
+            it->second.deadlinePos = deadlines.emplace(deadline, handle);
+        }
+    }
+    it->second.entries.push_back(std::move(entry));
+
+    evict();
+}
+
+std::vector<ResendTracker::Entry> ResendTracker::take(RaceHandle handle, Clock::time_point now) {
+    std::vector<Entry> entries;
+    auto it = packages.find(handle);
+    if (it != packages.end()) {
+        entries = it->second.entries;
+        erase(it);
+    }
+    expire(now);
+    return entries;
+}
+
+bool ResendTracker::remove(RaceHandle handle, Clock::time_point now) {
+    auto it = packages.find(handle);
+    const bool found = it != packages.end();
+    if (found) {
+        erase(it);
+    }
+    expire(now);
+    return found;
+}
+
+bool ResendTracker::removeIfUnreliable(RaceHandle handle, Clock::time_point now) {
+    auto it = packages.find(handle);
+    const bool found = it != packages.end() && !it->second.entries.front().reliable;
+    if (found) {
+        erase(it);
+    }
+    expire(now);
+    return found;
+}
+
+std::size_t ResendTracker::expire(Clock::time_point now) {
+    std::size_t count = 0;
+    while (!deadlines.empty() && deadlines.begin()->first <= now) {
+        erase(packages.find(deadlines.begin()->second));
+        ++count;
+    }
+    numExpired += count;
+    return count;
+}
+
+void ResendTracker::erase(std::unordered_map<RaceHandle, Package>::iterator it) {
+    for (const Entry &entry : it->second.entries) {
+        release(entry.msg);
+    }
+    lru.erase(it->second.lruPos);
+    deadlines.erase(it->second.deadlinePos);
+    packages.erase(it);
+}
+
+void ResendTracker::retain(const MsgPtr &msg) {
+    if (++msgRefs[msg.get()] == 1) {
+        bytesRetained += msg->size();
+    }
+}
+
+void ResendTracker::release(const MsgPtr &msg) {
+    auto it = msgRefs.find(msg.get());
+    if (--it->second == 0) {
+        bytesRetained -= msg->size();
+        msgRefs.erase(it);
+    }
+}
+
+void ResendTracker::evict() {
+    while (bytesRetained > maxBytes && !lru.empty()) {
+        erase(packages.find(lru.front()));
+        ++numEvicted;
+    }
+}
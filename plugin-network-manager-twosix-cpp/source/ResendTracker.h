@@ -0,0 +1,217 @@
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef __NETWORK_MANAGER_TWOSIX_RESEND_TRACKER_H__
+#define __NETWORK_MANAGER_TWOSIX_RESEND_TRACKER_H__
+
+#include <LinkProperties.h>
+#include <SdkResponse.h>
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Tracks the formatted messages of sent packages so that they can be resent if the package
+ * fails.
+ *
+ * Formatted messages are shared rather than copied, so a message sent to several destinations (or
+ * as a multicast package) is only retained once. Memory is bounded in two ways, since some
+ * channels never report the final status of a package:
+ *
+ *   * Packages expire once they are older than the age they were added with (see maxAgeForLink).
+ *   * When the retained messages take up more than the byte budget, the least recently added
+ *     packages are evicted.
+ *
+ * Expiry is checked whenever a package is added or removed, so no timer is needed.
+ *
+ * This class is not thread-safe.
+ */
+class ResendTracker {
+public:
+    using Clock = std::chrono::steady_clock;
+    using MsgPtr = std::shared_ptr<const std::string>;
+
+    /**
+     * @brief A formatted message and where it was sent
+     */
+    struct Entry {
+        std::string dst;
+        MsgPtr msg;
+        std::uint64_t traceId;
+        std::uint64_t spanId;
+        bool reliable;
+        // the connection the package was sent on
+        ConnectionID connId;
+    };
+
+    static constexpr std::size_t DEFAULT_MAX_BYTES = 16 * 1024 * 1024;
+    static constexpr std::chrono::seconds DEFAULT_MAX_AGE{600};
+
+    /**
+     * @brief Construct a tracker with the default limits
+     */
+    ResendTracker();
+
+    /**
+     * @brief Change the limits. Existing packages keep the age they were added with, but are
+     * evicted if they exceed the new byte budget.
+     *
+     * @param maxBytes The maximum number of message bytes to retain
+     * @param maxAge The maximum age of a package
+     */
+    void setLimits(std::size_t maxBytes, Clock::duration maxAge);
+
+    /**
+     * @brief Get the age a package sent on a link may reach before it expires. This is a multiple
+     * of the expected send latency of the link, bounded by the maximum age. If the latency is
+     * unknown the maximum age is used.
+     *
+     * @param props The LinkProperties of the link the package was sent on
+     * @return The maximum age of the package
+     */
+    Clock::duration maxAgeForLink(const LinkProperties &props) const;
+
+    /**
+     * @brief Get the age a package sent on a link with the given expected send latency may reach
+     * before it expires (see maxAgeForLink)
+     *
+     * @param sendLatencyMs The expected send latency of the link in milliseconds, or a negative
+     * value if unknown
+     * @return The maximum age of the package
+     */
+    Clock::duration maxAgeForLatency(std::int32_t sendLatencyMs) const;
+
+    /**
+     * @brief Track a sent package. Adding another entry for a handle that is already tracked
+     * (e.g. for each recipient of a multicast package) keeps all of its entries.
+     *
+     * @param handle The handle of the sent package
+     * @param entry The formatted message and destination
+     * @param maxAge The age at which the package expires
+     * @param now The current time
+     */
+    void add(RaceHandle handle, Entry entry, Clock::duration maxAge,
+             Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Stop tracking a package and get its entries, e.g. to resend them
+     *
+     * @param handle The handle of the package
+     * @param now The current time
+     * @return The entries of the package, or an empty vector if it is not tracked
+     */
+    std::vector<Entry> take(RaceHandle handle, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Stop tracking a package
+     *
+     * @param handle The handle of the package
+     * @param now The current time
+     * @return true if the package was tracked
+     */
+    bool remove(RaceHandle handle, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Stop tracking a package if it was sent on an unreliable link. A sent status is final
+     * for those links.
+     *
+     * @param handle The handle of the package
+     * @param now The current time
+     * @return true if the package was tracked and removed
+     */
+    bool removeIfUnreliable(RaceHandle handle, Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Stop tracking all packages that have expired
+     *
+     * @param now The current time
+     * @return The number of packages that expired
+     */
+    std::size_t expire(Clock::time_point now = Clock::now());
+
+    /**
+     * @brief Get the number of tracked packages
+     *
+     * @return The number of packages
+     */
+    std::size_t size() const {
+        return packages.size();
+    }
+
+    /**
+     * @brief Get the number of message bytes retained. A message shared by several packages or
+     * entries is only counted once.
+     *
+     * @return The number of bytes
+     */
+    std::size_t getBytesRetained() const {
+        return bytesRetained;
+    }
+
+    /**
+     * @brief Get the number of packages evicted to stay within the byte budget
+     *
+     * @return The number of evicted packages
+     */
+    std::uint64_t getNumEvicted() const {
+        return numEvicted;
+    }
+
+    /**
+     * @brief Get the number of packages that expired before reaching a final status
+     *
+     * @return The number of expired packages
+     */
+    std::uint64_t getNumExpired() const {
+        return numExpired;
+    }
+
+private:
+    using Lru = std::list<RaceHandle>;
+    using Deadlines = std::multimap<Clock::time_point, RaceHandle>;
+
+    struct Package {
+        std::vector<Entry> entries;
+        Lru::iterator lruPos;
+        Deadlines::iterator deadlinePos;
+    };
+
+    void erase(std::unordered_map<RaceHandle, Package>::iterator it);
+    void retain(const MsgPtr &msg);
+    void release(const MsgPtr &msg);
+    void evict();
+
+    std::unordered_map<RaceHandle, Package> packages;
+    // Handles in the order they were added, least recently added first
+    Lru lru;
+    Deadlines deadlines;
+    // Number of entries referring to each retained message
+    std::unordered_map<const std::string *, std::size_t> msgRefs;
+
+    std::size_t maxBytes;
+    Clock::duration maxAge;
+    std::size_t bytesRetained;
+    std::uint64_t numEvicted;
+    std::uint64_t numExpired;
+};
+
+#endif
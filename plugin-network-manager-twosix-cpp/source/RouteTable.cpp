@@ -0,0 +1,71 @@
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "RouteTable.h"
+
+#include <atomic>
+
+RouteTable::RouteTable() : routes(std::make_shared<const Routes>()) {}
+
+std::shared_ptr<const RouteTable::Route> RouteTable::find(const std::string &dst) const {
+    std::shared_ptr<const Routes> snapshot = std::atomic_load(&routes);
+    auto it = snapshot->find(dst);
+    if (it == snapshot->end()) {
+        return nullptr;
+    }
+    return it->second;
+}
+
+void RouteTable::update(const std::string &dst, const RankedConnections &rankedConns,
+                        std::shared_ptr<const std::vector<std::uint8_t>> key) {
+    auto route = std::make_shared<Route>();
+    route->hops.reserve(rankedConns.size());
+    for (const auto &[connId, props] : rankedConns) {
+        route->hops.push_back(Hop{connId, props.channelGid, props.reliable, props.isFlushable,
+                                  props.expected.send.latency_ms});
+    }
+    route->key = std::move(key);
+    publish(dst, std::move(route));
+}
+
+void RouteTable::updateKey(const std::string &dst,
+                           std::shared_ptr<const std::vector<std::uint8_t>> key) {
+    std::shared_ptr<const Route> current = find(dst);
+    if (current == nullptr) {
+        return;
+    }
+    auto route = std::make_shared<Route>(*current);
+    route->key = std::move(key);
+    publish(dst, std::move(route));
+}
+
+void RouteTable::remove(const std::string &dst) {
+    publish(dst, nullptr);
+}
+
+size_t RouteTable::size() const {
+    return std::atomic_load(&routes)->size();
+}
+
+void RouteTable::publish(const std::string &dst, std::shared_ptr<const Route> route) {
+    auto snapshot = std::make_shared<Routes>(*std::atomic_load(&routes));
+    if (route == nullptr) {
+        snapshot->erase(dst);
+    } else {
+        (*snapshot)[dst] = std::move(route);
+    }
+    std::atomic_store(&routes, std::shared_ptr<const Routes>(std::move(snapshot)));
+}
@@ -0,0 +1,121 @@
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef __NETWORK_MANAGER_TWOSIX_ROUTE_TABLE_H__
+#define __NETWORK_MANAGER_TWOSIX_ROUTE_TABLE_H__
+
+#include <LinkProperties.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Precomputed routes to each destination, read by the send path.
+ *
+ * A route holds what sending needs to know about each connection to a destination, already ranked,
+ * along with the destination's key. Routes are rebuilt when connections open or close, or link
+ * properties change, so sending never has to copy the ranked connections or persona, or ask the SDK
+ * for link properties.
+ *
+ * Routes are immutable once published. The table itself is a snapshot that is replaced (copying
+ * only its pointers) on every update, so readers never take a lock: find() returns a route that
+ * stays valid for as long as the caller holds it, even if it is replaced meanwhile. Updates must
+ * not be made concurrently with each other.
+ */
+class RouteTable {
+public:
+    /**
+     * @brief A connection to a destination
+     */
+    struct Hop {
+        ConnectionID connId;
+        std::string channelGid;
+        bool reliable{false};
+        bool isFlushable{false};
+        std::int32_t sendLatencyMs{-1};
+    };
+
+    /**
+     * @brief The ranked connections to a destination and the key to encrypt for it with
+     */
+    struct Route {
+        std::vector<Hop> hops;
+        // Null for a multicast group, whose members each have their own key
+        std::shared_ptr<const std::vector<std::uint8_t>> key;
+    };
+
+    using RankedConnections = std::vector<std::pair<ConnectionID, LinkProperties>>;
+
+    RouteTable();
+
+    /**
+     * @brief Get the route to a destination
+     *
+     * @param dst The destination UUID, or personasToString of a multicast group
+     * @return The route, or nullptr if there is none
+     */
+    std::shared_ptr<const Route> find(const std::string &dst) const;
+
+    /**
+     * @brief Replace the route to a destination
+     *
+     * @param dst The destination UUID, or personasToString of a multicast group
+     * @param rankedConns The connections to the destination, best first
+     * @param key The key of the destination, or nullptr for a multicast group
+     */
+    void update(const std::string &dst, const RankedConnections &rankedConns,
+                std::shared_ptr<const std::vector<std::uint8_t>> key);
+
+    /**
+     * @brief Replace the key of the route to a destination, keeping its connections. Does nothing
+     * if there is no route to the destination.
+     *
+     * @param dst The destination UUID
+     * @param key The new key of the destination
+     */
+    void updateKey(const std::string &dst, std::shared_ptr<const std::vector<std::uint8_t>> key);
+
+    /**
+     * @brief Remove the route to a destination
+     *
+     * @param dst The destination UUID, or personasToString of a multicast group
+     */
+    void remove(const std::string &dst);
+
+    /**
+     * @brief Get the number of destinations with a route
+     *
+     * @return The number of routes
+     */
+    size_t size() const;
+
+private:
+    using Routes = std::unordered_map<std::string, std::shared_ptr<const Route>>;
+
+    /**
+     * @brief Publish a new snapshot with the route to dst replaced, or removed if route is null
+     */
+    void publish(const std::string &dst, std::shared_ptr<const Route> route);
+
+    // Only accessed with std::atomic_load / std::atomic_store
+    std::shared_ptr<const Routes> routes;
+};
+
+#endif
@@ -59,6 +59,10 @@ TEST(ConfigNMTwoSixClient, load_defaults) {
     EXPECT_EQ("", config.bootstrapIntroducer);
     EXPECT_NEAR(60.0, config.lookbackSeconds, 0.01);
     EXPECT_EQ(0, config.otherConnections.size());
+    EXPECT_EQ(16 * 1024 * 1024, config.maxResendBytes);
+    EXPECT_NEAR(600.0, config.maxResendAgeSeconds, 0.01);
+    EXPECT_FALSE(config.adaptiveLinkSelection);
+    EXPECT_FALSE(config.splitTraffic);
 }
 
 TEST(ConfigNMTwoSixClient, load_all_keys_defined) {
@@ -96,6 +100,10 @@ TEST(ConfigNMTwoSixClient, load_all_keys_defined) {
                 "invalid-value"
             ],
             "maxSeenMessages": 200,
+            "maxResendBytes": 4096,
+            "maxResendAgeSeconds": 120,
+            "adaptiveLinkSelection": true,
+            "splitTraffic": true,
             "useLinkWizard": false,
             "bootstrapHandle": 8675309,
             "bootstrapIntroducer": "race-client-1",
@@ -123,6 +131,10 @@ TEST(ConfigNMTwoSixClient, load_all_keys_defined) {
     EXPECT_EQ("race-client-1", config.bootstrapIntroducer);
     EXPECT_NEAR(15.0, config.lookbackSeconds, 0.01);
     EXPECT_THAT(config.otherConnections, ::testing::ElementsAre("race-server-1"));
+    EXPECT_EQ(4096, config.maxResendBytes);
+    EXPECT_NEAR(120.0, config.maxResendAgeSeconds, 0.01);
+    EXPECT_TRUE(config.adaptiveLinkSelection);
+    EXPECT_TRUE(config.splitTraffic);
 }
 
 TEST(ConfigNMTwoSixClient, load_file_doesnt_exist) {
@@ -146,6 +158,7 @@ TEST(ConfigNMTwoSixClient, load_invalid_format) {
 }
 
 static const std::string expectedClientJson = R"({
+    "adaptiveLinkSelection": false,
     "bootstrapHandle": 8675309,
     "bootstrapIntroducer": "race-client-2",
     "channelRoles": {
@@ -176,8 +189,11 @@ static const std::string expectedClientJson = R"({
         }
     ],
     "lookbackSeconds": 60.0,
+    "maxResendAgeSeconds": 600.0,
+    "maxResendBytes": 16777216,
     "maxSeenMessages": 10000,
     "otherConnections": [],
+    "splitTraffic": false,
     "useLinkWizard": true
 })";
 
@@ -216,11 +232,18 @@ TEST(ConfigNMTwoSixServer, load_defaults) {
     EXPECT_EQ(1000000, config.maxFloodedUuids);
     EXPECT_EQ(2, config.floodingFactor);
     EXPECT_EQ(0, config.rings.size());
+    EXPECT_EQ("redundant", config.ringStrategy);
+    EXPECT_EQ(0, config.erasureDataRings);
+    EXPECT_EQ(1024, config.erasureMinBytes);
     EXPECT_TRUE(config.useLinkWizard);
     EXPECT_EQ(0, config.bootstrapHandle);
     EXPECT_EQ("", config.bootstrapIntroducer);
     EXPECT_NEAR(60.0, config.lookbackSeconds, 0.01);
     EXPECT_EQ(0, config.otherConnections.size());
+    EXPECT_EQ(16 * 1024 * 1024, config.maxResendBytes);
+    EXPECT_NEAR(600.0, config.maxResendAgeSeconds, 0.01);
+    EXPECT_FALSE(config.adaptiveLinkSelection);
+    EXPECT_FALSE(config.splitTraffic);
 }
 
 TEST(ConfigNMTwoSixServer, load_all_keys_defined) {
@@ -248,6 +271,9 @@ TEST(ConfigNMTwoSixServer, load_all_keys_defined) {
             "maxStaleUuids": 10000,
             "maxFloodedUuids": 15000,
             "floodingFactor": 5,
+            "ringStrategy": "erasure",
+            "erasureDataRings": 2,
+            "erasureMinBytes": 4096,
             "rings": [
                 {
                     "length": 2,
@@ -293,6 +319,9 @@ TEST(ConfigNMTwoSixServer, load_all_keys_defined) {
     EXPECT_THAT(config.rings, ::testing::ElementsAre(::testing::AllOf(
                                   ::testing::Field(&RingEntry::length, 2),
                                   ::testing::Field(&RingEntry::next, "race-server-2"))));
+    EXPECT_EQ("erasure", config.ringStrategy);
+    EXPECT_EQ(2, config.erasureDataRings);
+    EXPECT_EQ(4096, config.erasureMinBytes);
     EXPECT_FALSE(config.useLinkWizard);
     EXPECT_EQ(314159, config.bootstrapHandle);
     EXPECT_EQ("race-server-0", config.bootstrapIntroducer);
@@ -321,12 +350,15 @@ TEST(ConfigNMTwoSixServer, load_invalid_format) {
 }
 
 static const std::string expectedServerJson = R"({
+    "adaptiveLinkSelection": false,
     "channelRoles": {
         "twoSixBootstrapCpp": "roleA",
         "twoSixIndirectCpp": "roleB"
     },
     "committeeClients": [],
     "committeeName": "",
+    "erasureDataRings": 0,
+    "erasureMinBytes": 1024,
     "exitClients": [
         "race-client-2",
         "race-client-1"
@@ -342,10 +374,14 @@ static const std::string expectedServerJson = R"({
     "floodingFactor": 2,
     "lookbackSeconds": 60.0,
     "maxFloodedUuids": 1000000,
+    "maxResendAgeSeconds": 600.0,
+    "maxResendBytes": 16777216,
     "maxStaleUuids": 1000000,
     "otherConnections": [],
     "reachableCommittees": {},
+    "ringStrategy": "redundant",
     "rings": [],
+    "splitTraffic": false,
     "useLinkWizard": true
 })";
 
@@ -0,0 +1,110 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "DedupCache.h"
+
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <set>
+
+#include "gtest/gtest.h"
+
+TEST(DedupCache, insert_contains) {
+    DedupCache<std::int64_t> cache(4);
+    EXPECT_FALSE(cache.contains(1));
+    EXPECT_TRUE(cache.insert(1));
+    EXPECT_TRUE(cache.contains(1));
+    EXPECT_FALSE(cache.contains(2));
+    EXPECT_EQ(cache.size(), 1u);
+    EXPECT_EQ(cache.capacity(), 4u);
+}
+
+TEST(DedupCache, insert_duplicate) {
+    DedupCache<std::int64_t> cache(4);
+    EXPECT_TRUE(cache.insert(1));
+    EXPECT_FALSE(cache.insert(1));
+    EXPECT_EQ(cache.size(), 1u);
+}
+
+TEST(DedupCache, evicts_oldest) {
+    DedupCache<std::int64_t> cache(3);
+    cache.insert(1);
+    cache.insert(2);
+    cache.insert(3);
+    cache.insert(4);
+    EXPECT_EQ(cache.size(), 3u);
+    EXPECT_FALSE(cache.contains(1));
+    EXPECT_TRUE(cache.contains(2));
+    EXPECT_TRUE(cache.contains(3));
+    EXPECT_TRUE(cache.contains(4));
+
+    // re-inserting a present value does not refresh its age
+    EXPECT_FALSE(cache.insert(2));
+    cache.insert(5);
+    EXPECT_FALSE(cache.contains(2));
+    EXPECT_TRUE(cache.contains(3));
+}
+
+TEST(DedupCache, zero_capacity) {
+    DedupCache<std::int64_t> cache;
+    EXPECT_FALSE(cache.insert(1));
+    EXPECT_FALSE(cache.contains(1));
+    EXPECT_EQ(cache.size(), 0u);
+}
+
+TEST(DedupCache, reset) {
+    DedupCache<std::int64_t> cache(2);
+    cache.insert(1);
+    cache.insert(2);
+    cache.reset(10);
+    EXPECT_EQ(cache.size(), 0u);
+    EXPECT_EQ(cache.capacity(), 10u);
+    EXPECT_FALSE(cache.contains(1));
+    for (std::int64_t i = 0; i < 10; ++i) {
+        EXPECT_TRUE(cache.insert(i));
+    }
+    EXPECT_EQ(cache.size(), 10u);
+}
+
+TEST(DedupCache, matches_reference) {
+    // Colliding values (small range) exercise probing and backward-shift deletion
+    const size_t capacity = 1000;
+    DedupCache<std::int64_t> cache(capacity);
+    std::deque<std::int64_t> order;
+    std::set<std::int64_t> present;
+
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<std::int64_t> dist(0, 5000);
+    for (int i = 0; i < 200000; ++i) {
+        std::int64_t value = dist(rng);
+        bool expected = present.count(value) == 0;
+        ASSERT_EQ(cache.insert(value), expected) << "iteration " << i;
+        if (expected) {
+            order.push_back(value);
+            present.insert(value);
+            if (order.size() > capacity) {
+                present.erase(order.front());
+                order.pop_front();
+            }
+        }
+        ASSERT_EQ(cache.size(), order.size());
+
+        std::int64_t probe = dist(rng);
+        ASSERT_EQ(cache.contains(probe), present.count(probe) > 0) << "iteration " << i;
+    }
+}
@@ -0,0 +1,112 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Compares DedupCache with the boost multi_index container (sequenced + ordered_unique, trimmed
+// by 10% when full) that was previously used for seenMessages, staleUuids and floodedUuids.
+//
+// Usage: benchmarkDedupCache [entries]
+
+#include <boost/multi_index/identity.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index_container.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DedupCache.h"
+
+namespace bmi = boost::multi_index;
+using OrderedUuidSet = bmi::multi_index_container<
+    std::int64_t,
+    bmi::indexed_by<bmi::sequenced<>,
+                    bmi::ordered_unique<bmi::tag<struct unique>, bmi::identity<std::int64_t>>>>;
+
+class MultiIndexCache {
+public:
+    explicit MultiIndexCache(size_t capacity) : capacity(capacity) {}
+
+    bool contains(std::int64_t value) const {
+        return set.get<unique>().count(value) > 0;
+    }
+
+    void insert(std::int64_t value) {
+        if (set.size() > capacity) {
+            auto end = set.begin();
+            std::advance(end, capacity / 10 + 1);
+            set.erase(set.begin(), end);
+        }
+        set.push_back(value);
+    }
+
+private:
+    size_t capacity;
+    OrderedUuidSet set;
+};
+
+template <typename Cache>
+static void run(const std::string &name, size_t entries, const std::vector<std::int64_t> &values) {
+    using Clock = std::chrono::steady_clock;
+    Cache cache(entries);
+
+    // fill to capacity, then keep going so that every insert evicts
+    auto start = Clock::now();
+    for (auto value : values) {
+        if (!cache.contains(value)) {
+            cache.insert(value);
+        }
+    }
+    auto insertTime = Clock::now() - start;
+
+    // look up a mix of values that are and aren't present
+    size_t hits = 0;
+    start = Clock::now();
+    for (size_t i = 0; i < values.size(); i += 2) {
+        hits += cache.contains(values[i]) ? 1 : 0;
+    }
+    auto lookupTime = Clock::now() - start;
+
+    auto nsPerOp = [](Clock::duration elapsed, size_t ops) {
+        return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(ops);
+    };
+    std::cout << name << ": check+insert " << nsPerOp(insertTime, values.size())
+              << " ns/op, lookup " << nsPerOp(lookupTime, values.size() / 2) << " ns/op ("
+              << hits << " hits)" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    size_t entries = 1000000;
+    if (argc > 1) {
+        entries = std::strtoull(argv[1], nullptr, 10);
+    }
+
+    std::mt19937_64 rng(42);
+    std::vector<std::int64_t> values(entries * 3);
+    for (auto &value : values) {
+        value = static_cast<std::int64_t>(rng());
+    }
+
+    std::cout << entries << " entries, " << values.size() << " inserts" << std::endl;
+    run<MultiIndexCache>("multi_index", entries, values);
+    run<DedupCache<std::int64_t>>("DedupCache ", entries, values);
+    return 0;
+}
@@ -0,0 +1,94 @@
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "ErasureCode.h"
+
+#include <stdexcept>
+
+#include "gtest/gtest.h"
+
+static std::string makeData(size_t length) {
+    std::string data(length, '\0');
+    for (size_t i = 0; i < length; ++i) {
+        data[i] = static_cast<char>((i * 131 + 7) % 256);
+    }
+    return data;
+}
+
+static std::vector<std::optional<std::string>> toOptional(const std::vector<std::string> &in) {
+    return std::vector<std::optional<std::string>>(in.begin(), in.end());
+}
+
+TEST(ErasureCode, encode_sizes) {
+    std::vector<std::string> fragments = ErasureCode::encode(makeData(1001), 3, 5);
+    ASSERT_EQ(fragments.size(), 5u);
+    for (const std::string &fragment : fragments) {
+        EXPECT_EQ(fragment.size(), 334u);
+    }
+    // data fragments hold the data as is
+    EXPECT_EQ(fragments[0], makeData(1001).substr(0, 334));
+}
+
+TEST(ErasureCode, round_trip_all_fragments) {
+    const std::string data = makeData(1000);
+    auto fragments = toOptional(ErasureCode::encode(data, 4, 6));
+    EXPECT_EQ(ErasureCode::decode(fragments, 4, data.size()), data);
+}
+
+TEST(ErasureCode, recovers_from_any_k_fragments) {
+    const std::string data = makeData(777);
+    const std::vector<std::string> fragments = ErasureCode::encode(data, 3, 5);
+    // try every combination of two missing fragments
+    for (size_t a = 0; a < 5; ++a) {
+        for (size_t b = a + 1; b < 5; ++b) {
+            auto received = toOptional(fragments);
+            received[a].reset();
+            received[b].reset();
+            EXPECT_EQ(ErasureCode::decode(received, 3, data.size()), data)
+                << "missing " << a << " and " << b;
+        }
+    }
+}
+
+TEST(ErasureCode, empty_and_short_data) {
+    for (size_t length : {0u, 1u, 2u, 5u}) {
+        const std::string data = makeData(length);
+        auto fragments = toOptional(ErasureCode::encode(data, 3, 4));
+        fragments[0].reset();
+        EXPECT_EQ(ErasureCode::decode(fragments, 3, length), data);
+    }
+}
+
+TEST(ErasureCode, too_few_fragments) {
+    const std::string data = makeData(100);
+    auto fragments = toOptional(ErasureCode::encode(data, 2, 3));
+    fragments[0].reset();
+    fragments[2].reset();
+    EXPECT_THROW(ErasureCode::decode(fragments, 2, data.size()), std::invalid_argument);
+
+    // a fragment of the wrong size does not count
+    fragments = toOptional(ErasureCode::encode(data, 2, 3));
+    fragments[1]->pop_back();
+    fragments[2].reset();
+    EXPECT_THROW(ErasureCode::decode(fragments, 2, data.size()), std::invalid_argument);
+}
+
+TEST(ErasureCode, invalid_counts) {
+    EXPECT_THROW(ErasureCode::encode("data", 0, 2), std::invalid_argument);
+    EXPECT_THROW(ErasureCode::encode("data", 3, 2), std::invalid_argument);
+    EXPECT_THROW(ErasureCode::encode("data", 2, ErasureCode::MAX_FRAGMENTS + 1),
+                 std::invalid_argument);
+}
@@ -0,0 +1,113 @@
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "LinkStats.h"
+
+#include "gtest/gtest.h"
+
+using namespace std::chrono_literals;
+
+static const LinkStats::Clock::time_point start;
+
+static RouteTable::Hop makeHop(const ConnectionID &connId, std::int32_t latencyMs = -1) {
+    RouteTable::Hop hop;
+    hop.connId = connId;
+    hop.sendLatencyMs = latencyMs;
+    return hop;
+}
+
+TEST(LinkStats, latency_from_first_status) {
+    LinkStats stats;
+    stats.onSent(1, "conn-a", 0.0, start);
+    EXPECT_EQ(stats.numInFlight(), 1u);
+
+    stats.onPackageStatus(1, PACKAGE_SENT, start + 100ms);
+    // later statuses of the same package are ignored
+    stats.onPackageStatus(1, PACKAGE_RECEIVED, start + 900ms);
+
+    const LinkStats::Stats *connStats = stats.find("conn-a");
+    ASSERT_NE(connStats, nullptr);
+    EXPECT_NEAR(connStats->latencyMs, 100.0, 0.01);
+    EXPECT_NEAR(connStats->loss, 0.0, 0.01);
+    EXPECT_EQ(stats.numInFlight(), 0u);
+}
+
+TEST(LinkStats, ewma) {
+    LinkStats stats;
+    stats.setParameters(0.5, 600s);
+    stats.onSent(1, "conn-a", 0.0, start);
+    stats.onPackageStatus(1, PACKAGE_SENT, start + 100ms);
+    stats.onSent(2, "conn-a", 1.0, start);
+    stats.onPackageStatus(2, PACKAGE_FAILED_GENERIC, start + 300ms);
+    stats.onSent(3, "conn-a", 0.0, start);
+    stats.onPackageStatus(3, PACKAGE_SENT, start + 300ms);
+
+    const LinkStats::Stats *connStats = stats.find("conn-a");
+    ASSERT_NE(connStats, nullptr);
+    EXPECT_NEAR(connStats->latencyMs, 200.0, 0.01);
+    EXPECT_NEAR(connStats->loss, 0.25, 0.01);
+    EXPECT_NEAR(connStats->queueUtilization, 0.25, 0.01);
+}
+
+TEST(LinkStats, unanswered_packages_expire_as_lost) {
+    LinkStats stats;
+    stats.setParameters(0.5, 10s);
+    stats.onSent(1, "conn-a", 0.0, start);
+    EXPECT_EQ(stats.expire(start + 9s), 0u);
+    EXPECT_EQ(stats.expire(start + 10s), 1u);
+    EXPECT_EQ(stats.numInFlight(), 0u);
+    EXPECT_NEAR(stats.find("conn-a")->loss, 0.5, 0.01);
+}
+
+TEST(LinkStats, select_keeps_ranking_without_evidence) {
+    LinkStats stats;
+    std::vector<RouteTable::Hop> hops = {makeHop("conn-a"), makeHop("conn-b", 10)};
+    EXPECT_EQ(stats.select(hops, false), 0u);
+}
+
+TEST(LinkStats, select_avoids_slow_connection) {
+    LinkStats stats;
+    std::vector<RouteTable::Hop> hops = {makeHop("conn-a"), makeHop("conn-b", 50)};
+    stats.onSent(1, "conn-a", 0.9, start);
+    stats.onPackageStatus(1, PACKAGE_SENT, start + 2s);
+    EXPECT_EQ(stats.select(hops, false), 1u);
+
+    // a lossy connection is predicted to be slower
+    stats.onSent(2, "conn-b", 0.0, start);
+    stats.onPackageStatus(2, PACKAGE_SENT, start + 500ms);
+    for (RaceHandle handle = 3; handle < 20; ++handle) {
+        stats.onSent(handle, "conn-b", 0.0, start);
+        stats.onPackageStatus(handle, PACKAGE_FAILED_TIMEOUT, start);
+    }
+    EXPECT_EQ(stats.select(hops, false), 0u);
+
+    // a closed connection is forgotten
+    stats.remove("conn-a");
+    EXPECT_EQ(stats.select(hops, false), 0u);
+}
+
+TEST(LinkStats, select_split) {
+    LinkStats stats;
+    std::vector<RouteTable::Hop> hops = {makeHop("conn-a", 100), makeHop("conn-b", 300),
+                                         makeHop("conn-c")};
+    std::vector<int> counts(hops.size(), 0);
+    for (int i = 0; i < 400; ++i) {
+        ++counts[stats.select(hops, true)];
+    }
+    EXPECT_EQ(counts[0], 300);
+    EXPECT_EQ(counts[1], 100);
+    EXPECT_EQ(counts[2], 0);
+}
@@ -44,7 +44,16 @@ public:
             msg = sendQueues[uuid].at(0);
             sendQueues[uuid].erase(sendQueues[uuid].begin());
         }
-        return messageParser.parseDelimitedExtMessage(msg);
+        return messageParser.parseExtMessage(msg, getAesKeyRef(uuid));
+    }
+
+    // The body of the next msg sent to uuid, which is sealed for uuid
+    std::string peekMsg(const std::string &uuid) {
+        return messageParser.parseExtMessage(sendQueues[uuid].at(0), getAesKeyRef(uuid)).getMsg();
+    }
+
+    void addPersona(const Persona &persona) {
+        uuidToPersonaMap[persona.getRaceUuid()] = persona;
     }
 
     std::unordered_map<std::string, std::vector<std::string>> sendQueues;
@@ -75,6 +84,8 @@ public:
         for (auto &node : nodes) {
             node.persona.setDisplayName(node.uuid);
             node.persona.setRaceUuid(node.uuid);
+            node.persona.setAesKey(
+                std::vector<uint8_t>(32, static_cast<uint8_t>(&node - nodes.data())));
             if (node.uuid.find("client") != std::string::npos) {
                 node.persona.setPersonaType(P_CLIENT);
             } else {
@@ -96,6 +107,13 @@ public:
             node.wizard->init();
             node.wizard->setReadyToRespond(true);
         }
+
+        // Every node knows the keys of the others, as with the shared personas config
+        for (auto &node : nodes) {
+            for (auto &other : nodes) {
+                node.plugin->addPersona(other.persona);
+            }
+        }
     }
     virtual ~LinkWizardTestFixture() {}
     virtual void SetUp() override {}
@@ -108,7 +126,7 @@ public:
         // Process the query from wizard0
         EXPECT_TRUE(respondingNode.wizard->processLinkMsg(
             queryNode.persona, queryNode.plugin->popMsg(respondingNode.uuid)));
-        EXPECT_THAT(respondingNode.plugin->sendQueues[queryNode.uuid].at(0),
+        EXPECT_THAT(respondingNode.plugin->peekMsg(queryNode.uuid),
                     testing::HasSubstr("\"supportedChannels\""));
 
         // Process the response
@@ -132,7 +150,7 @@ public:
         linkProps.linkAddress = originNode.uuid;
         linkProps.channelGid = expectedChannelGid;
         originNode.wizard->handleLinkStatusUpdate(createHandle, "linkId", LINK_CREATED, linkProps);
-        EXPECT_THAT(originNode.plugin->sendQueues[destNode.uuid].at(0),
+        EXPECT_THAT(originNode.plugin->peekMsg(destNode.uuid),
                     testing::HasSubstr("\"requestLoadLinkAddress\""));
 
         // wizard1 process the requestLoadLinkAddress from wizard0
@@ -151,7 +169,7 @@ public:
         // call tryObtainUnicastLink on wizard0
         EXPECT_TRUE(originNode.wizard->tryObtainUnicastLink(destNode.persona, linkType,
                                                             expectedChannelGid, LS_BOTH));
-        EXPECT_THAT(originNode.plugin->sendQueues[destNode.uuid].at(0),
+        EXPECT_THAT(originNode.plugin->peekMsg(destNode.uuid),
                     testing::HasSubstr("\"requestCreateUnicastLink\""));
 
         // wizard1 process the requestCreateUnicastLink from wizard0
@@ -167,7 +185,7 @@ public:
         linkProps.linkAddress = destNode.uuid;
         linkProps.channelGid = expectedChannelGid;
         destNode.wizard->handleLinkStatusUpdate(createHandle, "linkId", LINK_CREATED, linkProps);
-        EXPECT_THAT(destNode.plugin->sendQueues[originNode.uuid].at(0),
+        EXPECT_THAT(destNode.plugin->peekMsg(originNode.uuid),
                     testing::HasSubstr("\"requestLoadLinkAddress\""));
 
         // wizard0 process the requestLoadLinkAddress from wizard0
@@ -192,7 +210,7 @@ TEST_F(LinkWizardTestFixture2x0, test_addPersona_queries) {
     // Including BLANK so our numerical indices match the names
     EXPECT_TRUE(nodes[0].wizard->addPersona(nodes[1].persona));
     EXPECT_EQ(nodes[0].plugin->sendQueues[nodes[1].uuid].size(), 1);
-    EXPECT_THAT(nodes[0].plugin->sendQueues[nodes[1].uuid].at(0),
+    EXPECT_THAT(nodes[0].plugin->peekMsg(nodes[1].uuid),
                 testing::HasSubstr("{\"getSupportedChannels\": true}"));
 }
 
@@ -273,9 +291,9 @@ TEST_F(LinkWizardTestFixture3x0, test_tryObtainMulticastSend_l2c) {
     // call tryObtainMulticastSend on wizard0
     EXPECT_TRUE(nodes[0].wizard->tryObtainMulticastSend({nodes[1].persona, nodes[2].persona},
                                                         LT_SEND, "uni-l2c", LS_BOTH));
-    EXPECT_THAT(nodes[0].plugin->sendQueues[nodes[1].uuid].at(0),
+    EXPECT_THAT(nodes[0].plugin->peekMsg(nodes[1].uuid),
                 testing::HasSubstr("\"requestCreateMulticastRecvLink\""));
-    EXPECT_THAT(nodes[0].plugin->sendQueues[nodes[2].uuid].at(0),
+    EXPECT_THAT(nodes[0].plugin->peekMsg(nodes[2].uuid),
                 testing::HasSubstr("\"requestCreateMulticastRecvLink\""));
 
     // wizard1 process the requestLoadLinkAddress from wizard0
@@ -347,9 +365,9 @@ TEST_F(LinkWizardTestFixture3x0, test_tryObtainMulticastSend_bidi) {
     linkProps.linkAddress = nodes[0].uuid;
     linkProps.channelGid = channelGid;
     nodes[0].wizard->handleLinkStatusUpdate(createHandle, "linkId", LINK_CREATED, linkProps);
-    EXPECT_THAT(nodes[0].plugin->sendQueues[nodes[1].uuid].at(0),
+    EXPECT_THAT(nodes[0].plugin->peekMsg(nodes[1].uuid),
                 testing::HasSubstr("\"requestLoadLinkAddress\""));
-    EXPECT_THAT(nodes[0].plugin->sendQueues[nodes[2].uuid].at(0),
+    EXPECT_THAT(nodes[0].plugin->peekMsg(nodes[2].uuid),
                 testing::HasSubstr("\"requestLoadLinkAddress\""));
 
     // wizard1 process the requestLoadLinkAddress from wizard0
@@ -397,7 +415,7 @@ TEST_F(LinkWizardTestFixture2x0, test_delayedTryObtain) {
     linkProps.linkAddress = nodes[0].uuid;
     linkProps.channelGid = channelGid;
     nodes[0].wizard->handleLinkStatusUpdate(createHandle, "linkId", LINK_CREATED, linkProps);
-    EXPECT_THAT(nodes[0].plugin->sendQueues[nodes[1].uuid].at(0),
+    EXPECT_THAT(nodes[0].plugin->peekMsg(nodes[1].uuid),
                 testing::HasSubstr("\"requestLoadLinkAddress\""));
 
     // wizard1 process the requestLoadLinkAddress from wizard0
@@ -102,6 +102,11 @@ public:
     std::string getJaegerConfigPath() override {
         return "";
     }
+
+    void addRouteTest(const std::string &uuid, const ConnectionID &connId) {
+        uuidToConnectionsMap[uuid] = {{connId, LinkProperties()}};
+        updateRoute(uuid);
+    }
 };
 
 class PluginNMTwoSixClientCppTestFixture : public ::testing::Test {
@@ -231,6 +236,37 @@ TEST_F(PluginNMTwoSixClientCppTestFixture,
                 potentialLinks.end());
 }
 
+TEST_F(PluginNMTwoSixClientCppTestFixture, sendMsg_to_client_without_key_is_not_sealed) {
+    PluginConfig pluginConfig;
+    pluginConfig.tmpDirectory = "/tmp/";
+    ASSERT_NO_THROW(plugin.init(pluginConfig));
+    plugin.addRouteTest("race-server-00001", "conn-1");
+    // clients do not keep the keys of clients they are told about
+    plugin.addClient("race-client-00003", RawData(32, 0x42));
+
+    EncPkg sent(0, 0, {});
+    SdkResponse response(SDK_OK);
+    response.handle = 7;
+    EXPECT_CALL(sdk, sendEncryptedPackage(::testing::_, "conn-1", ::testing::_, ::testing::_))
+        .WillOnce([&](EncPkg pkg, ConnectionID, uint64_t, int32_t) {
+            sent = pkg;
+            return response;
+        });
+
+    ClrMsg msg("hello", "race-client-00001", "race-client-00003", 1, 0);
+    RaceHandle handle = NULL_RACE_HANDLE;
+    ASSERT_NO_THROW(handle = plugin.sendMsg("race-server-00001", msg));
+    EXPECT_EQ(handle, 7);
+
+    // the entrance server can read the msg body and seal it for the destination itself
+    RaceCrypto encryptor;
+    std::string decrypted = encryptor.decryptMessage(sent.getCipherTextView(), aes3Bytes);
+    ExtClrMsg received = encryptor.parseExtMessageHeader(decrypted);
+    EXPECT_EQ(received.getMsg(), "hello");
+    EXPECT_EQ(received.getTo(), "race-client-00003");
+    EXPECT_EQ(received.getUuid(), ExtClrMsg(msg).getUuid());
+}
+
 TEST_F(PluginNMTwoSixClientCppTestFixture, reopenReceiveConnection) {
     RaceHandle handle = 42;
     LinkID linkId = "LinkID-0";
@@ -17,6 +17,7 @@
 
 #include "PluginNMTwoSixServerCpp.h"
 
+#include "ErasureCode.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "race/mocks/MockRaceSdkNM.h"
@@ -102,6 +103,13 @@ public:
         return PluginNMTwoSixServerCpp::getPreferredLinkIdForSendingToPersona(potentialLinks,
                                                                               personaType);
     }
+    std::vector<std::size_t> hopOrderTest(const RouteTable::Route &route, std::size_t linkRank,
+                                          const ConnectionID &failedConnId = {}) {
+        return hopOrder(route, linkRank, failedConnId);
+    }
+    void setAdaptiveLinkSelection(bool enabled) {
+        adaptiveLinkSelection = enabled;
+    }
 
     std::string getJaegerConfigPath() override {
         return "";
@@ -349,6 +357,80 @@ TEST_F(PluginNMTwoSixServerCppTestFixture,
     EXPECT_EQ(result, "");
 }
 
+static RouteTable::Route makeRoute(const std::vector<std::int32_t> &sendLatenciesMs) {
+    RouteTable::Route route;
+    for (std::int32_t latencyMs : sendLatenciesMs) {
+        RouteTable::Hop hop;
+        hop.connId = "conn-" + std::to_string(route.hops.size());
+        hop.sendLatencyMs = latencyMs;
+        route.hops.push_back(hop);
+    }
+    return route;
+}
+
+TEST_F(PluginNMTwoSixServerCppTestFixture, hopOrder_uses_ranked_hops_by_default) {
+    auto route = makeRoute({100, 50, 10});
+    EXPECT_EQ(plugin.hopOrderTest(route, 0), std::vector<std::size_t>({0, 1, 2}));
+}
+
+TEST_F(PluginNMTwoSixServerCppTestFixture, hopOrder_tries_adaptive_pick_then_ranked_hops) {
+    plugin.setAdaptiveLinkSelection(true);
+    // the third ranked connection is predicted fastest
+    auto route = makeRoute({100, 50, 10});
+    EXPECT_EQ(plugin.hopOrderTest(route, 0), std::vector<std::size_t>({2, 0, 1}));
+}
+
+TEST_F(PluginNMTwoSixServerCppTestFixture, hopOrder_starts_at_link_rank) {
+    auto route = makeRoute({100, 50, 10});
+    EXPECT_EQ(plugin.hopOrderTest(route, 1), std::vector<std::size_t>({1, 2}));
+    EXPECT_EQ(plugin.hopOrderTest(route, 4), std::vector<std::size_t>({1}));
+}
+
+TEST_F(PluginNMTwoSixServerCppTestFixture, hopOrder_resend_tries_failed_hop_last) {
+    auto route = makeRoute({100, 50, 10});
+    EXPECT_EQ(plugin.hopOrderTest(route, 0, "conn-2"), std::vector<std::size_t>({0, 1, 2}));
+    EXPECT_EQ(plugin.hopOrderTest(route, 0, "conn-1"), std::vector<std::size_t>({0, 2, 1}));
+    EXPECT_EQ(plugin.hopOrderTest(route, 0, "conn-0"), std::vector<std::size_t>({1, 2, 0}));
+    // e.g. a multicast package resent to one of its recipients
+    EXPECT_EQ(plugin.hopOrderTest(route, 0, "conn-multicast"), std::vector<std::size_t>({0, 1, 2}));
+}
+
+static ExtClrMsg makeFragmentMsg(MsgUuid uuid, const std::string &payload, std::uint8_t index) {
+    PayloadFragment fragment;
+    fragment.index = index;
+    fragment.dataCount = 2;
+    fragment.totalCount = 3;
+    fragment.payloadLength = static_cast<std::uint32_t>(payload.size());
+    auto sealed = std::make_shared<SealedPayload>();
+    sealed->cipherText =
+        ErasureCode::encode(payload, fragment.dataCount, fragment.totalCount)[index];
+
+    ExtClrMsg msg;
+    msg.setUuid(uuid);
+    msg.setSealedPayload(std::move(sealed));
+    msg.setFragment(fragment);
+    return msg;
+}
+
+// A msg still waiting for fragments isn't given up on to make room for msgs rebuilt since
+TEST_F(PluginNMTwoSixServerCppTestFixture, assembleFragments_rebuilt_msgs_are_not_pending) {
+    const std::string payload = "sealed payload";
+    ExtClrMsg waiting = makeFragmentMsg(1, payload, 0);
+    EXPECT_FALSE(plugin.assembleFragments(waiting));
+
+    // as many msgs as may be pending at once are rebuilt in the meantime
+    for (MsgUuid uuid = 2; uuid < 1002; ++uuid) {
+        ExtClrMsg first = makeFragmentMsg(uuid, payload, 0);
+        ExtClrMsg second = makeFragmentMsg(uuid, payload, 2);
+        EXPECT_FALSE(plugin.assembleFragments(first));
+        ASSERT_TRUE(plugin.assembleFragments(second));
+    }
+
+    waiting = makeFragmentMsg(1, payload, 1);
+    ASSERT_TRUE(plugin.assembleFragments(waiting));
+    EXPECT_EQ(waiting.getSealedPayload()->cipherText, payload);
+}
+
 TEST_F(PluginNMTwoSixServerCppTestFixture, reopenReceiveConnection) {
     RaceHandle handle = 42;
     LinkID linkId = "LinkID-0";
@@ -17,9 +17,13 @@
 
 #include "RaceCrypto.h"
 
+#include <atomic>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "ExtClrMsg.h"
+#include "MessageFormat.h"
 #include "gtest/gtest.h"
 
 // Forces gtest to use our printing method for MsgHash
@@ -27,6 +31,10 @@ static void PrintTo(const MsgHash &m, std::ostream *o) {
     *o << m;
 }
 
+// Key of the persona formatted messages are addressed to
+static const std::vector<std::uint8_t> dstKey{3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5, 8, 9, 7, 9, 3,
+                                               2, 3, 8, 4, 6, 2, 6, 4, 3, 3, 8, 3, 2, 7, 9, 5};
+
 ////////////////////////////////////////////////////////////////
 // encryptClrMsg
 ////////////////////////////////////////////////////////////////
@@ -51,6 +59,74 @@ TEST(RaceCrypto, encryptClrMsg_empty) {
     EXPECT_EQ(result.size(), 12 + 16);
 }
 
+TEST(RaceCrypto, encryptClrMsg_alternating_keys) {
+    // Contexts are cached per key, so make sure switching between keys uses the right one
+    RaceCrypto encryptor;
+    std::vector<std::uint8_t> key1(32, 1);
+    std::vector<std::uint8_t> key2(32, 2);
+    for (int i = 0; i < 3; ++i) {
+        const RawData result1 = encryptor.encryptClrMsg("one", key1);
+        const RawData result2 = encryptor.encryptClrMsg("two", key2);
+        EXPECT_EQ(encryptor.decryptEncPkg(result1, key1), "one");
+        EXPECT_EQ(encryptor.decryptEncPkg(result2, key2), "two");
+        EXPECT_EQ(encryptor.decryptEncPkg(result1, key2), "");
+        EXPECT_EQ(encryptor.decryptEncPkg(result2, key1), "");
+    }
+}
+
+TEST(RaceCrypto, encryptClrMsg_invalid_key) {
+    RaceCrypto encryptor;
+    EXPECT_THROW(encryptor.encryptClrMsg("abcde", std::vector<std::uint8_t>(16, 0)),
+                 std::logic_error);
+    EXPECT_THROW(encryptor.decryptEncPkg(RawData(40, 0), {}), std::logic_error);
+}
+
+TEST(RaceCrypto, decryptInto_in_place) {
+    RaceCrypto encryptor;
+    const std::vector<std::uint8_t> key(32, 7);
+    const std::string plaintext = "hello, world";
+    RawData encrypted = encryptor.encryptClrMsg(plaintext, key);
+    ASSERT_EQ(RaceCrypto::getPlaintextLength(encrypted.size()), plaintext.size());
+
+    uint8_t *output = encrypted.data() + 12 + 16;
+    ASSERT_TRUE(encryptor.decryptInto(encrypted, key, output));
+    EXPECT_EQ(std::string(output, output + plaintext.size()), plaintext);
+}
+
+TEST(RaceCrypto, decryptInto_verification_failure) {
+    RaceCrypto encryptor;
+    const std::vector<std::uint8_t> key(32, 7);
+    RawData encrypted = encryptor.encryptClrMsg("hello, world", key);
+    encrypted.back() ^= 1;
+
+    std::vector<uint8_t> output(RaceCrypto::getPlaintextLength(encrypted.size()));
+    EXPECT_FALSE(encryptor.decryptInto(encrypted, key, output.data()));
+    EXPECT_FALSE(encryptor.decryptInto(RawData(10, 0), key, output.data()));
+    EXPECT_EQ(RaceCrypto::getPlaintextLength(10), 0u);
+}
+
+TEST(RaceCrypto, encryptClrMsg_multiple_threads) {
+    RaceCrypto encryptor;
+    const std::vector<std::uint8_t> key(32, 3);
+    std::atomic<int> failures{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 200; ++i) {
+                std::string plaintext = std::to_string(t) + ":" + std::to_string(i);
+                if (encryptor.decryptEncPkg(encryptor.encryptClrMsg(plaintext, key), key) !=
+                    plaintext) {
+                    failures++;
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(failures, 0);
+}
+
 ////////////////////////////////////////////////////////////////
 // parseDelimitedMessage
 ////////////////////////////////////////////////////////////////
@@ -97,6 +173,304 @@ TEST(RaceCrypto, parseDelimitedMessage_invalid) {
     EXPECT_THROW(encryptor.parseDelimitedMessage(messageToParse), std::invalid_argument);
 }
 
+TEST(RaceCrypto, parseDelimitedExtMessage) {
+    RaceCrypto encryptor;
+    const std::string delimiter = encryptor.getDelimiter();
+    const std::string messageToParse =
+        "extClrMsg" + delimiter + "hello, world" + delimiter + "race-client-2" + delimiter +
+        "race-client-1" + delimiter + "1577836800000000" + delimiter + "1234567890" + delimiter +
+        "1" + delimiter + "42" + delimiter + "3" + delimiter + "2" + delimiter + "1" + delimiter +
+        "[\"committee-1\"]" + delimiter + "[]";
+    ExtClrMsg parsedMsg = encryptor.parseExtMessage(messageToParse, dstKey);
+    EXPECT_EQ(parsedMsg.getMsg(), "hello, world");
+    EXPECT_EQ(parsedMsg.getFrom(), "race-client-2");
+    EXPECT_EQ(parsedMsg.getTo(), "race-client-1");
+    EXPECT_EQ(parsedMsg.getTime(), 1577836800000000);
+    EXPECT_EQ(parsedMsg.getNonce(), 1234567890);
+    EXPECT_EQ(parsedMsg.getAmpIndex(), 1);
+    EXPECT_EQ(parsedMsg.getUuid(), 42);
+    EXPECT_EQ(parsedMsg.getRingTtl(), 3);
+    EXPECT_EQ(parsedMsg.getRingIdx(), 2);
+    EXPECT_EQ(parsedMsg.getMsgType(), MSG_CLIENT);
+    EXPECT_EQ(parsedMsg.getCommitteesVisited(), std::vector<std::string>({"committee-1"}));
+    EXPECT_EQ(parsedMsg.getCommitteesSent(), std::vector<std::string>());
+}
+
+////////////////////////////////////////////////////////////////
+// formatMessage / parseExtMessage
+////////////////////////////////////////////////////////////////
+
+TEST(RaceCrypto, formatMessage_ext_round_trip) {
+    RaceCrypto encryptor;
+    // include the delimiter in the message to make sure it no longer matters
+    ExtClrMsg msg("hello:::world", "race-client-1", "race-client-2", 1577836800000000,
+                  -5, 3, 0x1122334455667788, 7, -1, MSG_LINKS, {"committee-1", "committee-2"},
+                  {"committee-3"});
+
+    std::string formatted = encryptor.formatMessage(msg, dstKey);
+    EXPECT_TRUE(MessageFormat::isBinary(formatted));
+    EXPECT_EQ(encryptor.getMsgLength(formatted), msg.getMsg().size());
+
+    ExtClrMsg parsedMsg = encryptor.parseExtMessage(formatted, dstKey);
+    EXPECT_EQ(parsedMsg.getMsg(), msg.getMsg());
+    EXPECT_EQ(parsedMsg.getFrom(), msg.getFrom());
+    EXPECT_EQ(parsedMsg.getTo(), msg.getTo());
+    EXPECT_EQ(parsedMsg.getTime(), msg.getTime());
+    EXPECT_EQ(parsedMsg.getNonce(), msg.getNonce());
+    EXPECT_EQ(parsedMsg.getAmpIndex(), msg.getAmpIndex());
+    EXPECT_EQ(parsedMsg.getUuid(), msg.getUuid());
+    EXPECT_EQ(parsedMsg.getRingTtl(), msg.getRingTtl());
+    EXPECT_EQ(parsedMsg.getRingIdx(), msg.getRingIdx());
+    EXPECT_EQ(parsedMsg.getMsgType(), msg.getMsgType());
+    EXPECT_EQ(parsedMsg.getCommitteesVisited(), msg.getCommitteesVisited());
+    EXPECT_EQ(parsedMsg.getCommitteesSent(), msg.getCommitteesSent());
+}
+
+TEST(RaceCrypto, formatMessage_clr_round_trip) {
+    RaceCrypto encryptor;
+    ClrMsg msg("hello", "race-client-1", "race-client-2", 1577836800000000, 10, 2);
+
+    ExtClrMsg parsedMsg = encryptor.parseExtMessage(encryptor.formatMessage(msg, dstKey), dstKey);
+    EXPECT_EQ(static_cast<const ClrMsg &>(parsedMsg), msg);
+    EXPECT_EQ(parsedMsg.getUuid(), ExtClrMsg(msg).getUuid());
+    EXPECT_EQ(parsedMsg.getMsgType(), MSG_CLIENT);
+}
+
+TEST(RaceCrypto, decode_views_formatted_buffer) {
+    RaceCrypto encryptor;
+    ExtClrMsg msg("hello", "race-client-1", "race-client-2", 0, 0, 0, 1, 0, 0, MSG_CLIENT,
+                  {"committee-1"}, {});
+    std::string formatted = encryptor.formatMessage(msg, dstKey);
+
+    MessageFormat::ExtClrMsgView view = MessageFormat::decode(formatted);
+    EXPECT_EQ(view.kind, MessageFormat::KIND_EXT_CLR_MSG);
+    EXPECT_EQ(view.from, "race-client-1");
+    EXPECT_GE(view.from.data(), formatted.data());
+    EXPECT_LE(view.from.data() + view.from.size(), formatted.data() + formatted.size());
+    ASSERT_EQ(view.committeesVisited.size(), 1u);
+    EXPECT_EQ(view.committeesVisited[0], "committee-1");
+
+    // the msg body is sealed, so it does not appear in the formatted message
+    EXPECT_EQ(formatted.find("hello"), std::string::npos);
+    EXPECT_EQ(view.sealedPayload.size(), msg.getMsg().size() + 12 + 16);
+    EXPECT_EQ(MessageFormat::getHeaderLength(formatted),
+              formatted.size() - view.sealedPayload.size());
+}
+
+TEST(RaceCrypto, parseExtMessage_truncated) {
+    RaceCrypto encryptor;
+    ExtClrMsg msg("hello", "race-client-1", "race-client-2", 0, 0, 0, 1, 0, 0, MSG_CLIENT,
+                  {"committee-1"}, {"committee-2"});
+    std::string formatted = encryptor.formatMessage(msg, dstKey);
+
+    for (size_t length = 1; length < formatted.size(); ++length) {
+        EXPECT_THROW(encryptor.parseExtMessage(formatted.substr(0, length), dstKey),
+                     std::invalid_argument);
+    }
+    EXPECT_THROW(encryptor.parseExtMessage(formatted + "x", dstKey), std::invalid_argument);
+}
+
+TEST(RaceCrypto, parseExtMessage_unsupported_version) {
+    RaceCrypto encryptor;
+    std::string formatted = encryptor.formatMessage(ClrMsg("hello", "a", "b", 0, 0, 0), dstKey);
+    formatted[1] = static_cast<char>(MessageFormat::VERSION + 1);
+    EXPECT_THROW(encryptor.parseExtMessage(formatted, dstKey), std::invalid_argument);
+}
+
+////////////////////////////////////////////////////////////////
+// encryptMessage / decryptMessage
+////////////////////////////////////////////////////////////////
+
+static const std::vector<std::uint8_t> hopKey1{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1, 2, 3, 4, 5,
+                                               6, 7, 8, 9, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0, 1};
+static const std::vector<std::uint8_t> hopKey2{9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 9, 8, 7, 6, 5, 4,
+                                               3, 2, 1, 0, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 9, 8};
+
+TEST(RaceCrypto, encryptMessage_round_trip) {
+    RaceCrypto encryptor;
+    ExtClrMsg msg("hello", "race-client-1", "race-client-2", 0, 0, 0, 1, 2, 0, MSG_CLIENT, {}, {});
+    std::string formatted = encryptor.formatMessage(msg, dstKey);
+
+    RawData encrypted = encryptor.encryptMessage(formatted, hopKey1);
+    EXPECT_EQ(encryptor.decryptMessage(encrypted, hopKey1), formatted);
+    EXPECT_EQ(encryptor.decryptMessage(encrypted, hopKey2), "");
+}
+
+TEST(RaceCrypto, decryptMessage_legacy) {
+    RaceCrypto encryptor;
+    std::string formatted = encryptor.formatDelimitedMessage(ClrMsg("hello", "a", "b", 0, 0, 0));
+
+    RawData encrypted = encryptor.encryptMessage(formatted, hopKey1);
+    EXPECT_EQ(encrypted.size(), formatted.size() + 12 + 16);
+    EXPECT_EQ(encryptor.decryptMessage(encrypted, hopKey1), formatted);
+}
+
+TEST(RaceCrypto, encryptMulticastMessage_round_trip) {
+    RaceCrypto encryptor;
+    ExtClrMsg msg("hello", "race-client-1", "race-server-1", 0, 0, 0, 1, 2, 0, MSG_CLIENT, {}, {});
+    std::string formatted = encryptor.formatMessage(msg, dstKey);
+
+    RawData encrypted = encryptor.encryptMulticastMessage(formatted, {hopKey1, hopKey2});
+    EXPECT_EQ(encryptor.decryptMessage(encrypted, hopKey1), formatted);
+    EXPECT_EQ(encryptor.decryptMessage(encrypted, hopKey2), formatted);
+
+    std::vector<std::uint8_t> otherKey(hopKey1);
+    otherKey[0] ^= 1;
+    EXPECT_EQ(encryptor.decryptMessage(encrypted, otherKey), "");
+}
+
+TEST(RaceCrypto, encryptMulticastMessage_size) {
+    RaceCrypto encryptor;
+    std::string formatted = encryptor.formatMessage(ClrMsg("hello", "a", "b", 0, 0, 0), dstKey);
+    const size_t unicastSize = encryptor.encryptMessage(formatted, hopKey1).size();
+
+    // each additional recipient only adds a wrapped 32-byte key with its IV and tag
+    EXPECT_EQ(encryptor.encryptMulticastMessage(formatted, {hopKey1}).size(), unicastSize + 8 + 60);
+    EXPECT_EQ(encryptor.encryptMulticastMessage(formatted, {hopKey1, hopKey2}).size(),
+              unicastSize + 8 + 2 * 60);
+}
+
+TEST(RaceCrypto, encryptMulticastMessage_legacy) {
+    RaceCrypto encryptor;
+    std::string formatted = encryptor.formatDelimitedMessage(ClrMsg("hello", "a", "b", 0, 0, 0));
+
+    RawData encrypted = encryptor.encryptMulticastMessage(formatted, {hopKey1, hopKey2});
+    EXPECT_EQ(encryptor.decryptMessage(encrypted, hopKey2), formatted);
+}
+
+TEST(RaceCrypto, encryptMulticastMessage_truncated) {
+    RaceCrypto encryptor;
+    std::string formatted = encryptor.formatMessage(ClrMsg("hello", "a", "b", 0, 0, 0), dstKey);
+    RawData encrypted = encryptor.encryptMulticastMessage(formatted, {hopKey1, hopKey2});
+
+    for (size_t length = 0; length < encrypted.size(); length += 7) {
+        EXPECT_EQ(encryptor.decryptMessage(RawDataView(encrypted.data(), length), hopKey2), "");
+    }
+}
+
+TEST(RaceCrypto, decryptMessage_tampered_payload) {
+    RaceCrypto encryptor;
+    std::string formatted = encryptor.formatMessage(ClrMsg("hello", "a", "b", 0, 0, 0), dstKey);
+    const size_t payloadLength = MessageFormat::decode(formatted).sealedPayload.size();
+
+    // the payload travels unencrypted after the header, but the header's tag covers it
+    for (RawData encrypted : {encryptor.encryptMessage(formatted, hopKey1),
+                              encryptor.encryptMulticastMessage(formatted, {hopKey1})}) {
+        ASSERT_EQ(encryptor.decryptMessage(encrypted, hopKey1), formatted);
+        for (size_t i = encrypted.size() - payloadLength; i < encrypted.size(); i += 5) {
+            RawData tampered(encrypted);
+            tampered[i] ^= 1;
+            EXPECT_EQ(encryptor.decryptMessage(tampered, hopKey1), "");
+        }
+    }
+}
+
+TEST(RaceCrypto, forward_without_opening_payload) {
+    RaceCrypto encryptor;
+    ExtClrMsg msg("hello, world", "race-client-1", "race-client-2", 1577836800000000, 10, 0, 42,
+                  UNSET_RING_TTL, 0, MSG_CLIENT, {}, {});
+
+    // first hop
+    std::string formatted = encryptor.formatMessage(msg, dstKey);
+    std::string received =
+        encryptor.decryptMessage(encryptor.encryptMessage(formatted, hopKey1), hopKey1);
+    ExtClrMsg header = encryptor.parseExtMessageHeader(received);
+    EXPECT_EQ(header.getMsg(), "");
+    EXPECT_EQ(header.getUuid(), 42);
+    ASSERT_NE(header.getSealedPayload(), nullptr);
+
+    // forward with an updated header; the sealed payload is passed through as is
+    header.setRingTtl(3);
+    header.addCommitteeVisited("committee-1");
+    std::string forwarded = encryptor.formatMessage(header, dstKey);
+    EXPECT_EQ(MessageFormat::decode(forwarded).sealedPayload,
+              MessageFormat::decode(formatted).sealedPayload);
+
+    // the destination opens the payload
+    received = encryptor.decryptMessage(encryptor.encryptMessage(forwarded, hopKey2), hopKey2);
+    ExtClrMsg parsedMsg = encryptor.parseExtMessage(received, dstKey);
+    EXPECT_EQ(parsedMsg.getMsg(), "hello, world");
+    EXPECT_EQ(parsedMsg.getRingTtl(), 3);
+    EXPECT_EQ(parsedMsg.getCommitteesVisited(), std::vector<std::string>({"committee-1"}));
+
+    // forwarding to a client as a ClrMsg also keeps the payload
+    ExtClrMsg clientMsg =
+        encryptor.parseExtMessage(encryptor.formatClrMessage(header, dstKey), dstKey);
+    EXPECT_EQ(static_cast<const ClrMsg &>(clientMsg), static_cast<const ClrMsg &>(msg));
+    EXPECT_EQ(clientMsg.getUuid(), ExtClrMsg(msg.asClrMsg()).getUuid());
+}
+
+TEST(RaceCrypto, forward_payload_fragment) {
+    RaceCrypto encryptor;
+    ExtClrMsg msg("hello, world", "race-client-1", "race-client-2", 1577836800000000, 10, 0, 42, 2,
+                  1, MSG_CLIENT, {}, {});
+    SealedPayload sealed = encryptor.sealPayload(msg.getMsg(), dstKey);
+    auto fragmentPayload = std::make_shared<SealedPayload>();
+    fragmentPayload->key = sealed.key;
+    fragmentPayload->cipherText = sealed.cipherText.substr(0, 8);
+    msg.setSealedPayload(fragmentPayload);
+    PayloadFragment fragment;
+    fragment.index = 1;
+    fragment.dataCount = 2;
+    fragment.totalCount = 3;
+    fragment.payloadLength = static_cast<uint32_t>(sealed.cipherText.size());
+    msg.setFragment(fragment);
+
+    ExtClrMsg header = encryptor.parseExtMessageHeader(encryptor.formatMessage(msg, dstKey));
+    ASSERT_TRUE(header.getFragment().has_value());
+    EXPECT_EQ(header.getFragment()->index, 1);
+    EXPECT_EQ(header.getFragment()->dataCount, 2);
+    EXPECT_EQ(header.getFragment()->totalCount, 3);
+    EXPECT_EQ(header.getFragment()->payloadLength, sealed.cipherText.size());
+    EXPECT_EQ(header.getSealedPayload()->cipherText, fragmentPayload->cipherText);
+    EXPECT_EQ(header.getRingTtl(), 2);
+
+    // a fragment can not be opened on its own
+    EXPECT_THROW(encryptor.parseExtMessage(encryptor.formatMessage(msg, dstKey), dstKey),
+                 std::invalid_argument);
+}
+
+TEST(RaceCrypto, parseExtMessageHeader_clr_msg_has_uuid) {
+    RaceCrypto encryptor;
+    ClrMsg msg("hello", "race-client-1", "race-client-2", 1577836800000000, 10, 2);
+
+    // the payload can not be opened by a relay, so the UUID is derived from the sealed payload
+    std::string formatted = encryptor.formatMessage(msg, dstKey);
+    ExtClrMsg header = encryptor.parseExtMessageHeader(formatted);
+    EXPECT_NE(header.getUuid(), UNSET_UUID);
+    EXPECT_EQ(header.getUuid(), encryptor.parseExtMessageHeader(formatted).getUuid());
+    EXPECT_NE(header.getUuid(),
+              encryptor.parseExtMessageHeader(encryptor.formatMessage(msg, dstKey)).getUuid());
+    EXPECT_NE(header.getSealedPayload(), nullptr);
+}
+
+TEST(RaceCrypto, payload_key_wrapped_for_destination) {
+    RaceCrypto encryptor;
+    ExtClrMsg msg("hello, world", "race-client-1", "race-client-2", 0, 0, 0, 42, UNSET_RING_TTL, 0,
+                  MSG_CLIENT, {}, {});
+    std::string formatted = encryptor.formatMessage(msg, dstKey);
+
+    // a relay can read the header but not the payload key or the msg body
+    std::string received =
+        encryptor.decryptMessage(encryptor.encryptMessage(formatted, hopKey1), hopKey1);
+    ExtClrMsg header = encryptor.parseExtMessageHeader(received);
+    EXPECT_EQ(header.getTo(), "race-client-2");
+    EXPECT_THROW(encryptor.parseExtMessage(received, hopKey1), std::invalid_argument);
+
+    // the forwarded payload key is the same opaque blob
+    std::string forwarded = encryptor.formatMessage(header, hopKey1);
+    EXPECT_EQ(MessageFormat::decode(forwarded).payloadKey,
+              MessageFormat::decode(formatted).payloadKey);
+    EXPECT_EQ(encryptor.parseExtMessage(forwarded, dstKey).getMsg(), "hello, world");
+}
+
+TEST(RaceCrypto, parseExtMessage_tampered_payload) {
+    RaceCrypto encryptor;
+    std::string formatted = encryptor.formatMessage(ClrMsg("hello", "a", "b", 0, 0, 0), dstKey);
+    formatted.back() = static_cast<char>(formatted.back() ^ 1);
+    EXPECT_THROW(encryptor.parseExtMessage(formatted, dstKey), std::invalid_argument);
+}
+
 ////////////////////////////////////////////////////////////////
 // getMessageHash
 ////////////////////////////////////////////////////////////////
@@ -0,0 +1,128 @@
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "ResendTracker.h"
+
+#include "gtest/gtest.h"
+
+using namespace std::chrono_literals;
+
+static const ResendTracker::Clock::time_point start;
+
+static ResendTracker::Entry makeEntry(const std::string &dst, const ResendTracker::MsgPtr &msg,
+                                      bool reliable = true) {
+    return ResendTracker::Entry{dst, msg, 0, 0, reliable, "conn-1"};
+}
+
+TEST(ResendTracker, add_take) {
+    ResendTracker tracker;
+    auto msg = std::make_shared<const std::string>("hello");
+    tracker.add(1, makeEntry("race-server-1", msg), 10s, start);
+    EXPECT_EQ(tracker.size(), 1u);
+    EXPECT_EQ(tracker.getBytesRetained(), 5u);
+
+    auto entries = tracker.take(1, start);
+    ASSERT_EQ(entries.size(), 1u);
+    EXPECT_EQ(entries[0].dst, "race-server-1");
+    EXPECT_EQ(*entries[0].msg, "hello");
+    EXPECT_EQ(tracker.size(), 0u);
+    EXPECT_EQ(tracker.getBytesRetained(), 0u);
+
+    EXPECT_TRUE(tracker.take(1, start).empty());
+}
+
+TEST(ResendTracker, shared_message_counted_once) {
+    ResendTracker tracker;
+    auto msg = std::make_shared<const std::string>("hello");
+
+    // multicast package
+    tracker.add(1, makeEntry("race-server-1", msg), 10s, start);
+    tracker.add(1, makeEntry("race-server-2", msg), 10s, start);
+    // fan-out over unicast
+    tracker.add(2, makeEntry("race-server-3", msg), 10s, start);
+    EXPECT_EQ(tracker.size(), 2u);
+    EXPECT_EQ(tracker.getBytesRetained(), 5u);
+
+    EXPECT_EQ(tracker.take(1, start).size(), 2u);
+    EXPECT_EQ(tracker.getBytesRetained(), 5u);
+    EXPECT_TRUE(tracker.remove(2, start));
+    EXPECT_EQ(tracker.getBytesRetained(), 0u);
+}
+
+TEST(ResendTracker, remove_if_unreliable) {
+    ResendTracker tracker;
+    auto msg = std::make_shared<const std::string>("hello");
+    tracker.add(1, makeEntry("race-server-1", msg, true), 10s, start);
+    tracker.add(2, makeEntry("race-server-1", msg, false), 10s, start);
+
+    EXPECT_FALSE(tracker.removeIfUnreliable(1, start));
+    EXPECT_TRUE(tracker.removeIfUnreliable(2, start));
+    EXPECT_FALSE(tracker.removeIfUnreliable(3, start));
+    EXPECT_EQ(tracker.size(), 1u);
+}
+
+TEST(ResendTracker, evicts_least_recently_added) {
+    ResendTracker tracker;
+    tracker.setLimits(10, 600s);
+    tracker.add(1, makeEntry("a", std::make_shared<const std::string>("1234")), 10s, start);
+    tracker.add(2, makeEntry("a", std::make_shared<const std::string>("1234")), 10s, start);
+    EXPECT_EQ(tracker.getNumEvicted(), 0u);
+
+    tracker.add(3, makeEntry("a", std::make_shared<const std::string>("1234")), 10s, start);
+    EXPECT_EQ(tracker.size(), 2u);
+    EXPECT_EQ(tracker.getBytesRetained(), 8u);
+    EXPECT_EQ(tracker.getNumEvicted(), 1u);
+    EXPECT_FALSE(tracker.remove(1, start));
+    EXPECT_TRUE(tracker.remove(2, start));
+    EXPECT_TRUE(tracker.remove(3, start));
+}
+
+TEST(ResendTracker, expires_by_age) {
+    ResendTracker tracker;
+    auto msg = std::make_shared<const std::string>("hello");
+    tracker.add(1, makeEntry("a", msg), 20s, start);
+    tracker.add(2, makeEntry("a", msg), 10s, start);
+    tracker.add(3, makeEntry("a", msg), 30s, start);
+
+    EXPECT_EQ(tracker.expire(start + 9s), 0u);
+    EXPECT_EQ(tracker.expire(start + 20s), 2u);
+    EXPECT_EQ(tracker.size(), 1u);
+    EXPECT_EQ(tracker.getNumExpired(), 2u);
+
+    // adding also expires old packages
+    tracker.add(4, makeEntry("a", msg), 10s, start + 30s);
+    EXPECT_EQ(tracker.size(), 1u);
+    EXPECT_EQ(tracker.getBytesRetained(), 5u);
+}
+
+TEST(ResendTracker, max_age_for_link) {
+    ResendTracker tracker;
+    tracker.setLimits(ResendTracker::DEFAULT_MAX_BYTES, 600s);
+
+    LinkProperties props;
+    EXPECT_EQ(tracker.maxAgeForLink(props), ResendTracker::Clock::duration(600s));
+
+    props.expected.send.latency_ms = 5000;
+    EXPECT_EQ(tracker.maxAgeForLink(props), ResendTracker::Clock::duration(50s));
+
+    // fast links get a minimum age
+    props.expected.send.latency_ms = 1;
+    EXPECT_EQ(tracker.maxAgeForLink(props), ResendTracker::Clock::duration(30s));
+
+    // slow links are capped
+    props.expected.send.latency_ms = 3600000;
+    EXPECT_EQ(tracker.maxAgeForLink(props), ResendTracker::Clock::duration(600s));
+}
@@ -0,0 +1,93 @@
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "RouteTable.h"
+
+#include "gtest/gtest.h"
+
+static LinkProperties makeProps(const std::string &channelGid, bool reliable, int32_t latency) {
+    LinkProperties props;
+    props.channelGid = channelGid;
+    props.reliable = reliable;
+    props.isFlushable = !reliable;
+    props.expected.send.latency_ms = latency;
+    return props;
+}
+
+TEST(RouteTable, find_missing) {
+    RouteTable table;
+    EXPECT_EQ(table.find("race-server-1"), nullptr);
+    EXPECT_EQ(table.size(), 0u);
+}
+
+TEST(RouteTable, update_keeps_rank_order) {
+    RouteTable table;
+    auto key = std::make_shared<const std::vector<uint8_t>>(32, 1);
+    table.update("race-server-1",
+                 {{"conn-a", makeProps("twoSixIndirectCpp", true, 5000)},
+                  {"conn-b", makeProps("twoSixDirectCpp", false, 100)}},
+                 key);
+
+    auto route = table.find("race-server-1");
+    ASSERT_NE(route, nullptr);
+    ASSERT_EQ(route->hops.size(), 2u);
+    EXPECT_EQ(route->hops[0].connId, "conn-a");
+    EXPECT_EQ(route->hops[0].channelGid, "twoSixIndirectCpp");
+    EXPECT_TRUE(route->hops[0].reliable);
+    EXPECT_FALSE(route->hops[0].isFlushable);
+    EXPECT_EQ(route->hops[0].sendLatencyMs, 5000);
+    EXPECT_EQ(route->hops[1].connId, "conn-b");
+    EXPECT_TRUE(route->hops[1].isFlushable);
+    EXPECT_EQ(route->key, key);
+}
+
+TEST(RouteTable, readers_keep_old_route) {
+    RouteTable table;
+    table.update("race-server-1", {{"conn-a", makeProps("a", true, 1)}}, nullptr);
+    auto before = table.find("race-server-1");
+
+    table.update("race-server-1", {{"conn-b", makeProps("b", true, 1)}}, nullptr);
+    ASSERT_NE(before, nullptr);
+    EXPECT_EQ(before->hops[0].connId, "conn-a");
+    EXPECT_EQ(table.find("race-server-1")->hops[0].connId, "conn-b");
+}
+
+TEST(RouteTable, update_key) {
+    RouteTable table;
+    auto key = std::make_shared<const std::vector<uint8_t>>(32, 2);
+
+    // no route to update yet
+    table.updateKey("race-client-1", key);
+    EXPECT_EQ(table.find("race-client-1"), nullptr);
+
+    table.update("race-client-1", {{"conn-a", makeProps("a", true, 1)}}, nullptr);
+    table.updateKey("race-client-1", key);
+    auto route = table.find("race-client-1");
+    ASSERT_NE(route, nullptr);
+    EXPECT_EQ(route->key, key);
+    EXPECT_EQ(route->hops.size(), 1u);
+}
+
+TEST(RouteTable, remove) {
+    RouteTable table;
+    table.update("race-server-1", {{"conn-a", makeProps("a", true, 1)}}, nullptr);
+    table.update("race-server-2", {}, nullptr);
+    EXPECT_EQ(table.size(), 2u);
+
+    table.remove("race-server-1");
+    EXPECT_EQ(table.find("race-server-1"), nullptr);
+    EXPECT_EQ(table.size(), 1u);
+}
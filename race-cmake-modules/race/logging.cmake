@@ -0,0 +1,30 @@
+
+# Copyright 2023 Two Six Technologies
+# 
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+# 
+#     http://www.apache.org/licenses/LICENSE-2.0
+# 
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+# 
+
+option(RACE_LOG_COMPILE_OUT_DEBUG "Compile out debug log messages guarded by RACE_LOG_ENABLED" OFF)
+
+if(RACE_LOG_COMPILE_OUT_DEBUG)
+    message("-- Compiling out debug logging")
+    # 1 is RaceLog::LL_INFO
+    add_compile_definitions(RACE_LOG_COMPILED_LEVEL=1)
+endif()
+
+option(RACE_LOG_TRACE_TIMING "Record how long each call traced with TRACE_METHOD/TRACE_FUNCTION takes" OFF)
+
+if(RACE_LOG_TRACE_TIMING)
+    message("-- Recording trace timings")
+    add_compile_definitions(RACE_TRACE_TIMING=1)
+endif()
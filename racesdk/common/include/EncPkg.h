@@ -18,7 +18,10 @@
 #ifndef __ENC_PKG_
 #define __ENC_PKG_
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <tuple>
 #include <vector>
@@ -27,16 +30,88 @@
 
 using RawData = std::vector<std::uint8_t>;
 
+#ifndef SWIG
+/**
+ * @brief A read-only, non-owning view of a contiguous range of bytes. The view is only valid for as
+ * long as the object it was taken from.
+ */
+class RawDataView {
+public:
+    RawDataView() : ptr(nullptr), length(0) {}
+    RawDataView(const std::uint8_t *data, size_t size) : ptr(data), length(size) {}
+    // cppcheck-suppress noExplicitConstructor
+    RawDataView(const RawData &data) : ptr(data.data()), length(data.size()) {}
+
+    const std::uint8_t *data() const {
+        return ptr;
+    }
+    size_t size() const {
+        return length;
+    }
+    bool empty() const {
+        return length == 0;
+    }
+    const std::uint8_t *begin() const {
+        return ptr;
+    }
+    const std::uint8_t *end() const {
+        return ptr + length;
+    }
+    std::uint8_t operator[](size_t index) const {
+        return ptr[index];
+    }
+
+    /**
+     * @brief Get a view of a sub-range of this view. The range is clamped to the bounds of this
+     * view.
+     *
+     * @param offset The offset of the first byte of the sub-range.
+     * @param count The maximum number of bytes in the sub-range.
+     * @return RawDataView The sub-range.
+     */
+    RawDataView slice(size_t offset, size_t count) const;
+
+    /**
+     * @brief Copy the viewed bytes into a new RawData.
+     *
+     * @return RawData A copy of the viewed bytes.
+     */
+    RawData toRawData() const {
+        return RawData(begin(), end());
+    }
+
+private:
+    const std::uint8_t *ptr;
+    size_t length;
+};
+
+bool operator==(const RawDataView &lhs, const RawDataView &rhs);
+#endif
+
 /**
  * @brief Class for representing an encrypted package in the RACE system.
  *
+ * The serialized package is a header (trace ID, span ID, and package type) followed by the cipher
+ * text. The header is stored inline while the cipher text is a slice of a reference counted buffer,
+ * so copying a package or changing its header never copies the cipher text. Prefer the view
+ * accessors on hot paths as they do not copy either.
  */
 class EncPkg {
+public:
+    static const size_t HEADER_LENGTH = sizeof(uint64_t) + sizeof(uint64_t) + sizeof(uint8_t);
+
 private:
     uint64_t traceId;
     uint64_t spanId;
     uint8_t packageType;
-    RawData cipherText;
+    std::array<uint8_t, HEADER_LENGTH> header;
+    std::shared_ptr<const RawData> buffer;
+    size_t cipherTextOffset;
+
+    /**
+     * @brief Write the trace ID, span ID, and package type into the serialized header.
+     */
+    void updateHeader();
 
 public:
     /**
@@ -79,6 +154,40 @@ public:
      */
     RawData getCipherText() const;
 
+#ifndef SWIG
+    /**
+     * @brief Get a view of the serialized header, i.e. the bytes that precede the cipher text in
+     * getRawData(). The view is valid until this package is modified or destroyed.
+     *
+     * @return RawDataView View of the trace ID, span ID, and package type bytes.
+     */
+    RawDataView getHeaderView() const;
+
+    /**
+     * @brief Get a view of just the cipher text without copying it. The view is valid until this
+     * package is destroyed.
+     *
+     * @return RawDataView View of the cipher text.
+     */
+    RawDataView getCipherTextView() const;
+
+    /**
+     * @brief Get the buffer backing the cipher text. This allows the cipher text to be referenced
+     * beyond the lifetime of this package without copying it. The cipher text starts at
+     * getCipherTextOffset() within the buffer.
+     *
+     * @return std::shared_ptr<const RawData> The buffer containing the cipher text.
+     */
+    std::shared_ptr<const RawData> getBuffer() const;
+
+    /**
+     * @brief Get the offset of the cipher text within getBuffer().
+     *
+     * @return size_t The offset in bytes.
+     */
+    size_t getCipherTextOffset() const;
+#endif
+
     /**
      * @brief Get the trace ID of the encrypted package.
      *
@@ -138,7 +247,7 @@ public:
 };
 
 inline bool operator==(const EncPkg &lhs, const EncPkg &rhs) {
-    return lhs.getCipherText() == rhs.getCipherText();
+    return lhs.getCipherTextView() == rhs.getCipherTextView();
 }
 
 inline bool operator!=(const EncPkg &lhs, const EncPkg &rhs) {
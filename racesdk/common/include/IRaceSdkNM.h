@@ -20,6 +20,7 @@
 
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "ChannelProperties.h"
@@ -64,6 +65,26 @@ public:
     virtual SdkResponse sendEncryptedPackage(EncPkg ePkg, ConnectionID connectionId,
                                              uint64_t batchId, int32_t timeout) = 0;
 
+    /**
+     * @brief Pass several EncPkgs to comms channels via the SDK to send out. This behaves like
+     * calling sendEncryptedPackage for each package in turn, but the SDK takes its locks and looks
+     * up each comms plugin once for the whole batch. Packages sent on the same connection are
+     * queued in the order given.
+     *
+     * @param packages The EncPkgs to send, each paired with the ConnectionID of the connection to
+     * send it out on
+     * @param batchId An ID to "batch" encrypted packages. Used by the flushChannel API so that
+     * all encrypted packages in a batch will be flushed together. Set this to zero if you don't
+     * care about flushing or if the connection you're using does not support flushing.
+     * @param timeout Timeout in milliseconds to block, 0 indicates a nonblocking call. The value
+     * RACE_BLOCKING indicates the call will block forever. Other negative values are invalid
+     * @return std::vector<SdkResponse> the status of the SDK in response to each package, in the
+     * same order as packages
+     */
+    virtual std::vector<SdkResponse> sendEncryptedPackages(
+        std::vector<std::pair<EncPkg, ConnectionID>> packages, uint64_t batchId,
+        int32_t timeout) = 0;
+
     /**
      * @brief Pass a ClrMsg to the client or server Race App (likely for presentation to the user)
      *
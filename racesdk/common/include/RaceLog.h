@@ -18,15 +18,35 @@
 #ifndef __RACE_LOG_H_
 #define __RACE_LOG_H_
 
+#include <atomic>
+#include <chrono>
 #include <iomanip>
 #include <ios>
 #include <nlohmann/json.hpp>
 #include <sstream>
 #include <string>
 #include <type_traits>
+#include <typeinfo>
 
 #include "Defer.h"
 
+/**
+ * @brief Log messages below this level are compiled out when logged through RACE_LOG_ENABLED or
+ * the lazy logging macros built on it, and dropped by RaceLog otherwise. Set to 1 (LL_INFO) with
+ * the RACE_LOG_COMPILE_OUT_DEBUG CMake option.
+ */
+#ifndef RACE_LOG_COMPILED_LEVEL
+#define RACE_LOG_COMPILED_LEVEL 0
+#endif
+
+/**
+ * @brief When set to 1, the TRACE_FUNCTION_BASE and TRACE_METHOD_BASE macros record how long each
+ * traced call takes. See RaceLog::logTraceTimings. Set with the RACE_LOG_TRACE_TIMING CMake option.
+ */
+#ifndef RACE_TRACE_TIMING
+#define RACE_TRACE_TIMING 0
+#endif
+
 #ifndef SWIG
 template <typename S, typename T>
 class is_streamable {
@@ -45,6 +65,13 @@ class RaceLog {
 public:
     enum LogLevel { LL_DEBUG = 0, LL_INFO = 1, LL_WARNING = 2, LL_ERROR = 3 };
 
+    /**
+     * @brief What to do with a log message logged asynchronously when the calling thread's buffer
+     * is full. OP_DROP discards the message (a count of dropped messages is logged later) while
+     * OP_BLOCK waits for the background thread to make room.
+     */
+    enum OverflowPolicy { OP_DROP = 0, OP_BLOCK = 1 };
+
     static void log(LogLevel level, const std::string &pluginName, const std::string &message,
                     const std::string &stackTrace);
     static void logDebug(const std::string &pluginName, const std::string &message,
@@ -63,6 +90,33 @@ public:
     static void setLogLevelStdout(LogLevel level);
     static void setLogLevelFile(LogLevel level);
     static void setLogFile(const std::string &file);
+
+    /**
+     * @brief Enable or disable asynchronous logging. When enabled, log calls only queue the message
+     * in a lock-free buffer owned by the calling thread and a background thread writes the queued
+     * messages in batches. Disabling it writes out any queued messages before returning.
+     *
+     * @param enabled Whether to log asynchronously
+     * @param bufferSize The number of messages each thread may have queued
+     * @param policy What to do when a thread's buffer is full
+     */
+    static void setAsyncLogging(bool enabled, size_t bufferSize = 4096,
+                                OverflowPolicy policy = OP_DROP);
+
+    /**
+     * @brief Write out any messages queued for asynchronous logging. Returns once they have been
+     * written.
+     */
+    static void flush();
+
+    /**
+     * @brief Check whether a log message of the given level would be written anywhere. Used to
+     * skip building messages that would be discarded. See RACE_LOG_ENABLED.
+     *
+     * @param level The log level
+     * @return true if a message of that level would be written
+     */
+    static bool isLogLevelEnabled(LogLevel level);
     static std::string get_this_thread_id_prefix();
 
     /**
@@ -113,6 +167,18 @@ public:
         }
     }
 
+#ifndef SWIG
+    class TraceSite;
+    class TraceScope;
+    class TimedTraceScope;
+
+    /**
+     * @brief Log, at info level, a summary of the call timings recorded by every thread for each
+     * traced call site. Timings are only recorded when built with RACE_TRACE_TIMING.
+     */
+    static void logTraceTimings();
+#endif
+
 private:
     template <typename T,
               typename std::enable_if<is_streamable<std::stringstream, T>::value>::type * = nullptr>
@@ -127,12 +193,126 @@ private:
     }
 };
 
+/**
+ * @brief Check whether log messages of the given level are compiled in and would be written. Guard
+ * building expensive log messages with this so the work is skipped, or compiled out entirely, when
+ * the message would be discarded.
+ *
+ * Example:
+ *
+ * if (RACE_LOG_ENABLED(RaceLog::LL_DEBUG)) {
+ *     RaceLog::logDebug(pluginName, "received: " + expensiveToString(msg), "");
+ * }
+ *
+ * @param level The log level
+ */
+#define RACE_LOG_ENABLED(level) \
+    (static_cast<int>(level) >= RACE_LOG_COMPILED_LEVEL && RaceLog::isLogLevelEnabled(level))
+
+#ifndef SWIG
+/**
+ * @brief The state for a single use of MAKE_LOG_PREFIX, TRACE_FUNCTION_BASE or TRACE_METHOD_BASE.
+ * The macros declare one as a function local static, so the log prefix is built (and the class name
+ * demangled) once per call site and class rather than on every call.
+ */
+class RaceLog::TraceSite {
+public:
+    TraceSite(const char *_pluginName, const char *_function) :
+        pluginName(_pluginName), function(_function) {}
+    TraceSite(const TraceSite &) = delete;
+    TraceSite &operator=(const TraceSite &) = delete;
+
+    /**
+     * @brief Get the log prefix for a function, e.g. "example_function: "
+     *
+     * @return The prefix. It is never freed, so the reference is valid for the life of the process.
+     */
+    const std::string &prefix();
+
+    /**
+     * @brief Get the log prefix for a method called on an object of the given dynamic type, e.g.
+     * "ExampleClass::example_method: "
+     *
+     * @param type The dynamic type of the object, i.e. typeid(*this)
+     * @return The prefix. It is never freed, so the reference is valid for the life of the process.
+     */
+    const std::string &prefix(const std::type_info &type);
+
+    /**
+     * @brief Record the duration of a call in the calling thread's histogram for this call site
+     *
+     * @param elapsed How long the call took
+     */
+    void recordTiming(std::chrono::steady_clock::duration elapsed);
+
+    const char *const pluginName;
+    const char *const function;
+
+private:
+    struct Prefix {
+        // nullptr for the prefix of a function
+        const std::type_info *type;
+        std::string text;
+        Prefix *next;
+    };
+
+    const std::string &findOrAddPrefix(const std::type_info *type);
+
+    // Prefixes are only ever pushed on the front, so readers can walk the list without locking
+    std::atomic<Prefix *> prefixes{nullptr};
+};
+
+/**
+ * @brief Logs that a traced call returned when it goes out of scope
+ */
+class RaceLog::TraceScope {
+public:
+    TraceScope(TraceSite &_site, const std::string &_prefix) : site(_site), prefix(_prefix) {}
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+    ~TraceScope() {
+        if (RACE_LOG_ENABLED(RaceLog::LL_DEBUG)) {
+            RaceLog::logDebug(site.pluginName, prefix + "returned", "");
+        }
+    }
+
+protected:
+    TraceSite &site;
+    const std::string &prefix;
+};
+
+/**
+ * @brief A TraceScope that also records how long the call took. Used when built with
+ * RACE_TRACE_TIMING.
+ */
+class RaceLog::TimedTraceScope : public RaceLog::TraceScope {
+public:
+    TimedTraceScope(TraceSite &_site, const std::string &_prefix) :
+        TraceScope(_site, _prefix), start(std::chrono::steady_clock::now()) {}
+
+    ~TimedTraceScope() {
+        site.recordTiming(std::chrono::steady_clock::now() - start);
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+#if RACE_TRACE_TIMING
+#define RACE_TRACE_SCOPE RaceLog::TimedTraceScope
+#else
+#define RACE_TRACE_SCOPE RaceLog::TraceScope
+#endif
+#endif
+
 /**
  * @brief Create a log prefix based on the class name and the function name. This may only be used
  * from methods.
  */
-#define MAKE_LOG_PREFIX() \
-    std::string logPrefix = RaceLog::cppDemangle(typeid(*this).name()) + "::" + __func__ + ": "
+#define MAKE_LOG_PREFIX()                                  \
+    static RaceLog::TraceSite raceTraceSite("", __func__); \
+    const std::string &logPrefix = raceTraceSite.prefix(typeid(*this))
 
 /**
  * @brief This macro has a number of effects. It creates a log prefix based on the name of the
@@ -145,6 +325,11 @@ private:
  * log the result of a function, it's recommended to assign to a variable beforehand and log that
  * variable.
  *
+ * The prefix is built once per call site and kept in a function local static, and the arguments are
+ * only stringified when debug logging is enabled, so tracing costs little more than a log level
+ * check when debug logging is off. Since logPrefix is a reference to the cached prefix, it can't be
+ * modified.
+ *
  * It is recommended to create a plugin-specific macro that pre-sets the plugin name.
  *
  * Example #1:
@@ -173,12 +358,16 @@ private:
  * @param pluginName Plugin name
  * @param args The arguments to log
  */
-#define TRACE_FUNCTION_BASE(pluginName, ...)                                                       \
-    std::string logPrefix = std::string(__func__) + ": ";                                          \
-    RaceLog::logDebug(                                                                             \
-        #pluginName, logPrefix + "called" + RaceLog::stringifyValues(#__VA_ARGS__, ##__VA_ARGS__), \
-        "");                                                                                       \
-    Defer defer([logPrefix] { RaceLog::logDebug(#pluginName, logPrefix + "returned", ""); })
+#define TRACE_FUNCTION_BASE(pluginName, ...)                                                     \
+    static RaceLog::TraceSite raceTraceSite(#pluginName, __func__);                              \
+    const std::string &logPrefix = raceTraceSite.prefix();                                       \
+    if (RACE_LOG_ENABLED(RaceLog::LL_DEBUG)) {                                                   \
+        RaceLog::logDebug(#pluginName,                                                           \
+                          logPrefix + "called" +                                                 \
+                              RaceLog::stringifyValues(#__VA_ARGS__, ##__VA_ARGS__),             \
+                          "");                                                                   \
+    }                                                                                            \
+    RACE_TRACE_SCOPE raceTraceScope(raceTraceSite, logPrefix)
 
 /**
  * @brief Similar to TRACE_FUNCTION except it gets the class name as well
@@ -186,11 +375,15 @@ private:
  * @param pluginName Plugin name
  * @param args The arguments to log
  */
-#define TRACE_METHOD_BASE(pluginName, ...)                                                         \
-    std::string logPrefix = RaceLog::cppDemangle(typeid(*this).name()) + "::" + __func__ + ": ";   \
-    RaceLog::logDebug(                                                                             \
-        #pluginName, logPrefix + "called" + RaceLog::stringifyValues(#__VA_ARGS__, ##__VA_ARGS__), \
-        "");                                                                                       \
-    Defer defer([logPrefix] { RaceLog::logDebug(#pluginName, logPrefix + "returned", ""); })
+#define TRACE_METHOD_BASE(pluginName, ...)                                                       \
+    static RaceLog::TraceSite raceTraceSite(#pluginName, __func__);                              \
+    const std::string &logPrefix = raceTraceSite.prefix(typeid(*this));                          \
+    if (RACE_LOG_ENABLED(RaceLog::LL_DEBUG)) {                                                   \
+        RaceLog::logDebug(#pluginName,                                                           \
+                          logPrefix + "called" +                                                 \
+                              RaceLog::stringifyValues(#__VA_ARGS__, ##__VA_ARGS__),             \
+                          "");                                                                   \
+    }                                                                                            \
+    RACE_TRACE_SCOPE raceTraceScope(raceTraceSite, logPrefix)
 
 #endif
@@ -51,7 +51,7 @@ constexpr bool operator>=(const RaceVersionInfo &a, const RaceVersionInfo &b) {
                a.minor != b.minor ? a.minor > b.minor : a.compatibility >= b.compatibility;
 }
 
-#define RACE_VERSION (RaceVersionInfo{2, 4, 0})
+#define RACE_VERSION (RaceVersionInfo{2, 4, 1})
 
 extern "C" EXPORT const RaceVersionInfo raceVersion;
 extern "C" EXPORT const char *const racePluginId;
@@ -0,0 +1,172 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef __RACE_TIMER_WHEEL_H_
+#define __RACE_TIMER_WHEEL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+/**
+ * @brief Runs callbacks at given times on a single background thread.
+ *
+ * Timers are kept in a hierarchical timing wheel: four levels of 256 slots, with 1 ms slots on the
+ * first level, so scheduling and cancelling a timer are O(1) regardless of how many timers are
+ * pending. Timers more than about 49 days out are parked on the last level and re-bucketed as time
+ * passes.
+ *
+ * Callbacks run on the wheel thread, in the order they expire with millisecond resolution (timers
+ * that expire in the same millisecond run in the order they were scheduled). They should be short,
+ * as a slow callback delays every other timer on the wheel.
+ *
+ * The SDK and plugins share the instance returned by TimerWheel::shared(), so a single thread
+ * services every timeout in the process.
+ */
+class TimerWheel {
+public:
+    using TimerId = std::uint64_t;
+    using Callback = std::function<void()>;
+
+    /**
+     * @brief Never returned for a scheduled timer. Cancelling it does nothing.
+     */
+    static constexpr TimerId INVALID_TIMER = 0;
+
+    TimerWheel();
+    TimerWheel(const TimerWheel &) = delete;
+    TimerWheel &operator=(const TimerWheel &) = delete;
+
+    /**
+     * @brief Stop the wheel thread. Pending timers are discarded without running.
+     */
+    ~TimerWheel();
+
+    /**
+     * @brief Get the process-wide timer wheel. It is never destroyed, so it may be used from the
+     * destructors of other static objects.
+     *
+     * @return The shared timer wheel
+     */
+    static TimerWheel &shared();
+
+    /**
+     * @brief Schedule a callback to run once a time has passed. The wheel thread is started on the
+     * first call.
+     *
+     * @param timestamp The time to run the callback, in seconds since the epoch (as used for
+     * package timeouts). If it has already passed, the callback runs as soon as possible.
+     * @param callback The callback to run on the wheel thread
+     * @return The ID of the timer, to use with cancel(), or INVALID_TIMER if timestamp is infinite,
+     * in which case nothing is scheduled.
+     */
+    TimerId schedule(double timestamp, Callback callback);
+
+    /**
+     * @brief Cancel a timer. This does not wait for the callback if it is already running; use
+     * waitForCallbacks() for that.
+     *
+     * @param timer The ID returned by schedule()
+     * @return true if the timer was cancelled before its callback started, false if it has already
+     * run, is running, or doesn't exist.
+     */
+    bool cancel(TimerId timer);
+
+    /**
+     * @brief Wait until the wheel thread is no longer running callbacks that it had already started
+     * when this was called. After cancelling all of its timers, an object can call this before
+     * being destroyed to make sure none of its callbacks are still running. Returns immediately
+     * when called from a callback.
+     */
+    void waitForCallbacks();
+
+    /**
+     * @brief Get the number of timers that are scheduled and haven't run yet
+     *
+     * @return The number of pending timers
+     */
+    size_t size();
+
+private:
+    struct Slot;
+
+    struct Timer {
+        TimerId id = INVALID_TIMER;
+        std::uint64_t expires = 0;
+        Callback callback;
+        Timer *prev = nullptr;
+        Timer *next = nullptr;
+        Slot *slot = nullptr;
+    };
+
+    struct Slot {
+        Timer *head = nullptr;
+        Timer *tail = nullptr;
+
+        bool empty() const {
+            return head == nullptr;
+        }
+        void push_back(Timer *timer);
+        void erase(Timer *timer);
+    };
+
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOT_BITS = 8;
+    static constexpr std::uint64_t SLOTS = 1 << SLOT_BITS;
+    static constexpr std::uint64_t SLOT_MASK = SLOTS - 1;
+    static constexpr std::uint64_t NO_TICK = UINT64_MAX;
+
+    void run();
+    static std::uint64_t nowTick();
+
+    // The following must be called with mLock held
+    void insert(Timer *timer);
+    void advance(std::uint64_t now, Slot &expired);
+    void cascade(int level, std::uint64_t index);
+    std::uint64_t nextEventTick() const;
+    Timer *acquireTimer();
+    void releaseTimer(Timer *timer);
+
+    std::mutex mLock;
+    std::condition_variable mSignaler;
+    std::condition_variable mCallbacksDone;
+    std::thread mThread;
+    bool mStarted;
+    bool mStopped;
+
+    Slot mSlots[LEVELS][SLOTS];
+    std::unordered_map<TimerId, Timer *> mTimers;
+    TimerId mNextId;
+
+    // The next tick that hasn't been processed yet
+    std::uint64_t mCurrentTick;
+    // The tick the wheel thread is sleeping until, or NO_TICK if it's waiting indefinitely
+    std::uint64_t mWakeTick;
+
+    // Incremented every time the wheel thread starts running a batch of callbacks
+    std::uint64_t mBatch;
+    bool mRunningCallbacks;
+
+    Timer *mFreeTimers;
+    size_t mFreeTimerCount;
+};
+
+#endif
@@ -17,20 +17,43 @@
 
 #include "EncPkg.h"
 
-#include <cstring>  // memcpy
+#include <cstring>  // memcpy, memcmp
 
 const size_t TRACE_ID_LENGTH = sizeof(uint64_t);     // using 64 bit trace id
 const size_t SPAN_ID_LENGTH = sizeof(uint64_t);      // using 64 bit span id
 const size_t PACKAGE_TYPE_LENGTH = sizeof(uint8_t);  // using 8 bit package type
 
+const size_t EncPkg::HEADER_LENGTH;
+
+RawDataView RawDataView::slice(size_t offset, size_t count) const {
+    if (offset > length) {
+        offset = length;
+    }
+    if (count > length - offset) {
+        count = length - offset;
+    }
+    return RawDataView(ptr + offset, count);
+}
+
+bool operator==(const RawDataView &lhs, const RawDataView &rhs) {
+    return lhs.size() == rhs.size() &&
+           (lhs.size() == 0 || std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0);
+}
+
 EncPkg::EncPkg(uint64_t _traceId, uint64_t _spanId, const RawData &_cipherText) :
     traceId(_traceId),
     spanId(_spanId),
     packageType(static_cast<uint8_t>(PKG_TYPE_UNDEF)),
-    cipherText(_cipherText) {}
+    buffer(std::make_shared<const RawData>(_cipherText)),
+    cipherTextOffset(0) {
+    updateHeader();
+}
 
 EncPkg::EncPkg(RawData rawData) :
-    traceId(0), spanId(0), packageType(static_cast<uint8_t>(PKG_TYPE_UNDEF)) {
+    traceId(0),
+    spanId(0),
+    packageType(static_cast<uint8_t>(PKG_TYPE_UNDEF)),
+    cipherTextOffset(0) {
     // TODO: should we throw an exception if the incoming size is greater than zero but less than
     // the size TRACE_ID_LENGTH + SPAN_ID_LENGTH?
     if (rawData.size() >= (TRACE_ID_LENGTH + SPAN_ID_LENGTH + PACKAGE_TYPE_LENGTH)) {
@@ -39,28 +62,51 @@ EncPkg::EncPkg(RawData rawData) :
         std::memcpy(&spanId, rawData.data() + TRACE_ID_LENGTH, SPAN_ID_LENGTH);
         std::memcpy(&packageType, rawData.data() + (TRACE_ID_LENGTH + SPAN_ID_LENGTH),
                     PACKAGE_TYPE_LENGTH);
-        cipherText =
-            RawData(rawData.begin() + (TRACE_ID_LENGTH + SPAN_ID_LENGTH + PACKAGE_TYPE_LENGTH),
-                    rawData.end());
+        // Take ownership of the raw data and slice the cipher text out of it rather than copying
+        cipherTextOffset = TRACE_ID_LENGTH + SPAN_ID_LENGTH + PACKAGE_TYPE_LENGTH;
+        buffer = std::make_shared<const RawData>(std::move(rawData));
+    } else {
+        buffer = std::make_shared<const RawData>();
     }
+    updateHeader();
+}
+
+void EncPkg::updateHeader() {
+    // TODO: endianness
+    std::memcpy(header.data(), &traceId, TRACE_ID_LENGTH);
+    std::memcpy(header.data() + TRACE_ID_LENGTH, &spanId, SPAN_ID_LENGTH);
+    std::memcpy(header.data() + (TRACE_ID_LENGTH + SPAN_ID_LENGTH), &packageType,
+                PACKAGE_TYPE_LENGTH);
 }
 
 RawData EncPkg::getRawData() const {
     RawData rawData;
-    // TODO: endianness
-    rawData.insert(rawData.end(), reinterpret_cast<const uint8_t *>(&traceId),
-                   reinterpret_cast<const uint8_t *>(&traceId) + sizeof(traceId));
-    rawData.insert(rawData.end(), reinterpret_cast<const uint8_t *>(&spanId),
-                   reinterpret_cast<const uint8_t *>(&spanId) + sizeof(spanId));
-    rawData.insert(rawData.end(), reinterpret_cast<const uint8_t *>(&packageType),
-                   reinterpret_cast<const uint8_t *>(&packageType) + sizeof(packageType));
-    rawData.insert(rawData.end(), cipherText.begin(), cipherText.end());
+    rawData.reserve(getSize());
+    rawData.insert(rawData.end(), header.begin(), header.end());
+    rawData.insert(rawData.end(), buffer->begin() + static_cast<std::ptrdiff_t>(cipherTextOffset),
+                   buffer->end());
 
     return rawData;
 }
 
 RawData EncPkg::getCipherText() const {
-    return cipherText;
+    return RawData(buffer->begin() + static_cast<std::ptrdiff_t>(cipherTextOffset), buffer->end());
+}
+
+RawDataView EncPkg::getHeaderView() const {
+    return RawDataView(header.data(), header.size());
+}
+
+RawDataView EncPkg::getCipherTextView() const {
+    return RawDataView(buffer->data() + cipherTextOffset, buffer->size() - cipherTextOffset);
+}
+
+std::shared_ptr<const RawData> EncPkg::getBuffer() const {
+    return buffer;
+}
+
+size_t EncPkg::getCipherTextOffset() const {
+    return cipherTextOffset;
 }
 
 uint64_t EncPkg::getTraceId() const {
@@ -85,17 +131,20 @@ PackageType EncPkg::getPackageType() const {
 }
 
 void EncPkg::setTraceId(uint64_t value) {
-    spanId = value;
+    traceId = value;
+    updateHeader();
 }
 
 void EncPkg::setSpanId(uint64_t value) {
     spanId = value;
+    updateHeader();
 }
 
 void EncPkg::setPackageType(PackageType value) {
     packageType = static_cast<uint8_t>(value);
+    updateHeader();
 }
 
 size_t EncPkg::getSize() const {
-    return cipherText.size() + TRACE_ID_LENGTH + SPAN_ID_LENGTH + PACKAGE_TYPE_LENGTH;
+    return header.size() + buffer->size() - cipherTextOffset;
 }
@@ -26,16 +26,19 @@
 #include <algorithm>
 #include <atomic>  // std::atomic
 #include <chrono>
+#include <condition_variable>  // std::condition_variable
 #include <cstdio>
 #include <ctime>
 #include <fstream>
 #include <iomanip>
 #include <ios>
 #include <iostream>
+#include <memory>  // std::shared_ptr
 #include <mutex>
 #include <sstream>        // std::stringstream
 #include <thread>         // std::this_thread
 #include <unordered_map>  // std::unordered_map
+#include <vector>         // std::vector
 
 /*
  * A sublcass of streambuf that allows for writes to a single ostream to write
@@ -84,9 +87,11 @@ public:
     void open_file(const std::string &name) {
         // cppcheck-suppress ignoredReturnValue
         file.open(name, std::ios_base::out | std::ios_base::app);
+        fileOpen = file.is_open();
     }
     void close_file() {
         file.close();
+        fileOpen = false;
     }
     void setup_hook(std::ostream &o) {
         o.rdbuf(this);
@@ -102,6 +107,11 @@ public:
         levelFile = level;
     }
 
+    // whether anything would be written for a message of the given level
+    bool would_write(RaceLog::LogLevel level) const {
+        return level >= levelCout || (fileOpen && level >= levelFile);
+    }
+
 private:
     std::streambuf &cout = *std::cout.rdbuf();
     std::filebuf file;
@@ -109,6 +119,7 @@ private:
     std::atomic<RaceLog::LogLevel> levelWrite = RaceLog::LL_DEBUG;
     std::atomic<RaceLog::LogLevel> levelCout = RaceLog::LL_INFO;
     std::atomic<RaceLog::LogLevel> levelFile = RaceLog::LL_INFO;
+    std::atomic<bool> fileOpen = false;
 };
 static teebuf logBuffer;
 static std::ostream logStream(&logBuffer);
@@ -139,6 +150,346 @@ inline const char *logLevelToStr(RaceLog::LogLevel level) {
 
 static std::mutex logMutex;
 
+/*
+ * The timestamp of the last record written, formatted to the second. Records are written in
+ * bursts, so this saves formatting the same second over and over. Guarded by logMutex.
+ */
+static std::time_t lastTimestampSeconds = -1;
+static char lastTimestamp[32] = "";
+
+/*
+ * Write a single log record to the log stream. Must be called with logMutex held. The caller is
+ * responsible for flushing the stream.
+ */
+static void writeRecord(RaceLog::LogLevel level, std::chrono::system_clock::time_point time,
+                        const std::string &pluginName, const std::string &message,
+                        const std::string &stackTrace) {
+    logBuffer.set_level(level);
+
+    // C++20 will add time format functionality for <chrono>
+    const std::time_t seconds = std::chrono::system_clock::to_time_t(time);
+    if (seconds != lastTimestampSeconds) {
+        std::tm localTime;
+        localtime_r(&seconds, &localTime);
+        std::strftime(lastTimestamp, sizeof(lastTimestamp), "%F %T", &localTime);
+        lastTimestampSeconds = seconds;
+    }
+    const auto micros =
+        std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()) % 1000000;
+    logStream << lastTimestamp << '.' << std::setfill('0') << std::setw(6) << micros.count()
+              << ": ";
+
+    logStream << logLevelToStr(level) << ": " << pluginName << ": " << message << "\n";
+    if (stackTrace.length() > 0) {
+        logStream << stackTrace << "\n";
+    }
+
+#ifdef __ANDROID__
+    std::string androidLog = logLevelToStr(level) + std::string(" ") + pluginName + ": " + message;
+    __android_log_print(ANDROID_LOG_DEBUG, "RaceLog", "%s", androidLog.c_str());
+#endif
+}
+
+namespace {
+
+struct LogRecord {
+    RaceLog::LogLevel level;
+    std::chrono::system_clock::time_point time;
+    std::string pluginName;
+    std::string message;
+    std::string stackTrace;
+};
+
+/*
+ * A bounded single-producer/single-consumer queue of log records. Each logging thread owns one and
+ * is its only producer. The consumer side is only used while holding AsyncLogger::drainLock.
+ */
+class LogRing {
+public:
+    explicit LogRing(size_t capacity) : records(capacity + 1) {}
+
+    // Producer side. The record is only moved from if it was queued.
+    bool push(LogRecord &&record) {
+        const size_t current = head.load(std::memory_order_relaxed);
+        const size_t next = (current + 1) % records.size();
+        if (next == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        records[current] = std::move(record);
+        head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool pop(LogRecord &record) {
+        const size_t current = tail.load(std::memory_order_relaxed);
+        if (current == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        record = std::move(records[current]);
+        tail.store((current + 1) % records.size(), std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        const size_t n = records.size();
+        return (head.load(std::memory_order_acquire) + n - tail.load(std::memory_order_acquire)) %
+               n;
+    }
+
+    size_t capacity() const {
+        return records.size() - 1;
+    }
+
+    // Set once the owning thread exits or switches to a new ring, so the ring can be released once
+    // it has been drained
+    std::atomic<bool> retired{false};
+
+    // The number of records the owning thread dropped because the ring was full
+    std::atomic<uint64_t> dropped{0};
+
+private:
+    std::vector<LogRecord> records;
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+};
+
+/*
+ * The ring owned by the current thread along with the generation of the async logging
+ * configuration it was created for.
+ */
+struct ThreadRing {
+    std::shared_ptr<LogRing> ring;
+    uint64_t generation = 0;
+
+    ~ThreadRing() {
+        if (ring != nullptr) {
+            ring->retired = true;
+        }
+    }
+};
+thread_local ThreadRing threadRing;
+
+/*
+ * Background writer for asynchronous logging. Log calls queue records in the calling thread's
+ * LogRing without taking any locks and a background thread periodically drains every ring, writing
+ * the records in timestamp order and flushing the log stream once per batch.
+ */
+class AsyncLogger {
+public:
+    bool isEnabled() const {
+        return enabled.load(std::memory_order_acquire);
+    }
+
+    void start(size_t bufferSize, RaceLog::OverflowPolicy overflowPolicy) {
+        std::lock_guard<std::mutex> lock(threadLock);
+        ringCapacity = std::max<size_t>(bufferSize, 1);
+        policy = overflowPolicy;
+        // threads pick up a ring with the new capacity the next time they log
+        generation++;
+        if (!thread.joinable()) {
+            running = true;
+            thread = std::thread(&AsyncLogger::run, this);
+        }
+        enabled = true;
+    }
+
+    void stop() {
+        std::lock_guard<std::mutex> lock(threadLock);
+        enabled = false;
+        // pairs with the fence in push, so either the final drain below sees a record queued while
+        // stopping or the thread that queued it sees async logging is off and drains it itself
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> signalGuard(signalLock);
+                running = false;
+            }
+            signaler.notify_one();
+            thread.join();
+        }
+        flush();
+    }
+
+    /*
+     * Queue a record. Returns false if the record was not queued and should be written
+     * synchronously instead.
+     */
+    bool push(LogRecord &&record) {
+        LogRing &ring = getRing();
+        while (!ring.push(std::move(record))) {
+            if (policy == RaceLog::OP_DROP) {
+                ring.dropped++;
+                break;
+            }
+            if (!isEnabled()) {
+                return false;
+            }
+            signaler.notify_one();
+            std::this_thread::yield();
+        }
+
+        // If async logging was turned off since the caller checked, the final drain in stop may
+        // have missed this record (or drop), so write it now rather than leave it in the ring
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!isEnabled()) {
+            flush();
+            return true;
+        }
+
+        // Don't wait for the flush interval if this thread is logging faster than it's drained
+        if (sleeping.load(std::memory_order_relaxed) && ring.size() * 2 >= ring.capacity()) {
+            signaler.notify_one();
+        }
+        return true;
+    }
+
+    /*
+     * Write every record queued before the call
+     */
+    void flush() {
+        std::lock_guard<std::mutex> lock(drainLock);
+        drain();
+    }
+
+private:
+    LogRing &getRing() {
+        const uint64_t currentGeneration = generation.load();
+        if (threadRing.ring == nullptr || threadRing.generation != currentGeneration) {
+            if (threadRing.ring != nullptr) {
+                threadRing.ring->retired = true;
+            }
+            threadRing.ring = std::make_shared<LogRing>(ringCapacity.load());
+            threadRing.generation = currentGeneration;
+
+            std::lock_guard<std::mutex> lock(registryLock);
+            rings.push_back(threadRing.ring);
+        }
+        return *threadRing.ring;
+    }
+
+    void run() {
+        while (running) {
+            {
+                std::lock_guard<std::mutex> lock(drainLock);
+                drain();
+            }
+
+            std::unique_lock<std::mutex> lock(signalLock);
+            if (!running) {
+                break;
+            }
+            sleeping = true;
+            signaler.wait_for(lock, FLUSH_INTERVAL);
+            sleeping = false;
+        }
+    }
+
+    /*
+     * Write the records currently queued in every ring. Must be called with drainLock held.
+     */
+    void drain() {
+        std::vector<std::shared_ptr<LogRing>> current;
+        {
+            std::lock_guard<std::mutex> lock(registryLock);
+            current = rings;
+        }
+
+        batch.clear();
+        uint64_t dropped = 0;
+        std::vector<const LogRing *> released;
+        LogRecord record;
+        for (auto &ring : current) {
+            // retired is checked first, so everything the owning thread queued or dropped before
+            // retiring the ring is drained below and the ring can then be released
+            const bool retired = ring->retired.load();
+            dropped += ring->dropped.exchange(0);
+            // only take what is queued now so a busy thread can't keep the drain going forever
+            for (size_t count = ring->size(); count > 0 && ring->pop(record); --count) {
+                batch.push_back(std::move(record));
+            }
+            if (retired) {
+                released.push_back(ring.get());
+            }
+        }
+
+        if (!released.empty()) {
+            std::lock_guard<std::mutex> lock(registryLock);
+            rings.erase(std::remove_if(rings.begin(), rings.end(),
+                                       [&released](const std::shared_ptr<LogRing> &ring) {
+                                           return std::find(released.begin(), released.end(),
+                                                            ring.get()) != released.end();
+                                       }),
+                        rings.end());
+        }
+
+        if (batch.empty() && dropped == 0) {
+            return;
+        }
+
+        // records from different threads are interleaved by time, as they would be if written
+        // synchronously
+        std::stable_sort(batch.begin(), batch.end(), [](const LogRecord &a, const LogRecord &b) {
+            return a.time < b.time;
+        });
+
+        std::lock_guard<std::mutex> lock(logMutex);
+        if (dropped > 0) {
+            writeRecord(RaceLog::LL_WARNING, std::chrono::system_clock::now(), "RaceLog",
+                        "dropped " + std::to_string(dropped) +
+                            " log messages because the async log buffer was full",
+                        "");
+        }
+        for (const auto &entry : batch) {
+            writeRecord(entry.level, entry.time, entry.pluginName, entry.message,
+                        entry.stackTrace);
+        }
+        logStream << std::flush;
+    }
+
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL{10};
+
+    std::atomic<bool> enabled{false};
+    std::atomic<size_t> ringCapacity{4096};
+    std::atomic<RaceLog::OverflowPolicy> policy{RaceLog::OP_DROP};
+    std::atomic<uint64_t> generation{0};
+
+    std::mutex registryLock;
+    std::vector<std::shared_ptr<LogRing>> rings;
+
+    std::mutex drainLock;
+    std::vector<LogRecord> batch;
+
+    std::mutex threadLock;
+    std::mutex signalLock;
+    std::condition_variable signaler;
+    std::atomic<bool> sleeping{false};
+    std::atomic<bool> running{false};
+    std::thread thread;
+};
+
+/*
+ * The async logger is never destroyed so that threads logging during process exit don't use it
+ * after it's gone. It's stopped, and its queued records written, by asyncLoggerShutdown instead.
+ */
+AsyncLogger &getAsyncLogger() {
+    static AsyncLogger *asyncLogger = new AsyncLogger();
+    return *asyncLogger;
+}
+
+/*
+ * Declared after logStream so it's destroyed, and the remaining records written, before the
+ * stream is.
+ */
+struct AsyncLoggerShutdown {
+    ~AsyncLoggerShutdown() {
+        getAsyncLogger().stop();
+    }
+};
+AsyncLoggerShutdown asyncLoggerShutdown;
+
+}  // namespace
+
 void RaceLog::setLogLevel(LogLevel level) {
     logBuffer.set_level_cout(level);
     logBuffer.set_level_file(level);
@@ -161,29 +512,47 @@ void RaceLog::setLogFile(const std::string &file) {
     }
 }
 
+void RaceLog::setAsyncLogging(bool enabled, size_t bufferSize, OverflowPolicy policy) {
+    if (enabled) {
+        getAsyncLogger().start(bufferSize, policy);
+    } else {
+        getAsyncLogger().stop();
+    }
+}
+
+void RaceLog::flush() {
+    getAsyncLogger().flush();
+}
+
+bool RaceLog::isLogLevelEnabled(LogLevel level) {
+    if (static_cast<int>(level) < RACE_LOG_COMPILED_LEVEL) {
+        return false;
+    }
+#ifdef __ANDROID__
+    // everything is also sent to logcat
+    return true;
+#else
+    return logBuffer.would_write(level);
+#endif
+}
+
 void RaceLog::log(LogLevel level, const std::string &pluginName, const std::string &message,
                   const std::string &stackTrace) {
-    std::lock_guard<std::mutex> lock(logMutex);
-    logBuffer.set_level(level);
+    if (!isLogLevelEnabled(level)) {
+        return;
+    }
 
-    // C++20 will add time format functionality for <chrono>
     const auto now = std::chrono::system_clock::now();
-    std::time_t nowFormatted = std::chrono::system_clock::to_time_t(now);
-    const auto nowMs =
-        std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()) % 1000000;
-    logStream << std::put_time(std::localtime(&nowFormatted), "%F %T") << '.' << std::setfill('0')
-              << std::setw(6) << nowMs.count() << ": ";
 
-    logStream << logLevelToStr(level) << ": " << pluginName << ": " << message << "\n";
-    if (stackTrace.length() > 0) {
-        logStream << stackTrace << "\n";
+    AsyncLogger &asyncLogger = getAsyncLogger();
+    if (asyncLogger.isEnabled() &&
+        asyncLogger.push({level, now, pluginName, message, stackTrace})) {
+        return;
     }
-    logStream << std::flush;
 
-#ifdef __ANDROID__
-    std::string androidLog = logLevelToStr(level) + std::string(" ") + pluginName + ": " + message;
-    __android_log_print(ANDROID_LOG_DEBUG, "RaceLog", "%s", androidLog.c_str());
-#endif
+    std::lock_guard<std::mutex> lock(logMutex);
+    writeRecord(level, now, pluginName, message, stackTrace);
+    logStream << std::flush;
 }
 
 std::string RaceLog::get_this_thread_id_prefix() {
@@ -227,3 +596,173 @@ std::string RaceLog::cppDemangle(const char *abiName) {
         return ret;
     }
 }
+
+const std::string &RaceLog::TraceSite::prefix() {
+    return findOrAddPrefix(nullptr);
+}
+
+const std::string &RaceLog::TraceSite::prefix(const std::type_info &type) {
+    return findOrAddPrefix(&type);
+}
+
+const std::string &RaceLog::TraceSite::findOrAddPrefix(const std::type_info *type) {
+    Prefix *head = prefixes.load(std::memory_order_acquire);
+    for (Prefix *entry = head; entry != nullptr; entry = entry->next) {
+        const bool matches = entry->type == nullptr || type == nullptr ? entry->type == type
+                                                                       : *entry->type == *type;
+        if (matches) {
+            return entry->text;
+        }
+    }
+
+    // First call for this type. Two threads may race to add the same type, in which case both
+    // prefixes are kept and either may be returned afterward, which is harmless.
+    std::string text = function + std::string(": ");
+    if (type != nullptr) {
+        text = cppDemangle(type->name()) + "::" + text;
+    }
+    // Intentionally leaked, as the prefix may be used by threads that are still logging while
+    // static objects are destroyed at exit
+    Prefix *entry = new Prefix{type, std::move(text), head};
+    while (!prefixes.compare_exchange_weak(entry->next, entry, std::memory_order_release,
+                                           std::memory_order_acquire)) {
+    }
+    return entry->text;
+}
+
+namespace {
+
+/*
+ * The durations of calls to a single call site. Bucket i counts calls that took from 2^i up to
+ * 2^(i+1) nanoseconds. The last bucket also counts anything longer.
+ */
+struct TraceHistogram {
+    static constexpr size_t NUM_BUCKETS = 40;
+
+    uint64_t count = 0;
+    uint64_t totalNanos = 0;
+    uint64_t maxNanos = 0;
+    uint64_t buckets[NUM_BUCKETS] = {};
+
+    void add(uint64_t nanos) {
+        size_t bucket = 0;
+        for (uint64_t value = nanos >> 1; value != 0 && bucket < NUM_BUCKETS - 1; value >>= 1) {
+            bucket++;
+        }
+        buckets[bucket]++;
+        count++;
+        totalNanos += nanos;
+        maxNanos = std::max(maxNanos, nanos);
+    }
+
+    void merge(const TraceHistogram &other) {
+        for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+            buckets[i] += other.buckets[i];
+        }
+        count += other.count;
+        totalNanos += other.totalNanos;
+        maxNanos = std::max(maxNanos, other.maxNanos);
+    }
+
+    // An upper bound on the given quantile, i.e. the end of the bucket it falls in
+    uint64_t quantile(double q) const {
+        const auto target = static_cast<uint64_t>(q * static_cast<double>(count));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < NUM_BUCKETS - 1; ++i) {
+            seen += buckets[i];
+            if (seen > target) {
+                return std::min(uint64_t{1} << (i + 1), maxNanos);
+            }
+        }
+        return maxNanos;
+    }
+};
+
+using TraceHistograms = std::unordered_map<const RaceLog::TraceSite *, TraceHistogram>;
+
+struct ThreadTraceTimings;
+
+/*
+ * Every thread's timings. The histograms of threads that have exited are merged into retired.
+ * Lock this before any thread's lock.
+ */
+struct TraceTimingRegistry {
+    std::mutex lock;
+    std::vector<ThreadTraceTimings *> threads;
+    TraceHistograms retired;
+};
+
+/*
+ * Never destroyed, as threads may exit after static objects are destroyed
+ */
+TraceTimingRegistry &getTraceTimingRegistry() {
+    static TraceTimingRegistry *registry = new TraceTimingRegistry();
+    return *registry;
+}
+
+/*
+ * The timings recorded by a single thread. The lock is only contended while the timings are being
+ * summarized by logTraceTimings.
+ */
+struct ThreadTraceTimings {
+    std::mutex lock;
+    TraceHistograms histograms;
+
+    ThreadTraceTimings() {
+        TraceTimingRegistry &registry = getTraceTimingRegistry();
+        std::lock_guard<std::mutex> registryGuard(registry.lock);
+        registry.threads.push_back(this);
+    }
+
+    ~ThreadTraceTimings() {
+        TraceTimingRegistry &registry = getTraceTimingRegistry();
+        std::lock_guard<std::mutex> registryGuard(registry.lock);
+        std::lock_guard<std::mutex> guard(lock);
+        for (const auto &entry : histograms) {
+            registry.retired[entry.first].merge(entry.second);
+        }
+        registry.threads.erase(std::remove(registry.threads.begin(), registry.threads.end(), this),
+                               registry.threads.end());
+    }
+};
+thread_local ThreadTraceTimings threadTraceTimings;
+
+}  // namespace
+
+void RaceLog::TraceSite::recordTiming(std::chrono::steady_clock::duration elapsed) {
+    const auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    std::lock_guard<std::mutex> guard(threadTraceTimings.lock);
+    threadTraceTimings.histograms[this].add(static_cast<uint64_t>(std::max<int64_t>(nanos, 0)));
+}
+
+void RaceLog::logTraceTimings() {
+    TraceHistograms merged;
+    {
+        TraceTimingRegistry &registry = getTraceTimingRegistry();
+        std::lock_guard<std::mutex> registryGuard(registry.lock);
+        merged = registry.retired;
+        for (ThreadTraceTimings *thread : registry.threads) {
+            std::lock_guard<std::mutex> guard(thread->lock);
+            for (const auto &entry : thread->histograms) {
+                merged[entry.first].merge(entry.second);
+            }
+        }
+    }
+
+    // the call sites that took the most time in total first
+    std::vector<std::pair<const TraceSite *, TraceHistogram>> sites(merged.begin(), merged.end());
+    std::sort(sites.begin(), sites.end(), [](const auto &a, const auto &b) {
+        return a.second.totalNanos > b.second.totalNanos;
+    });
+
+    for (const auto &[site, histogram] : sites) {
+        std::stringstream message;
+        message << site->function << ": calls=" << histogram.count
+                << ", total=" << histogram.totalNanos
+                << " ns, mean=" << histogram.totalNanos / histogram.count
+                << " ns, p50<=" << histogram.quantile(0.5)
+                << " ns, p99<=" << histogram.quantile(0.99) << " ns, max=" << histogram.maxNanos
+                << " ns";
+        logInfo(site->pluginName, message.str(), "");
+    }
+}
@@ -0,0 +1,334 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "TimerWheel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include "RaceLog.h"
+
+// The most unused timers kept for reuse. Any more are freed.
+static constexpr size_t MAX_FREE_TIMERS = 1024;
+
+void TimerWheel::Slot::push_back(Timer *timer) {
+    timer->slot = this;
+    timer->prev = tail;
+    timer->next = nullptr;
+    if (tail != nullptr) {
+        tail->next = timer;
+    } else {
+        head = timer;
+    }
+    tail = timer;
+}
+
+void TimerWheel::Slot::erase(Timer *timer) {
+    if (timer->prev != nullptr) {
+        timer->prev->next = timer->next;
+    } else {
+        head = timer->next;
+    }
+    if (timer->next != nullptr) {
+        timer->next->prev = timer->prev;
+    } else {
+        tail = timer->prev;
+    }
+    timer->prev = nullptr;
+    timer->next = nullptr;
+    timer->slot = nullptr;
+}
+
+TimerWheel::TimerWheel() :
+    mStarted(false),
+    mStopped(false),
+    mNextId(INVALID_TIMER + 1),
+    mCurrentTick(nowTick()),
+    mWakeTick(NO_TICK),
+    mBatch(0),
+    mRunningCallbacks(false),
+    mFreeTimers(nullptr),
+    mFreeTimerCount(0) {}
+
+TimerWheel::~TimerWheel() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStopped = true;
+    }
+    mSignaler.notify_all();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+
+    for (auto &entry : mTimers) {
+        delete entry.second;
+    }
+    while (mFreeTimers != nullptr) {
+        Timer *timer = mFreeTimers;
+        mFreeTimers = timer->next;
+        delete timer;
+    }
+}
+
+TimerWheel &TimerWheel::shared() {
+    // Intentionally leaked. Handlers and links held by other static objects may still cancel
+    // timers while those objects are being destroyed at exit.
+    static TimerWheel *wheel = new TimerWheel();
+    return *wheel;
+}
+
+TimerWheel::TimerId TimerWheel::schedule(double timestamp, Callback callback) {
+    if (timestamp == std::numeric_limits<double>::infinity()) {
+        return INVALID_TIMER;
+    }
+
+    // round up so the callback never runs before the timestamp
+    std::uint64_t expires = 0;
+    if (timestamp > 0) {
+        expires = static_cast<std::uint64_t>(std::ceil(timestamp * 1000));
+    }
+
+    bool wake;
+    TimerId id;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        if (mStopped) {
+            return INVALID_TIMER;
+        }
+
+        if (!mStarted) {
+            mStarted = true;
+            mThread = std::thread(&TimerWheel::run, this);
+        }
+
+        Timer *timer = acquireTimer();
+        timer->id = mNextId++;
+        timer->expires = expires;
+        timer->callback = std::move(callback);
+        insert(timer);
+        mTimers.emplace(timer->id, timer);
+
+        id = timer->id;
+        wake = expires < mWakeTick;
+    }
+
+    // wake the wheel thread if this timer expires before it was going to wake up anyway
+    if (wake) {
+        mSignaler.notify_one();
+    }
+    return id;
+}
+
+bool TimerWheel::cancel(TimerId timer) {
+    if (timer == INVALID_TIMER) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+    auto iter = mTimers.find(timer);
+    if (iter == mTimers.end()) {
+        return false;
+    }
+
+    Timer *cancelled = iter->second;
+    mTimers.erase(iter);
+    cancelled->slot->erase(cancelled);
+    releaseTimer(cancelled);
+    return true;
+}
+
+void TimerWheel::waitForCallbacks() {
+    std::unique_lock<std::mutex> lock(mLock);
+    if (!mRunningCallbacks || std::this_thread::get_id() == mThread.get_id()) {
+        return;
+    }
+
+    // only wait for the batch that is running now. New batches can't contain the caller's
+    // (already cancelled) timers.
+    std::uint64_t batch = mBatch;
+    mCallbacksDone.wait(lock, [this, batch] { return !mRunningCallbacks || mBatch != batch; });
+}
+
+size_t TimerWheel::size() {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mTimers.size();
+}
+
+void TimerWheel::run() {
+    using TimePoint = std::chrono::time_point<std::chrono::system_clock, std::chrono::milliseconds>;
+
+    std::unique_lock<std::mutex> lock(mLock);
+    while (!mStopped) {
+        Slot expired;
+        advance(nowTick(), expired);
+
+        if (!expired.empty()) {
+            mBatch++;
+            mRunningCallbacks = true;
+            lock.unlock();
+
+            for (Timer *timer = expired.head; timer != nullptr; timer = timer->next) {
+                try {
+                    timer->callback();
+                } catch (std::exception &e) {
+                    RaceLog::logError("TimerWheel",
+                                      "callback threw exception: " + std::string(e.what()), "");
+                } catch (...) {
+                    RaceLog::logError("TimerWheel", "callback threw an exception", "");
+                }
+            }
+
+            lock.lock();
+            while (!expired.empty()) {
+                Timer *timer = expired.head;
+                expired.erase(timer);
+                releaseTimer(timer);
+            }
+            mRunningCallbacks = false;
+            mCallbacksDone.notify_all();
+            continue;
+        }
+
+        mWakeTick = nextEventTick();
+        if (mWakeTick == NO_TICK) {
+            mSignaler.wait(lock);
+        } else {
+            mSignaler.wait_until(
+                lock, TimePoint{std::chrono::milliseconds{static_cast<int64_t>(mWakeTick)}});
+        }
+        mWakeTick = NO_TICK;
+    }
+}
+
+std::uint64_t TimerWheel::nowTick() {
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch());
+    return static_cast<std::uint64_t>(now.count());
+}
+
+void TimerWheel::insert(Timer *timer) {
+    // timers that have already expired go in the slot for the current tick
+    std::uint64_t expires = std::max(timer->expires, mCurrentTick);
+    std::uint64_t delta = expires - mCurrentTick;
+
+    // park timers beyond the range of the wheel on the last level. They're re-inserted with their
+    // real expiry when that slot is cascaded.
+    const std::uint64_t range = std::uint64_t{1} << (SLOT_BITS * LEVELS);
+    if (delta >= range) {
+        expires = mCurrentTick + range - 1;
+        delta = range - 1;
+    }
+
+    int level = 0;
+    while (delta >= (std::uint64_t{1} << (SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+
+    mSlots[level][(expires >> (SLOT_BITS * level)) & SLOT_MASK].push_back(timer);
+}
+
+void TimerWheel::advance(std::uint64_t now, Slot &expired) {
+    while (mCurrentTick <= now) {
+        // skip straight to the next tick with anything to do
+        std::uint64_t next = nextEventTick();
+        if (next > now) {
+            mCurrentTick = now + 1;
+            break;
+        }
+        mCurrentTick = next;
+
+        // when a level wraps, move the timers in the next slot of the level above down
+        for (int level = 1; level < LEVELS; ++level) {
+            if ((mCurrentTick & ((std::uint64_t{1} << (SLOT_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            cascade(level, (mCurrentTick >> (SLOT_BITS * level)) & SLOT_MASK);
+        }
+
+        Slot &slot = mSlots[0][mCurrentTick & SLOT_MASK];
+        while (!slot.empty()) {
+            Timer *timer = slot.head;
+            slot.erase(timer);
+            mTimers.erase(timer->id);
+            expired.push_back(timer);
+        }
+
+        mCurrentTick++;
+    }
+}
+
+void TimerWheel::cascade(int level, std::uint64_t index) {
+    Slot &slot = mSlots[level][index];
+    while (!slot.empty()) {
+        Timer *timer = slot.head;
+        slot.erase(timer);
+        insert(timer);
+    }
+}
+
+std::uint64_t TimerWheel::nextEventTick() const {
+    std::uint64_t next = NO_TICK;
+
+    // the first level expires timers, and every other level is cascaded when the level below it
+    // wraps around. Find the earliest tick that either happens for a non-empty slot.
+    for (int level = 0; level < LEVELS; ++level) {
+        const int shift = SLOT_BITS * level;
+        const std::uint64_t granularity = std::uint64_t{1} << shift;
+
+        // the first tick at or after the current one that this level acts on
+        std::uint64_t position = (mCurrentTick + granularity - 1) >> shift;
+        for (std::uint64_t i = 0; i < SLOTS; ++i) {
+            if (!mSlots[level][(position + i) & SLOT_MASK].empty()) {
+                next = std::min(next, (position + i) << shift);
+                break;
+            }
+        }
+    }
+
+    return next;
+}
+
+TimerWheel::Timer *TimerWheel::acquireTimer() {
+    if (mFreeTimers == nullptr) {
+        return new Timer();
+    }
+
+    Timer *timer = mFreeTimers;
+    mFreeTimers = timer->next;
+    timer->next = nullptr;
+    mFreeTimerCount--;
+    return timer;
+}
+
+void TimerWheel::releaseTimer(Timer *timer) {
+    timer->callback = nullptr;
+    timer->id = INVALID_TIMER;
+    timer->prev = nullptr;
+    timer->slot = nullptr;
+
+    if (mFreeTimerCount >= MAX_FREE_TIMERS) {
+        delete timer;
+        return;
+    }
+
+    timer->next = mFreeTimers;
+    mFreeTimers = timer;
+    mFreeTimerCount++;
+}
@@ -65,3 +65,80 @@ TEST(EncPkg, eq_false) {
 
     ASSERT_EQ(package1 == package2, false);
 }
+
+TEST(EncPkg, views_match_copies) {
+    EncPkg package(273, 546, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9});
+    package.setPackageType(PKG_TYPE_NM);
+
+    RawData rawData = package.getRawData();
+    RawData header = package.getHeaderView().toRawData();
+    RawData cipherText = package.getCipherTextView().toRawData();
+    ASSERT_EQ(header.size(), EncPkg::HEADER_LENGTH);
+    ASSERT_EQ(cipherText, package.getCipherText());
+
+    header.insert(header.end(), cipherText.begin(), cipherText.end());
+    ASSERT_EQ(header, rawData);
+    ASSERT_EQ(package.getSize(), rawData.size());
+}
+
+TEST(EncPkg, raw_data_constructor_does_not_copy_cipher_text) {
+    RawData rawData({0x11, 0x1, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,  // little endian trace id
+                     0x22, 0x2, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,  // little endian span id
+                     1,                                        // package type
+                     0,    1,   2,   3});
+    const uint8_t *data = rawData.data();
+    EncPkg package(std::move(rawData));
+
+    ASSERT_EQ(package.getCipherTextView().data(), data + EncPkg::HEADER_LENGTH);
+    ASSERT_EQ(package.getCipherTextView().toRawData(), RawData({0, 1, 2, 3}));
+}
+
+TEST(EncPkg, copies_share_cipher_text) {
+    EncPkg package(1, 2, {0, 1, 2, 3});
+    EncPkg copy = package;
+
+    ASSERT_EQ(package.getBuffer(), copy.getBuffer());
+    ASSERT_EQ(package.getCipherTextView().data(), copy.getCipherTextView().data());
+}
+
+TEST(EncPkg, modifying_copy_does_not_modify_original) {
+    EncPkg package(1, 2, {0, 1, 2, 3});
+    EncPkg copy = package;
+    copy.setTraceId(3);
+    copy.setSpanId(4);
+    copy.setPackageType(PKG_TYPE_SDK);
+
+    ASSERT_EQ(package.getTraceId(), 1);
+    ASSERT_EQ(package.getSpanId(), 2);
+    ASSERT_EQ(package.getPackageType(), PKG_TYPE_UNDEF);
+    ASSERT_EQ(copy.getTraceId(), 3);
+    ASSERT_EQ(copy.getSpanId(), 4);
+    ASSERT_EQ(copy.getPackageType(), PKG_TYPE_SDK);
+
+    EncPkg parsed(copy.getRawData());
+    ASSERT_EQ(parsed.getTraceId(), 3);
+    ASSERT_EQ(parsed.getSpanId(), 4);
+    ASSERT_EQ(parsed.getPackageType(), PKG_TYPE_SDK);
+    ASSERT_EQ(parsed, package);
+}
+
+TEST(EncPkg, setters_only_change_their_own_field) {
+    EncPkg package(1, 2, {0, 1, 2, 3});
+
+    package.setTraceId(5);
+    ASSERT_EQ(package.getTraceId(), 5);
+    ASSERT_EQ(package.getSpanId(), 2);
+
+    package.setSpanId(6);
+    ASSERT_EQ(package.getTraceId(), 5);
+    ASSERT_EQ(package.getSpanId(), 6);
+}
+
+TEST(EncPkg, short_raw_data) {
+    EncPkg package(RawData({1, 2, 3}));
+
+    ASSERT_EQ(package.getTraceId(), 0);
+    ASSERT_EQ(package.getSpanId(), 0);
+    ASSERT_TRUE(package.getCipherText().empty());
+    ASSERT_EQ(package.getSize(), EncPkg::HEADER_LENGTH);
+}
@@ -16,6 +16,12 @@
 //
 
 #include <climits>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <ostream>
+#include <thread>
+#include <vector>
 
 #include "RaceLog.h"
 #include "gtest/gtest.h"
@@ -53,3 +59,290 @@ TEST(RaceLogTest, logWarning) {
 TEST(RaceLogTest, logError) {
     RaceLog::logError("my plugin name", "my message", "my stack trace");
 }
+
+static std::vector<std::string> readLinesContaining(const std::string &path,
+                                                   const std::string &substring) {
+    std::vector<std::string> lines;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.find(substring) != std::string::npos) {
+            lines.push_back(line);
+        }
+    }
+    return lines;
+}
+
+TEST(RaceLogTest, async_logging_block_writes_every_message_in_order) {
+    const std::string path = testing::TempDir() + "RaceLogTest_async_block.log";
+    std::remove(path.c_str());
+    RaceLog::setLogFile(path);
+    RaceLog::setLogLevelFile(RaceLog::LL_DEBUG);
+    RaceLog::setAsyncLogging(true, 8, RaceLog::OP_BLOCK);
+
+    const int numThreads = 4;
+    const int numMessages = 500;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < numMessages; ++i) {
+                RaceLog::logDebug("my plugin name",
+                                  "async message " + std::to_string(t) + " " + std::to_string(i),
+                                  "");
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    RaceLog::setAsyncLogging(false);
+    RaceLog::setLogFile("");
+    RaceLog::setLogLevelFile(RaceLog::LL_INFO);
+
+    auto lines = readLinesContaining(path, "async message ");
+    ASSERT_EQ(lines.size(), static_cast<size_t>(numThreads * numMessages));
+
+    std::vector<int> next(numThreads, 0);
+    for (const auto &line : lines) {
+        std::string fields = line.substr(line.find("async message ") + 14);
+        int t = std::stoi(fields.substr(0, fields.find(' ')));
+        int i = std::stoi(fields.substr(fields.find(' ') + 1));
+        EXPECT_EQ(i, next[t]++);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(RaceLogTest, async_logging_drop_reports_dropped_messages) {
+    const std::string path = testing::TempDir() + "RaceLogTest_async_drop.log";
+    std::remove(path.c_str());
+    RaceLog::setLogFile(path);
+    RaceLog::setLogLevelFile(RaceLog::LL_DEBUG);
+    RaceLog::setAsyncLogging(true, 1, RaceLog::OP_DROP);
+
+    const int numMessages = 1000;
+    for (int i = 0; i < numMessages; ++i) {
+        RaceLog::logDebug("my plugin name", "async message " + std::to_string(i), "");
+    }
+
+    RaceLog::setAsyncLogging(false);
+    RaceLog::setLogFile("");
+    RaceLog::setLogLevelFile(RaceLog::LL_INFO);
+
+    size_t written = readLinesContaining(path, "async message ").size();
+    size_t dropped = 0;
+    for (const auto &line : readLinesContaining(path, "log messages because")) {
+        std::string count = line.substr(line.find("dropped ") + 8);
+        dropped += std::stoul(count.substr(0, count.find(' ')));
+    }
+    EXPECT_GT(written, 0u);
+    EXPECT_EQ(written + dropped, static_cast<size_t>(numMessages));
+    std::remove(path.c_str());
+}
+
+TEST(RaceLogTest, async_logging_drop_reports_messages_dropped_by_exited_threads) {
+    const std::string path = testing::TempDir() + "RaceLogTest_async_drop_exited.log";
+    std::remove(path.c_str());
+    RaceLog::setLogFile(path);
+    RaceLog::setLogLevelFile(RaceLog::LL_DEBUG);
+    RaceLog::setAsyncLogging(true, 1, RaceLog::OP_DROP);
+
+    // each thread retires its ring when it exits
+    const int numThreads = 8;
+    const int numMessages = 200;
+    for (int t = 0; t < numThreads; ++t) {
+        std::thread([] {
+            for (int i = 0; i < numMessages; ++i) {
+                RaceLog::logDebug("my plugin name", "async message " + std::to_string(i), "");
+            }
+        }).join();
+    }
+
+    RaceLog::setAsyncLogging(false);
+    RaceLog::setLogFile("");
+    RaceLog::setLogLevelFile(RaceLog::LL_INFO);
+
+    size_t written = readLinesContaining(path, "async message ").size();
+    size_t dropped = 0;
+    for (const auto &line : readLinesContaining(path, "log messages because")) {
+        std::string count = line.substr(line.find("dropped ") + 8);
+        dropped += std::stoul(count.substr(0, count.find(' ')));
+    }
+    EXPECT_EQ(written + dropped, static_cast<size_t>(numThreads * numMessages));
+    std::remove(path.c_str());
+}
+
+TEST(RaceLogTest, async_logging_disabled_while_logging_writes_every_message) {
+    const std::string path = testing::TempDir() + "RaceLogTest_async_disable.log";
+    std::remove(path.c_str());
+    RaceLog::setLogFile(path);
+    RaceLog::setLogLevelFile(RaceLog::LL_DEBUG);
+    RaceLog::setAsyncLogging(true, 8, RaceLog::OP_BLOCK);
+
+    const int numMessages = 2000;
+    std::thread thread([] {
+        for (int i = 0; i < numMessages; ++i) {
+            RaceLog::logDebug("my plugin name", "async message " + std::to_string(i), "");
+        }
+    });
+    RaceLog::setAsyncLogging(false);
+    thread.join();
+
+    // no flush, any message queued while async logging was turning off must already be written
+    RaceLog::setLogFile("");
+    RaceLog::setLogLevelFile(RaceLog::LL_INFO);
+
+    EXPECT_EQ(readLinesContaining(path, "async message ").size(),
+              static_cast<size_t>(numMessages));
+    std::remove(path.c_str());
+}
+
+TEST(RaceLogTest, flush_without_async_logging) {
+    RaceLog::flush();
+}
+
+TEST(RaceLogTest, isLogLevelEnabled) {
+    RaceLog::setLogFile("");
+    RaceLog::setLogLevelStdout(RaceLog::LL_WARNING);
+    EXPECT_FALSE(RaceLog::isLogLevelEnabled(RaceLog::LL_DEBUG));
+    EXPECT_FALSE(RaceLog::isLogLevelEnabled(RaceLog::LL_INFO));
+    EXPECT_TRUE(RaceLog::isLogLevelEnabled(RaceLog::LL_WARNING));
+    EXPECT_TRUE(RaceLog::isLogLevelEnabled(RaceLog::LL_ERROR));
+
+    RaceLog::setLogLevelStdout(RaceLog::LL_DEBUG);
+    EXPECT_TRUE(RaceLog::isLogLevelEnabled(RaceLog::LL_DEBUG));
+    RaceLog::setLogLevelStdout(RaceLog::LL_INFO);
+}
+
+TEST(RaceLogTest, RACE_LOG_ENABLED_skips_evaluating_disabled_messages) {
+    RaceLog::setLogFile("");
+    RaceLog::setLogLevelStdout(RaceLog::LL_INFO);
+
+    int evaluated = 0;
+    auto buildMessage = [&evaluated] {
+        evaluated++;
+        return std::string("my message");
+    };
+    if (RACE_LOG_ENABLED(RaceLog::LL_DEBUG)) {
+        RaceLog::logDebug("my plugin name", buildMessage(), "");
+    }
+    EXPECT_EQ(evaluated, 0);
+    if (RACE_LOG_ENABLED(RaceLog::LL_INFO)) {
+        RaceLog::logInfo("my plugin name", buildMessage(), "");
+    }
+    EXPECT_EQ(evaluated, 1);
+}
+
+#define TRACE_FUNCTION(...) TRACE_FUNCTION_BASE(RaceLogTest, ##__VA_ARGS__)
+#define TRACE_METHOD(...) TRACE_METHOD_BASE(RaceLogTest, ##__VA_ARGS__)
+
+namespace {
+
+// counts how many times it is written to a stream
+struct CountedArg {
+    int *written;
+};
+
+std::ostream &operator<<(std::ostream &out, const CountedArg &arg) {
+    (*arg.written)++;
+    return out << "counted";
+}
+
+void tracedFunction(CountedArg arg) {
+    TRACE_FUNCTION(arg);
+}
+
+const std::string *tracedFunctionPrefix() {
+    TRACE_FUNCTION();
+    return &logPrefix;
+}
+
+class TracedBase {
+public:
+    virtual ~TracedBase() {}
+
+    const std::string *tracedMethod() {
+        TRACE_METHOD();
+        return &logPrefix;
+    }
+};
+
+class TracedDerived : public TracedBase {};
+
+}  // namespace
+
+TEST(RaceLogTest, TRACE_FUNCTION_skips_formatting_when_debug_disabled) {
+    RaceLog::setLogFile("");
+    RaceLog::setLogLevelStdout(RaceLog::LL_INFO);
+
+    int written = 0;
+    tracedFunction({&written});
+    EXPECT_EQ(written, 0);
+
+    RaceLog::setLogLevelStdout(RaceLog::LL_DEBUG);
+    tracedFunction({&written});
+    EXPECT_EQ(written, 1);
+    RaceLog::setLogLevelStdout(RaceLog::LL_INFO);
+}
+
+TEST(RaceLogTest, TRACE_FUNCTION_caches_prefix) {
+    const std::string *prefix = tracedFunctionPrefix();
+    EXPECT_EQ(*prefix, "tracedFunctionPrefix: ");
+    EXPECT_EQ(tracedFunctionPrefix(), prefix);
+}
+
+TEST(RaceLogTest, TRACE_METHOD_caches_prefix_per_dynamic_type) {
+    TracedBase base;
+    TracedDerived derived;
+
+    const std::string *basePrefix = base.tracedMethod();
+    const std::string *derivedPrefix = derived.tracedMethod();
+    EXPECT_EQ(*basePrefix, "(anonymous namespace)::TracedBase::tracedMethod: ");
+    EXPECT_EQ(*derivedPrefix, "(anonymous namespace)::TracedDerived::tracedMethod: ");
+
+    EXPECT_EQ(base.tracedMethod(), basePrefix);
+    EXPECT_EQ(derived.tracedMethod(), derivedPrefix);
+}
+
+TEST(RaceLogTest, TRACE_METHOD_logs_called_and_returned) {
+    const std::string path = testing::TempDir() + "RaceLogTest_trace.log";
+    std::remove(path.c_str());
+    RaceLog::setLogFile(path);
+    RaceLog::setLogLevelFile(RaceLog::LL_DEBUG);
+
+    TracedDerived derived;
+    derived.tracedMethod();
+
+    RaceLog::setLogFile("");
+    RaceLog::setLogLevelFile(RaceLog::LL_INFO);
+
+    auto lines = readLinesContaining(path, "TracedDerived::tracedMethod: ");
+    ASSERT_EQ(lines.size(), 2u);
+    EXPECT_NE(lines[0].find("RaceLogTest: "), std::string::npos);
+    EXPECT_NE(lines[0].find("tracedMethod: called"), std::string::npos);
+    EXPECT_NE(lines[1].find("tracedMethod: returned"), std::string::npos);
+    std::remove(path.c_str());
+}
+
+TEST(RaceLogTest, logTraceTimings_merges_thread_histograms) {
+    const std::string path = testing::TempDir() + "RaceLogTest_trace_timings.log";
+    std::remove(path.c_str());
+    RaceLog::setLogFile(path);
+
+    static RaceLog::TraceSite site("RaceLogTest", "timedFunction");
+    // from a thread that has exited, and from one that is still running
+    std::thread([] {
+        site.recordTiming(std::chrono::microseconds(1));
+        site.recordTiming(std::chrono::microseconds(3));
+    }).join();
+    site.recordTiming(std::chrono::microseconds(2));
+
+    RaceLog::logTraceTimings();
+    RaceLog::setLogFile("");
+
+    auto lines = readLinesContaining(path, "timedFunction: ");
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_NE(lines[0].find("calls=3, total=6000 ns, mean=2000 ns"), std::string::npos);
+    EXPECT_NE(lines[0].find("max=3000 ns"), std::string::npos);
+    std::remove(path.c_str());
+}
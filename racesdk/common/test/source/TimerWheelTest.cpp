@@ -0,0 +1,184 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "TimerWheel.h"
+#include "gtest/gtest.h"
+
+using namespace std::chrono_literals;
+
+static double now() {
+    std::chrono::duration<double> time = std::chrono::system_clock::now().time_since_epoch();
+    return time.count();
+}
+
+TEST(TimerWheelTest, schedule_runs_callback_after_timestamp) {
+    TimerWheel wheel;
+    std::promise<double> promise;
+    double timestamp = now() + 0.020;
+
+    wheel.schedule(timestamp, [&promise] { promise.set_value(now()); });
+
+    auto future = promise.get_future();
+    ASSERT_EQ(future.wait_for(5s), std::future_status::ready);
+    EXPECT_GE(future.get(), timestamp);
+}
+
+TEST(TimerWheelTest, schedule_in_the_past_runs_callback) {
+    TimerWheel wheel;
+    std::promise<void> promise;
+
+    wheel.schedule(0, [&promise] { promise.set_value(); });
+
+    EXPECT_EQ(promise.get_future().wait_for(5s), std::future_status::ready);
+}
+
+TEST(TimerWheelTest, schedule_infinity_does_nothing) {
+    TimerWheel wheel;
+    auto id = wheel.schedule(std::numeric_limits<double>::infinity(), [] { FAIL(); });
+
+    EXPECT_EQ(id, TimerWheel::INVALID_TIMER);
+    EXPECT_EQ(wheel.size(), 0u);
+}
+
+TEST(TimerWheelTest, callbacks_run_in_expiry_order) {
+    TimerWheel wheel;
+    std::mutex lock;
+    std::vector<int> order;
+    std::promise<void> promise;
+
+    double start = now();
+    const double offsets[] = {0.030, 0.010, 0.020, 0.010, 0.001};
+    for (int i = 0; i < 5; ++i) {
+        wheel.schedule(start + offsets[i], [&, i] {
+            std::lock_guard<std::mutex> guard(lock);
+            order.push_back(i);
+            if (order.size() == 5) {
+                promise.set_value();
+            }
+        });
+    }
+
+    ASSERT_EQ(promise.get_future().wait_for(5s), std::future_status::ready);
+    EXPECT_EQ(order, std::vector<int>({4, 1, 3, 2, 0}));
+}
+
+TEST(TimerWheelTest, cascades_timers_beyond_first_level) {
+    TimerWheel wheel;
+    std::promise<double> promise;
+
+    // more than 256 ms out, so the timer starts on the second level
+    double timestamp = now() + 0.300;
+    wheel.schedule(timestamp, [&promise] { promise.set_value(now()); });
+
+    auto future = promise.get_future();
+    ASSERT_EQ(future.wait_for(5s), std::future_status::ready);
+    double ranAt = future.get();
+    EXPECT_GE(ranAt, timestamp);
+    EXPECT_LT(ranAt, timestamp + 1);
+}
+
+TEST(TimerWheelTest, cancel_prevents_callback) {
+    TimerWheel wheel;
+    std::atomic<bool> called{false};
+    std::promise<void> promise;
+
+    auto id = wheel.schedule(now() + 0.010, [&called] { called = true; });
+    wheel.schedule(now() + 0.020, [&promise] { promise.set_value(); });
+
+    EXPECT_TRUE(wheel.cancel(id));
+    EXPECT_FALSE(wheel.cancel(id));
+
+    ASSERT_EQ(promise.get_future().wait_for(5s), std::future_status::ready);
+    EXPECT_FALSE(called);
+}
+
+TEST(TimerWheelTest, cancel_after_run_returns_false) {
+    TimerWheel wheel;
+    std::promise<void> promise;
+
+    auto id = wheel.schedule(0, [&promise] { promise.set_value(); });
+    ASSERT_EQ(promise.get_future().wait_for(5s), std::future_status::ready);
+    wheel.waitForCallbacks();
+
+    EXPECT_FALSE(wheel.cancel(id));
+    EXPECT_FALSE(wheel.cancel(TimerWheel::INVALID_TIMER));
+}
+
+TEST(TimerWheelTest, far_timers_stay_pending) {
+    TimerWheel wheel;
+
+    // one minute and one year out
+    auto id1 = wheel.schedule(now() + 60, [] { FAIL(); });
+    auto id2 = wheel.schedule(now() + 365 * 24 * 60 * 60, [] { FAIL(); });
+    std::this_thread::sleep_for(10ms);
+
+    EXPECT_EQ(wheel.size(), 2u);
+    EXPECT_TRUE(wheel.cancel(id1));
+    EXPECT_TRUE(wheel.cancel(id2));
+    EXPECT_EQ(wheel.size(), 0u);
+}
+
+TEST(TimerWheelTest, wait_for_callbacks_waits_for_running_callback) {
+    TimerWheel wheel;
+    std::promise<void> started;
+    std::atomic<bool> finished{false};
+
+    wheel.schedule(0, [&] {
+        started.set_value();
+        std::this_thread::sleep_for(20ms);
+        finished = true;
+    });
+
+    ASSERT_EQ(started.get_future().wait_for(5s), std::future_status::ready);
+    wheel.waitForCallbacks();
+    EXPECT_TRUE(finished);
+}
+
+TEST(TimerWheelTest, many_timers) {
+    TimerWheel wheel;
+    const int count = 10000;
+    std::atomic<int> called{0};
+    std::promise<void> promise;
+    std::vector<TimerWheel::TimerId> ids;
+
+    double start = now();
+    for (int i = 0; i < count; ++i) {
+        ids.push_back(wheel.schedule(start + 0.100 + 0.001 * (i % 50), [&] {
+            if (++called == count / 2) {
+                promise.set_value();
+            }
+        }));
+    }
+
+    // cancel every other timer
+    for (size_t i = 0; i < ids.size(); i += 2) {
+        EXPECT_TRUE(wheel.cancel(ids[i]));
+    }
+
+    ASSERT_EQ(promise.get_future().wait_for(5s), std::future_status::ready);
+    wheel.waitForCallbacks();
+    EXPECT_EQ(called, count / 2);
+    EXPECT_EQ(wheel.size(), 0u);
+}
@@ -27,13 +27,15 @@ public:
 
     /**
      * @brief Recursively copy the contents of the source directory and decrypt them before writing
-     * into the destination
+     * into the destination. Files are decrypted in parallel, a chunk at a time, so
+     * pluginStorageEncryption must be initialized before this is called.
      * @param srcPath Source directory path
      * @param destPath Destination directory path
      * @param pluginStorageEncryption The Storage Encryption object responsible for
      * encrpting/decrypting the file
      *
-     * @return True if successful
+     * @return True if successful, false if any file failed to decrypt. Files that fail to decrypt
+     * are not written to the destination.
      */
     virtual bool copyAndDecryptDir(const std::string &srcPath, const std::string &destPath,
                                    StorageEncryption &pluginStorageEncryption);
@@ -48,6 +48,8 @@ public:
     std::vector<std::string> usermodels;
     std::vector<std::string> transports;
     std::vector<std::string> encodings;
+    // whether the plugin can handle calls from more than one thread at a time
+    bool threadSafe = false;
 
     /**
      * @brief Convert plugin json to a plugin definition. If the plugin json is invalid then an
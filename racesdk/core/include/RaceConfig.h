@@ -24,6 +24,7 @@
 
 #include <cstdint>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -44,14 +45,26 @@ public:
     std::unordered_map<std::string, std::vector<std::string>> environmentTags;
     bool isPluginFetchOnStartEnabled;
     bool isVoaEnabled;
+    // the most package bytes VoA holds for delayed and replayed sends before refusing more
+    size_t voaMaxQueuedBytes;
     size_t wrapperQueueMaxSize;
     size_t wrapperTotalMaxSize;
+    size_t wrapperMaxWorkers;
     RaceLog::LogLevel logLevel;
     RaceLog::LogLevel logLevelStdout;
+    bool logAsync;
+    size_t logAsyncBufferSize;
+    RaceLog::OverflowPolicy logAsyncOverflowPolicy;
     bool logRaceConfig;
     bool logNMConfig;
     bool logCommsConfig;
     unsigned long msgLogLength;
+    // fraction of package sends/receives that get a CONNECTION_SEND/CONNECTION_RECV span
+    double traceSampleRate;
+    // per channel GID overrides of traceSampleRate
+    std::unordered_map<std::string, double> traceChannelSampleRates;
+    // the most package spans queued for export before further spans are dropped
+    size_t traceExportQueueSize;
 
     std::string env;
 
@@ -79,6 +92,8 @@ protected:
     std::string readConfigFile(const std::string &raceConfigPath);
     void parseConfigString(const std::string &config, const AppConfig &appConfig);
     RaceLog::LogLevel stringToLogLevel(std::string logLevel);
+    RaceLog::OverflowPolicy stringToOverflowPolicy(const std::string &policy);
+    double parseSampleRate(const nlohmann::json &rateJson, const std::string &fieldName);
     bool to_bool(std::string str);
     std::string bool_to_string(bool b);
     void validatePluginDefs();
@@ -235,6 +235,14 @@ public:
      */
     static std::string getPluginFromConnectionID(const ConnectionID &connId);
 
+    /**
+     * @brief Get the channel GID from a link id or connection id
+     *
+     * @param linkId The ID of the link or connection.
+     * @return string The channel the link is on
+     */
+    static std::string getChannelFromLinkID(const LinkID &linkId);
+
     /**
      * @brief Save the traceId and spanId for a given link tracing context
      *
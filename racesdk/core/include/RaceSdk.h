@@ -254,10 +254,12 @@ public:
     virtual SdkResponse sendEncryptedPackage(NMWrapper &plugin, EncPkg ePkg,
                                              ConnectionID connectionId, uint64_t batchId,
                                              int32_t timeout);
+    virtual std::vector<SdkResponse> sendEncryptedPackages(
+        NMWrapper &plugin, std::vector<std::pair<EncPkg, ConnectionID>> packages,
+        uint64_t batchId, int32_t timeout);
     virtual SdkResponse shipPackage(RaceHandle handle, EncPkg ePkg, ConnectionID connectionId,
                                     int32_t timeout, bool isTestHarness, uint64_t batchId);
-    virtual SdkResponse shipVoaItems(RaceHandle handle,
-                                     std::list<std::pair<EncPkg, double>> voaPkgQueue,
+    virtual SdkResponse shipVoaItems(RaceHandle handle, const std::vector<VoaWorkItem> &voaPkgQueue,
                                      ConnectionID connectionId, int32_t timeout, bool isTestHarness,
                                      uint64_t batchId);
 
@@ -458,6 +460,10 @@ protected:
     std::unique_ptr<VoaThread> voaThread;
     IPluginLoader &pluginLoader;
     std::shared_ptr<opentracing::Tracer> tracer;
+    // decides which packages get CONNECTION_SEND/CONNECTION_RECV spans
+    std::unique_ptr<TraceSampler> traceSampler;
+    // builds those spans off of the package path
+    std::unique_ptr<SpanExporter> spanExporter;
     std::mutex traceIdLock;
     std::atomic<bool> isShuttingDown;
 
@@ -26,6 +26,9 @@ class CommsWrapper;
 class TestHarnessWrapper;
 class AppWrapper;
 class VoaThread;
+struct VoaWorkItem;
 class VoaConfig;
+class TraceSampler;
+class SpanExporter;
 
 #endif
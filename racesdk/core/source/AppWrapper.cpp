@@ -73,7 +73,7 @@ void AppWrapper::handleReceivedMessage(ClrMsg msg) {
                      " traceId: " + helper::convertToHexString(newMsg.getTraceId()) +
                      " spanId: " + helper::convertToHexString(newMsg.getSpanId()));
 
-    mThreadHandler.post("", 0, 0, [=] {
+    mThreadHandler.post_detached("", 0, 0, [=] {
         helper::logDebug("Calling IRaceApp::handleReceivedMessage(), postId: " + postId +
                          " traceId: " + helper::convertToHexString(newMsg.getTraceId()) +
                          " spanId: " + helper::convertToHexString(newMsg.getSpanId()));
@@ -93,7 +93,7 @@ void AppWrapper::onMessageStatusChanged(RaceHandle handle, MessageStatus status)
     helper::logDebug("Posting IRaceApp::onMessageStatusChanged(), postId: " + postId + " handle: " +
                      std::to_string(handle) + " status: " + messageStatusToString(status));
 
-    mThreadHandler.post("", 0, 0, [=] {
+    mThreadHandler.post_detached("", 0, 0, [=] {
         helper::logDebug("Calling IRaceApp::onMessageStatusChanged(), postId: " + postId +
                          " handle: " + std::to_string(handle) +
                          " status: " + messageStatusToString(status));
@@ -112,7 +112,7 @@ nlohmann::json AppWrapper::getSdkStatus() {
 void AppWrapper::onSdkStatusChanged(const nlohmann::json &sdkStatus) {
     helper::logDebug("AppWrapper::onSdkStatusChanged called");
     std::string postId = std::to_string(nextPostId++);
-    mThreadHandler.post("", 0, 0, [=] {
+    mThreadHandler.post_detached("", 0, 0, [=] {
         helper::logDebug("Calling IRaceApp::onSdkStatusChanged(), postId: " + postId);
         mClient->onSdkStatusChanged(sdkStatus);
         helper::logDebug("IRaceApp::onSdkStatusChanged() returned, postId: " + postId);
@@ -168,13 +168,12 @@ SdkResponse AppWrapper::displayInfoToUser(RaceHandle handle, const std::string &
     try {
         std::string postId = std::to_string(nextPostId++);
         helper::logInfo("Posting IRaceApp::displayInfoToUser(), postId: " + postId);
-        auto [success, queueSize, future] = mThreadHandler.post("", 0, -1, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("", 0, -1, [=] {
             helper::logDebug("Calling IRaceApp::displayInfoToUser()");
             mClient->displayInfoToUser(handle, data, displayType);
             return std::make_optional(true);
         });
         (void)queueSize;
-        (void)future;
 
         // Since we aren't using posted work sizes, the only reason this would fail
         // is because of an invalid state, rather than a full queue
@@ -194,13 +193,12 @@ SdkResponse AppWrapper::displayBootstrapInfoToUser(RaceHandle handle, const std:
     try {
         std::string postId = std::to_string(nextPostId++);
         helper::logInfo("Posting IRaceApp::displayBootstrapInfoToUser(), postId: " + postId);
-        auto [success, queueSize, future] = mThreadHandler.post("", 0, -1, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("", 0, -1, [=] {
             helper::logDebug("Calling IRaceApp::displayBootstrapInfoToUser()");
             mClient->displayBootstrapInfoToUser(handle, data, displayType, actionType);
             return std::make_optional(true);
         });
         (void)queueSize;
-        (void)future;
 
         // Since we aren't using posted work sizes, the only reason this would fail
         // is because of an invalid state, rather than a full queue
@@ -69,7 +69,7 @@ bool BootstrapThread::fetchArtifacts(std::vector<std::string> artifacts,
     try {
         std::string postId = std::to_string(nextPostId++);
         helper::logInfo("Posting fetchArtifacts, postId: " + postId);
-        auto [success, queueSize, future] = mThreadHandler.post("", 0, -1, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("", 0, -1, [=] {
             const std::string &platform = bootstrapInfo->deviceInfo.platform;
             const std::string &architecture = bootstrapInfo->deviceInfo.architecture;
             const std::string &nodeType = bootstrapInfo->deviceInfo.nodeType;
@@ -98,7 +98,6 @@ bool BootstrapThread::fetchArtifacts(std::vector<std::string> artifacts,
             return std::make_optional(true);
         });
         (void)queueSize;
-        (void)future;
 
         return success == Handler::PostStatus::OK;
     } catch (std::out_of_range &error) {
@@ -154,7 +153,7 @@ bool BootstrapThread::serveFiles(const LinkID &linkId,
 
         std::string postId = std::to_string(nextPostId++);
         helper::logInfo("Posting serveFiles, postId: " + postId);
-        auto [success, queueSize, future] = mThreadHandler.post("", 0, -1, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("", 0, -1, [=] {
             manager.sdk.displayBootstrapInfoToUser("sdk", "Creating bootstrap bundle...",
                                                    RaceEnums::UD_NOTIFICATION,
                                                    RaceEnums::BS_CREATING_BUNDLE);
@@ -286,7 +285,6 @@ bool BootstrapThread::serveFiles(const LinkID &linkId,
             return std::make_optional(true);
         });
         (void)queueSize;
-        (void)future;
 
         return success == Handler::PostStatus::OK;
     } catch (std::out_of_range &error) {
@@ -304,7 +302,7 @@ bool BootstrapThread::onBootstrapFinished(const std::shared_ptr<BootstrapInfo> &
     TRACE_METHOD();
 
     // remove bootstrap directory on same thread as not to interfere with current/pending file IO
-    auto [success, queueSize, future] = mThreadHandler.post("", 0, -1, [=] {
+    auto [success, queueSize] = mThreadHandler.post_detached("", 0, -1, [=] {
         try {
             helper::logDebug(logPrefix + " removing bootstrap dir " + bootstrapInfo->bootstrapPath);
             if (fs::exists(bootstrapInfo->bootstrapPath)) {
@@ -321,7 +319,6 @@ bool BootstrapThread::onBootstrapFinished(const std::shared_ptr<BootstrapInfo> &
         return std::make_optional(true);
     });
     (void)queueSize;
-    (void)future;
     return success == Handler::PostStatus::OK;
 }
 
@@ -62,6 +62,11 @@ void CommsWrapper::stopHandler() {
     mThreadHandler.stop();
 }
 
+void CommsWrapper::setNumWorkers(size_t numWorkers) {
+    TRACE_METHOD(getId(), numWorkers);
+    mThreadHandler.set_num_workers(numWorkers);
+}
+
 void CommsWrapper::waitForCallbacks() {
     auto [success, queueSize, future] =
         mThreadHandler.post("wait queue", 0, -1, [=] { return std::make_optional(true); });
@@ -200,8 +205,39 @@ SdkResponse CommsWrapper::sendPackage(RaceHandle handle, const ConnectionID &con
     }
 
     std::chrono::duration<double> now = std::chrono::system_clock::now().time_since_epoch();
-    double timeoutTimestamp = now.count() + sendTimeout;
+    return postPackage(handle, connectionId, pkg, postTimeout, batchId, now.count() + sendTimeout);
+}
+
+std::vector<SdkResponse> CommsWrapper::sendPackages(const std::vector<PackageToSend> &packages,
+                                                    int32_t postTimeout, uint64_t batchId) {
+    TRACE_METHOD(getId(), packages.size(), postTimeout, batchId);
+    if (state == SHUTDOWN) {
+        return std::vector<SdkResponse>(packages.size(), SDK_SHUTTING_DOWN);
+    }
+
+    std::vector<double> sendTimeouts;
+    sendTimeouts.reserve(packages.size());
+    {
+        std::lock_guard<std::mutex> lock(mConnectionSendTimeoutMapMutex);
+        for (auto &package : packages) {
+            sendTimeouts.push_back(mConnectionSendTimeoutMap[package.connectionId]);
+        }
+    }
+
+    std::chrono::duration<double> now = std::chrono::system_clock::now().time_since_epoch();
+    std::vector<SdkResponse> responses;
+    responses.reserve(packages.size());
+    for (size_t i = 0; i < packages.size(); ++i) {
+        responses.push_back(postPackage(packages[i].handle, packages[i].connectionId,
+                                        packages[i].pkg, postTimeout, batchId,
+                                        now.count() + sendTimeouts[i]));
+    }
+    return responses;
+}
 
+SdkResponse CommsWrapper::postPackage(RaceHandle handle, const ConnectionID &connectionId,
+                                      const EncPkg &pkg, int32_t postTimeout, uint64_t batchId,
+                                      double timeoutTimestamp) {
     std::string postId = std::to_string(nextPostId++);
 
     auto pkgSpanContext = spanContextFromEncryptedPackage(pkg);
@@ -226,7 +262,7 @@ SdkResponse CommsWrapper::sendPackage(RaceHandle handle, const ConnectionID &con
     uint32_t pkgSize = newPkg.getSize();
 
     try {
-        auto [success, queueSize, future] = mThreadHandler.post(
+        auto [success, queueSize] = mThreadHandler.post_detached(
             connectionId, pkgSize, postTimeout,
             [=]() -> std::optional<bool> {
                 if (state == SHUTDOWN) {
@@ -311,7 +347,6 @@ SdkResponse CommsWrapper::sendPackage(RaceHandle handle, const ConnectionID &con
             }
         }
 
-        (void)future;
         return makeResponse(__func__, success == Handler::PostStatus::OK, queueSize, handle);
     } catch (std::out_of_range &error) {
         helper::logError("Queue for connection '" + connectionId +
@@ -342,7 +377,7 @@ SdkResponse CommsWrapper::openConnection(RaceHandle handle, LinkType linkType, c
     }
 
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("", 0, timeout, [=] {
             if (state == SHUTDOWN) {
                 onConnectionStatusChanged(handle, generateConnectionId(linkId), CONNECTION_CLOSED,
                                           {}, 0);
@@ -396,7 +431,6 @@ SdkResponse CommsWrapper::openConnection(RaceHandle handle, LinkType linkType, c
             mHandlePriorityTimeoutMap.erase(handle);
         }
 
-        (void)future;
         return makeResponse(__func__, success == Handler::PostStatus::OK, queueSize, handle);
     } catch (std::out_of_range &error) {
         helper::logError("Default queue does not exist. This should never happen. what:" +
@@ -421,7 +455,7 @@ SdkResponse CommsWrapper::closeConnection(RaceHandle handle, const ConnectionID
     helper::logDebug("Posting IRacePluginComms::closeConnection(), postId: " + postId);
 
     try {
-        auto [success, queueSize, future] = mThreadHandler.post(connectionId, 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached(connectionId, 0, timeout, [=] {
             if (state == SHUTDOWN) {
                 // plugin should take care of any open connection in shutdown and issue
                 // onConnectionStatusChanged there
@@ -465,7 +499,6 @@ SdkResponse CommsWrapper::closeConnection(RaceHandle handle, const ConnectionID
             helper::logError("Closing connection on " + mId + " failed with error HANDLER_FULL");
         }
 
-        (void)future;
         return makeResponse(__func__, success == Handler::PostStatus::OK, queueSize, handle);
     } catch (std::out_of_range &error) {
         helper::logError("Queue for connection '" + connectionId +
@@ -485,7 +518,7 @@ SdkResponse CommsWrapper::deactivateChannel(RaceHandle handle, const std::string
     std::string postId = std::to_string(nextPostId++);
     helper::logDebug("Posting IRacePluginComms::deactivateChannel(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("", 0, timeout, [=] {
             if (state == SHUTDOWN) {
                 return std::make_optional(false);
             }
@@ -529,7 +562,6 @@ SdkResponse CommsWrapper::deactivateChannel(RaceHandle handle, const std::string
             }
         }
 
-        (void)future;
         return makeResponse(__func__, success == Handler::PostStatus::OK, queueSize, handle);
     } catch (std::out_of_range &error) {
         helper::logError("Default queue does not exist. This should never happen. what:" +
@@ -549,7 +581,7 @@ SdkResponse CommsWrapper::activateChannel(RaceHandle handle, const std::string &
     std::string postId = std::to_string(nextPostId++);
     helper::logDebug("Posting IRacePluginComms::activateChannel(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("", 0, timeout, [=] {
             if (state == SHUTDOWN) {
                 return std::make_optional(false);
             }
@@ -597,7 +629,6 @@ SdkResponse CommsWrapper::activateChannel(RaceHandle handle, const std::string &
             onChannelStatusChanged(handle, channelGid, CHANNEL_FAILED, defaultProperties, timeout);
         }
 
-        (void)future;
         return makeResponse(__func__, success == Handler::PostStatus::OK, queueSize, handle);
     } catch (std::out_of_range &error) {
         helper::logError("Default queue does not exist. This should never happen. what:" +
@@ -617,7 +648,7 @@ SdkResponse CommsWrapper::destroyLink(RaceHandle handle, const LinkID &linkId,
     std::string postId = std::to_string(nextPostId++);
     helper::logDebug("Posting IRacePluginComms::destroyLink(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("", 0, timeout, [=] {
             if (state == SHUTDOWN) {
                 return std::make_optional(false);
             }
@@ -661,7 +692,6 @@ SdkResponse CommsWrapper::destroyLink(RaceHandle handle, const LinkID &linkId,
             }
         }
 
-        (void)future;
         return makeResponse(__func__, success == Handler::PostStatus::OK, queueSize, handle);
     } catch (std::out_of_range &error) {
         helper::logError("Default queue does not exist. This should never happen. what:" +
@@ -681,7 +711,7 @@ SdkResponse CommsWrapper::createLink(RaceHandle handle, const std::string &chann
     std::string postId = std::to_string(nextPostId++);
     helper::logDebug("Posting IRacePluginComms::createLink(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("", 0, timeout, [=] {
             if (state == SHUTDOWN) {
                 onLinkStatusChanged(handle, generateLinkId(channelGid), LINK_DESTROYED, {}, 0);
                 return std::make_optional(false);
@@ -726,7 +756,6 @@ SdkResponse CommsWrapper::createLink(RaceHandle handle, const std::string &chann
             }
         }
 
-        (void)future;
         return makeResponse(__func__, success == Handler::PostStatus::OK, queueSize, handle);
     } catch (std::out_of_range &error) {
         helper::logError("Default queue does not exist. This should never happen. what:" +
@@ -746,7 +775,7 @@ SdkResponse CommsWrapper::createBootstrapLink(RaceHandle handle, const std::stri
     std::string postId = std::to_string(nextPostId++);
     helper::logDebug("Posting IRacePluginComms::createBootstrapLink(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("", 0, timeout, [=] {
             if (state == SHUTDOWN) {
                 onLinkStatusChanged(handle, generateLinkId(channelGid), LINK_DESTROYED, {}, 0);
                 return std::make_optional(false);
@@ -789,7 +818,6 @@ SdkResponse CommsWrapper::createBootstrapLink(RaceHandle handle, const std::stri
             }
         }
 
-        (void)future;
         return makeResponse(__func__, success == Handler::PostStatus::OK, queueSize, handle);
     } catch (std::out_of_range &error) {
         helper::logError("Default queue does not exist. This should never happen. what:" +
@@ -809,7 +837,7 @@ SdkResponse CommsWrapper::loadLinkAddress(RaceHandle handle, const std::string &
     std::string postId = std::to_string(nextPostId++);
     helper::logDebug("Calling IRacePluginComms::loadLinkAddress(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("", 0, timeout, [=] {
             if (state == SHUTDOWN) {
                 onLinkStatusChanged(handle, generateLinkId(channelGid), LINK_DESTROYED, {}, 0);
                 return std::make_optional(false);
@@ -857,7 +885,6 @@ SdkResponse CommsWrapper::loadLinkAddress(RaceHandle handle, const std::string &
             }
         }
 
-        (void)future;
         return makeResponse(__func__, success == Handler::PostStatus::OK, queueSize, handle);
     } catch (std::out_of_range &error) {
         helper::logError("Default queue does not exist. This should never happen. what:" +
@@ -877,7 +904,7 @@ SdkResponse CommsWrapper::loadLinkAddresses(RaceHandle handle, const std::string
     std::string postId = std::to_string(nextPostId++);
     helper::logDebug("Calling IRacePluginComms::loadLinkAddresses(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("", 0, timeout, [=] {
             if (state == SHUTDOWN) {
                 onLinkStatusChanged(handle, generateLinkId(channelGid), LINK_DESTROYED, {}, 0);
                 return std::make_optional(false);
@@ -925,7 +952,6 @@ SdkResponse CommsWrapper::loadLinkAddresses(RaceHandle handle, const std::string
             }
         }
 
-        (void)future;
         return makeResponse(__func__, success == Handler::PostStatus::OK, queueSize, handle);
     } catch (std::out_of_range &error) {
         helper::logError("Default queue does not exist. This should never happen. what:" +
@@ -946,7 +972,7 @@ SdkResponse CommsWrapper::createLinkFromAddress(RaceHandle handle, const std::st
     std::string postId = std::to_string(nextPostId++);
 
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("", 0, timeout, [=] {
             if (state == SHUTDOWN) {
                 onLinkStatusChanged(handle, generateLinkId(channelGid), LINK_DESTROYED, {}, 0);
                 return std::make_optional(false);
@@ -996,7 +1022,6 @@ SdkResponse CommsWrapper::createLinkFromAddress(RaceHandle handle, const std::st
             }
         }
 
-        (void)future;
         return makeResponse(__func__, success == Handler::PostStatus::OK, queueSize, handle);
     } catch (std::out_of_range &error) {
         helper::logError("Default queue does not exist. This should never happen. what:" +
@@ -1015,7 +1040,7 @@ SdkResponse CommsWrapper::serveFiles(LinkID linkId, std::string path, int32_t ti
     std::string postId = std::to_string(nextPostId++);
     helper::logDebug("Calling IRacePluginComms::serveFiles(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("", 0, timeout, [=] {
             if (state == SHUTDOWN) {
                 return std::make_optional(false);
             }
@@ -1060,7 +1085,6 @@ SdkResponse CommsWrapper::serveFiles(LinkID linkId, std::string path, int32_t ti
             }
         }
 
-        (void)future;
         return makeResponse(__func__, success == Handler::PostStatus::OK, queueSize,
                             NULL_RACE_HANDLE);
     } catch (std::out_of_range &error) {
@@ -1080,7 +1104,7 @@ SdkResponse CommsWrapper::flushChannel(RaceHandle handle, std::string channelGid
     std::string postId = std::to_string(nextPostId++);
     helper::logDebug("Calling IRacePluginComms::flushChannel(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("", 0, timeout, [=] {
             if (state == SHUTDOWN) {
                 return std::make_optional(false);
             }
@@ -1125,7 +1149,6 @@ SdkResponse CommsWrapper::flushChannel(RaceHandle handle, std::string channelGid
             }
         }
 
-        (void)future;
         return makeResponse(__func__, success == Handler::PostStatus::OK, queueSize,
                             NULL_RACE_HANDLE);
     } catch (std::out_of_range &error) {
@@ -1148,7 +1171,7 @@ std::tuple<bool, double> CommsWrapper::onUserInputReceived(RaceHandle handle, bo
     std::string postId = std::to_string(nextPostId++);
     helper::logDebug("Posting IRacePluginComms::onUserInputReceived(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("", 0, timeout, [=] {
             if (state == SHUTDOWN) {
                 return std::make_optional(false);
             }
@@ -1180,7 +1203,6 @@ std::tuple<bool, double> CommsWrapper::onUserInputReceived(RaceHandle handle, bo
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
@@ -1202,7 +1224,7 @@ std::tuple<bool, double> CommsWrapper::onUserAcknowledgementReceived(RaceHandle
     helper::logDebug("Posting IRacePluginComms::onUserAcknowledgementReceived(), postId: " +
                      postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("", 0, timeout, [=] {
             if (state == SHUTDOWN) {
                 return std::make_optional(false);
             }
@@ -1238,7 +1260,6 @@ std::tuple<bool, double> CommsWrapper::onUserAcknowledgementReceived(RaceHandle
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
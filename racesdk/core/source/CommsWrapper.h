@@ -97,6 +97,14 @@ public:
      */
     void stopHandler();
 
+    /* setNumWorkers: set the number of plugin threads
+     *
+     * Must be called before startHandler. With more than one thread, calls for different
+     * connections may run concurrently, so this should only be used for plugins that are
+     * thread-safe. Calls for the same connection still run one at a time, in order.
+     */
+    void setNumWorkers(size_t numWorkers);
+
     /* waitForCallbacks: wait for all callbacks to finish
      *
      * Creates a queue and callback with the minimum priority and waits for that to finish. Used for
@@ -142,6 +150,26 @@ public:
     SdkResponse sendPackage(RaceHandle handle, const ConnectionID &connectionId, const EncPkg &pkg,
                             int32_t timeout, uint64_t batchId);
 
+    /* PackageToSend: a package, the connection to send it on and the handle to report its status
+     * with
+     */
+    struct PackageToSend {
+        RaceHandle handle;
+        ConnectionID connectionId;
+        EncPkg pkg;
+    };
+
+    /* sendPackages: call sendPackage on the wrapped plugin for each of several packages
+     *
+     * Equivalent to calling sendPackage for each package in order, but the send timeouts of all the
+     * connections are looked up at once. Packages on the same connection are posted in the order
+     * given.
+     *
+     * @return SdkResponse for each package, in the same order as packages
+     */
+    std::vector<SdkResponse> sendPackages(const std::vector<PackageToSend> &packages,
+                                          int32_t timeout, uint64_t batchId);
+
     /* openConnection: call openConnection on the wrapped plugin
      *
      * openConnection will be called on the plugin thread. openConnection will not return
@@ -363,6 +391,13 @@ protected:
      */
     SdkResponse makeResponse(const std::string &functionName, bool success, size_t queueUtil,
                              RaceHandle handle);
+
+    /* postPackage: post a call to sendPackage on the wrapped plugin to the connection's queue
+     *
+     * Does the work of sendPackage once the send timeout of the connection has been looked up.
+     */
+    SdkResponse postPackage(RaceHandle handle, const ConnectionID &connectionId, const EncPkg &pkg,
+                            int32_t postTimeout, uint64_t batchId, double timeoutTimestamp);
 };
 
 #endif
@@ -22,14 +22,56 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "filesystem.h"
 #include "helper.h"
 
+// Decrypting is CPU bound, so files are decrypted on a worker per core, up to this many
+static const size_t MAX_DECRYPT_WORKERS = 8;
+
 FileSystemHelper::FileSystemHelper() {}
 
+/**
+ * @brief Decrypt a file into a new file, a chunk at a time. The plaintext is written to a
+ * temporary file which only replaces destPath once every chunk has been authenticated.
+ *
+ */
+static void decryptFile(const fs::path &srcPath, const fs::path &destPath,
+                        StorageEncryption &pluginStorageEncryption) {
+    const fs::path tmpPath = destPath.string() + ".tmp";
+    try {
+        // Open the file in truncate mode. This will overwrite any existing file content.
+        std::ofstream file(tmpPath.string(), std::ofstream::trunc | std::ofstream::binary);
+        if (file.fail()) {
+            throw std::runtime_error("copyAndDecryptDir::write: failed to open output file: " +
+                                     tmpPath.string());
+        }
+        pluginStorageEncryption.readStream(srcPath.string(),
+                                           [&file](const std::uint8_t *data, size_t size) {
+                                               file.write(reinterpret_cast<const char *>(data),
+                                                          static_cast<std::int64_t>(size));
+                                           });
+        file.close();
+        if (file.fail()) {
+            throw std::runtime_error("copyAndDecryptDir::write: failed to write file: " +
+                                     tmpPath.string());
+        }
+        fs::rename(tmpPath, destPath);
+    } catch (...) {
+        // std::remove rather than fs::remove, so cleaning up can not throw over the error
+        std::remove(tmpPath.string().c_str());
+        throw;
+    }
+}
+
 bool FileSystemHelper::copyAndDecryptDir(const std::string &srcPath, const std::string &destPath,
                                          StorageEncryption &pluginStorageEncryption) {
     TRACE_FUNCTION(srcPath, destPath);
@@ -48,6 +90,9 @@ bool FileSystemHelper::copyAndDecryptDir(const std::string &srcPath, const std::
             }
         }
 
+        // Directories are created and unencrypted files copied while walking the tree. Files to
+        // decrypt are collected and decrypted in parallel afterwards.
+        std::vector<std::pair<fs::path, fs::path>> filesToDecrypt;
         for (auto &iter : fs::recursive_directory_iterator(srcPath)) {
             auto relPath = iter.path().string();
             // Remove the src prefix, leaving a relative path under src/dest
@@ -94,35 +139,42 @@ bool FileSystemHelper::copyAndDecryptDir(const std::string &srcPath, const std::
                                      newPath.string());
                     fs::copy(iter.path(), newPath);
                 } else {
-                    helper::logDebug(logPrefix + "copying and decrypting " + iter.path().string() +
-                                     " to " + newPath.string());
-
-                    try {
-                        std::vector<std::uint8_t> decryptedFile =
-                            pluginStorageEncryption.read(iter.path().string());
-
-                        // Open the file in truncate mode. This will overwrite any existing file
-                        // content.
-                        std::ofstream file(newPath.string(), std::ofstream::trunc);
-                        if (file.fail()) {
-                            throw std::runtime_error(
-                                "copyAndDecryptDir::write: failed to open output file: " +
-                                newPath.string());
-                        }
-                        file.write(reinterpret_cast<const char *>(decryptedFile.data()),
-                                   static_cast<std::int64_t>(decryptedFile.size()));
-                        if (file.fail()) {
-                            throw std::runtime_error(
-                                "copyAndDecryptDir::write: failed to write file: " +
-                                newPath.string());
-                        }
-                    } catch (...) {
-                    }
+                    filesToDecrypt.emplace_back(iter.path(), newPath);
+                }
+            }
+        }
+
+        std::atomic<size_t> nextFile{0};
+        std::atomic<bool> decryptFailed{false};
+        auto decryptFiles = [&]() {
+            for (size_t i = nextFile++; i < filesToDecrypt.size(); i = nextFile++) {
+                const auto &[src, dest] = filesToDecrypt[i];
+                helper::logDebug(logPrefix + "copying and decrypting " + src.string() + " to " +
+                                 dest.string());
+                try {
+                    decryptFile(src, dest, pluginStorageEncryption);
+                } catch (const std::exception &error) {
+                    helper::logError(logPrefix + "failed to decrypt " + src.string() + ": " +
+                                     error.what());
+                    decryptFailed = true;
                 }
             }
+        };
+
+        // the calling thread decrypts files too, so one fewer worker is started
+        size_t workerCount = std::min({MAX_DECRYPT_WORKERS,
+                                       static_cast<size_t>(std::thread::hardware_concurrency()),
+                                       filesToDecrypt.size()});
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < workerCount; ++i) {
+            workers.emplace_back(decryptFiles);
+        }
+        decryptFiles();
+        for (auto &worker : workers) {
+            worker.join();
         }
 
-        return true;
+        return !decryptFailed;
     } catch (const fs::filesystem_error &error) {
         helper::logError(logPrefix + "error: " + std::string(error.what()));
         return false;
@@ -19,6 +19,9 @@
 
 #include "helper.h"
 
+// The most unused work nodes kept for reuse. Any more are freed.
+static constexpr size_t MAX_FREE_WORK = 1024;
+
 // increment the iterator to the next value. If it has reached the end of the container, reset it to
 // the beginning
 template <typename I, typename C>
@@ -37,20 +40,32 @@ Handler::Handler(const std::string &name, size_t _max_queue_size, size_t _max_to
     max_queue_size(_max_queue_size),
     max_total_size(_max_total_size),
     state(State::PRESTART),
-    timeoutQueue([](const std::shared_ptr<Work> &w1, const std::shared_ptr<Work> &w2) {
-        return w1->timeoutTimestamp < w2->timeoutTimestamp;
-    }),
+    num_workers(1),
+    next_timeout_sequence(0),
+    running_timed_out(0),
+    free_work(nullptr),
+    free_work_count(0),
     total_work(0),
     total_marked(0),
     total_size(0),
-    unblocked_work(0) {
-    create_queue("", 0);
+    unblocked_work(0),
+    next_queue_id(DEFAULT_QUEUE + 1) {
+    create_queue_internal("", 0, DEFAULT_QUEUE);
     current_priority = priority_levels.begin();
 }
 
 Handler::~Handler() {
     helper::logDebug("~Handler called");
     stop_immediate();
+
+    // stopping cancelled all the timeouts, but one may have been firing at the time
+    TimerWheel::shared().waitForCallbacks();
+
+    while (free_work != nullptr) {
+        Work *work = free_work;
+        free_work = work->next;
+        delete work;
+    }
     helper::logDebug("~Handler returned");
 }
 
@@ -65,80 +80,69 @@ void Handler::start() {
 
     state.store(State::STARTED);
 
-    work_thread = std::thread(&Handler::runWorkThread, this);
-    timeout_thread = std::thread(&Handler::runTimeoutThread, this);
+    for (size_t i = 0; i < num_workers; ++i) {
+        work_threads.emplace_back(&Handler::runWorkThread, this, i);
+    }
 }
 
-void Handler::runTimeoutThread() {
-    helper::set_thread_name(name + "-timeout-thread");
-    while (true) {
-        using TimePoint =
-            std::chrono::time_point<std::chrono::system_clock, std::chrono::duration<double>>;
-        using Duration = TimePoint::duration;
-
-        std::unique_lock<std::mutex> lock(data_mutex);
+void Handler::set_num_workers(size_t _num_workers) {
+    std::lock_guard<std::mutex> lock(data_mutex);
 
-        // check state here. It may have changed while we were waiting for the lock
-        if (state.load() != State::STARTED) {
-            break;
-        }
+    if (state.load() != State::PRESTART) {
+        throw std::logic_error("Failed to set number of workers. Handler was already started.");
+    }
+    if (_num_workers == 0) {
+        throw std::invalid_argument("Handler must have at least one worker");
+    }
 
-        // wait until the earliest timestamp (or we're woken up before that)
-        double timeoutTimestamp = std::numeric_limits<double>::infinity();
-        if (!timeoutQueue.empty()) {
-            // helper::logInfo("Handler::runTimeoutThread: waiting until: " +
-            // std::to_string((*timeoutQueue.begin())->timeoutTimestamp));
-            timeoutTimestamp = (*timeoutQueue.begin())->timeoutTimestamp;
-        }
+    num_workers = _num_workers;
+}
 
-        helper::logInfo("Handler::runTimeoutThread: waiting until: " +
-                        std::to_string(timeoutTimestamp));
-        if (timeoutTimestamp < std::numeric_limits<double>::infinity()) {
-            TimePoint nextTimestamp = TimePoint{Duration{timeoutTimestamp}};
-            timeout_thread_signaler.wait_until(lock, nextTimestamp);
-        } else {
-            // special case infinity. Waiting until infinity returns immediately, when we want it to
-            // wait until it gets a signal
-            timeout_thread_signaler.wait(lock);
-        }
+void Handler::timeout_work(std::uint64_t sequence) {
+    std::unique_lock<std::mutex> lock(data_mutex);
 
-        // check state again here. it may have changed while we were waiting
-        if (state.load() != State::STARTED) {
-            break;
-        }
+    // timeouts are only processed before and while running, so stopping lets queued work finish
+    State current_state = state.load();
+    if (current_state != State::PRESTART && current_state != State::STARTED) {
+        return;
+    }
 
-        // find work that has timed out
-        std::chrono::duration<double> now = std::chrono::system_clock::now().time_since_epoch();
+    // the work may have been removed while its timer was firing
+    auto iter = timeouts.find(sequence);
+    if (iter == timeouts.end()) {
+        return;
+    }
+    Work *work = iter->second;
+    timeouts.erase(iter);
+    work->timer = TimerWheel::INVALID_TIMER;
 
-        while (timeoutQueue.size() > 0) {
-            auto workIt = timeoutQueue.begin();
-            auto work = *workIt;
-            if (work->timeoutTimestamp > now.count()) {
-                break;
-            }
+    // work whose callback is running is removed by the work thread running it
+    if (work->queue->running && work->queue->queue.front() == work) {
+        running_timed_out++;
+    }
 
-            if (!work->runningCallback && work->timeoutCallback) {
-                helper::logDebug("Handler::runTimeoutThread: Calling timeout callback");
-                work->timeoutCallback();
-            }
+    // the work may be removed as soon as the lock is released, so take its timeout callback
+    std::function<void()> timeoutCallback;
+    if (!work->runningCallback) {
+        timeoutCallback = std::move(work->timeoutCallback);
+    }
 
-            // move work from timeoutQueue to timedOutQueue
-            work->timedOutIter = timedOutQueue.insert(timedOutQueue.end(), work);
-            timeoutQueue.erase(workIt);
-            work->timeoutIter = timeoutQueue.end();
-            helper::logDebug("Handler::runTimeoutThread: Moving work to timed out queue");
-        }
+    // move work to timedOutQueue and have the work thread remove it
+    work->timedOut = true;
+    timedOutQueue.push_back(work);
+    helper::logDebug("Handler::timeout_work: Moving work to timed out queue");
+    work_thread_signaler.notify_one();
 
-        // notify the work thread if there's something for it to do
-        if (!timedOutQueue.empty()) {
-            helper::logDebug("Handler::runTimeoutThread: Notifying work queue");
-            work_thread_signaler.notify_one();
-        }
+    // don't hold the lock during the timeout callback, as it may post to this handler
+    lock.unlock();
+    if (timeoutCallback) {
+        helper::logDebug("Handler::timeout_work: Calling timeout callback");
+        timeoutCallback();
     }
 }
 
-void Handler::runWorkThread() {
-    helper::set_thread_name(name);
+void Handler::runWorkThread(size_t index) {
+    helper::set_thread_name(index == 0 ? name : name + "-" + std::to_string(index));
     while (true) {
         std::unique_lock<std::mutex> lock(data_mutex);
 
@@ -152,10 +156,7 @@ void Handler::runWorkThread() {
         //
         // Each iteration of the while loop will perform one of these, and then check again for
         // any other work
-        work_thread_signaler.wait(lock, [this] {
-            return unblock_list.size() > 0 || state.load() != State::STARTED || total_marked > 0 ||
-                   unblocked_work > 0 || timedOutQueue.size() > 0;
-        });
+        work_thread_signaler.wait(lock, [this] { return has_work_internal(); });
 
         // unblock any queues. This must happen before the check to stop, since this may cause
         // new work to become available.
@@ -167,49 +168,94 @@ void Handler::runWorkThread() {
         // check if we should stop
         if (state.load() == State::STOPPED ||
             (state.load() == State::STOPPING && unblocked_work == 0)) {
-            // if we are stopping, we don't care about any blocked or marked queues
+            // if we are stopping, we don't care about any blocked or marked queues. Work in queues
+            // that are running is finished by the work threads running them.
             break;
         }
 
-        // remove timed out work
-        if (timedOutQueue.size() > 0) {
-            while (timedOutQueue.size() > 0) {
-                helper::logDebug("Handler::runWorkThread: removing timed out work");
-                remove_work_internal(timedOutQueue.front());
+        // remove timed out work, except work whose callback another work thread is running
+        if (timedOutQueue.size() > running_timed_out) {
+            Work *work = timedOutQueue.front();
+            while (work != nullptr) {
+                Work *next = work->timedOutNext;
+                if (!work->queue->running || work->queue->queue.front() != work) {
+                    helper::logDebug("Handler::runWorkThread: removing timed out work");
+                    remove_work_internal(work);
+                }
+                work = next;
             }
             continue;
         }
 
-        QueueIter &queue = get_next_queue_with_work();
+        QueueIter &next_queue = get_next_queue_with_work();
 
         // got the queue to update, either get work from it, or remove it as necessary
-        if (!queue->queue.empty()) {
+        if (!next_queue->queue.empty()) {
+            // advance to the next queue for fairness. This is done before running the callback so
+            // other work threads don't take work from the same queue.
+            QueueIter queue = next_queue;
+            next_queue = next_cycle(next_queue, queue->priority_level.work_queues);
+
             // get the work, and decrement the work counts and sizes
             Work &work = *queue->queue.front();
             work.runningCallback = true;
+            start_running_internal(queue);
 
             // don't hold lock during work callback()
             lock.unlock();
             bool success = work.callback();
             lock.lock();
 
+            stop_running_internal(queue);
+            if (work.timedOut) {
+                // it's in timedOutQueue, and is removed with the rest of the timed out work
+                running_timed_out--;
+            }
+
             if (success) {
                 pop_queue_internal(queue);
+            } else if (queue->unblock_requested) {
+                // the queue was unblocked while the callback was running, so try again
+                queue->unblock_requested = false;
             } else {
                 // item is blocked. Don't pop, since we want it to be there when we're unblocked
                 block_queue_internal(queue);
             }
 
-            // advance to the next queue for fairness
-            queue = next_cycle(queue, queue->priority_level.work_queues);
-        } else if (queue->marked) {
-            remove_queue_internal(queue);
+            // other work threads may be waiting for this queue or its priority level
+            if (num_workers > 1) {
+                work_thread_signaler.notify_all();
+            }
+        } else if (next_queue->marked) {
+            remove_queue_internal(next_queue);
         } else {
             helper::logError("Handler::run invalid state");
         }
     }
 }
 
+bool Handler::has_work_internal() {
+    State current_state = state.load();
+    if (!unblock_list.empty() || current_state == State::STOPPED ||
+        (current_state == State::STOPPING && unblocked_work == 0) ||
+        timedOutQueue.size() > running_timed_out) {
+        return true;
+    }
+
+    // work is only taken from the highest priority with work, and not from a priority lower than
+    // that of a running callback
+    for (auto &priority_level : priority_levels) {
+        PriorityLevel &level = priority_level.second;
+        if (level.unblocked_work_count > 0 || level.marked_count > 0) {
+            return true;
+        }
+        if (level.running_count > 0) {
+            return false;
+        }
+    }
+    return false;
+}
+
 void Handler::stop() {
     State prev_state;
     {
@@ -224,8 +270,7 @@ void Handler::stop() {
     // don't block other threads from posting while we are waiting for callbacks
     if (prev_state == State::STARTED) {
         // wait for thread to stop
-        join_work_thread();
-        join_timeout_thread();
+        join_work_threads();
 
         // sanity check
         std::lock_guard<std::mutex> lock(data_mutex);
@@ -251,15 +296,14 @@ void Handler::stop_immediate() {
         prev_state = state.exchange(State::STOPPED);
     }
     if (prev_state == State::STARTED) {
-        join_work_thread();
-        join_timeout_thread();
+        join_work_threads();
     }
 
     std::lock_guard<std::mutex> lock(data_mutex);
     clear();
 }
 
-void Handler::create_queue(const std::string &queue_name, int priority) {
+Handler::QueueId Handler::create_queue(const std::string &queue_name, int priority) {
     std::unique_lock<std::mutex> data_lock(data_mutex);
 
     // check if we already have a queue with this name
@@ -267,15 +311,43 @@ void Handler::create_queue(const std::string &queue_name, int priority) {
         throw std::invalid_argument("Already have a queue named: " + queue_name);
     }
 
+    QueueId id = next_queue_id++;
+    create_queue_internal(queue_name, priority, id);
+    return id;
+}
+
+void Handler::create_queue_internal(const std::string &queue_name, int priority, QueueId id) {
     // get or create the priority
     PriorityIter priorityIter = priority_levels.emplace(priority, PriorityLevel(priority)).first;
 
     // create the queue
     QueueIter queueIter = priorityIter->second.work_queues.emplace(
-        priorityIter->second.work_queues.end(), queue_name, priorityIter->second);
+        priorityIter->second.work_queues.end(), queue_name, id, priorityIter->second);
 
-    // create the name mapping
+    // create the name and id mappings
     queue_map.emplace(queue_name, queueIter);
+    queue_ids.emplace(id, queueIter);
+}
+
+Handler::QueueId Handler::get_queue_id(const std::string &queue_name) {
+    std::lock_guard<std::mutex> lock(data_mutex);
+    return find_queue(queue_name)->id;
+}
+
+Handler::QueueIter Handler::find_queue(const std::string &queue_name) {
+    auto iter = queue_map.find(queue_name);
+    if (iter == queue_map.end()) {
+        throw std::out_of_range("No queue named: " + queue_name + " exists");
+    }
+    return iter->second;
+}
+
+Handler::QueueIter Handler::find_queue(QueueId queue) {
+    auto iter = queue_ids.find(queue);
+    if (iter == queue_ids.end()) {
+        throw std::out_of_range("No queue with id: " + std::to_string(queue) + " exists");
+    }
+    return iter->second;
 }
 
 void Handler::remove_queue(const std::string &queue_name) {
@@ -296,22 +368,14 @@ void Handler::remove_queue(const std::string &queue_name) {
     QueueIter queue = iter->second;
     queue->marked = true;
 
-    // we can only do more if the queue isn't blocked
-    if (queue->blocked == false) {
+    // we can only do more if the queue isn't blocked or running
+    if (queue->blocked == false && queue->running == false) {
         // increment the marked counters
         queue->priority_level.marked_count++;
         total_marked++;
 
         // update max priority if necessary
-        if (queue->priority_level.priority > current_priority->first) {
-            current_priority = priority_levels.find(queue->priority_level.priority);
-            if (current_priority == priority_levels.end()) {
-                // we have an entry in the queue map, but the entry in the priority map doesn't
-                // exist. This shouldn't be possible
-                throw std::logic_error(
-                    "Failed to find entry in priority map. This should never happen");
-            }
-        }
+        raise_current_priority(queue->priority_level.priority);
 
         // There's a new marked queue, so tell the work thread to wake if if it's not awake already
         work_thread_signaler.notify_one();
@@ -345,11 +409,13 @@ int Handler::get_num_queues() {
     return num_queues;
 }
 
-void Handler::join_work_thread() {
+void Handler::join_work_threads() {
     work_thread_signaler.notify_all();
     std::promise<void> timeoutPromise;
     std::thread([&]() {
-        work_thread.join();
+        for (auto &work_thread : work_threads) {
+            work_thread.join();
+        }
         timeoutPromise.set_value();
     }).detach();
     // Wait for the threads to join. If they don't join within the timeout then assume they are
@@ -359,37 +425,34 @@ void Handler::join_work_thread() {
         timeoutPromise.get_future().wait_for(std::chrono::seconds(secondsToWaitForThreadsToJoin));
     if (status != std::future_status::ready) {
         helper::logError(
-            "FATAL: Handler::join_work_thread: timed out waiting for worker thread to join. "
+            "FATAL: Handler::join_work_threads: timed out waiting for worker threads to join. "
             "Terminating.");
         std::terminate();
     }
 }
 
-void Handler::join_timeout_thread() {
-    timeout_thread_signaler.notify_all();
-    std::promise<void> timeoutPromise;
-    std::thread([&]() {
-        timeout_thread.join();
-        timeoutPromise.set_value();
-    }).detach();
-    // Wait for the threads to join. If they don't join within the timeout then assume they are
-    // hanging, log an error, and bail.
-    const std::int32_t secondsToWaitForThreadsToJoin = 5;
-    auto status =
-        timeoutPromise.get_future().wait_for(std::chrono::seconds(secondsToWaitForThreadsToJoin));
-    if (status != std::future_status::ready) {
-        helper::logError(
-            "FATAL: Handler::join_timeout_thread: timed out waiting for timeout thread to join. "
-            "Terminating.");
-        std::terminate();
+void Handler::clear() {
+    // return all the work to the pool. This destroys the callbacks, so the futures of work that
+    // was never run are set to ready with std::future_error
+    for (auto &priority_level : priority_levels) {
+        for (auto &queue : priority_level.second.work_queues) {
+            while (!queue.queue.empty()) {
+                Work *work = queue.queue.front();
+                queue.queue.erase(work);
+                if (work->timer != TimerWheel::INVALID_TIMER) {
+                    cancel_timeout(work);
+                }
+                release_work(work);
+            }
+        }
     }
-}
 
-void Handler::clear() {
     priority_levels.clear();
+    queueIters.clear();
     queue_map.clear();
-    timeoutQueue.clear();
-    timedOutQueue.clear();
+    queue_ids.clear();
+    timedOutQueue = TimedOutWork();
+    running_timed_out = 0;
     unblocked_work = 0;
     total_work = 0;
     total_marked = 0;
@@ -397,10 +460,8 @@ void Handler::clear() {
 
     // create default work queue, as it's assumed to always exist
     // can't use create as that tries to lock
-    current_priority = priority_levels.emplace(0, PriorityLevel(0)).first;
-    QueueIter queue = current_priority->second.work_queues.emplace(
-        current_priority->second.work_queues.end(), "", current_priority->second);
-    queue_map.emplace("", queue);
+    create_queue_internal("", 0, DEFAULT_QUEUE);
+    current_priority = priority_levels.begin();
 }
 
 void Handler::unblock_queue_internal(const std::string &queue_name) {
@@ -409,8 +470,15 @@ void Handler::unblock_queue_internal(const std::string &queue_name) {
         return;
     }
 
-    // clear the blocked flag
+    // the queue can't be blocked while its callback is running, but the callback may be about to
+    // block it. Have the work thread running it retry instead.
     QueueIter queue = iter->second;
+    if (queue->running) {
+        queue->unblock_requested = true;
+        return;
+    }
+
+    // clear the blocked flag
     if (queue->blocked == true) {
         queue->blocked = false;
 
@@ -427,15 +495,7 @@ void Handler::unblock_queue_internal(const std::string &queue_name) {
         }
 
         // update max priority if necessary
-        if (queue->priority_level.priority > current_priority->first) {
-            current_priority = priority_levels.find(queue->priority_level.priority);
-            if (current_priority == priority_levels.end()) {
-                // we have an entry in the queue map, but the entry in the priority map doesn't
-                // exist. This shouldn't be possible
-                throw std::logic_error(
-                    "Failed to find entry in priority map. This should never happen");
-            }
-        }
+        raise_current_priority(queue->priority_level.priority);
     }
 }
 
@@ -459,8 +519,8 @@ Handler::QueueIter &Handler::get_next_queue_with_work() {
         queueIters.emplace(current_priority->first, current_priority->second.work_queues.begin())
             .first->second;
 
-    // find next queue that is not blocked and has work or is marked and deal with it.
-    while (queue->blocked || !(queue->marked || !queue->queue.empty())) {
+    // find next queue that is not blocked or running and has work or is marked and deal with it.
+    while (queue->blocked || queue->running || !(queue->marked || !queue->queue.empty())) {
         queue = next_cycle(queue, current_priority->second.work_queues);
     }
 
@@ -468,46 +528,31 @@ Handler::QueueIter &Handler::get_next_queue_with_work() {
 }
 
 void Handler::pop_queue_internal(Handler::QueueIter &queue) {
-    std::shared_ptr<Work> work = queue->queue.front();
-    queue->queue.pop_front();
-
-    if (work->timeoutIter != timeoutQueue.end()) {
-        timeoutQueue.erase(work->timeoutIter);
-    }
-
-    if (work->timedOutIter != timedOutQueue.end()) {
-        timedOutQueue.erase(work->timedOutIter);
-    }
-
-    // update counts
-    queue->size -= work->size;
-    queue->priority_level.unblocked_work_count--;
-    total_size -= work->size;
-    total_work--;
-    unblocked_work--;
-
-    post_signaler.notify_all();
+    remove_work_internal(queue->queue.front());
 }
 
-void Handler::remove_work_internal(std::shared_ptr<Work> work) {
-    Handler::QueueIter &queue = work->queueIter;
-    queue->queue.erase(work->workIter);
+void Handler::remove_work_internal(Work *work) {
+    WorkQueue &queue = *work->queue;
+    queue.queue.erase(work);
 
-    if (work->timeoutIter != timeoutQueue.end()) {
-        timeoutQueue.erase(work->timeoutIter);
+    if (work->timer != TimerWheel::INVALID_TIMER) {
+        cancel_timeout(work);
     }
 
-    if (work->timedOutIter != timedOutQueue.end()) {
-        timedOutQueue.erase(work->timedOutIter);
+    if (work->timedOut) {
+        timedOutQueue.erase(work);
     }
 
-    // update counts
-    queue->size -= work->size;
-    queue->priority_level.unblocked_work_count--;
+    // update counts. The work of blocked and running queues isn't counted as unblocked.
+    queue.size -= work->size;
     total_size -= work->size;
     total_work--;
-    unblocked_work--;
+    if (!queue.blocked && !queue.running) {
+        queue.priority_level.unblocked_work_count--;
+        unblocked_work--;
+    }
 
+    release_work(work);
     post_signaler.notify_all();
 }
 
@@ -526,9 +571,51 @@ void Handler::block_queue_internal(Handler::QueueIter &queue) {
     }
 }
 
+void Handler::start_running_internal(Handler::QueueIter &queue) {
+    queue->running = true;
+    queue->unblock_requested = false;
+    queue->priority_level.running_count++;
+
+    // update counts, the same as blocking the queue
+    queue->priority_level.unblocked_work_count -= queue->queue.size();
+    unblocked_work -= queue->queue.size();
+    if (queue->marked == true) {
+        queue->priority_level.marked_count--;
+        total_marked--;
+    }
+}
+
+void Handler::stop_running_internal(Handler::QueueIter &queue) {
+    queue->running = false;
+    queue->priority_level.running_count--;
+
+    // update counts, the same as unblocking the queue
+    queue->priority_level.unblocked_work_count += queue->queue.size();
+    unblocked_work += queue->queue.size();
+    if (queue->marked == true) {
+        queue->priority_level.marked_count++;
+        total_marked++;
+    }
+
+    raise_current_priority(queue->priority_level.priority);
+}
+
+void Handler::raise_current_priority(int priority) {
+    if (priority > current_priority->first) {
+        current_priority = priority_levels.find(priority);
+        if (current_priority == priority_levels.end()) {
+            // we have an entry in the queue map, but the entry in the priority map doesn't
+            // exist. This shouldn't be possible
+            throw std::logic_error(
+                "Failed to find entry in priority map. This should never happen");
+        }
+    }
+}
+
 void Handler::remove_queue_internal(Handler::QueueIter &queue) {
-    // remove from the map to prevent anything new from being added to the queue
+    // remove from the maps to prevent anything new from being added to the queue
     queue_map.erase(queue->name);
+    queue_ids.erase(queue->id);
 
     // remove this queue from the list of queues and advance the iterator to the next queue
     QueueIter next_queue = next_cycle(queue, current_priority->second.work_queues);
@@ -559,6 +646,52 @@ void Handler::remove_queue_internal(Handler::QueueIter &queue) {
     }
 }
 
+Handler::Work *Handler::acquire_work() {
+    if (free_work == nullptr) {
+        return new Work();
+    }
+
+    Work *work = free_work;
+    free_work = work->next;
+    work->next = nullptr;
+    free_work_count--;
+    return work;
+}
+
+void Handler::release_work(Work *work) {
+    work->callback.reset();
+    work->timeoutCallback = nullptr;
+    work->queue = nullptr;
+    work->prev = nullptr;
+    work->timedOutPrev = nullptr;
+    work->timedOutNext = nullptr;
+    work->timedOut = false;
+    work->runningCallback = false;
+
+    if (free_work_count >= MAX_FREE_WORK) {
+        delete work;
+        return;
+    }
+
+    work->next = free_work;
+    free_work = work;
+    free_work_count++;
+}
+
+void Handler::schedule_timeout(Work *work) {
+    std::uint64_t sequence = next_timeout_sequence++;
+    work->timeoutSequence = sequence;
+    work->timer = TimerWheel::shared().schedule(work->timeoutTimestamp,
+                                                [this, sequence] { timeout_work(sequence); });
+    timeouts.emplace(sequence, work);
+}
+
+void Handler::cancel_timeout(Work *work) {
+    TimerWheel::shared().cancel(work->timer);
+    timeouts.erase(work->timeoutSequence);
+    work->timer = TimerWheel::INVALID_TIMER;
+}
+
 std::string handlerPostStatusToString(Handler::PostStatus status) {
     switch (status) {
         case Handler::PostStatus::OK:
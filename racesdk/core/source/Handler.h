@@ -19,22 +19,38 @@
 #define __HANDLER_H__
 
 #include <IRaceSdkCommon.h>
+#include <TimerWheel.h>
 
+#include <atomic>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <future>
+#include <limits>
 #include <list>
 #include <map>
 #include <memory>
-#include <set>
+#include <mutex>
+#include <new>
+#include <optional>
 #include <thread>
+#include <type_traits>
 #include <unordered_map>
+#include <vector>
 
 class Handler {
 public:
     enum class State { INVALID, PRESTART, STARTED, STOPPING, STOPPED };
     enum PostStatus { OK, INVALID_STATE, QUEUE_FULL, HANDLER_FULL };
 
+    // Identifies a queue without having to look it up by name. Ids are never reused, so the id of a
+    // removed queue stays invalid even if a queue with the same name is created again.
+    using QueueId = std::uint64_t;
+
+    // The id of the default queue, named "", which always exists
+    static constexpr QueueId DEFAULT_QUEUE = 0;
+
     const std::string name;
     const size_t max_queue_size;
     const size_t max_total_size;
@@ -46,36 +62,154 @@ private:
 
     using QueueIter = std::list<WorkQueue>::iterator;
     using PriorityIter = std::map<int, PriorityLevel, std::greater<int>>::iterator;
-    using TimeoutIter = std::multiset<std::shared_ptr<Work>,
-                                      std::function<bool(const std::shared_ptr<Work> &,
-                                                         const std::shared_ptr<Work> &)>>::iterator;
-    using TimedOutIter = std::list<std::shared_ptr<Work>>::iterator;
-    using WorkQueueIter = std::list<std::shared_ptr<Work>>::iterator;
 
+    // A type erased, move-only callable returning bool. Callables that fit are stored inline so
+    // posting doesn't need a separate allocation for the callback.
+    class Callback {
+    public:
+        static constexpr size_t INLINE_SIZE = 128;
+
+        Callback() = default;
+        Callback(const Callback &) = delete;
+        Callback &operator=(const Callback &) = delete;
+        ~Callback() {
+            reset();
+        }
+
+        template <typename F>
+        void emplace(F &&func) {
+            using Fn = typename std::decay<F>::type;
+            reset();
+            if constexpr (sizeof(Fn) <= INLINE_SIZE && alignof(Fn) <= alignof(std::max_align_t)) {
+                new (storage) Fn(std::forward<F>(func));
+                ops = &InlineOps<Fn>::ops;
+            } else {
+                *reinterpret_cast<Fn **>(storage) = new Fn(std::forward<F>(func));
+                ops = &HeapOps<Fn>::ops;
+            }
+        }
+
+        bool operator()() {
+            return ops->invoke(storage);
+        }
+
+        void reset() {
+            if (ops != nullptr) {
+                const Ops *current = ops;
+                ops = nullptr;
+                current->destroy(storage);
+            }
+        }
+
+    private:
+        struct Ops {
+            bool (*invoke)(void *);
+            void (*destroy)(void *);
+        };
+
+        template <typename Fn>
+        struct InlineOps {
+            static bool invoke(void *func) {
+                return (*static_cast<Fn *>(func))();
+            }
+            static void destroy(void *func) {
+                static_cast<Fn *>(func)->~Fn();
+            }
+            static constexpr Ops ops{&invoke, &destroy};
+        };
+
+        template <typename Fn>
+        struct HeapOps {
+            static bool invoke(void *func) {
+                return (**static_cast<Fn **>(func))();
+            }
+            static void destroy(void *func) {
+                delete *static_cast<Fn **>(func);
+            }
+            static constexpr Ops ops{&invoke, &destroy};
+        };
+
+        alignas(std::max_align_t) unsigned char storage[INLINE_SIZE];
+        const Ops *ops = nullptr;
+    };
+
+    // Work nodes are pooled and reused, and are linked into their work queue and the timed out list
+    // directly so that queueing work doesn't allocate.
     struct Work {
-        std::function<bool()> callback;
+        Callback callback;
         std::function<void()> timeoutCallback;
-        size_t size;
-        double timeoutTimestamp;
-        QueueIter queueIter;     // the queue that contains this work
-        WorkQueueIter workIter;  // the iterator to this work in the work queue
-        TimeoutIter timeoutIter;
-        TimedOutIter timedOutIter;
-        bool runningCallback;
-
-        template <typename T, typename T2>
-        Work(T &&_callback, T2 _timeoutCallback, size_t _size, double _timeoutTimestamp) :
-            callback(std::forward<T>(_callback)),
-            timeoutCallback(_timeoutCallback),
-            size(_size),
-            timeoutTimestamp(_timeoutTimestamp),
-            runningCallback(false) {}
-        Work() : size(0), timeoutTimestamp(0), runningCallback(false) {}
+        size_t size = 0;
+        double timeoutTimestamp = 0;
+        WorkQueue *queue = nullptr;  // the queue that contains this work
+
+        // links in the work queue
+        Work *prev = nullptr;
+        Work *next = nullptr;
+
+        // links in the timed out list
+        Work *timedOutPrev = nullptr;
+        Work *timedOutNext = nullptr;
+        bool timedOut = false;
+
+        // the timer that times out this work, or INVALID_TIMER if it never times out or already
+        // has. timeoutSequence is its key in the pending timeouts map.
+        TimerWheel::TimerId timer = TimerWheel::INVALID_TIMER;
+        std::uint64_t timeoutSequence = 0;
+        bool runningCallback = false;
     };
 
+    // An intrusive doubly linked list of work using the given links
+    template <Work *Work::*Prev, Work *Work::*Next>
+    struct WorkList {
+        Work *head = nullptr;
+        Work *tail = nullptr;
+        size_t count = 0;
+
+        bool empty() const {
+            return count == 0;
+        }
+        size_t size() const {
+            return count;
+        }
+        Work *front() const {
+            return head;
+        }
+
+        void push_back(Work *work) {
+            work->*Prev = tail;
+            work->*Next = nullptr;
+            if (tail != nullptr) {
+                tail->*Next = work;
+            } else {
+                head = work;
+            }
+            tail = work;
+            count++;
+        }
+
+        void erase(Work *work) {
+            if (work->*Prev != nullptr) {
+                (work->*Prev)->*Next = work->*Next;
+            } else {
+                head = work->*Next;
+            }
+            if (work->*Next != nullptr) {
+                (work->*Next)->*Prev = work->*Prev;
+            } else {
+                tail = work->*Prev;
+            }
+            work->*Prev = nullptr;
+            work->*Next = nullptr;
+            count--;
+        }
+    };
+
+    using QueuedWork = WorkList<&Work::prev, &Work::next>;
+    using TimedOutWork = WorkList<&Work::timedOutPrev, &Work::timedOutNext>;
+
     struct WorkQueue {
         // The work in this queue
-        std::list<std::shared_ptr<Work>> queue;
+        QueuedWork queue;
 
         // The priority level this queue is part of
         PriorityLevel &priority_level;
@@ -83,6 +217,9 @@ private:
         // The name of the queue
         std::string name;
 
+        // The id of the queue
+        QueueId id;
+
         // the sum of the sizes of all the work in this queue
         size_t size;
 
@@ -92,8 +229,23 @@ private:
         // whether this queue is blocked and can't make progress
         bool blocked;
 
-        WorkQueue(const std::string &_name, PriorityLevel &_priority_level) :
-            priority_level(_priority_level), name(_name), size(0), marked(false), blocked(false) {}
+        // whether a work thread is running the callback of the work at the front of this queue.
+        // Only one callback from a queue runs at a time, so other work threads skip running queues.
+        bool running;
+
+        // whether the queue was unblocked while running. If the running callback blocks the queue,
+        // it's retried instead.
+        bool unblock_requested;
+
+        WorkQueue(const std::string &_name, QueueId _id, PriorityLevel &_priority_level) :
+            priority_level(_priority_level),
+            name(_name),
+            id(_id),
+            size(0),
+            marked(false),
+            blocked(false),
+            running(false),
+            unblock_requested(false) {}
     };
 
     struct PriorityLevel {
@@ -109,24 +261,27 @@ private:
         // The total number of marked queue in this priority level
         size_t marked_count;
 
+        // The number of queues in this priority level that are running a callback
+        size_t running_count;
+
         explicit PriorityLevel(int _priority) :
-            priority(_priority), unblocked_work_count(0), marked_count(0) {}
+            priority(_priority), unblocked_work_count(0), marked_count(0), running_count(0) {}
     };
 
     // Locking this prevents any other thread from simultaneously modifying any of the member
     // variables Locking this does not mean anything can be done to the variables however. Notably,
-    // the work thread maintains iterators to queues and priorities, so even if the mutex is locked
+    // the work threads maintain iterators to queues and priorities, so even if the mutex is locked
     // no operation that invalidates iterators should be called on those containers.
     std::mutex data_mutex;
 
-    // informs the timeout thread that there's work to be done.
-    std::condition_variable timeout_thread_signaler;
-
-    // informs the work thread that there's work to be done.
+    // informs the work threads that there's work to be done.
     std::condition_variable work_thread_signaler;
     std::atomic<State> state;
-    std::thread work_thread;
-    std::thread timeout_thread;
+    std::vector<std::thread> work_threads;
+
+    // the number of work threads to start. Work from different queues runs in parallel, but work
+    // from the same queue still runs one at a time in FIFO order.
+    size_t num_workers;
 
     // used to inform waiting posts that there may be more space available. This was changed from
     // being per queue because a post waiting on total work to decrease may be unblocked by a
@@ -151,28 +306,43 @@ private:
     // queues to be unblocked by the work thread.
     std::vector<std::string> unblock_list;
 
-    // The work, in timeout order
-    std::multiset<std::shared_ptr<Work>,
-                  std::function<bool(const std::shared_ptr<Work> &, const std::shared_ptr<Work> &)>>
-        timeoutQueue;
+    // Work that can time out and hasn't yet, by the key its timer was scheduled with. Timeouts run
+    // on the shared TimerWheel thread, so timers refer to work by key rather than by pointer in
+    // case the work is removed while its timer is firing.
+    std::unordered_map<std::uint64_t, Work *> timeouts;
+    std::uint64_t next_timeout_sequence;
 
     // work that has timed out, but not yet been removed from its work queue
-    std::list<std::shared_ptr<Work>> timedOutQueue;
+    TimedOutWork timedOutQueue;
+
+    // the number of work items in timedOutQueue whose callback is running. These are removed by
+    // the work thread running them once the callback returns.
+    size_t running_timed_out;
+
+    // Work nodes that are not in use, linked through Work::next
+    Work *free_work;
+    size_t free_work_count;
 
     // various counts, prevents having to iterate over all the queues to tell if there's work to do
     // the amount of work in all queues, including blocked queues
     int total_work;
-    // the number of queues marked for removal, NOT including blocked queues that are marked for
-    // removal
+    // the number of queues marked for removal, NOT including blocked or running queues that are
+    // marked for removal
     int total_marked;
     // the sum of the size of all work in all queues, including blocked queues
     size_t total_size;
-    // the amount of work in all queues, not including blocked queues
+    // the amount of work in all queues, not including blocked or running queues
     size_t unblocked_work;
 
     // Map queue name to queue
     std::unordered_map<std::string, QueueIter> queue_map;
 
+    // Map queue id to queue
+    std::unordered_map<QueueId, QueueIter> queue_ids;
+
+    // The id to give the next queue created
+    QueueId next_queue_id;
+
 public:
     /* Handler: Construct a Handler that manages a thread of execution
      *
@@ -186,6 +356,22 @@ public:
     Handler(const std::string &name, size_t _max_queue_size, size_t _max_total_size);
     ~Handler();
 
+    /* set_num_workers: Set the number of threads that run callbacks
+     *
+     * By default a handler runs all callbacks on a single thread. With more than one worker, work
+     * from different queues may run in parallel, so this should only be used if the callbacks are
+     * thread-safe. Work posted to the same queue still runs one callback at a time, in the order
+     * it was posted. Work from a lower priority queue is not started while a callback from a higher
+     * priority queue is running, so work posted to the lowest priority queue still runs after all
+     * callbacks that were started before it.
+     *
+     * exceptions: throws std::logic_error if the handler has already been started, and
+     * std::invalid_argument if num_workers is 0.
+     *
+     * param num_workers: the number of work threads to start
+     */
+    void set_num_workers(size_t num_workers);
+
     /* post: Post a callback to be run on the handler thread
      *
      * If post is called before the handler has been started, post will return as normal but the
@@ -207,12 +393,46 @@ public:
      * and retrieving the return value.
      */
     template <typename T>
-    auto post(std::string queue_name, size_t postedWorkSize, int timeout, T &&callback,
+    auto post(const std::string &queue_name, size_t postedWorkSize, int timeout, T &&callback,
+              double timeoutTimestamp = std::numeric_limits<double>::infinity(),
+              std::function<void()> timeoutCallback = {})
+        -> std::tuple<Handler::PostStatus, size_t,
+                      std::future<typename std::remove_reference<decltype(*callback())>::type>>;
+
+    /* post: Same as above, but posts to the queue with the given id
+     *
+     * exceptions: throws std::out_of_range if a queue with the specified id does not exist.
+     *
+     * param queue: The id of the queue to post to, as returned by create_queue() or get_queue_id()
+     */
+    template <typename T>
+    auto post(QueueId queue, size_t postedWorkSize, int timeout, T &&callback,
               double timeoutTimestamp = std::numeric_limits<double>::infinity(),
               std::function<void()> timeoutCallback = {})
         -> std::tuple<Handler::PostStatus, size_t,
                       std::future<typename std::remove_reference<decltype(*callback())>::type>>;
 
+    /* post_detached: Post a callback to be run on the handler thread without a future
+     *
+     * Behaves the same as post(), but no future is created for the result of the callback. This
+     * avoids allocating the future's shared state, so it should be used by callers that don't wait
+     * on the callback.
+     *
+     * return: a tuple containing whether the work was successfully implaced and the size of the
+     * queue that is was implaced on.
+     */
+    template <typename T>
+    std::tuple<Handler::PostStatus, size_t> post_detached(
+        const std::string &queue_name, size_t postedWorkSize, int timeout, T &&callback,
+        double timeoutTimestamp = std::numeric_limits<double>::infinity(),
+        std::function<void()> timeoutCallback = {});
+
+    template <typename T>
+    std::tuple<Handler::PostStatus, size_t> post_detached(
+        QueueId queue, size_t postedWorkSize, int timeout, T &&callback,
+        double timeoutTimestamp = std::numeric_limits<double>::infinity(),
+        std::function<void()> timeoutCallback = {});
+
     /* start: Start the internal Handler thread
      *
      * start() may only be called once on a given handler. If start() is called after
@@ -257,8 +477,18 @@ public:
      * exceptions: throws std::invalid_argument if a queue with the specified name already exists.
      *
      * param queue_name: The name of the queue to be created
+     * return: the id of the new queue, which may be used to post to it without a lookup by name
      */
-    void create_queue(const std::string &queue_name, int priority);
+    QueueId create_queue(const std::string &queue_name, int priority);
+
+    /* get_queue_id: Get the id of a queue
+     *
+     * exceptions: throws std::out_of_range if a queue with the specified name does not exist.
+     *
+     * param queue_name: The name of the queue
+     * return: the id of the queue
+     */
+    QueueId get_queue_id(const std::string &queue_name);
 
     /* remove_queue: mark a queue for removal.
      *
@@ -308,27 +538,30 @@ protected:
      * Stops if the state is stopping and there's no more work, or stops immediately if the state is
      * set to stopped.
      *
+     * @param index The index of the work thread, used to name it
      */
-    void runWorkThread();
+    void runWorkThread(size_t index);
 
     /**
-     * @brief The timeout thread. Waits for queued work to timeout, and notifies the work thread if
-     * it has.
+     * @brief Called on the TimerWheel thread when work times out. Hands the work to the work thread
+     * to be removed, then calls its timeout callback without holding the lock.
      *
+     * @param sequence The key of the work in the pending timeouts map
      */
-    void runTimeoutThread();
+    void timeout_work(std::uint64_t sequence);
 
     /**
-     * @brief Join the work thread, or timeout if it takes too long.
+     * @brief Join the work threads, or timeout if they take too long.
      *
      */
-    void join_work_thread();
+    void join_work_threads();
 
     /**
-     * @brief Join the timeout thread
+     * @brief Check whether a work thread has anything to do. Must be called with data_mutex held.
      *
+     * @return true if there's work a work thread can do now
      */
-    void join_timeout_thread();
+    bool has_work_internal();
 
     /**
      * @brief Clear the handler. remove all work and all queues except for the default queue. This
@@ -381,7 +614,7 @@ protected:
      *
      * @param: work The work to remove
      */
-    void remove_work_internal(std::shared_ptr<Work> work);
+    void remove_work_internal(Work *work);
 
     /**
      * @brief block a queue
@@ -389,47 +622,148 @@ protected:
      * @param: queue The queue to block
      */
     void block_queue_internal(QueueIter &queue);
-};
 
-template <typename T>
-auto Handler::post(std::string queue_name, size_t postedWorkSize, int timeout, T &&callback,
-                   double timeoutTimestamp, std::function<void()> timeoutCallback)
-    -> std::tuple<Handler::PostStatus, size_t,
-                  std::future<typename std::remove_reference<decltype(*callback())>::type>> {
-    using Ret = typename std::remove_reference<decltype(*callback())>::type;
-    static_assert(std::is_same<decltype(callback()), std::optional<Ret>>::value,
-                  "return type of callback must be std::optional");
+    /**
+     * @brief Mark a queue as running a callback, so no other work thread takes work from it. Its
+     * work no longer counts as unblocked until stop_running_internal() is called.
+     *
+     * @param: queue The queue to mark
+     */
+    void start_running_internal(QueueIter &queue);
 
-    // we need shared_ptr because std::function requires everything to be copyable, and promise is
-    // not
-    auto promise_ptr = std::make_shared<std::promise<Ret>>();
-    bool success = false;
-    size_t queue_size = 0;
+    /**
+     * @brief Mark a queue as no longer running a callback
+     *
+     * @param: queue The queue to mark
+     */
+    void stop_running_internal(QueueIter &queue);
+
+    /**
+     * @brief Raise current_priority if the priority is higher. Must be called whenever a queue
+     * gains work that a work thread can take.
+     *
+     * @param: priority The priority of the queue
+     */
+    void raise_current_priority(int priority);
+
+    /**
+     * @brief Get the queue with the given name. Must be called with data_mutex held.
+     *
+     * @param queue_name The name of the queue
+     * @return QueueIter The queue. Throws std::out_of_range if it doesn't exist.
+     */
+    QueueIter find_queue(const std::string &queue_name);
+
+    /**
+     * @brief Get the queue with the given id. Must be called with data_mutex held.
+     *
+     * @param queue The id of the queue
+     * @return QueueIter The queue. Throws std::out_of_range if it doesn't exist.
+     */
+    QueueIter find_queue(QueueId queue);
 
+    /**
+     * @brief Create a queue. Must be called with data_mutex held.
+     *
+     * @param queue_name The name of the queue
+     * @param priority The priority of the queue
+     * @param id The id to give the queue
+     */
+    void create_queue_internal(const std::string &queue_name, int priority, QueueId id);
+
+    /**
+     * @brief Wait for space for work and add it to a queue. This is shared by all the variants of
+     * post().
+     *
+     * @param queue_key The name or id of the queue to post to
+     * @param postedWorkSize The size in bytes of the posted work
+     * @param timeout How long to wait (in milliseconds) for space to become available
+     * @param callback The callback to run. Returns true if the work completed, or false if the
+     * queue is blocked.
+     * @param timeoutTimestamp The time after which the work times out
+     * @param timeoutCallback Called if the work times out
+     * @return a tuple containing the status of the post and the size of the queue
+     */
+    template <typename K, typename F>
+    std::tuple<Handler::PostStatus, size_t> post_internal(const K &queue_key,
+                                                          size_t postedWorkSize, int timeout,
+                                                          F &&callback, double timeoutTimestamp,
+                                                          std::function<void()> &&timeoutCallback);
+
+    /**
+     * @brief Wrap the callback so its result is passed to a future, and post it.
+     */
+    template <typename K, typename T>
+    auto post_with_future(const K &queue_key, size_t postedWorkSize, int timeout, T &&callback,
+                          double timeoutTimestamp, std::function<void()> &&timeoutCallback)
+        -> std::tuple<Handler::PostStatus, size_t,
+                      std::future<typename std::remove_reference<decltype(*callback())>::type>>;
+
+    /**
+     * @brief Wrap the callback so its result is discarded, and post it.
+     */
+    template <typename K, typename T>
+    std::tuple<Handler::PostStatus, size_t> post_without_future(
+        const K &queue_key, size_t postedWorkSize, int timeout, T &&callback,
+        double timeoutTimestamp, std::function<void()> &&timeoutCallback);
+
+    /**
+     * @brief Get an unused work node from the pool, or allocate one. Must be called with
+     * data_mutex held.
+     */
+    Work *acquire_work();
+
+    /**
+     * @brief Destroy the callbacks of a work node and return it to the pool. Must be called with
+     * data_mutex held.
+     */
+    void release_work(Work *work);
+
+    /**
+     * @brief Schedule work to time out at its timeout timestamp. Must be called with data_mutex
+     * held.
+     */
+    void schedule_timeout(Work *work);
+
+    /**
+     * @brief Cancel the timeout of work that is being removed. Must be called with data_mutex held.
+     */
+    void cancel_timeout(Work *work);
+};
+
+template <typename K, typename F>
+std::tuple<Handler::PostStatus, size_t> Handler::post_internal(
+    const K &queue_key, size_t postedWorkSize, int timeout, F &&callback, double timeoutTimestamp,
+    std::function<void()> &&timeoutCallback) {
     std::chrono::duration<double> now = std::chrono::system_clock::now().time_since_epoch();
     if (timeoutTimestamp < now.count() && timeoutCallback) {
         timeoutCallback();
-        return {PostStatus::OK, 0, promise_ptr->get_future()};
+        return {PostStatus::OK, 0};
     }
 
     // work is too large to fit in even an empty queue
     if (postedWorkSize > max_queue_size) {
-        return {PostStatus::QUEUE_FULL, 0, std::future<Ret>()};
+        return {PostStatus::QUEUE_FULL, 0};
     } else if (postedWorkSize > max_total_size) {
-        return {PostStatus::HANDLER_FULL, 0, std::future<Ret>()};
+        return {PostStatus::HANDLER_FULL, 0};
     }
 
-    if (state.load() == State::PRESTART || state.load() == State::STARTED) {
+    if (state.load() != State::PRESTART && state.load() != State::STARTED) {
+        return {PostStatus::INVALID_STATE, 0};
+    }
+
+    size_t queue_size = 0;
+    {
         std::unique_lock<std::mutex> lock(data_mutex);
         // throws std::out_of_range if queue does not exist
-        QueueIter queue = queue_map.at(queue_name);
+        QueueIter queue = find_queue(queue_key);
         PostStatus wait_status = PostStatus::OK;
 
         auto cond = [&]() {
             // Look up the queue again. wait() will release the lock, so it's possible the map has
             // changed. This will throw std::out_of_range if the queue was deleted while we were
             // waiting
-            queue = queue_map.at(queue_name);
+            queue = find_queue(queue_key);
 
             if (queue->marked) {
                 // just throw out of range to map the queue not existing case. The queue is
@@ -455,40 +789,22 @@ auto Handler::post(std::string queue_name, size_t postedWorkSize, int timeout, T
         } else {
             if (!post_signaler.wait_for(lock, std::chrono::milliseconds(timeout), cond)) {
                 // queue is still empty after timeout
-                return {wait_status, queue->size, std::future<Ret>()};
+                return {wait_status, queue->size};
             }
         }
 
-        auto work = std::make_shared<Work>(
-            [callback = std::forward<T>(callback), promise_ptr]() mutable {
-                auto ret = callback();
-
-                // if the callback returned a value, return true
-                // if it returned an null optional, return false.
-                if (ret) {
-                    promise_ptr->set_value(*ret);
-                    return true;
-                } else {
-                    return false;
-                }
-            },
-            timeoutCallback, postedWorkSize, timeoutTimestamp);
-
-        // notify the work thread if there's a shorter timeout
-        if (timeoutTimestamp != std::numeric_limits<double>::infinity() &&
-            (timeoutQueue.empty() ||
-             timeoutTimestamp < (*timeoutQueue.begin())->timeoutTimestamp)) {
-            timeout_thread_signaler.notify_one();
-        }
+        Work *work = acquire_work();
+        work->callback.emplace(std::forward<F>(callback));
+        work->timeoutCallback = std::move(timeoutCallback);
+        work->size = postedWorkSize;
+        work->timeoutTimestamp = timeoutTimestamp;
+        work->queue = &*queue;
 
-        // add the work and get the iterator
-        auto workIt = queue->queue.insert(queue->queue.end(), work);
-        auto timeoutIt = timeoutQueue.insert(work);
+        if (timeoutTimestamp != std::numeric_limits<double>::infinity()) {
+            schedule_timeout(work);
+        }
 
-        work->queueIter = queue;
-        work->workIter = workIt;
-        work->timeoutIter = timeoutIt;
-        work->timedOutIter = timedOutQueue.end();
+        queue->queue.push_back(work);
 
         // update counters
         queue->size += postedWorkSize;
@@ -496,32 +812,104 @@ auto Handler::post(std::string queue_name, size_t postedWorkSize, int timeout, T
         total_work++;
 
         // only update the unblocked counters if the queue we're putting the work in is not
-        // blocked
-        if (!queue->blocked) {
+        // blocked. Running queues are counted again once their callback returns.
+        if (!queue->blocked && !queue->running) {
             queue->priority_level.unblocked_work_count++;
             unblocked_work++;
         }
 
         // update max priority if we are higher that the current max work priority
-        if (queue->priority_level.priority > current_priority->first) {
-            current_priority = priority_levels.find(queue->priority_level.priority);
-            if (current_priority == priority_levels.end()) {
-                // we have an entry in the queue map, but the entry in the priority map doesn't
-                // exist. This shouldn't be possible
-                throw std::logic_error(
-                    "Failed to find entry in priority map. This should never happen");
-            }
-        }
-
-        // we did it!
-        success = true;
+        raise_current_priority(queue->priority_level.priority);
 
         queue_size = queue->size;
     }
 
     work_thread_signaler.notify_one();
-    return {success ? PostStatus::OK : PostStatus::INVALID_STATE, queue_size,
-            promise_ptr->get_future()};
+    return {PostStatus::OK, queue_size};
+}
+
+template <typename K, typename T>
+auto Handler::post_with_future(const K &queue_key, size_t postedWorkSize, int timeout,
+                               T &&callback, double timeoutTimestamp,
+                               std::function<void()> &&timeoutCallback)
+    -> std::tuple<Handler::PostStatus, size_t,
+                  std::future<typename std::remove_reference<decltype(*callback())>::type>> {
+    using Ret = typename std::remove_reference<decltype(*callback())>::type;
+    static_assert(std::is_same<decltype(callback()), std::optional<Ret>>::value,
+                  "return type of callback must be std::optional");
+
+    // The promise is owned by the work, so if the work is never run (e.g. the post fails, the work
+    // times out, or the handler is stopped) the future is set to ready with std::future_error
+    std::promise<Ret> result;
+    std::future<Ret> future = result.get_future();
+    auto [status, queue_size] = post_internal(
+        queue_key, postedWorkSize, timeout,
+        [callback = std::forward<T>(callback), result = std::move(result)]() mutable {
+            auto ret = callback();
+
+            // if the callback returned a value, return true
+            // if it returned an null optional, return false.
+            if (ret) {
+                result.set_value(*ret);
+                return true;
+            } else {
+                return false;
+            }
+        },
+        timeoutTimestamp, std::move(timeoutCallback));
+
+    if (status == PostStatus::QUEUE_FULL || status == PostStatus::HANDLER_FULL) {
+        return {status, queue_size, std::future<Ret>()};
+    }
+    return {status, queue_size, std::move(future)};
+}
+
+template <typename K, typename T>
+std::tuple<Handler::PostStatus, size_t> Handler::post_without_future(
+    const K &queue_key, size_t postedWorkSize, int timeout, T &&callback, double timeoutTimestamp,
+    std::function<void()> &&timeoutCallback) {
+    using Ret = typename std::remove_reference<decltype(*callback())>::type;
+    static_assert(std::is_same<decltype(callback()), std::optional<Ret>>::value,
+                  "return type of callback must be std::optional");
+
+    return post_internal(
+        queue_key, postedWorkSize, timeout,
+        [callback = std::forward<T>(callback)]() mutable { return callback().has_value(); },
+        timeoutTimestamp, std::move(timeoutCallback));
+}
+
+template <typename T>
+auto Handler::post(const std::string &queue_name, size_t postedWorkSize, int timeout,
+                   T &&callback, double timeoutTimestamp, std::function<void()> timeoutCallback)
+    -> std::tuple<Handler::PostStatus, size_t,
+                  std::future<typename std::remove_reference<decltype(*callback())>::type>> {
+    return post_with_future(queue_name, postedWorkSize, timeout, std::forward<T>(callback),
+                            timeoutTimestamp, std::move(timeoutCallback));
+}
+
+template <typename T>
+auto Handler::post(QueueId queue, size_t postedWorkSize, int timeout, T &&callback,
+                   double timeoutTimestamp, std::function<void()> timeoutCallback)
+    -> std::tuple<Handler::PostStatus, size_t,
+                  std::future<typename std::remove_reference<decltype(*callback())>::type>> {
+    return post_with_future(queue, postedWorkSize, timeout, std::forward<T>(callback),
+                            timeoutTimestamp, std::move(timeoutCallback));
+}
+
+template <typename T>
+std::tuple<Handler::PostStatus, size_t> Handler::post_detached(
+    const std::string &queue_name, size_t postedWorkSize, int timeout, T &&callback,
+    double timeoutTimestamp, std::function<void()> timeoutCallback) {
+    return post_without_future(queue_name, postedWorkSize, timeout, std::forward<T>(callback),
+                               timeoutTimestamp, std::move(timeoutCallback));
+}
+
+template <typename T>
+std::tuple<Handler::PostStatus, size_t> Handler::post_detached(
+    QueueId queue, size_t postedWorkSize, int timeout, T &&callback, double timeoutTimestamp,
+    std::function<void()> timeoutCallback) {
+    return post_without_future(queue, postedWorkSize, timeout, std::forward<T>(callback),
+                               timeoutTimestamp, std::move(timeoutCallback));
 }
 
 std::string handlerPostStatusToString(Handler::PostStatus status);
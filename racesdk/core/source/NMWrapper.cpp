@@ -49,6 +49,7 @@ NMWrapper::NMWrapper(RaceSdk &sdk, const std::string &name) :
 void NMWrapper::construct() {
     TRACE_METHOD(getId());
     createQueue("receive", -2);
+    mReceiveQueues = {mThreadHandler.get_queue_id("receive")};
     createQueue("callback", -1);
     createQueue("wait queue", std::numeric_limits<int>::min());
 }
@@ -67,6 +68,17 @@ void NMWrapper::stopHandler() {
     mThreadHandler.stop();
 }
 
+void NMWrapper::setNumWorkers(size_t numWorkers) {
+    TRACE_METHOD(getId(), numWorkers);
+    mThreadHandler.set_num_workers(numWorkers);
+
+    // give each worker a receive queue so packages from different connections are processed in
+    // parallel
+    for (size_t i = mReceiveQueues.size(); i < numWorkers; ++i) {
+        mReceiveQueues.push_back(mThreadHandler.create_queue("receive-" + std::to_string(i), -2));
+    }
+}
+
 void NMWrapper::waitForCallbacks() {
     auto [success, queueSize, future] =
         mThreadHandler.post("wait queue", 0, -1, [=] { return std::make_optional(true); });
@@ -207,14 +219,14 @@ std::tuple<bool, double> NMWrapper::processClrMsg(RaceHandle handle, const ClrMs
     //                 message  from                   to                   ids
     uint32_t msgSize = length + msg.getFrom().size() + msg.getTo().size() + 16;
 
-    helper::logDebug("Posting IRacePluginNM::processClrMsg(), postId: " + postId +
-                     " traceId: " + helper::convertToHexString(newMsg.getTraceId()) +
-                     " spanId: " + helper::convertToHexString(newMsg.getSpanId()));
+    LOG_DEBUG("Posting IRacePluginNM::processClrMsg(), postId: " + postId +
+              " traceId: " + helper::convertToHexString(newMsg.getTraceId()) +
+              " spanId: " + helper::convertToHexString(newMsg.getSpanId()));
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("receive", msgSize, timeout, [=] {
-            helper::logDebug("Calling IRacePluginNM::processClrMsg(), postId: " + postId +
-                             " traceId: " + helper::convertToHexString(newMsg.getTraceId()) +
-                             " spanId: " + helper::convertToHexString(newMsg.getSpanId()));
+        auto [success, queueSize] = mThreadHandler.post_detached("receive", msgSize, timeout, [=] {
+            LOG_DEBUG("Calling IRacePluginNM::processClrMsg(), postId: " + postId +
+                      " traceId: " + helper::convertToHexString(newMsg.getTraceId()) +
+                      " spanId: " + helper::convertToHexString(newMsg.getSpanId()));
             PluginResponse response;
             try {
                 response = mPlugin->processClrMsg(handle, newMsg);
@@ -226,9 +238,9 @@ std::tuple<bool, double> NMWrapper::processClrMsg(RaceHandle handle, const ClrMs
                 helper::logError("IRacePluginNM::processClrMsg() threw an exception");
                 response = PLUGIN_FATAL;
             }
-            helper::logDebug("IRacePluginNM::processClrMsg() returned, postId: " + postId +
-                             " traceId: " + helper::convertToHexString(newMsg.getTraceId()) +
-                             " spanId: " + helper::convertToHexString(newMsg.getSpanId()));
+            LOG_DEBUG("IRacePluginNM::processClrMsg() returned, postId: " + postId +
+                      " traceId: " + helper::convertToHexString(newMsg.getTraceId()) +
+                      " spanId: " + helper::convertToHexString(newMsg.getSpanId()));
             span->Finish();
 
             if (response != PLUGIN_OK) {
@@ -245,7 +257,6 @@ std::tuple<bool, double> NMWrapper::processClrMsg(RaceHandle handle, const ClrMs
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
@@ -288,18 +299,25 @@ std::tuple<bool, double> NMWrapper::processEncPkg(RaceHandle handle, const EncPk
     newPkg.setTraceId(traceIdFromContext(span->context()));
     newPkg.setSpanId(spanIdFromContext(span->context()));
 
-    helper::logDebug("Posting IRacePluginNM::processEncPkg(), postId: " + postId +
-                     " traceId: " + helper::convertToHexString(newPkg.getTraceId()) +
-                     " spanId: " + helper::convertToHexString(newPkg.getSpanId()) +
-                     " parent spanId: " + helper::convertToHexString(ePkg.getSpanId()));
+    LOG_DEBUG("Posting IRacePluginNM::processEncPkg(), postId: " + postId +
+              " traceId: " + helper::convertToHexString(newPkg.getTraceId()) +
+              " spanId: " + helper::convertToHexString(newPkg.getSpanId()) +
+              " parent spanId: " + helper::convertToHexString(ePkg.getSpanId()));
 
     uint32_t pkgSize = newPkg.getSize();
 
+    // packages from the same connection always go to the same queue, so they're processed in order
+    Handler::QueueId queue = mReceiveQueues.front();
+    if (mReceiveQueues.size() > 1 && !connIDs.empty()) {
+        size_t index = std::hash<ConnectionID>{}(connIDs.front()) % mReceiveQueues.size();
+        queue = mReceiveQueues[index];
+    }
+
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("receive", pkgSize, timeout, [=] {
-            helper::logDebug("Calling IRacePluginNM::processEncPkg(), postId: " + postId +
-                             " traceId: " + helper::convertToHexString(newPkg.getTraceId()) +
-                             " spanId: " + helper::convertToHexString(newPkg.getSpanId()));
+        auto [success, queueSize] = mThreadHandler.post_detached(queue, pkgSize, timeout, [=] {
+            LOG_DEBUG("Calling IRacePluginNM::processEncPkg(), postId: " + postId +
+                      " traceId: " + helper::convertToHexString(newPkg.getTraceId()) +
+                      " spanId: " + helper::convertToHexString(newPkg.getSpanId()));
 
             PluginResponse response;
             try {
@@ -312,9 +330,9 @@ std::tuple<bool, double> NMWrapper::processEncPkg(RaceHandle handle, const EncPk
                 helper::logError("IRacePluginNM::processEncPkg() threw an exception");
                 response = PLUGIN_FATAL;
             }
-            helper::logDebug("IRacePluginNM::processEncPkg() returned, postId: " + postId +
-                             " traceId: " + helper::convertToHexString(newPkg.getTraceId()) +
-                             " spanId: " + helper::convertToHexString(newPkg.getSpanId()));
+            LOG_DEBUG("IRacePluginNM::processEncPkg() returned, postId: " + postId +
+                      " traceId: " + helper::convertToHexString(newPkg.getTraceId()) +
+                      " spanId: " + helper::convertToHexString(newPkg.getSpanId()));
             span->Finish();
 
             if (response != PLUGIN_OK) {
@@ -331,7 +349,6 @@ std::tuple<bool, double> NMWrapper::processEncPkg(RaceHandle handle, const EncPk
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
@@ -349,7 +366,7 @@ std::tuple<bool, double> NMWrapper::prepareToBootstrap(RaceHandle handle, LinkID
     std::string postId = std::to_string(nextPostId++);
     helper::logDebug("Posting IRacePluginNM::prepareToBootstrap(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("receive", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("receive", 0, timeout, [=] {
             helper::logDebug("Calling IRacePluginNM::prepareToBootstrap(), postId: " + postId);
 
             PluginResponse response;
@@ -379,7 +396,6 @@ std::tuple<bool, double> NMWrapper::prepareToBootstrap(RaceHandle handle, LinkID
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
@@ -396,7 +412,7 @@ std::tuple<bool, double> NMWrapper::onBootstrapPkgReceived(std::string persona,
     std::string postId = std::to_string(nextPostId++);
     helper::logDebug("Posting IRacePluginNM::onBootstrapPkgReceived(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("callback", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("callback", 0, timeout, [=] {
             helper::logDebug("Calling IRacePluginNM::onBootstrapPkgReceived(), postId: " + postId);
 
             PluginResponse response;
@@ -426,7 +442,6 @@ std::tuple<bool, double> NMWrapper::onBootstrapPkgReceived(std::string persona,
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
@@ -442,7 +457,7 @@ bool NMWrapper::onBootstrapFinished(RaceHandle bootstrapHandle, BootstrapState s
     std::string postId = std::to_string(nextPostId++);
     helper::logDebug(logPrefix + "Posting postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("callback", 0, 60, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("callback", 0, 60, [=] {
             helper::logDebug("Calling IRacePluginNM::onBootstrapFinished(), postId: " + postId);
 
             PluginResponse response;
@@ -472,7 +487,6 @@ bool NMWrapper::onBootstrapFinished(RaceHandle bootstrapHandle, BootstrapState s
             return std::make_optional(true);
         });
 
-        (void)future;
         return success == Handler::PostStatus::OK;
     } catch (std::exception &ex) {
         helper::logError(logPrefix + " exception: " + std::string(ex.what()));
@@ -488,7 +502,7 @@ std::tuple<bool, double> NMWrapper::onPackageStatusChanged(RaceHandle handle, Pa
 
     helper::logDebug("Posting IRacePluginNM::onPackageStatusChanged(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("callback", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("callback", 0, timeout, [=] {
             helper::logDebug("Calling IRacePluginNM::onPackageStatusChanged(), postId: " + postId);
 
             PluginResponse response;
@@ -518,7 +532,6 @@ std::tuple<bool, double> NMWrapper::onPackageStatusChanged(RaceHandle handle, Pa
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
@@ -537,7 +550,7 @@ std::tuple<bool, double> NMWrapper::onConnectionStatusChanged(
 
     helper::logDebug("Posting IRacePluginNM::onConnectionStatusChanged(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("callback", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("callback", 0, timeout, [=] {
             helper::logDebug("Calling IRacePluginNM::onConnectionStatusChanged(), postId: " +
                              postId);
             PluginResponse response;
@@ -569,7 +582,6 @@ std::tuple<bool, double> NMWrapper::onConnectionStatusChanged(
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
@@ -589,7 +601,7 @@ std::tuple<bool, double> NMWrapper::onLinkStatusChanged(RaceHandle handle, LinkI
 
     helper::logDebug("Posting IRacePluginNM::onLinkStatusChanged(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("callback", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("callback", 0, timeout, [=] {
             helper::logDebug("Calling IRacePluginNM::onLinkStatusChanged(), postId: " + postId);
             PluginResponse response;
             try {
@@ -618,7 +630,6 @@ std::tuple<bool, double> NMWrapper::onLinkStatusChanged(RaceHandle handle, LinkI
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
@@ -639,7 +650,7 @@ std::tuple<bool, double> NMWrapper::onChannelStatusChanged(RaceHandle handle,
 
     helper::logDebug("Posting IRacePluginNM::onChannelStatusChanged(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("callback", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("callback", 0, timeout, [=] {
             helper::logDebug("Calling IRacePluginNM::onChannelStatusChanged(), postId: " + postId);
             PluginResponse response;
             try {
@@ -668,7 +679,6 @@ std::tuple<bool, double> NMWrapper::onChannelStatusChanged(RaceHandle handle,
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
@@ -687,7 +697,7 @@ std::tuple<bool, double> NMWrapper::onLinkPropertiesChanged(LinkID linkId,
 
     helper::logDebug("Posting IRacePluginNM::onLinkPropertiesChanged(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("callback", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("callback", 0, timeout, [=] {
             helper::logDebug("Calling IRacePluginNM::onLinkPropertiesChanged(), postId: " + postId);
             PluginResponse response;
             try {
@@ -717,7 +727,6 @@ std::tuple<bool, double> NMWrapper::onLinkPropertiesChanged(LinkID linkId,
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
@@ -737,7 +746,7 @@ std::tuple<bool, double> NMWrapper::onPersonaLinksChanged(std::string recipientP
 
     helper::logDebug("Posting IRacePluginNM::onPersonaLinksChanged(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("callback", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("callback", 0, timeout, [=] {
             helper::logDebug("Calling IRacePluginNM::onPersonaLinksChanged(), postId: " + postId);
             PluginResponse response;
             try {
@@ -766,7 +775,6 @@ std::tuple<bool, double> NMWrapper::onPersonaLinksChanged(std::string recipientP
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
@@ -785,7 +793,7 @@ std::tuple<bool, double> NMWrapper::onUserInputReceived(RaceHandle handle, bool
 
     helper::logDebug("Posting IRacePluginNM::onUserInputReceived(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("callback", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("callback", 0, timeout, [=] {
             helper::logDebug("Calling IRacePluginNM::onUserInputReceived(), postId: " + postId);
             PluginResponse response;
             try {
@@ -814,7 +822,6 @@ std::tuple<bool, double> NMWrapper::onUserInputReceived(RaceHandle handle, bool
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
@@ -832,7 +839,7 @@ std::tuple<bool, double> NMWrapper::onUserAcknowledgementReceived(RaceHandle han
 
     helper::logDebug("Posting IRacePluginNM::onUserAcknowledgementReceived(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("callback", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("callback", 0, timeout, [=] {
             helper::logDebug("Calling IRacePluginNM::onUserAcknowledgementReceived(), postId: " +
                              postId);
             PluginResponse response;
@@ -866,7 +873,6 @@ std::tuple<bool, double> NMWrapper::onUserAcknowledgementReceived(RaceHandle han
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
@@ -883,7 +889,7 @@ std::tuple<bool, double> NMWrapper::notifyEpoch(const std::string &data, int32_t
 
     helper::logDebug("Posting IRacePluginNM::notifyEpoch(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("", 0, timeout, [=] {
             helper::logDebug("Calling IRacePluginNM::notifyEpoch(), postId: " + postId);
             PluginResponse response;
             try {
@@ -912,7 +918,6 @@ std::tuple<bool, double> NMWrapper::notifyEpoch(const std::string &data, int32_t
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
@@ -1020,6 +1025,12 @@ SdkResponse NMWrapper::sendEncryptedPackage(EncPkg ePkg, ConnectionID connection
     return response;
 }
 
+std::vector<SdkResponse> NMWrapper::sendEncryptedPackages(
+    std::vector<std::pair<EncPkg, ConnectionID>> packages, uint64_t batchId, int32_t timeout) {
+    TRACE_METHOD(getId(), packages.size(), batchId);
+    return raceSdk.sendEncryptedPackages(*this, std::move(packages), batchId, timeout);
+}
+
 SdkResponse NMWrapper::presentCleartextMessage(ClrMsg msg) {
     TRACE_METHOD(getId());
     SdkResponse response = raceSdk.presentCleartextMessage(*this, msg);
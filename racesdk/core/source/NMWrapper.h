@@ -20,6 +20,7 @@
 
 #include <atomic>
 #include <memory>
+#include <vector>
 
 #include "../include/RaceSdk.h"
 #include "Handler.h"
@@ -37,6 +38,8 @@ protected:
     Handler mThreadHandler;
     // nextPostId is used to identify which post matches with which call/return log.
     std::atomic<uint64_t> nextPostId = 0;
+    // queues that received packages are posted to, chosen by connection. There's one per worker.
+    std::vector<Handler::QueueId> mReceiveQueues;
 
     std::shared_ptr<IRacePluginNM>
         mPlugin;  // unique_ptr requires deleter type as template parameter
@@ -81,6 +84,15 @@ public:
      */
     virtual void stopHandler();
 
+    /* setNumWorkers: set the number of plugin threads
+     *
+     * Must be called before startHandler. With more than one thread, calls into the plugin may run
+     * concurrently, so this should only be used for plugins that are thread-safe. Received packages
+     * are spread over one receive queue per thread by connection, so packages received on the same
+     * connection are still processed in order.
+     */
+    virtual void setNumWorkers(size_t numWorkers);
+
     /* waitForCallbacks: wait for all callbacks to finish
      *
      * Creates a queue and callback with the minimum priority and waits for that to finish. Used for
@@ -382,6 +394,9 @@ public:
     // IRaceSdkNM
     virtual SdkResponse sendEncryptedPackage(EncPkg ePkg, ConnectionID connectionId,
                                              uint64_t batchId, int32_t timeout) override;
+    virtual std::vector<SdkResponse> sendEncryptedPackages(
+        std::vector<std::pair<EncPkg, ConnectionID>> packages, uint64_t batchId,
+        int32_t timeout) override;
     virtual SdkResponse presentCleartextMessage(ClrMsg msg) override;
     virtual SdkResponse onPluginStatusChanged(PluginStatus status) override;
     virtual SdkResponse openConnection(LinkType linkType, LinkID linkId, std::string linkHints,
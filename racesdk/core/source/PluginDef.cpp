@@ -47,6 +47,7 @@ PluginDef PluginDef::pluginJsonToPluginDef(json pluginJson) {
         pluginDef.transports = pluginJson.value("transports", std::vector<std::string>{});
         pluginDef.usermodels = pluginJson.value("usermodels", std::vector<std::string>{});
         pluginDef.encodings = pluginJson.value("encodings", std::vector<std::string>{});
+        pluginDef.threadSafe = pluginJson.value("thread_safe", false);
     } catch (const json::out_of_range &error) {
         throw parsing_error("plugin definition missing required key: " + std::string(error.what()));
     } catch (const std::invalid_argument &error) {
@@ -19,11 +19,13 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
 #include <boost/io/ios_state.hpp>
 #include <fstream>
 #include <iostream>
 #include <nlohmann/json.hpp>
 #include <sstream>
+#include <thread>
 
 #include "helper.h"
 
@@ -33,17 +35,25 @@ RaceConfig::RaceConfig() :
              {RaceEnums::PluginType::PT_ARTIFACT_MANAGER, {}}}),
     isPluginFetchOnStartEnabled(false),
     isVoaEnabled(true),
+    voaMaxQueuedBytes(64 * 1024 * 1024),
     // 10MB queue size for plugins, There's no reason for this being the default, just seems fine.
     wrapperQueueMaxSize(10 * 1024 * 1024),
     // 2GB total size for all the plugin queues combined, This is >200 times the single queue limit,
     // so it shoudn't get hit.
     wrapperTotalMaxSize(2048 * 1024 * 1024ul),
+    // thread-safe plugins get a worker per core by default
+    wrapperMaxWorkers(std::max(1u, std::thread::hardware_concurrency())),
     logLevel(RaceLog::LL_DEBUG),
     logLevelStdout(RaceLog::LL_WARNING),
+    logAsync(false),
+    logAsyncBufferSize(4096),
+    logAsyncOverflowPolicy(RaceLog::OP_DROP),
     logRaceConfig(true),
     logNMConfig(true),
     logCommsConfig(true),
-    msgLogLength(256) {}
+    msgLogLength(256),
+    traceSampleRate(0.01),
+    traceExportQueueSize(4096) {}
 
 RaceConfig::RaceConfig(const AppConfig &config, const std::vector<std::uint8_t> &raceJsonContents) :
     RaceConfig() {
@@ -57,13 +67,25 @@ void RaceConfig::log() const {
 
     o << "isPluginFetchOnStartEnabled: " << isPluginFetchOnStartEnabled << "\n";
     o << "isVoaEnabled: " << isVoaEnabled << "\n";
+    o << "voaMaxQueuedBytes: " << voaMaxQueuedBytes << "\n";
     o << "wrapperQueueMaxSize: " << wrapperQueueMaxSize << "\n";
     o << "wrapperTotalMaxSize: " << wrapperTotalMaxSize << "\n";
+    o << "wrapperMaxWorkers: " << wrapperMaxWorkers << "\n";
     o << "logLevel: " << logLevel << "\n";
+    o << "logAsync: " << logAsync << "\n";
+    o << "logAsyncBufferSize: " << logAsyncBufferSize << "\n";
+    o << "logAsyncOverflowPolicy: " << logAsyncOverflowPolicy << "\n";
     o << "logRaceConfig: " << logRaceConfig << "\n";
     o << "logNMConfig: " << logNMConfig << "\n";
     o << "logCommsConfig: " << logCommsConfig << "\n";
     o << "msgLogLength: " << msgLogLength << "\n";
+    o << "traceSampleRate: " << traceSampleRate << "\n";
+    o << "traceChannelSampleRates: ";
+    for (auto &[channelGid, rate] : traceChannelSampleRates) {
+        o << channelGid << '=' << rate << ' ';
+    }
+    o << "\n";
+    o << "traceExportQueueSize: " << traceExportQueueSize << "\n";
     o << "network manager plugins: ";
     for (auto &networkManager : getNMPluginDefs()) {
         o << networkManager.filePath << ' ';
@@ -167,6 +189,8 @@ void RaceConfig::parseConfigString(const std::string &configString, const AppCon
             "isPluginFetchOnStartEnabled", bool_to_string(isPluginFetchOnStartEnabled)));
 
         isVoaEnabled = to_bool(configJson.value("isVoaEnabled", bool_to_string(isVoaEnabled)));
+        voaMaxQueuedBytes = std::stoul(
+            configJson.value("voa-max-queued-bytes", std::to_string(voaMaxQueuedBytes)));
 
         wrapperQueueMaxSize =
             std::stoul(configJson.value("max_queue_size", std::to_string(wrapperQueueMaxSize)));
@@ -174,7 +198,15 @@ void RaceConfig::parseConfigString(const std::string &configString, const AppCon
         wrapperTotalMaxSize =
             std::stoul(configJson.value("max_size", std::to_string(wrapperTotalMaxSize)));
 
+        wrapperMaxWorkers = std::max(
+            1ul, std::stoul(configJson.value("max_workers", std::to_string(wrapperMaxWorkers))));
+
         logLevel = stringToLogLevel(configJson.value("level", "DEBUG"));
+        logAsync = to_bool(configJson.value("log-async", bool_to_string(logAsync)));
+        logAsyncBufferSize = std::stoul(
+            configJson.value("log-async-buffer-size", std::to_string(logAsyncBufferSize)));
+        logAsyncOverflowPolicy =
+            stringToOverflowPolicy(configJson.value("log-async-overflow", "drop"));
         logRaceConfig = to_bool(configJson.value("log-race-config", bool_to_string(logRaceConfig)));
         logNMConfig =
             to_bool(configJson.value("log-network-manager-config", bool_to_string(logNMConfig)));
@@ -182,6 +214,20 @@ void RaceConfig::parseConfigString(const std::string &configString, const AppCon
             to_bool(configJson.value("log-comms-config", bool_to_string(logCommsConfig)));
         msgLogLength = std::stoul(configJson.value("msg-log-length", std::to_string(msgLogLength)));
 
+        if (configJson.contains("trace-sample-rate")) {
+            traceSampleRate =
+                parseSampleRate(configJson.at("trace-sample-rate"), "trace-sample-rate");
+        }
+        if (configJson.contains("trace-channel-sample-rates")) {
+            auto &channelRatesJson = configJson.at("trace-channel-sample-rates");
+            for (auto &[channelGid, rateJson] : channelRatesJson.items()) {
+                traceChannelSampleRates[channelGid] =
+                    parseSampleRate(rateJson, "trace-channel-sample-rates." + channelGid);
+            }
+        }
+        traceExportQueueSize = std::stoul(
+            configJson.value("trace-export-queue-size", std::to_string(traceExportQueueSize)));
+
         // Parse plugin defs
 
         for (auto &channelPropertiesJson : configJson.at("channels")) {
@@ -308,6 +354,31 @@ RaceLog::LogLevel RaceConfig::stringToLogLevel(std::string logLevelStr) {
     }
 }
 
+RaceLog::OverflowPolicy RaceConfig::stringToOverflowPolicy(const std::string &policyStr) {
+    if (policyStr == "drop") {
+        return RaceLog::OP_DROP;
+    } else if (policyStr == "block") {
+        return RaceLog::OP_BLOCK;
+    } else {
+        std::string errorMessage = "Invalid log-async-overflow specified: " + policyStr;
+        helper::logError(errorMessage);
+        throw race_config_parsing_exception(errorMessage);
+    }
+}
+
+double RaceConfig::parseSampleRate(const nlohmann::json &rateJson, const std::string &fieldName) {
+    // like the other fields, the rate may be written as a string
+    double rate =
+        rateJson.is_string() ? std::stod(rateJson.get<std::string>()) : rateJson.get<double>();
+    if (!(rate >= 0.0 && rate <= 1.0)) {
+        std::string errorMessage =
+            "Invalid " + fieldName + " specified: " + rateJson.dump() + ". Must be from 0 to 1.";
+        helper::logError(errorMessage);
+        throw race_config_parsing_exception(errorMessage);
+    }
+    return rate;
+}
+
 // convert string to boolean but default to false
 bool RaceConfig::to_bool(std::string str) {
     std::transform(str.begin(), str.end(), str.begin(), ::tolower);
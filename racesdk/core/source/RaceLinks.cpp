@@ -254,6 +254,15 @@ std::string RaceLinks::getPluginFromConnectionID(const ConnectionID &connId) {
     return getPluginFromLinkID(connId);
 }
 
+std::string RaceLinks::getChannelFromLinkID(const LinkID &linkId) {
+    std::size_t begin = linkId.find('/');  // plugin
+    std::size_t end = begin == std::string::npos ? begin : linkId.find('/', begin + 1);
+    if (end == std::string::npos) {
+        throw std::invalid_argument("LinkID does not include a channel GID: " + linkId);
+    }
+    return linkId.substr(begin + 1, end - begin - 1);
+}
+
 void RaceLinks::addTraceCtxForLink(const LinkID &linkId, std::uint64_t traceId,
                                    std::uint64_t spanId) {
     std::lock_guard<std::mutex> lock{linksLock};
@@ -51,7 +51,9 @@
 #include "NMWrapper.h"
 #include "OpenTracingHelpers.h"
 #include "PluginLoader.h"
+#include "SpanExporter.h"
 #include "TestHarnessWrapper.h"
+#include "TraceSampler.h"
 #include "VoaThread.h"
 #include "helper.h"
 
@@ -59,22 +61,6 @@ static constexpr RaceHandle START_TEST_HARNESS_HANDLE = 1ul << 63;
 
 using namespace std::string_literals;
 
-template <typename T>
-static std::string vectorToString(const std::vector<T> &someVector) {
-    if (someVector.size() == 0) {
-        return "";
-    }
-
-    std::stringstream result;
-    result << "{ " << someVector[0];
-    for (size_t index = 1; index < someVector.size(); ++index) {
-        result << ", " << someVector[index];
-    }
-    result << " }";
-
-    return result.str();
-}
-
 template <class T>
 static void runEachComms(
     std::unordered_map<std::string, std::unique_ptr<CommsWrapper>> &commsWrappers, T &&func) {
@@ -92,9 +78,13 @@ RaceSdk::RaceSdk(const AppConfig &_appConfig, const RaceConfig &_raceConfig,
                  IPluginLoader &_pluginLoader, std::shared_ptr<FileSystemHelper> fileSystemHelper) :
     appConfig(_appConfig),
     raceConfig(_raceConfig),
-    voaThread(std::make_unique<VoaThread>(*this, appConfig.voaConfigPath)),
+    voaThread(std::make_unique<VoaThread>(*this, appConfig.voaConfigPath,
+                                          raceConfig.voaMaxQueuedBytes)),
     pluginLoader(_pluginLoader),
     tracer(createTracer(appConfig.jaegerConfigPath, appConfig.persona)),
+    traceSampler(std::make_unique<TraceSampler>(raceConfig.traceSampleRate,
+                                                raceConfig.traceChannelSampleRates)),
+    spanExporter(std::make_unique<SpanExporter>(*this, raceConfig.traceExportQueueSize)),
     isShuttingDown(false),
     isReady(false),
     statusJson({}),
@@ -108,6 +98,10 @@ RaceSdk::RaceSdk(const AppConfig &_appConfig, const RaceConfig &_raceConfig,
     RaceLog::setLogFile(appConfig.logFilePath);
     RaceLog::setLogLevelFile(raceConfig.logLevel);
     RaceLog::setLogLevelStdout(raceConfig.logLevelStdout);
+    if (raceConfig.logAsync) {
+        RaceLog::setAsyncLogging(true, raceConfig.logAsyncBufferSize,
+                                 raceConfig.logAsyncOverflowPolicy);
+    }
 
     initializeRaceChannels();
 }
@@ -136,8 +130,6 @@ RaceSdk::RaceSdk(const AppConfig &_appConfig, IPluginLoader &_pluginLoader,
 
     tracer = createTracer(appConfig.jaegerConfigPath, appConfig.persona);
 
-    voaThread = std::make_unique<VoaThread>(*this, appConfig.voaConfigPath);
-
     const std::string raceConfigPath =
         _appConfig.baseConfigPath + "/" + _appConfig.sdkFilePath + "/race.json";
     helper::logInfo("initializing RACE config from file: " + raceConfigPath);
@@ -148,6 +140,17 @@ RaceSdk::RaceSdk(const AppConfig &_appConfig, IPluginLoader &_pluginLoader,
 
     RaceLog::setLogLevelFile(raceConfig.logLevel);
     RaceLog::setLogLevelStdout(raceConfig.logLevelStdout);
+    if (raceConfig.logAsync) {
+        RaceLog::setAsyncLogging(true, raceConfig.logAsyncBufferSize,
+                                 raceConfig.logAsyncOverflowPolicy);
+    }
+
+    traceSampler = std::make_unique<TraceSampler>(raceConfig.traceSampleRate,
+                                                  raceConfig.traceChannelSampleRates);
+    spanExporter = std::make_unique<SpanExporter>(*this, raceConfig.traceExportQueueSize);
+
+    voaThread = std::make_unique<VoaThread>(*this, appConfig.voaConfigPath,
+                                            raceConfig.voaMaxQueuedBytes);
 
     channels = std::make_unique<RaceChannels>(raceConfig.channels, this);
     initializeRaceChannels();
@@ -1143,22 +1146,21 @@ SdkResponse RaceSdk::shipPackage(RaceHandle handle, EncPkg ePkg, ConnectionID co
         return SDK_INVALID_ARGUMENT;
     }
 
-    // Add trace for connection use
-    const std::pair<std::uint64_t, std::uint64_t> traceIds =
-        links->getTraceCtxForConnection(connectionId);
-    auto ctx = spanContextFromIds(traceIds);
-    std::shared_ptr<opentracing::Span> span =
-        tracer->StartSpan("CONNECTION_SEND", {opentracing::ChildOf(ctx.get())});
-    span->SetTag("connectionId", connectionId);
-    span->SetTag("size", ePkg.getSize());
-    LinkID linkId = links->getLinkForConnection(connectionId);
-    traceLinkStatus(span, linkId);
-    span->Finish();
+    // Add trace for connection use, from here until the comms plugin has the package
+    const bool traced = traceSampler->sample(connectionId);
+    std::chrono::steady_clock::time_point traceStart;
+    if (traced) {
+        traceStart = std::chrono::steady_clock::now();
+    }
 
     ePkg.setPackageType(isTestHarness ? PKG_TYPE_TEST_HARNESS : PKG_TYPE_NM);
     links->cachePackageHandle(connectionId, handle);
     SdkResponse response = commsWrapper->sendPackage(handle, connectionId, ePkg, timeout, batchId);
 
+    if (traced) {
+        spanExporter->exportConnectionSpan("CONNECTION_SEND", connectionId, ePkg.getSize(),
+                                           traceStart);
+    }
     return response;
 }
 
@@ -1187,8 +1189,17 @@ void RaceSdk::setVoaActiveState(bool state) {
     voaThread->setVoaActiveState(state);
 }
 
-SdkResponse RaceSdk::shipVoaItems(RaceHandle handle,
-                                  std::list<std::pair<EncPkg, double>> voaPkgQueue,
+// The channel of a link, for matching VoA rules. Taken from the link ID rather than the link
+// properties to avoid copying them for every package.
+static std::string getVoaChannelGid(const LinkID &linkId) {
+    try {
+        return RaceLinks::getChannelFromLinkID(linkId);
+    } catch (std::invalid_argument &) {
+        return "";
+    }
+}
+
+SdkResponse RaceSdk::shipVoaItems(RaceHandle handle, const std::vector<VoaWorkItem> &voaPkgQueue,
                                   ConnectionID connectionId, int32_t timeout, bool isTestHarness,
                                   uint64_t batchId) {
     TRACE_METHOD(handle, connectionId, timeout, isTestHarness, batchId);
@@ -1198,28 +1209,22 @@ SdkResponse RaceSdk::shipVoaItems(RaceHandle handle,
         return SDK_SHUTTING_DOWN;
     }
 
-    // Create work items from the
-    // package queue
-    std::list<std::shared_ptr<VoaThread::VoaWorkItem>> voaItems;
-    for (std::pair<EncPkg, double> pkgItem : voaPkgQueue) {
-        EncPkg ePkg = pkgItem.first;
-        double holdTimestamp = pkgItem.second;
-
+    for (auto &voa : voaPkgQueue) {
         // Special handling for dropped packages
-        if (holdTimestamp == VOA_DROP_TIMESTAMP) {
+        if (voa.holdTimestamp == VOA_DROP_TIMESTAMP) {
             helper::logInfo("shipVoaItems: dropping package on connection ID:" + connectionId);
             // Return a null handle
             return SdkResponse(SDK_OK);
         }
+    }
 
-        auto voa = std::make_shared<VoaThread::VoaWorkItem>(
-            [=] {
-                return shipPackage(handle, ePkg, connectionId, timeout, isTestHarness, batchId);
-            },
-            holdTimestamp);
-        voaItems.push_back(voa);
+    SdkStatus status =
+        voaThread->process(connectionId, voaPkgQueue, [=](const EncPkg &ePkg) {
+            return shipPackage(handle, ePkg, connectionId, timeout, isTestHarness, batchId);
+        });
+    if (status != SDK_OK) {
+        return SdkResponse(status);
     }
-    voaThread->process(voaItems);
 
     return SdkResponse(SDK_OK, 0.0, handle);
 }
@@ -1242,22 +1247,18 @@ SdkResponse RaceSdk::sendEncryptedPackage(NMWrapper &plugin, EncPkg ePkg, Connec
     bool isTestHarness = plugin.isTestHarness();
     RaceHandle handle = generateHandle(isTestHarness);
 
-    if (raceConfig.isVoaEnabled && voaThread->isVoaActive()) {
+    if (raceConfig.isVoaEnabled && voaThread->isVoaActive() && voaThread->hasVoaRules()) {
         // Get VoA selectors
         LinkID linkId = links->getLinkForConnection(connectionId);
         std::string activePersona = getActivePersona();
-        LinkProperties properties = getLinkProperties(linkId);
+        std::string channelGid = getVoaChannelGid(linkId);
         personas::PersonaSet personas = links->getAllPersonasForLink(linkId);
-        // Convert personaSet to personaList
-        std::vector<std::string> personaList =
-            std::vector<std::string>(personas.begin(), personas.end());
-        std::list<std::pair<EncPkg, double>> voaPkgQueue = voaThread->getVoaPkgQueue(
-            ePkg, activePersona, linkId, properties.channelGid, personaList);
+        auto voaPkgQueue =
+            voaThread->getVoaPkgQueue(ePkg, activePersona, linkId, channelGid, personas);
 
         if (!voaPkgQueue.empty()) {
             helper::logDebug("RaceSdk::sendEncryptedPackage Number of VoA packages for linkId:" +
-                             linkId + " Gid:" + properties.channelGid +
-                             " personas:" + helper::personasToString(personaList) + " = " +
+                             linkId + " Gid:" + channelGid + " = " +
                              std::to_string(voaPkgQueue.size()));
             // only cache one handle for 1+ packages because they are all the same package
             links->cachePackageHandle(connectionId, handle);
@@ -1272,6 +1273,94 @@ SdkResponse RaceSdk::sendEncryptedPackage(NMWrapper &plugin, EncPkg ePkg, Connec
     return shipPackage(handle, ePkg, connectionId, timeout, isTestHarness, batchId);
 }
 
+std::vector<SdkResponse> RaceSdk::sendEncryptedPackages(
+    NMWrapper &plugin, std::vector<std::pair<EncPkg, ConnectionID>> packages, uint64_t batchId,
+    int32_t timeout) {
+    TRACE_METHOD(plugin.getId(), packages.size(), batchId);
+    std::vector<SdkResponse> responses(packages.size(), SDK_SHUTTING_DOWN);
+    if (isShuttingDown) {
+        helper::logInfo("sendEncryptedPackages: sdk is shutting down");
+        return responses;
+    }
+
+    bool isTestHarness = plugin.isTestHarness();
+    bool isVoaActive =
+        raceConfig.isVoaEnabled && voaThread->isVoaActive() && voaThread->hasVoaRules();
+    std::string activePersona = isVoaActive ? getActivePersona() : "";
+
+    // Packages for each comms plugin, along with where their responses go. The locks are taken in
+    // the same order as shipPackage.
+    std::unordered_map<CommsWrapper *, std::vector<CommsWrapper::PackageToSend>> toSend;
+    std::unordered_map<CommsWrapper *, std::vector<size_t>> toSendIndices;
+    // Sampled packages, traced from here until their comms plugin has them
+    struct TracedPackage {
+        size_t index;
+        size_t size;
+        std::chrono::steady_clock::time_point start;
+    };
+    std::vector<TracedPackage> traced;
+    std::shared_lock<std::shared_mutex> commsWrapperReadLock(commsWrapperReadWriteLock);
+    std::shared_lock<std::shared_mutex> connectionsReadLock(connectionsReadWriteLock);
+    for (size_t i = 0; i < packages.size(); ++i) {
+        EncPkg &ePkg = packages[i].first;
+        const ConnectionID &connectionId = packages[i].second;
+        if (!links->doesConnectionExist(connectionId)) {
+            helper::logError("sendEncryptedPackages: connection is no longer open: " +
+                             connectionId);
+            responses[i] = SDK_INVALID_ARGUMENT;
+            continue;
+        }
+
+        RaceHandle handle = generateHandle(isTestHarness);
+        LinkID linkId = links->getLinkForConnection(connectionId);
+
+        if (isVoaActive) {
+            personas::PersonaSet personas = links->getAllPersonasForLink(linkId);
+            auto voaPkgQueue = voaThread->getVoaPkgQueue(ePkg, activePersona, linkId,
+                                                         getVoaChannelGid(linkId), personas);
+            if (!voaPkgQueue.empty()) {
+                links->cachePackageHandle(connectionId, handle);
+                responses[i] = shipVoaItems(handle, voaPkgQueue, connectionId, timeout,
+                                            isTestHarness, batchId);
+                continue;
+            }
+        }
+
+        auto it = commsWrappers.find(RaceLinks::getPluginFromConnectionID(connectionId));
+        if (it == commsWrappers.end()) {
+            helper::logError("Error: plugin for connection could not be found in RaceSdk.");
+            responses[i] = SDK_PLUGIN_MISSING;
+            continue;
+        }
+
+        // Add trace for connection use
+        if (traceSampler->sample(connectionId)) {
+            traced.push_back({i, ePkg.getSize(), std::chrono::steady_clock::now()});
+        }
+
+        ePkg.setPackageType(isTestHarness ? PKG_TYPE_TEST_HARNESS : PKG_TYPE_NM);
+        links->cachePackageHandle(connectionId, handle);
+        toSend[it->second.get()].push_back({handle, connectionId, std::move(ePkg)});
+        toSendIndices[it->second.get()].push_back(i);
+    }
+    connectionsReadLock.unlock();
+
+    for (auto &entry : toSend) {
+        std::vector<SdkResponse> wrapperResponses =
+            entry.first->sendPackages(entry.second, timeout, batchId);
+        const std::vector<size_t> &indices = toSendIndices[entry.first];
+        for (size_t j = 0; j < indices.size(); ++j) {
+            responses[indices[j]] = wrapperResponses[j];
+        }
+    }
+
+    for (const auto &package : traced) {
+        spanExporter->exportConnectionSpan("CONNECTION_SEND", packages[package.index].second,
+                                           package.size, package.start);
+    }
+    return responses;
+}
+
 SdkResponse RaceSdk::presentCleartextMessage(NMWrapper &plugin, ClrMsg msg) {
     TRACE_METHOD(plugin.getId());
 
@@ -1639,6 +1728,11 @@ SdkResponse RaceSdk::onConnectionStatusChanged(CommsWrapper &plugin, RaceHandle
         traceLinkStatus(span, linkId);
         span->Finish();
 
+        // Packages held by VoA can no longer be sent
+        if (raceConfig.isVoaEnabled) {
+            voaThread->cancelConnection(connId);
+        }
+
         links->removeConnectionRequest(handle);
         links->removeConnection(connId);
     } else if (status == CONNECTION_AVAILABLE) {
@@ -1971,10 +2065,8 @@ SdkResponse RaceSdk::receiveEncPkg(CommsWrapper &plugin, const EncPkg &pkg,
         return SDK_INVALID_ARGUMENT;
     }
 
-    const std::string logPrefx =
-        "receiveEncPkg (connection IDs: " + vectorToString(connIDs) + "): ";
-    helper::logDebug("Package size = " + std::to_string(pkg.getCipherText().size()));
-    helper::logDebug("Package type = " + packageTypeToString(pkg.getPackageType()));
+    LOG_DEBUG("Package size = " + std::to_string(pkg.getCipherTextView().size()));
+    LOG_DEBUG("Package type = " + packageTypeToString(pkg.getPackageType()));
 
     if (isShuttingDown) {
         helper::logInfo("receiveEncPkg: sdk is shutting down");
@@ -2013,31 +2105,37 @@ SdkResponse RaceSdk::receiveEncPkg(CommsWrapper &plugin, const EncPkg &pkg,
             }
         }
 
-        // Add trace for connection use for each connection Id
-        for (auto connId : filteredConnectionIds) {
-            const std::pair<std::uint64_t, std::uint64_t> traceIds =
-                links->getTraceCtxForConnection(connId);
-            auto ctx = spanContextFromIds(traceIds);
-            std::shared_ptr<opentracing::Span> span =
-                tracer->StartSpan("CONNECTION_RECV", {opentracing::ChildOf(ctx.get())});
-            span->SetTag("connectionId", connId);
-            span->SetTag("size", pkg.getSize());
-            LinkID linkId = links->getLinkForConnection(connId);
-            traceLinkStatus(span, linkId);
-            span->Finish();
+        // Add trace for connection use for each connection Id, from here until the package has been
+        // handed on
+        std::vector<ConnectionID> tracedConnectionIds;
+        for (const auto &connId : filteredConnectionIds) {
+            if (traceSampler->sample(connId)) {
+                tracedConnectionIds.push_back(connId);
+            }
+        }
+        std::chrono::steady_clock::time_point traceStart;
+        if (!tracedConnectionIds.empty()) {
+            traceStart = std::chrono::steady_clock::now();
         }
 
+        SdkResponse response;
         if (pkg.getPackageType() == PKG_TYPE_SDK) {
             LinkID linkId = getLinkForConnection(connIDs.front());
             getBootstrapManager().onReceiveEncPkg(pkg, linkId, timeout);
-            return {SDK_OK, 0, NULL_RACE_HANDLE};
+            response = {SDK_OK, 0, NULL_RACE_HANDLE};
         } else {
             RaceHandle handle = generateHandle(pkg.getPackageType() == PKG_TYPE_TEST_HARNESS);
             auto [success, utilization] =
                 getNM(handle)->processEncPkg(handle, pkg, filteredConnectionIds, timeout);
             auto sdkStatus = success ? SDK_OK : SDK_QUEUE_FULL;
-            return {sdkStatus, utilization, handle};
+            response = {sdkStatus, utilization, handle};
+        }
+
+        for (const auto &connId : tracedConnectionIds) {
+            spanExporter->exportConnectionSpan("CONNECTION_RECV", connId, pkg.getSize(),
+                                               traceStart);
         }
+        return response;
     }
 }
 
@@ -2289,6 +2387,12 @@ void RaceSdk::cleanShutdown() {
             voaThread->stopThread();
         }
     }
+
+    if (spanExporter != nullptr) {
+        spanExporter->stop();
+    }
+
+    RaceLog::flush();
 }
 
 void RaceSdk::notifyShutdown(int numSeconds) {
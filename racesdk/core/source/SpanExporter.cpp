@@ -0,0 +1,138 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "SpanExporter.h"
+
+#include <opentracing/tracer.h>
+
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+#include "OpenTracingHelpers.h"
+#include "RaceSdk.h"
+#include "helper.h"
+
+SpanExporter::SpanExporter(RaceSdk &_sdk, size_t _maxQueuedSpans) :
+    sdk(_sdk), maxQueuedSpans(_maxQueuedSpans), started(false), stopped(false), dropped(0) {}
+
+SpanExporter::~SpanExporter() {
+    stop();
+}
+
+void SpanExporter::exportConnectionSpan(const char *operation, const ConnectionID &connectionId,
+                                        size_t size, std::chrono::steady_clock::time_point start) {
+    // opentracing wants the system time a span started at as well, so work it out from how long
+    // ago start was
+    const auto steadyNow = std::chrono::steady_clock::now();
+    const auto systemNow = std::chrono::system_clock::now();
+    PendingSpan span{operation,
+                     connectionId,
+                     size,
+                     systemNow - std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                     steadyNow - start),
+                     start,
+                     steadyNow};
+
+    bool wake;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (stopped || queued.size() >= maxQueuedSpans) {
+            dropped++;
+            return;
+        }
+        if (!started) {
+            started = true;
+            thread = std::thread(&SpanExporter::run, this);
+        }
+        wake = queued.empty();
+        queued.push_back(std::move(span));
+    }
+
+    // the thread drains everything that's queued when it wakes, so it only needs waking for the
+    // first span of a batch
+    if (wake) {
+        signaler.notify_one();
+    }
+}
+
+void SpanExporter::stop() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopped = true;
+    }
+    signaler.notify_one();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void SpanExporter::run() {
+    std::vector<PendingSpan> batch;
+    std::unique_lock<std::mutex> guard(lock);
+    while (true) {
+        signaler.wait(guard, [this] { return stopped || !queued.empty(); });
+        if (queued.empty()) {
+            break;
+        }
+
+        batch.swap(queued);
+        std::uint64_t batchDropped = dropped;
+        dropped = 0;
+        guard.unlock();
+
+        if (batchDropped > 0) {
+            helper::logWarning("SpanExporter: dropped " + std::to_string(batchDropped) +
+                               " package spans because the export queue was full");
+        }
+        for (const PendingSpan &span : batch) {
+            exportSpan(span);
+        }
+        batch.clear();
+
+        guard.lock();
+    }
+}
+
+void SpanExporter::exportSpan(const PendingSpan &span) {
+    const std::shared_ptr<opentracing::Tracer> &tracer = sdk.getTracer();
+    if (tracer == nullptr) {
+        return;
+    }
+
+    LinkID linkId;
+    try {
+        linkId = RaceLinks::getLinkIDFromConnectionID(span.connectionId);
+    } catch (const std::invalid_argument &) {
+        helper::logError("SpanExporter: not tracing invalid connection ID: " + span.connectionId);
+        return;
+    }
+
+    try {
+        auto ctx = spanContextFromIds(sdk.links->getTraceCtxForConnection(span.connectionId));
+        std::shared_ptr<opentracing::Span> otSpan = tracer->StartSpan(
+            span.operation, {opentracing::ChildOf(ctx.get()),
+                             opentracing::StartTimestamp(span.systemStart, span.steadyStart)});
+        otSpan->SetTag("connectionId", span.connectionId);
+        otSpan->SetTag("size", span.size);
+        sdk.traceLinkStatus(otSpan, linkId);
+        otSpan->Finish({opentracing::FinishTimestamp(span.steadyFinish)});
+    } catch (std::exception &e) {
+        helper::logError("SpanExporter: failed to export span for " + span.connectionId + ": " +
+                         e.what());
+    }
+}
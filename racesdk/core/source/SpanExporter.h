@@ -0,0 +1,105 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef __SPAN_EXPORTER_H__
+#define __SPAN_EXPORTER_H__
+
+#include <LinkProperties.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class RaceSdk;
+
+/**
+ * @brief Builds and finishes the CONNECTION_SEND and CONNECTION_RECV spans for packages on a
+ * background thread, so sending and receiving packages doesn't wait on building spans or on the
+ * RaceLinks lock needed to look up the connection's trace context and the link properties used to
+ * tag them.
+ *
+ * Spans are queued with only the connection ID, package size and timestamps, and the background
+ * thread exports everything queued in batches. If the queue is full, further spans are dropped
+ * rather than blocking the caller, and the number dropped is logged.
+ */
+class SpanExporter {
+public:
+    /**
+     * @brief Constructor. The background thread is started when the first span is queued.
+     *
+     * @param sdk The sdk, used for the tracer and to look up connections and links
+     * @param maxQueuedSpans The most spans that may be waiting to be exported
+     */
+    SpanExporter(RaceSdk &sdk, size_t maxQueuedSpans);
+    SpanExporter(const SpanExporter &) = delete;
+    SpanExporter &operator=(const SpanExporter &) = delete;
+
+    /**
+     * @brief Calls stop()
+     */
+    ~SpanExporter();
+
+    /**
+     * @brief Queue a span for a package sent or received on a connection. The span starts at start
+     * and finishes now, so it should be called once the sdk has handed the package on. The
+     * connection's trace context is looked up when the span is exported; if the connection has
+     * been closed by then, the span has no parent.
+     *
+     * @param operation The span's operation name, which must be a string literal
+     * @param connectionId The connection the package was sent or received on
+     * @param size The size of the package
+     * @param start When the sdk started handling the package
+     */
+    void exportConnectionSpan(const char *operation, const ConnectionID &connectionId, size_t size,
+                              std::chrono::steady_clock::time_point start);
+
+    /**
+     * @brief Export any queued spans and stop the background thread. Spans queued afterward are
+     * dropped.
+     */
+    void stop();
+
+private:
+    struct PendingSpan {
+        const char *operation;
+        ConnectionID connectionId;
+        size_t size;
+        std::chrono::system_clock::time_point systemStart;
+        std::chrono::steady_clock::time_point steadyStart;
+        std::chrono::steady_clock::time_point steadyFinish;
+    };
+
+    void run();
+    void exportSpan(const PendingSpan &span);
+
+    RaceSdk &sdk;
+    const size_t maxQueuedSpans;
+
+    std::mutex lock;
+    std::condition_variable signaler;
+    std::thread thread;
+    bool started;
+    bool stopped;
+    std::vector<PendingSpan> queued;
+    std::uint64_t dropped;
+};
+
+#endif
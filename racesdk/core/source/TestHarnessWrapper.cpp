@@ -76,7 +76,7 @@ std::tuple<bool, double> TestHarnessWrapper::processNMBypassMsg(RaceHandle handl
                      " traceId: " + helper::convertToHexString(newMsg.getTraceId()) +
                      " spanId: " + helper::convertToHexString(newMsg.getSpanId()));
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("receive", msgSize, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("receive", msgSize, timeout, [=] {
             helper::logDebug(
                 "Calling PluginNMTestHarness::processNMBypassMsg(), postId: " + postId +
                 " traceId: " + helper::convertToHexString(newMsg.getTraceId()) +
@@ -112,7 +112,6 @@ std::tuple<bool, double> TestHarnessWrapper::processNMBypassMsg(RaceHandle handl
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
@@ -132,7 +131,7 @@ std::tuple<bool, double> TestHarnessWrapper::openRecvConnection(RaceHandle handl
 
     helper::logDebug("Posting PluginNMTestHarness::openRecvConnection(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("open", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("open", 0, timeout, [=] {
             helper::logDebug("Calling PluginNMTestHarness::openRecvConnection(), postId: " +
                              postId);
             PluginResponse response;
@@ -157,7 +156,6 @@ std::tuple<bool, double> TestHarnessWrapper::openRecvConnection(RaceHandle handl
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
@@ -175,7 +173,7 @@ std::tuple<bool, double> TestHarnessWrapper::rpcDeactivateChannel(const std::str
 
     helper::logDebug("Posting PluginNMTestHarness::rpcDeactivateChannel(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("rpc", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("rpc", 0, timeout, [=] {
             helper::logDebug("Calling PluginNMTestHarness::rpcDeactivateChannel(), postId: " +
                              postId);
             PluginResponse response;
@@ -200,7 +198,6 @@ std::tuple<bool, double> TestHarnessWrapper::rpcDeactivateChannel(const std::str
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
@@ -218,7 +215,7 @@ std::tuple<bool, double> TestHarnessWrapper::rpcDestroyLink(const std::string &l
 
     helper::logDebug("Posting PluginNMTestHarness::rpcDestroyLink(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("rpc", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("rpc", 0, timeout, [=] {
             helper::logDebug("Calling PluginNMTestHarness::rpcDestroyLink(), postId: " + postId);
             PluginResponse response;
             try {
@@ -241,7 +238,6 @@ std::tuple<bool, double> TestHarnessWrapper::rpcDestroyLink(const std::string &l
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
@@ -259,7 +255,7 @@ std::tuple<bool, double> TestHarnessWrapper::rpcCloseConnection(const std::strin
 
     helper::logDebug("Posting PluginNMTestHarness::rpcCloseConnection(), postId: " + postId);
     try {
-        auto [success, queueSize, future] = mThreadHandler.post("rpc", 0, timeout, [=] {
+        auto [success, queueSize] = mThreadHandler.post_detached("rpc", 0, timeout, [=] {
             helper::logDebug("Calling PluginNMTestHarness::rpcCloseConnection(), postId: " +
                              postId);
             PluginResponse response;
@@ -284,7 +280,6 @@ std::tuple<bool, double> TestHarnessWrapper::rpcCloseConnection(const std::strin
             return std::make_optional(true);
         });
 
-        (void)future;
         double queueUtilization = (static_cast<double>(queueSize) / mThreadHandler.max_queue_size);
         return {success == Handler::PostStatus::OK, queueUtilization};
     } catch (std::out_of_range &error) {
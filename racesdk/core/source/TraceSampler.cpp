@@ -0,0 +1,58 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "TraceSampler.h"
+
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+#include "RaceLinks.h"
+
+TraceSampler::TraceSampler(double _sampleRate,
+                           std::unordered_map<std::string, double> _channelSampleRates) :
+    sampleRate(_sampleRate), channelSampleRates(std::move(_channelSampleRates)) {}
+
+double TraceSampler::getSampleRate(const ConnectionID &connectionId) const {
+    // the channel is only parsed out of the connection ID if there's an override to look up
+    if (channelSampleRates.empty()) {
+        return sampleRate;
+    }
+
+    try {
+        auto it = channelSampleRates.find(RaceLinks::getChannelFromLinkID(connectionId));
+        if (it != channelSampleRates.end()) {
+            return it->second;
+        }
+    } catch (const std::invalid_argument &) {
+        // not a generated connection ID, so the default applies
+    }
+    return sampleRate;
+}
+
+bool TraceSampler::sample(const ConnectionID &connectionId) const {
+    const double rate = getSampleRate(connectionId);
+    if (rate >= 1.0) {
+        return true;
+    } else if (rate <= 0.0) {
+        return false;
+    }
+
+    thread_local std::minstd_rand generator{std::random_device{}()};
+    std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    return distribution(generator) < rate;
+}
@@ -0,0 +1,64 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#ifndef __TRACE_SAMPLER_H__
+#define __TRACE_SAMPLER_H__
+
+#include <string>
+#include <unordered_map>
+
+#include "LinkProperties.h"
+
+/**
+ * @brief Decides which packages get an opentracing span. The decision is made when a package is
+ * sent or received, before any work is done to build the span, so packages that aren't sampled
+ * cost no more than a random number.
+ */
+class TraceSampler {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param sampleRate The fraction of packages to sample, from 0 to 1
+     * @param channelSampleRates Sample rates for specific channels, by channel GID, that override
+     * sampleRate
+     */
+    explicit TraceSampler(double sampleRate = 0.01,
+                          std::unordered_map<std::string, double> channelSampleRates = {});
+
+    /**
+     * @brief Decide whether to trace a package sent or received on a connection
+     *
+     * @param connectionId The connection the package was sent or received on
+     * @return true if the package should be traced
+     */
+    bool sample(const ConnectionID &connectionId) const;
+
+    /**
+     * @brief Get the sample rate that applies to a connection
+     *
+     * @param connectionId The connection
+     * @return The sample rate of the connection's channel
+     */
+    double getSampleRate(const ConnectionID &connectionId) const;
+
+private:
+    double sampleRate;
+    std::unordered_map<std::string, double> channelSampleRates;
+};
+
+#endif
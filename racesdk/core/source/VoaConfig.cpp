@@ -17,6 +17,9 @@
 
 #include "VoaConfig.h"
 
+#include <algorithm>
+#include <list>
+
 #include "helper.h"
 
 const std::string VoaConfig::VOA_CONF_ACTION = "action";
@@ -46,30 +49,117 @@ const std::string VoaConfig::VOA_TRIGGER_SKIPN = "skipN";
 const std::string VoaConfig::VOA_WINDOW_COUNT = "count";
 const std::string VoaConfig::VOA_WINDOW_DURATION = "duration";
 
-const std::string VoaConfig::VOA_STATE_COUNT = "count_state";
-const std::string VoaConfig::VOA_STATE_DURATION = "duration_state";
-const std::string VoaConfig::VOA_STATE_SKIPN = "skipN_state";
-
 const std::string VoaConfig::VOA_ACTION_DROP = "drop";
 const std::string VoaConfig::VOA_ACTION_DELAY = "delay";
 const std::string VoaConfig::VOA_ACTION_TAMPER = "tamper";
 const std::string VoaConfig::VOA_ACTION_REPLAY = "replay";
 
+// Get a numeric value from a rule's JSON map, if present. Values are strings in the
+// configuration, but plain JSON numbers are accepted as well.
+template <typename T, typename Convert>
+static std::optional<T> getNumber(const std::map<std::string, std::string> &values,
+                                  const std::string &key, Convert convert) {
+    auto it = values.find(key);
+    if (it == values.end()) {
+        return std::nullopt;
+    }
+    return convert(it->second);
+}
+
+VoaConfig::VoaRule::VoaRule(const std::string &_ruleId, const nlohmann::json &ruleItem,
+                            uint64_t _order, VoaRuleState &_state) :
+    ruleId(_ruleId),
+    racePersona(ruleItem.value(VOA_CONF_PERSONA, VOA_TARGET_MATCHID_ALL)),
+    tag(ruleItem.value(VOA_CONF_TAG, "")),
+    startupDelay(DEFAULT_STARTUPDELAY),
+    action(ruleItem.value(VOA_CONF_ACTION, VOA_ACTION_DELAY)),
+    targetType(TargetType::NONE),
+    replayTimes(DEFAULT_REPLAYTIMES),
+    iterations(DEFAULT_MANGLETIMES),
+    order(_order),
+    state(&_state) {
+    using StringMap = std::map<std::string, std::string>;
+    auto toFloat = [](const std::string &value) { return static_cast<double>(std::stof(value)); };
+    auto toInt = [](const std::string &value) { return std::stoi(value); };
+    auto toUnsigned = [](const std::string &value) { return std::stoul(value); };
+
+    std::string startupDelayStr = ruleItem.value(VOA_CONF_STARTUP_DELAY, "");
+    if (!startupDelayStr.empty()) {
+        startupDelay = toFloat(startupDelayStr);
+    }
+
+    StringMap to = ruleItem.value(VOA_CONF_TO, StringMap());
+    auto type = to.find(VOA_TARGET_TYPE);
+    auto matchId = to.find(VOA_TARGET_MATCHID);
+    if (type != to.end() && matchId != to.end()) {
+        targetId = matchId->second;
+        if (targetId == VOA_TARGET_MATCHID_ALL) {
+            // "all" matches any destination
+            targetType = TargetType::ALL;
+        } else if (type->second == VOA_TARGET_TYPE_PERSONA) {
+            targetType = TargetType::PERSONA;
+        } else if (type->second == VOA_TARGET_TYPE_LINK) {
+            targetType = TargetType::LINK;
+        } else if (type->second == VOA_TARGET_TYPE_CHANNEL) {
+            targetType = TargetType::CHANNEL;
+        }
+    }
+
+    StringMap params = ruleItem.value(VOA_CONF_PARAMS, StringMap());
+    holdTime = getNumber<double>(params, VOA_PARAMS_HOLDTIME, toFloat);
+    jitter = getNumber<double>(params, VOA_PARAMS_JITTER, toFloat);
+    replayTimes = getNumber<unsigned long>(params, VOA_PARAMS_REPLAYTIMES, toUnsigned)
+                      .value_or(DEFAULT_REPLAYTIMES);
+    iterations = getNumber<unsigned long>(params, VOA_PARAMS_ITERATIONS, toUnsigned)
+                     .value_or(DEFAULT_MANGLETIMES);
+
+    StringMap trigger = ruleItem.value(VOA_CONF_TRIGGER, StringMap());
+    triggerSkipN = getNumber<int>(trigger, VOA_TRIGGER_SKIPN, toInt);
+    triggerProb = getNumber<double>(trigger, VOA_TRIGGER_PROB, toFloat);
+
+    StringMap window = ruleItem.value(VOA_CONF_WINDOW, StringMap());
+    windowCount = getNumber<double>(window, VOA_WINDOW_COUNT, toFloat);
+    windowDuration = getNumber<double>(window, VOA_WINDOW_DURATION, toFloat);
+}
+
+bool VoaConfig::VoaRule::matches(const std::string &activePersona, const LinkID &linkId,
+                                 const std::string &channelGid,
+                                 const personas::PersonaSet &personas) const {
+    // The persona must match
+    if (racePersona != VOA_TARGET_MATCHID_ALL && (racePersona != activePersona)) {
+        return false;
+    }
+
+    switch (targetType) {
+        case TargetType::ALL:
+            return true;
+        case TargetType::PERSONA:
+            return personas.count(targetId) != 0;
+        case TargetType::LINK:
+            return linkId == targetId;
+        case TargetType::CHANNEL:
+            return channelGid == targetId;
+        case TargetType::NONE:
+            break;
+    }
+
+    // We need a positive match
+    return false;
+}
+
 VoaConfig::VoaConfig(const std::string &voaConfigPath) :
-    JsonConfig(voaConfigPath), mRnd(std::random_device{}()) {
+    JsonConfig(voaConfigPath), mRnd(std::random_device{}()), nextRuleOrder(0), ruleCount(0) {
     helper::logDebug("VoaConfig::Constructor called");
 
     try {
         // Create a list of VoA rules from the Json config list
-        auto configItems = configJson.items();
-        std::transform(
-            configItems.begin(), configItems.end(), std::back_inserter(voaRules),
-            [](auto configItem) { return VoaRule(configItem.key(), configItem.value()); });
+        appendRules(configJson);
     } catch (std::exception &error) {
         helper::logError("VoaConfig: failed to parse VoA configuration: " +
                          std::string(error.what()));
         voaRules = {};
     }
+    rebuildIndex();
 
     std::chrono::duration<double> now = std::chrono::system_clock::now().time_since_epoch();
     startupTimestamp = now.count();
@@ -77,20 +167,58 @@ VoaConfig::VoaConfig(const std::string &voaConfigPath) :
     helper::logDebug("VoaConfig::Constructor returned");
 }
 
+void VoaConfig::appendRules(const nlohmann::json &rules) {
+    // Compile every rule before adding any, so a bad rule doesn't leave the rules half-added
+    std::vector<VoaRulePtr> compiled;
+    uint64_t order = nextRuleOrder;
+    for (auto &item : rules.items()) {
+        compiled.push_back(
+            std::make_shared<VoaRule>(item.key(), item.value(), order++, ruleState[item.key()]));
+    }
+    voaRules.insert(voaRules.end(), compiled.begin(), compiled.end());
+    nextRuleOrder = order;
+}
+
+void VoaConfig::rebuildIndex() {
+    rulesForAll.clear();
+    rulesByPersona.clear();
+    rulesByLink.clear();
+    rulesByChannel.clear();
+
+    for (auto &rule : voaRules) {
+        switch (rule->targetType) {
+            case VoaRule::TargetType::ALL:
+                rulesForAll.push_back(rule);
+                break;
+            case VoaRule::TargetType::PERSONA:
+                rulesByPersona[rule->targetId].push_back(rule);
+                break;
+            case VoaRule::TargetType::LINK:
+                rulesByLink[rule->targetId].push_back(rule);
+                break;
+            case VoaRule::TargetType::CHANNEL:
+                rulesByChannel[rule->targetId].push_back(rule);
+                break;
+            case VoaRule::TargetType::NONE:
+                // can never match a package
+                break;
+        }
+    }
+    ruleCount = voaRules.size();
+}
+
 bool VoaConfig::addRules(const nlohmann::json &payload) {
     std::lock_guard<std::mutex> lock{voa_config_mutex};
 
     try {
         // Create the VoA rules from the Json config list
-        auto configItems = payload.items();
-        std::transform(
-            configItems.begin(), configItems.end(), std::back_inserter(voaRules),
-            [](auto configItem) { return VoaRule(configItem.key(), configItem.value()); });
+        appendRules(payload);
     } catch (std::exception &error) {
         helper::logError("VoaConfig: failed to parse VoA command configuration: " +
                          std::string(error.what()));
         return false;
     }
+    rebuildIndex();
     return true;
 }
 
@@ -103,19 +231,22 @@ bool VoaConfig::deleteRules(const nlohmann::json &payload) {
         // Remove all rules if the list of rule Ids is empty
         if (rule_ids.empty()) {
             voaRules.clear();
+            rebuildIndex();
             return true;
         }
 
         // Remove rules that are present in the list of ruleids
-        auto removeIt = std::remove_if(voaRules.begin(), voaRules.end(), [&](auto r) -> bool {
-            return (std::find(rule_ids.begin(), rule_ids.end(), r.ruleId) != rule_ids.end());
-        });
+        auto removeIt =
+            std::remove_if(voaRules.begin(), voaRules.end(), [&](const VoaRulePtr &r) -> bool {
+                return (std::find(rule_ids.begin(), rule_ids.end(), r->ruleId) != rule_ids.end());
+            });
 
         if (removeIt == voaRules.end()) {
             return false;
         }
 
         voaRules.erase(removeIt, voaRules.end());
+        rebuildIndex();
 
     } catch (std::exception &error) {
         helper::logError("VoaConfig: failed to parse VoA command configuration: " +
@@ -126,107 +257,139 @@ bool VoaConfig::deleteRules(const nlohmann::json &payload) {
     return true;
 }
 
-std::vector<VoaConfig::VoaRule> VoaConfig::findTargetedRules(
-    std::string activePersona, LinkID linkId, std::string channelGid,
-    std::vector<std::string> &personaList) {
+VoaConfig::VoaRulePtr VoaConfig::findTriggeredRule(const std::string &activePersona,
+                                                   const LinkID &linkId,
+                                                   const std::string &channelGid,
+                                                   const personas::PersonaSet &personas,
+                                                   double currentTimestamp) {
     std::lock_guard<std::mutex> lock{voa_config_mutex};
 
-    std::vector<VoaConfig::VoaRule> matchedRule;
+    // Gather the rules targeting this package from the index. Each rule is indexed under its one
+    // target, so no rule is gathered twice.
+    std::vector<const VoaRulePtr *> candidates;
+    auto addCandidates = [&candidates](const std::vector<VoaRulePtr> &rules) {
+        for (auto &rule : rules) {
+            candidates.push_back(&rule);
+        }
+    };
+    auto addIndexed = [&addCandidates](
+                          const std::unordered_map<std::string, std::vector<VoaRulePtr>> &index,
+                          const std::string &key) {
+        auto it = index.find(key);
+        if (it != index.end()) {
+            addCandidates(it->second);
+        }
+    };
+
+    addCandidates(rulesForAll);
+    addIndexed(rulesByLink, linkId);
+    addIndexed(rulesByChannel, channelGid);
+    if (!rulesByPersona.empty()) {
+        for (auto &persona : personas) {
+            addIndexed(rulesByPersona, persona);
+        }
+    }
+
+    if (candidates.empty()) {
+        return nullptr;
+    }
+
+    // Rules are checked in configuration order, as the first active rule is the one applied
+    std::sort(candidates.begin(), candidates.end(),
+              [](const VoaRulePtr *a, const VoaRulePtr *b) { return (*a)->order < (*b)->order; });
 
-    // Simply do a sequential search for now. This search should be optimized in
-    // the future.
-    for (auto voaRule : voaRules) {
-        if (voaRule.matches(activePersona, linkId, channelGid, personaList)) {
-            matchedRule.push_back(voaRule);
+    for (const VoaRulePtr *candidate : candidates) {
+        const VoaRulePtr &rule = *candidate;
+        if (!rule->matches(activePersona, linkId, channelGid, personas) ||
+            !isActive(*rule, currentTimestamp)) {
+            continue;
         }
+
+        helper::logDebug("VoaConfig::findTriggeredRule: found active rule:" + rule->ruleId);
+
+        // Check if rule application window is triggered
+        if (!isTriggered(*rule)) {
+            return nullptr;
+        }
+
+        return rule;
     }
-    return matchedRule;
+
+    helper::logDebug("VoaConfig::findTriggeredRule no rules are active");
+    return nullptr;
 }
 
-std::optional<VoaConfig::VoaRule> VoaConfig::getRuleForId(const std::string &ruleId) {
+VoaConfig::VoaRulePtr VoaConfig::getRuleForId(const std::string &ruleId) {
     std::lock_guard<std::mutex> lock{voa_config_mutex};
 
-    std::list<VoaRule>::iterator it =
-        std::find_if(voaRules.begin(), voaRules.end(),
-                     [&](const VoaConfig::VoaRule &r) { return r.ruleId == ruleId; });
+    auto it = std::find_if(voaRules.begin(), voaRules.end(),
+                           [&](const VoaRulePtr &r) { return r->ruleId == ruleId; });
     if (it == std::end(voaRules)) {
-        return std::nullopt;
+        return nullptr;
     }
     return *it;
 }
 
-template <typename KEY, typename VAL>
-bool VoaConfig::keyInMap(const std::map<KEY, VAL> &mapName, const std::string &key) {
-    if (mapName.empty() || (mapName.find(key) == mapName.end())) {
-        return false;
-    }
-    return true;
+bool VoaConfig::hasRules() const {
+    return ruleCount != 0;
 }
 
-bool VoaConfig::isActive(VoaConfig::VoaRule rule, double currentTimestamp) {
-    double waitTime = rule.getRuleStartupDelay();
-
+bool VoaConfig::isActive(const VoaConfig::VoaRule &rule, double currentTimestamp) {
     // Ensure that we've waited long enough to startup
-    if ((currentTimestamp - startupTimestamp) < waitTime) {
+    if ((currentTimestamp - startupTimestamp) < rule.startupDelay) {
         helper::logDebug(
             "VoaConfig::isActive - skipping until startup "
             "time (cur/start/wait) " +
             std::to_string(currentTimestamp) + " " + std::to_string(startupTimestamp) + " " +
-            std::to_string(waitTime));
+            std::to_string(rule.startupDelay));
         return false;
     }
 
-    if (keyInMap(rule.window, VOA_WINDOW_COUNT)) {
-        if (!keyInMap(ruleState, rule.ruleId) ||
-            !keyInMap(ruleState[rule.ruleId], VOA_STATE_COUNT)) {
-            ruleState[rule.ruleId][VOA_STATE_COUNT] = 0.0;
-        }
-        if (ruleState[rule.ruleId][VOA_STATE_COUNT] >= stof(rule.window[VOA_WINDOW_COUNT])) {
+    VoaRuleState &state = *rule.state;
+    if (rule.windowCount) {
+        if (state.count >= *rule.windowCount) {
             helper::logDebug("VoaConfig::isActive reached count_state=" +
-                             std::to_string(ruleState[rule.ruleId][VOA_STATE_COUNT]));
+                             std::to_string(state.count));
             return false;
         } else {
-            ruleState[rule.ruleId][VOA_STATE_COUNT] += 1.0;
+            state.count += 1.0;
         }
-    } else if (keyInMap(rule.window, VOA_WINDOW_DURATION)) {
-        if (!keyInMap(ruleState, rule.ruleId) ||
-            !keyInMap(ruleState[rule.ruleId], VOA_STATE_DURATION)) {
-            double durationTimestamp = currentTimestamp + stof(rule.window[VOA_WINDOW_DURATION]);
-            ruleState[rule.ruleId][VOA_STATE_DURATION] = durationTimestamp;
+    } else if (rule.windowDuration) {
+        if (!state.durationEnd) {
+            state.durationEnd = currentTimestamp + *rule.windowDuration;
         }
-        if (currentTimestamp >= ruleState[rule.ruleId][VOA_STATE_DURATION]) {
+        if (currentTimestamp >= *state.durationEnd) {
             helper::logDebug("VoaConfig::isActive reached duration_state=" +
-                             std::to_string(ruleState[rule.ruleId][VOA_STATE_DURATION]));
+                             std::to_string(*state.durationEnd));
             return false;
         }
     }
     return true;
 }
 
-bool VoaConfig::isTriggered(VoaConfig::VoaRule rule) {
-    if (keyInMap(rule.trigger, VOA_TRIGGER_SKIPN)) {
-        if (keyInMap(ruleState, rule.ruleId) && keyInMap(ruleState[rule.ruleId], VOA_STATE_SKIPN)) {
-            ruleState[rule.ruleId][VOA_STATE_SKIPN]++;
+bool VoaConfig::isTriggered(const VoaConfig::VoaRule &rule) {
+    VoaRuleState &state = *rule.state;
+    if (rule.triggerSkipN) {
+        if (state.skipN) {
+            ++*state.skipN;
         } else {
-            ruleState[rule.ruleId][VOA_STATE_SKIPN] = 0;
+            state.skipN = 0;
         }
         // apply the rule after every N packets
-        int skipNval = static_cast<int>(ruleState[rule.ruleId][VOA_STATE_SKIPN]);
-        int skipNparam = stoi(rule.trigger[VOA_TRIGGER_SKIPN]);
+        int skipNval = *state.skipN;
+        int skipNparam = *rule.triggerSkipN;
         // Trigger every Nth package
         if ((skipNparam == 0) || (skipNval % skipNparam == 0)) {
-            helper::logDebug("VoaConfig::isTriggered TRUE skipN=" +
-                             std::to_string(ruleState[rule.ruleId][VOA_STATE_SKIPN]));
-            ruleState[rule.ruleId][VOA_STATE_SKIPN] = 0;
+            helper::logDebug("VoaConfig::isTriggered TRUE skipN=" + std::to_string(skipNval));
+            state.skipN = 0;
             return true;
         }
-        helper::logDebug("VoaConfig::isTriggered FALSE skipN=" +
-                         std::to_string(ruleState[rule.ruleId][VOA_STATE_SKIPN]));
+        helper::logDebug("VoaConfig::isTriggered FALSE skipN=" + std::to_string(skipNval));
         return false;
-    } else if (keyInMap(rule.trigger, VOA_TRIGGER_PROB)) {
+    } else if (rule.triggerProb) {
         std::uniform_real_distribution<double> distribution(0.0, 1.0);
-        float calcProb = distribution(mRnd);
-        if (calcProb < stof(rule.trigger[VOA_TRIGGER_PROB])) {
+        float calcProb = static_cast<float>(distribution(mRnd));
+        if (calcProb < *rule.triggerProb) {
             helper::logDebug("VoaConfig::isTriggered TRUE prob=" + std::to_string(calcProb));
             return true;
         }
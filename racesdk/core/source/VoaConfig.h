@@ -20,10 +20,13 @@
 
 #include <stdlib.h>
 
-#include <list>
+#include <atomic>
+#include <memory>
 #include <nlohmann/json.hpp>
 #include <optional>
 #include <random>
+#include <unordered_map>
+#include <vector>
 
 #include "../include/RaceSdk.h"
 #include "JsonConfig.h"
@@ -180,10 +183,6 @@ public:
     static const std::string VOA_WINDOW_COUNT;
     static const std::string VOA_WINDOW_DURATION;
 
-    static const std::string VOA_STATE_COUNT;
-    static const std::string VOA_STATE_DURATION;
-    static const std::string VOA_STATE_SKIPN;
-
 public:
     /**
      * @brief Constructor.
@@ -193,10 +192,26 @@ public:
     explicit VoaConfig(const std::string &voaConfigPath);
 
     /**
-     * @brief Representation of a single VoA rule
+     * @brief Per-rule state for windows and triggers. Shared by rules with the same identifier, and
+     * kept when a rule is deleted so that re-adding it continues where it left off.
+     */
+    struct VoaRuleState {
+        // Number of packages seen while the count window was open
+        double count = 0;
+        // Time at which the duration window closes, set when the rule is first evaluated
+        std::optional<double> durationEnd;
+        // Number of packages seen since the rule was last triggered by skipN
+        std::optional<int> skipN;
+    };
+
+    /**
+     * @brief Representation of a single VoA rule, compiled from its JSON configuration. Numeric
+     * values are parsed once when the rule is added rather than each time a package is checked.
      *
      */
     struct VoaRule {
+        enum class TargetType { NONE, ALL, PERSONA, LINK, CHANNEL };
+
         // The rule identifier
         std::string ruleId;
         // The active persona associated with a race node
@@ -204,130 +219,68 @@ public:
         // A tag string to include in opentracing logs
         std::string tag;
         // The startup delay associated with this rule
-        std::string startupDelay;
+        double startupDelay;
         // The VoA action associated with this rule
         std::string action;
-        // a set of tuples specifying the package originator
-        // std::map<std::string, std::string> from;
-        // a set of tuples specifying the package destination
-        std::map<std::string, std::string> to;
-        // A set of tuples that supply parameters for the VoA action
-        std::map<std::string, std::string> params;
-        // A set of tuples that supply rule trigger parameters
-        std::map<std::string, std::string> trigger;
-        // A set of tuples that supply rule span  parameters
-        std::map<std::string, std::string> window;
+        // The kind of package destination the rule applies to. NONE never matches.
+        TargetType targetType;
+        // The persona, link, or channel to match, depending on targetType
+        std::string targetId;
+        // Action parameters
+        std::optional<double> holdTime;
+        std::optional<double> jitter;
+        unsigned long replayTimes;
+        unsigned long iterations;
+        // Trigger parameters
+        std::optional<int> triggerSkipN;
+        std::optional<double> triggerProb;
+        // Window parameters
+        std::optional<double> windowCount;
+        std::optional<double> windowDuration;
+        // Position of the rule in the configuration. Earlier rules take precedence.
+        uint64_t order;
+        // Window and trigger state, owned by VoaConfig
+        VoaRuleState *state;
 
         /**
          * @brief Constructor to create a VoA rule object
          *
          * @param _ruleId An identifier for the rule
          * @param ruleItem A JSON representation of the rule
+         * @param _order The position of the rule in the configuration
+         * @param _state The state for the rule identifier
          */
-        VoaRule(const std::string &_ruleId, nlohmann::json ruleItem) :
-            ruleId(_ruleId),
-            racePersona(ruleItem.value(VOA_CONF_PERSONA, VOA_TARGET_MATCHID_ALL)),
-            tag(ruleItem.value(VOA_CONF_TAG, "")),
-            startupDelay(ruleItem.value(VOA_CONF_STARTUP_DELAY, "")),
-            action(ruleItem.value(VOA_CONF_ACTION, VOA_ACTION_DELAY)),
-            to(ruleItem.value(VOA_CONF_TO, (std::map<std::string, std::string>()))),
-            params(ruleItem.value(VOA_CONF_PARAMS, (std::map<std::string, std::string>()))),
-            trigger(ruleItem.value(VOA_CONF_TRIGGER, (std::map<std::string, std::string>()))),
-            window(ruleItem.value(VOA_CONF_WINDOW, (std::map<std::string, std::string>()))) {}
-
-        /**
-         * @brief Get the configured startup delay time
-         *
-         */
-        double getRuleStartupDelay() {
-            if (startupDelay == "") {
-                return DEFAULT_STARTUPDELAY;
-            }
-            return stof(startupDelay);
-        }
+        VoaRule(const std::string &_ruleId, const nlohmann::json &ruleItem, uint64_t _order,
+                VoaRuleState &_state);
 
         /**
          * @brief Get the configured hold time
          *
          * @param randWeight A random value between 0 and 1 used to weight the jitter value
          */
-        double getHoldTimeParam(float randWeight) {
-            if (keyInMap(params, VOA_PARAMS_HOLDTIME)) {
-                return stof(params[VOA_PARAMS_HOLDTIME]);
-            } else if (keyInMap(params, VOA_PARAMS_JITTER)) {
-                float jitter = stof(params[VOA_PARAMS_JITTER]) * randWeight;
-                return jitter;
+        double getHoldTimeParam(float randWeight) const {
+            if (holdTime) {
+                return *holdTime;
+            } else if (jitter) {
+                return *jitter * randWeight;
             }
             return DEFAULT_HOLDTIME;
         }
 
-        /**
-         * @brief Get the configured replay count
-         *
-         */
-        unsigned long getReplayTimesParam() {
-            if (keyInMap(params, VOA_PARAMS_REPLAYTIMES)) {
-                return std::stoul(params[VOA_PARAMS_REPLAYTIMES]);
-            }
-            return DEFAULT_REPLAYTIMES;
-        }
-
-        /**
-         * @brief Get the configured iterations value
-         *
-         */
-        unsigned long getIterationsParam() {
-            if (keyInMap(params, VOA_PARAMS_ITERATIONS)) {
-                return std::stoul(params[VOA_PARAMS_ITERATIONS]);
-            }
-            return DEFAULT_MANGLETIMES;
-        }
-
         /**
          * @brief Logic for matching rules against provided parameters
          *
          * @param activePersona The active persona of the race node
          * @param linkId The link used by sendEncryptedPackage()
-         * @param personaList the personas associated with this link
+         * @param channelGid The channel of the link
+         * @param personas the personas associated with this link
          */
         bool matches(const std::string &activePersona, const LinkID &linkId,
-                     const std::string &channelGid, std::vector<std::string> &personaList) {
-            // The persona must match
-            if (racePersona != VOA_TARGET_MATCHID_ALL && (racePersona != activePersona)) {
-                return false;
-            }
-
-            // check if we have necessary config to process the destination
-            if (keyInMap(to, VOA_TARGET_TYPE) && keyInMap(to, VOA_TARGET_MATCHID)) {
-                // "all" matches any destination
-                if (to[VOA_TARGET_MATCHID] == VOA_TARGET_MATCHID_ALL) {
-                    return true;
-                }
-                // find a matching persona in the list
-                if (to[VOA_TARGET_TYPE] == VOA_TARGET_TYPE_PERSONA) {
-                    std::vector<std::string>::iterator it =
-                        std::find(personaList.begin(), personaList.end(), to[VOA_TARGET_MATCHID]);
-                    if (it != personaList.end()) {
-                        return true;
-                    }
-                }
-                // check if the linkId matches
-                if ((to[VOA_TARGET_TYPE] == VOA_TARGET_TYPE_LINK) &&
-                    (linkId == to[VOA_TARGET_MATCHID])) {
-                    return true;
-                }
-                // check if the channelId matches
-                if ((to[VOA_TARGET_TYPE] == VOA_TARGET_TYPE_CHANNEL) &&
-                    (channelGid == to[VOA_TARGET_MATCHID])) {
-                    return true;
-                }
-            }
-
-            // We need a positive match
-            return false;
-        }
+                     const std::string &channelGid, const personas::PersonaSet &personas) const;
     };
 
+    using VoaRulePtr = std::shared_ptr<const VoaRule>;
+
     /**
      * @brief Add a new rule from the given configuration
      *
@@ -346,10 +299,24 @@ private:
     // Random engine for probablistic actions
     std::default_random_engine mRnd;
 
-    // List of rules extracted from given configuration
-    std::list<VoaRule> voaRules;
+    // List of rules extracted from given configuration, in configuration order
+    std::vector<VoaRulePtr> voaRules;
 
-    std::map<std::string, std::map<std::string, float>> ruleState;
+    // Index of voaRules by target, so only rules that can match a package are checked. Each list is
+    // in configuration order.
+    std::vector<VoaRulePtr> rulesForAll;
+    std::unordered_map<std::string, std::vector<VoaRulePtr>> rulesByPersona;
+    std::unordered_map<std::string, std::vector<VoaRulePtr>> rulesByLink;
+    std::unordered_map<std::string, std::vector<VoaRulePtr>> rulesByChannel;
+
+    // Window and trigger state by rule identifier. Node-based, so VoaRule::state stays valid.
+    std::unordered_map<std::string, VoaRuleState> ruleState;
+
+    // Position to give the next rule added
+    uint64_t nextRuleOrder;
+
+    // Number of rules, readable without taking voa_config_mutex
+    std::atomic<size_t> ruleCount;
 
     // A mutex object that mediates access to the list of configuration rules
     std::mutex voa_config_mutex;
@@ -357,51 +324,66 @@ private:
     // Timestamp associated when config started up
     double startupTimestamp;
 
-public:
     /**
-     * @brief Find matching rules for given selection criteria
+     * @brief Compile rules from a JSON object of rule-ID to rule and append them to voaRules.
+     * Must be called with voa_config_mutex held.
      *
-     * @param activePersona The active persona of the race node
-     * @param linkId The link used by sendEncryptedPackage()
-     * @param personaList the personas associated with this link
+     * @param rules The rules to add
      */
-    std::vector<VoaRule> findTargetedRules(std::string activePersona, LinkID linkId,
-                                           std::string channelGid,
-                                           std::vector<std::string> &personaList);
+    void appendRules(const nlohmann::json &rules);
 
     /**
-     * @brief Return the rule corresponding to the given ruleId
-     *
+     * @brief Rebuild the target index from voaRules. Must be called with voa_config_mutex held.
      */
-    std::optional<VoaRule> getRuleForId(const std::string &ruleId);
-
-    /**
-     * @brief Convenience function to check if key exists in map
-     *
-     * @param mapName the map within which to check
-     * @param key the key to look for
-     */
-    template <typename KEY, typename VAL>
-    static bool keyInMap(const std::map<KEY, VAL> &mapName, const std::string &key);
+    void rebuildIndex();
 
     /**
      * @brief Check if VoA is active
      *
      * Check if VoA processing should be applied based on number of packages
      * processed (if there is a limit), and whether there is a
-     * configured duration.
+     * configured duration. Must be called with voa_config_mutex held.
      *
      * @param rule The rule to check against
      * @param currentTimestamp The current timestamp
      */
-    bool isActive(VoaRule rule, double currentTimestamp);
+    bool isActive(const VoaRule &rule, double currentTimestamp);
 
     /**
-     * @brief Check if VoA is triggered for the current package.
+     * @brief Check if VoA is triggered for the current package. Must be called with
+     * voa_config_mutex held.
      *
      * @param rule The rule to check against
      */
-    bool isTriggered(VoaRule rule);
+    bool isTriggered(const VoaRule &rule);
+
+public:
+    /**
+     * @brief Find the rule to apply to a package: the first matching rule, in configuration order,
+     * that is active. Updates the window and trigger state of the rules checked.
+     *
+     * @param activePersona The active persona of the race node
+     * @param linkId The link used by sendEncryptedPackage()
+     * @param channelGid The channel of the link
+     * @param personas the personas associated with this link
+     * @param currentTimestamp The current timestamp
+     * @return The rule, or nullptr if no rule is active or the active rule was not triggered
+     */
+    VoaRulePtr findTriggeredRule(const std::string &activePersona, const LinkID &linkId,
+                                 const std::string &channelGid,
+                                 const personas::PersonaSet &personas, double currentTimestamp);
+
+    /**
+     * @brief Return the rule corresponding to the given ruleId
+     *
+     */
+    VoaRulePtr getRuleForId(const std::string &ruleId);
+
+    /**
+     * @brief Check if there are any rules
+     *
+     */
+    bool hasRules() const;
 };
 
 #endif
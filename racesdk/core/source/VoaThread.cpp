@@ -22,14 +22,14 @@
 #include "VoaConfig.h"
 #include "helper.h"
 
-VoaThread::VoaThread(RaceSdk &sdk, const std::string &configPath) :
+VoaThread::VoaThread(RaceSdk &sdk, const std::string &configPath, size_t _maxQueuedBytes) :
     raceSdk(sdk),
     voaConfig(configPath),
     voaActiveState(true),
     mRnd(std::random_device{}()),
-    voaQueue([](const std::shared_ptr<VoaWorkItem> &v1, const std::shared_ptr<VoaWorkItem> &v2) {
-        return v1->holdTimestamp > v2->holdTimestamp;
-    }) {
+    maxQueuedBytes(_maxQueuedBytes),
+    queuedBytes(0),
+    nextSendId(0) {
     helper::logDebug("VoaThread::VoaThread constructor called with config:" + configPath);
     voa_thread_state.store(State::STOPPED);
 }
@@ -37,86 +37,9 @@ VoaThread::VoaThread(RaceSdk &sdk, const std::string &configPath) :
 void VoaThread::startThread() {
     helper::logDebug("VoaThread::startThread  called");
     std::lock_guard<std::mutex> lock(voa_queue_mutex);
-    voa_thread = std::thread(&VoaThread::runVoaThread, this);
     voa_thread_state.store(State::STARTED);
 }
 
-void VoaThread::runVoaThread() {
-    helper::logDebug("VoaThread::runVoaThread called");
-    while (true) {
-        using TimePoint =
-            std::chrono::time_point<std::chrono::system_clock, std::chrono::duration<double>>;
-        using Duration = TimePoint::duration;
-
-        std::unique_lock<std::mutex> lock(voa_queue_mutex);
-
-        // check state prior to waiting
-        if (voa_thread_state.load() == State::STOPPED) {
-            helper::logInfo("VoaThread::runVoaThread stopping thread.");
-            break;
-        }
-
-        if (voaQueue.empty()) {
-            helper::logDebug("VoaThread::runVoaThread: Waiting until lock notify");
-            voa_thread_signaler.wait(lock);
-        } else {
-            double holdTimestamp = (*voaQueue.top()).holdTimestamp;
-            std::chrono::duration<double> now = std::chrono::system_clock::now().time_since_epoch();
-            if (holdTimestamp > now.count()) {
-                helper::logDebug("VoaThread::runVoaThread: Waiting until:" +
-                                 std::to_string(holdTimestamp));
-                TimePoint nextTimestamp = TimePoint{Duration{holdTimestamp}};
-                voa_thread_signaler.wait_until(lock, nextTimestamp);
-            }
-        }
-
-        // check if we should stop
-        if (voa_thread_state.load() == State::STOPPED) {
-            helper::logInfo("VoaThread::runVoaThread stopping thread.");
-            break;
-        }
-
-        // Hold time reached or notifiy received
-        // Process entries in the queue
-        std::chrono::duration<double> now = std::chrono::system_clock::now().time_since_epoch();
-        helper::logDebug("VoaThread::runVoaThread: woke up at:" + std::to_string(now.count()));
-        if (voaQueue.size() == 0) {
-            helper::logDebug(
-                "VoaThread::runVoaThread: empty queue. "
-                "Going back to sleep");
-            continue;
-        }
-
-        auto voaIt = voaQueue.top();
-        auto currItem = *voaIt;
-        helper::logDebug("VoaThread::runVoaThread: checking holdTimeStamp=" +
-                         std::to_string(currItem.holdTimestamp) +
-                         " at time=" + std::to_string(now.count()));
-
-        if (currItem.holdTimestamp > now.count()) {
-            helper::logDebug(
-                "VoaThread::runVoaThread: spurious wakeup. "
-                "Going back to sleep");
-            continue;
-        }
-
-        helper::logDebug("VoaThread::runVoaThread: invoking callback.");
-        // Don't hold the lock while we perform the callback
-        lock.unlock();
-        SdkResponse response = currItem.callback();
-        lock.lock();
-        if (response.status != SDK_OK) {
-            helper::logInfo("VoaThread::runVoaThread: failed callback for handle:" +
-                            std::to_string(response.handle) +
-                            " with status:" + sdkStatusToString(response.status));
-        }
-        voaQueue.pop();
-        helper::logDebug("VoaThread::process: voaQueue size after work removed:" +
-                         std::to_string(voaQueue.size()));
-    }
-    helper::logInfo("VoaThread::runVoaThread returning from thread.");
-}
-
 // This routine was copied from plugin-comms-twosix-cpp/source/base/Link.cpp
 // Ideally, comms plugins should be able to use the SDK implementation
 EncPkg VoaThread::corruptPackage(const EncPkg &pkg, uint32_t corruptAmout) {
@@ -135,43 +58,25 @@ EncPkg VoaThread::corruptPackage(const EncPkg &pkg, uint32_t corruptAmout) {
     return newPkg;
 }
 
-std::list<std::pair<EncPkg, double>> VoaThread::getVoaPkgQueue(
-    const EncPkg &ePkg, std::string activePersona, LinkID linkId, std::string channelGid,
-    std::vector<std::string> &personaList) {
+std::vector<VoaWorkItem> VoaThread::getVoaPkgQueue(
+    const EncPkg &ePkg, const std::string &activePersona, const LinkID &linkId,
+    const std::string &channelGid, const personas::PersonaSet &personas) {
     // No lock should be needed here since we are simply constructing a list
 
-    std::list<std::pair<EncPkg, double>> pkgQueue;
+    std::vector<VoaWorkItem> pkgQueue;
 
     std::uniform_real_distribution<double> distribution(0.0, 1.0);
 
-    std::vector<VoaConfig::VoaRule> ruleVector =
-        voaConfig.findTargetedRules(activePersona, linkId, channelGid, personaList);
-
-    if (ruleVector.empty()) {
-        return {};
-    }
-
     std::chrono::duration<double> now = std::chrono::system_clock::now().time_since_epoch();
     double currentTimestamp = now.count();
 
-    // retrieve first active rule
-    std::vector<VoaConfig::VoaRule>::iterator it = std::find_if(
-        ruleVector.begin(), ruleVector.end(),
-        [&](const VoaConfig::VoaRule &rule) { return voaConfig.isActive(rule, currentTimestamp); });
-
-    if (it == std::end(ruleVector)) {
-        helper::logDebug("VoaThread::getVoaPkgQueue no rules are active");
-        return {};
-    }
-
-    VoaConfig::VoaRule rule = *it;
-    helper::logDebug("VoaConfig::getVoaPkgQueue: found active rule:" + rule.ruleId);
-
-    // Check if rule application window is triggered
-    if (!voaConfig.isTriggered(rule)) {
-        helper::logDebug("VoaThread::getVoaPkgQueue not triggered");
+    // retrieve the first active rule, if it's triggered
+    VoaConfig::VoaRulePtr matchedRule = voaConfig.findTriggeredRule(
+        activePersona, linkId, channelGid, personas, currentTimestamp);
+    if (matchedRule == nullptr) {
         return {};
     }
+    const VoaConfig::VoaRule &rule = *matchedRule;
 
     // Add tag to opentracing log
     auto pkgSpanContext = spanContextFromEncryptedPackage(ePkg);
@@ -184,18 +89,19 @@ std::list<std::pair<EncPkg, double>> VoaThread::getVoaPkgQueue(
     span->SetTag("voa_linkId", linkId);
     span->SetTag("voa_channelGid", channelGid);
     span->SetTag("voa_activePersona", activePersona);
-    span->SetTag("voa_personaList", helper::personasToString(personaList));
+    span->SetTag("voa_personaList", helper::personasToString(std::vector<std::string>(
+                                        personas.begin(), personas.end())));
 
     raceSdk.traceLinkStatus(span, linkId);
     span->Finish();
 
     // update the traceId and spanId for the package
-    EncPkg newPkg = ePkg;
-    newPkg.setTraceId(traceIdFromContext(span->context()));
-    newPkg.setSpanId(spanIdFromContext(span->context()));
+    auto newPkg = std::make_shared<EncPkg>(ePkg);
+    newPkg->setTraceId(traceIdFromContext(span->context()));
+    newPkg->setSpanId(spanIdFromContext(span->context()));
 
     if (rule.action == VoaConfig::VOA_ACTION_DROP) {
-        pkgQueue.push_back(std::make_pair(newPkg, VOA_DROP_TIMESTAMP));
+        pkgQueue.emplace_back(std::move(newPkg), VOA_DROP_TIMESTAMP);
         helper::logInfo("VoaThread::getVoaPkgQueue: Dropping package on LinkId=" + linkId +
                         " and Gid=" + channelGid);
     } else if (rule.action == VoaConfig::VOA_ACTION_DELAY) {
@@ -204,25 +110,26 @@ std::list<std::pair<EncPkg, double>> VoaThread::getVoaPkgQueue(
         float randWeight = distribution(mRnd);
         double holdTime = rule.getHoldTimeParam(randWeight);
         double holdTimestamp = currentTimestamp + holdTime;
-        pkgQueue.push_back(std::make_pair(newPkg, holdTimestamp));
+        pkgQueue.emplace_back(std::move(newPkg), holdTimestamp);
         helper::logInfo("VoaThread::getVoaPkgQueue: holding package for delay=" +
                         std::to_string(holdTime) + " until " + std::to_string(holdTimestamp));
     } else if (rule.action == VoaConfig::VOA_ACTION_TAMPER) {
         helper::logInfo("VoaThread::getVoaPkgQueue: Mangling package on LinkId=" + linkId +
                         " and Gid=" + channelGid);
-        unsigned long corruptTimes = rule.getIterationsParam();
-        EncPkg ePkgMod = corruptPackage(newPkg, corruptTimes);
-        pkgQueue.push_back(std::make_pair(ePkgMod, currentTimestamp));
+        uint32_t corruptTimes = static_cast<uint32_t>(rule.iterations);
+        auto ePkgMod = std::make_shared<EncPkg>(corruptPackage(*newPkg, corruptTimes));
+        pkgQueue.emplace_back(std::move(ePkgMod), currentTimestamp);
     } else if (rule.action == VoaConfig::VOA_ACTION_REPLAY) {
         helper::logInfo("VoaThread::getVoaPkgQueue: Replaying package on LinkId=" + linkId +
                         " and Gid=" + channelGid);
-        // Replay of one actually implies two packages
-        unsigned long times = rule.getReplayTimesParam() + 1;
+        // Replay of one actually implies two packages. They all reference the same package.
+        unsigned long times = rule.replayTimes + 1;
         double holdTimestamp = currentTimestamp;
+        pkgQueue.reserve(times);
         for (unsigned long i = 0; i < times; i++) {
             float randWeight = distribution(mRnd);
             double holdTime = rule.getHoldTimeParam(randWeight);
-            pkgQueue.push_back(std::make_pair(EncPkg(newPkg), holdTimestamp));
+            pkgQueue.emplace_back(newPkg, holdTimestamp);
             holdTimestamp += holdTime;
         }
     } else {
@@ -232,17 +139,124 @@ std::list<std::pair<EncPkg, double>> VoaThread::getVoaPkgQueue(
     return pkgQueue;
 }
 
-void VoaThread::process(std::list<std::shared_ptr<VoaThread::VoaWorkItem>> voaItems) {
+SdkStatus VoaThread::process(const ConnectionID &connectionId,
+                             const std::vector<VoaWorkItem> &voaItems, SendCallback send) {
+    std::lock_guard<std::mutex> lock(voa_queue_mutex);
+
+    if (voa_thread_state.load() == State::STOPPED) {
+        helper::logInfo("VoaThread::process: VoA processing is stopped");
+        return SDK_SHUTTING_DOWN;
+    }
+
+    // Check the whole batch fits before scheduling any of it
+    size_t newBytes = 0;
+    std::unordered_set<const EncPkg *> newPkgs;
+    for (auto &voa : voaItems) {
+        if (pkgReferences.count(voa.pkg.get()) == 0 && newPkgs.insert(voa.pkg.get()).second) {
+            newBytes += voa.pkg->getSize();
+        }
+    }
+    if (queuedBytes + newBytes > maxQueuedBytes) {
+        helper::logWarning("VoaThread::process: holding " + std::to_string(newBytes) +
+                           " more bytes would exceed the VoA budget of " +
+                           std::to_string(maxQueuedBytes) + " bytes (" +
+                           std::to_string(queuedBytes) + " held). Not sending on connection " +
+                           connectionId);
+        return SDK_QUEUE_FULL;
+    }
+
+    auto sharedSend = std::make_shared<const SendCallback>(std::move(send));
+    for (auto &voa : voaItems) {
+        // The callback blocks on voa_queue_mutex until this function returns, so the pending send
+        // is always recorded before it runs
+        uint64_t sendId = nextSendId++;
+        TimerWheel::TimerId timer =
+            wheel.schedule(voa.holdTimestamp, [this, sendId] { runPendingSend(sendId); });
+        if (timer == TimerWheel::INVALID_TIMER) {
+            continue;
+        }
+        pendingSends.emplace(sendId, PendingSend{connectionId, voa.pkg, sharedSend, timer});
+        connectionSends[connectionId].insert(sendId);
+        if (pkgReferences[voa.pkg.get()]++ == 0) {
+            queuedBytes += voa.pkg->getSize();
+        }
+    }
+
+    helper::logDebug("VoaThread::process: pending sends after work added:" +
+                     std::to_string(pendingSends.size()) +
+                     ", bytes held:" + std::to_string(queuedBytes));
+    return SDK_OK;
+}
+
+void VoaThread::runPendingSend(uint64_t sendId) {
+    PendingSend pending;
+    {
+        std::lock_guard<std::mutex> lock(voa_queue_mutex);
+        auto it = pendingSends.find(sendId);
+        if (it == pendingSends.end()) {
+            // cancelled while the callback was waiting for the lock
+            return;
+        }
+        // Keep the package referenced (but no longer counted against the budget) until sent
+        pending = removePendingSend(it);
+    }
+
+    helper::logDebug("VoaThread::runPendingSend: invoking callback.");
+    SdkResponse response = (*pending.send)(*pending.pkg);
+    if (response.status != SDK_OK) {
+        helper::logInfo("VoaThread::runPendingSend: failed callback for handle:" +
+                        std::to_string(response.handle) +
+                        " with status:" + sdkStatusToString(response.status));
+    }
+}
+
+VoaThread::PendingSend VoaThread::removePendingSend(
+    std::unordered_map<uint64_t, PendingSend>::iterator it) {
+    PendingSend pending = std::move(it->second);
+    uint64_t sendId = it->first;
+    pendingSends.erase(it);
+
+    auto sends = connectionSends.find(pending.connectionId);
+    if (sends != connectionSends.end()) {
+        sends->second.erase(sendId);
+        if (sends->second.empty()) {
+            connectionSends.erase(sends);
+        }
+    }
+
+    auto refs = pkgReferences.find(pending.pkg.get());
+    if (refs != pkgReferences.end() && --refs->second == 0) {
+        pkgReferences.erase(refs);
+        queuedBytes -= pending.pkg->getSize();
+    }
+    return pending;
+}
+
+size_t VoaThread::cancelConnection(const ConnectionID &connectionId) {
     std::lock_guard<std::mutex> lock(voa_queue_mutex);
 
-    for (auto voa : voaItems) {
-        voaQueue.push(voa);  // inserts in sorted holdtime order
+    auto sends = connectionSends.find(connectionId);
+    if (sends == connectionSends.end()) {
+        return 0;
+    }
+
+    // copy the send IDs, as removing the pending sends erases the set
+    std::vector<uint64_t> cancelled(sends->second.begin(), sends->second.end());
+    for (uint64_t sendId : cancelled) {
+        auto it = pendingSends.find(sendId);
+        // if the timer already fired, its callback finds nothing to send
+        wheel.cancel(it->second.timer);
+        removePendingSend(it);
     }
 
-    helper::logDebug("VoaThread::process: voaQueue size after work added:" +
-                     std::to_string(voaQueue.size()));
-    // tell Voa thread to look at its queue
-    voa_thread_signaler.notify_one();
+    helper::logInfo("VoaThread::cancelConnection: cancelled " + std::to_string(cancelled.size()) +
+                    " VoA sends on closed connection " + connectionId);
+    return cancelled.size();
+}
+
+size_t VoaThread::getQueuedBytes() {
+    std::lock_guard<std::mutex> lock(voa_queue_mutex);
+    return queuedBytes;
 }
 
 bool VoaThread::addVoaRules(const nlohmann::json &payload) {
@@ -269,36 +283,30 @@ bool VoaThread::isVoaActive() {
     return voaActiveState;
 }
 
+bool VoaThread::hasVoaRules() const {
+    return voaConfig.hasRules();
+}
+
 void VoaThread::stopThread() {
     helper::logInfo("VoaThread::stopThread called");
 
-    State prev_state;
-
     {
         std::lock_guard<std::mutex> lock(voa_queue_mutex);
-        prev_state = voa_thread_state.exchange(State::STOPPED);
-    }
+        if (voa_thread_state.exchange(State::STOPPED) == State::STOPPED) {
+            return;
+        }
 
-    if (prev_state == State::STARTED) {
-        // Terminate threads
-        voa_thread_signaler.notify_all();
-
-        std::promise<void> timeoutPromise;
-        std::thread([&]() {
-            voa_thread.join();
-            timeoutPromise.set_value();
-        }).detach();
-
-        // Wait for the threads to join. If they don't join within the timeout then assume they are
-        // hanging, log an error, and bail.
-        const std::int32_t secondsToWaitForThreadsToJoin = 5;
-        auto status = timeoutPromise.get_future().wait_for(
-            std::chrono::seconds(secondsToWaitForThreadsToJoin));
-        if (status != std::future_status::ready) {
-            helper::logError(
-                "FATAL: Handler:: timed out waiting for voa thread to join. "
-                "Terminating.");
-            std::terminate();
+        for (auto &pending : pendingSends) {
+            wheel.cancel(pending.second.timer);
         }
+        helper::logInfo("VoaThread::stopThread discarding " + std::to_string(pendingSends.size()) +
+                        " pending VoA sends");
+        pendingSends.clear();
+        connectionSends.clear();
+        pkgReferences.clear();
+        queuedBytes = 0;
     }
+
+    // Make sure a send that had already started finishes before returning
+    wheel.waitForCallbacks();
 }
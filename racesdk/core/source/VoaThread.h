@@ -15,16 +15,19 @@
 // limitations under the License.
 //
 
+
 #ifndef __VOA_THREAD_H__
 #define __VOA_THREAD_H__
 
 #include <atomic>
-#include <future>
-#include <list>
+#include <functional>
 #include <memory>
-#include <queue>
-#include <thread>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
+#include "TimerWheel.h"
 #include "VoaConfig.h"
 
 /**
@@ -33,35 +36,46 @@
  */
 const int32_t VOA_DROP_TIMESTAMP = std::numeric_limits<int32_t>::min();
 
+/**
+ * @brief Representation of a single VoA deferred action
+ */
+struct VoaWorkItem {
+    // The package to send. Shared between items that send the same package.
+    std::shared_ptr<const EncPkg> pkg;
+    // Hold-time prior to sending the package
+    double holdTimestamp;
+
+    VoaWorkItem(std::shared_ptr<const EncPkg> _pkg, double _holdTimestamp) :
+        pkg(std::move(_pkg)), holdTimestamp(_holdTimestamp) {}
+};
+
 /**
  * VoaThread: A class to manage the thread associated with Voice of Adversary
  * (VoA) actions
+ *
+ * Deferred sends are scheduled on a timer wheel owned by this class, so a slow send doesn't hold up
+ * timers elsewhere in the SDK. Pending sends hold a reference to their package rather than a copy,
+ * and replays of a package share one reference. The total size of the packages held is limited,
+ * and the sends pending for a connection are cancelled when it closes.
  */
 class VoaThread {
 public:
     enum class State { STARTED, STOPPED };
 
-    /**
-     * @brief Representation of a single VoA deferred action
-     */
-    struct VoaWorkItem {
-        // The deferred action
-        std::function<SdkResponse()> callback;
-        // Hold-time prior to invoking the deferred action
-        double holdTimestamp;
-
-        template <typename T>
-        VoaWorkItem(T _callback, double _holdTimestamp) :
-            callback(_callback), holdTimestamp(_holdTimestamp) {}
-    };
+    using SendCallback = std::function<SdkResponse(const EncPkg &)>;
 
 private:
+    // A deferred send waiting on the timer wheel
+    struct PendingSend {
+        ConnectionID connectionId;
+        std::shared_ptr<const EncPkg> pkg;
+        std::shared_ptr<const SendCallback> send;
+        TimerWheel::TimerId timer;
+    };
+
     // Reference to the RACE SDK context
     RaceSdk &raceSdk;
 
-    // The thread object
-    std::thread voa_thread;
-
     // Current VoA thread state
     std::atomic<State> voa_thread_state;
 
@@ -74,21 +88,33 @@ private:
     // Random engine for probablistic actions
     std::default_random_engine mRnd;
 
-    // A queue of VoA actions. Ordering based on hold-timestamp values.
-    std::priority_queue<std::shared_ptr<VoaWorkItem>, std::vector<std::shared_ptr<VoaWorkItem>>,
-                        std::function<bool(const std::shared_ptr<VoaWorkItem> &,
-                                           const std::shared_ptr<VoaWorkItem> &)>>
-        voaQueue;
+    // The most package bytes that may be held for deferred sends
+    size_t maxQueuedBytes;
+
+    // Package bytes held for deferred sends. Each package is counted once, however many sends
+    // reference it.
+    size_t queuedBytes;
+
+    // Number of pending sends referencing each package held
+    std::unordered_map<const EncPkg *, size_t> pkgReferences;
+
+    // Deferred sends by ID, and the IDs of the sends pending on each connection
+    std::unordered_map<uint64_t, PendingSend> pendingSends;
+    std::unordered_map<ConnectionID, std::unordered_set<uint64_t>> connectionSends;
+    uint64_t nextSendId;
 
-    // Mutex that mediates access to voaQueue
+    // Mutex that mediates access to the pending sends and the active state
     std::mutex voa_queue_mutex;
 
-    // Condition variable that manages concurrent access to voaQueue
-    // between the work posting and work invocation functions.
-    std::condition_variable voa_thread_signaler;
+    // Runs deferred sends when their hold time is reached. Declared last so that it is destroyed,
+    // and its thread stopped, before the state that callbacks use.
+    TimerWheel wheel;
 
-    // Internal routine to start-up VoA thread
-    void runVoaThread();
+    // Timer callback: sends the package for a pending send
+    void runPendingSend(uint64_t sendId);
+
+    // Remove a pending send and release its package. Must be called with voa_queue_mutex held.
+    PendingSend removePendingSend(std::unordered_map<uint64_t, PendingSend>::iterator it);
 
     // Helper routine to corrupt package
     EncPkg corruptPackage(const EncPkg &pkg, uint32_t corruptAmout);
@@ -99,16 +125,18 @@ public:
      *
      * @param sdk a reference to the Race SDK context
      * @param configPath path to the VoA config file
+     * @param maxQueuedBytes the most package bytes that may be held for deferred sends
      */
-    explicit VoaThread(RaceSdk &sdk, const std::string &configPath);
+    explicit VoaThread(RaceSdk &sdk, const std::string &configPath, size_t maxQueuedBytes);
 
     /**
-     * @brief Startup VoA Thread
+     * @brief Start accepting deferred sends
      */
     void startThread();
 
     /**
-     * @brief Stop VoA Thread
+     * @brief Stop VoA processing. Pending sends are discarded, and any send in progress is waited
+     * for.
      */
     void stopThread();
 
@@ -118,22 +146,42 @@ public:
      * @param ePkg Package under VoA consideration
      * @param activePersona active persona selection parameter
      * @param linkId link selection parameter
+     * @param channelGid channel selection parameter
      * @param personas persona selection parameter
      *
-     * @returns A list of package (copies) and an associated hold-timestamp, if
-     * the package was matched for VoA processing.
+     * @returns A list of packages and an associated hold-timestamp, if the package was matched for
+     * VoA processing.
      */
-    std::list<std::pair<EncPkg, double>> getVoaPkgQueue(const EncPkg &ePkg,
-                                                        std::string activePersona, LinkID linkId,
-                                                        std::string channelGid,
-                                                        std::vector<std::string> &personaList);
+    std::vector<VoaWorkItem> getVoaPkgQueue(const EncPkg &ePkg, const std::string &activePersona,
+                                            const LinkID &linkId, const std::string &channelGid,
+                                            const personas::PersonaSet &personas);
 
     /**
-     * @brief Process selected packages through VoA processing pipeline.
+     * @brief Schedule packages to be sent at their hold-timestamps.
      *
-     * @param voaItems list of <work-item, hold-timestamp> tuples
+     * @param connectionId The connection the packages are sent on
+     * @param voaItems list of <package, hold-timestamp> tuples
+     * @param send Called on the timer thread to send each package
+     * @return SDK_OK if the packages were scheduled, SDK_QUEUE_FULL if holding them would exceed
+     * the memory budget, or SDK_SHUTTING_DOWN if VoA processing has been stopped. Either none or
+     * all of the packages are scheduled.
      */
-    void process(std::list<std::shared_ptr<VoaWorkItem>> voaItems);
+    SdkStatus process(const ConnectionID &connectionId, const std::vector<VoaWorkItem> &voaItems,
+                      SendCallback send);
+
+    /**
+     * @brief Cancel all pending sends on a connection
+     *
+     * @param connectionId The connection that closed
+     * @return The number of sends cancelled
+     */
+    size_t cancelConnection(const ConnectionID &connectionId);
+
+    /**
+     * @brief Get the number of package bytes currently held for deferred sends
+     *
+     */
+    size_t getQueuedBytes();
 
     /**
      * @brief Add a new rule received from RiB
@@ -161,6 +209,13 @@ public:
      *
      */
     bool isVoaActive();
+
+    /**
+     * @brief Check if there are any VoA rules that could apply to a package. Lets callers skip
+     * gathering the selection parameters for getVoaPkgQueue when there are none.
+     *
+     */
+    bool hasVoaRules() const;
 };
 
 #endif
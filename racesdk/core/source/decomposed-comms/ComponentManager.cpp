@@ -98,8 +98,8 @@ ChannelResponse ComponentManager::post(const std::string &logPrefix, T &&functio
 
             return std::make_optional(status);
         };
-        auto [success, queueSize, future] =
-            handler.post("", 0, -1, std::bind(std::move(workFunc), std::forward<Args>(args)...));
+        auto [success, queueSize] = handler.post_detached(
+            "", 0, -1, std::bind(std::move(workFunc), std::forward<Args>(args)...));
 
         // this really shouldn't happen...
         if (success != Handler::PostStatus::OK) {
@@ -109,7 +109,6 @@ ChannelResponse ComponentManager::post(const std::string &logPrefix, T &&functio
         }
 
         (void)queueSize;
-        (void)future;
         return ok(postHandle.handle);
     } catch (std::out_of_range &e) {
         helper::logError("default queue does not exist. This should never happen. what:" +
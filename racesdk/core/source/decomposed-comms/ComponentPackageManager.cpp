@@ -255,17 +255,23 @@ void ComponentPackageManager::encodeForAction(CMTypes::ActionInfo *actionInfo) {
         }
 
         for (auto packageFragment : actionInfo->fragments) {
-            auto data = packageFragment->package->pkg.getRawData();
+            const EncPkg &pkg = packageFragment->package->pkg;
             uint32_t offset = packageFragment->offset;
             uint32_t len = packageFragment->len;
-            auto begin = data.data() + offset;
-            auto end = data.data() + offset + len;
             if (manager.mode != EncodingMode::SINGLE) {
                 uint8_t *lenPtr = reinterpret_cast<uint8_t *>(&len);
                 bytesToEncode.insert(bytesToEncode.end(), lenPtr, lenPtr + sizeof(len));
             }
 
-            bytesToEncode.insert(bytesToEncode.end(), begin, end);
+            // The fragment is a range of the serialized package (header followed by cipher text).
+            // Copy it straight out of the two parts rather than serializing the whole package.
+            RawDataView header = pkg.getHeaderView().slice(offset, len);
+            bytesToEncode.insert(bytesToEncode.end(), header.begin(), header.end());
+            size_t cipherTextOffset =
+                offset > EncPkg::HEADER_LENGTH ? offset - EncPkg::HEADER_LENGTH : 0;
+            RawDataView cipherText =
+                pkg.getCipherTextView().slice(cipherTextOffset, len - header.size());
+            bytesToEncode.insert(bytesToEncode.end(), cipherText.begin(), cipherText.end());
             packageFragment->state = PackageFragmentState::ENCODING;
         }
     }
@@ -60,8 +60,8 @@ void TemplatedComponentWrapper<ComponentType>::post(const std::string &logPrefix
 
             return std::make_optional(response);
         };
-        auto [success, queueSize, future] =
-            handler.post("", 0, -1, std::bind(std::move(workFunc), std::forward<Args>(args)...));
+        auto [success, queueSize] = handler.post_detached(
+            "", 0, -1, std::bind(std::move(workFunc), std::forward<Args>(args)...));
 
         // this really shouldn't happen...
         if (success == Handler::PostStatus::INVALID_STATE) {
@@ -73,7 +73,6 @@ void TemplatedComponentWrapper<ComponentType>::post(const std::string &logPrefix
         }
 
         (void)queueSize;
-        (void)future;
     } catch (std::out_of_range &error) {
         helper::logError("default queue does not exist. This should never happen. what:" +
                          std::string(error.what()));
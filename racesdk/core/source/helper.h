@@ -77,6 +77,19 @@ std::string personasToString(const std::vector<std::string> &personas);
  */
 void logDebug(const std::string &message, const std::string &stackTrace = "");
 
+/**
+ * @brief Call helper::logDebug only if debug messages are being written, so that the message isn't
+ * built otherwise. Use this for messages that are expensive to build on hot paths.
+ *
+ * @param message The message to log.
+ */
+#define LOG_DEBUG(message)                         \
+    do {                                           \
+        if (RACE_LOG_ENABLED(RaceLog::LL_DEBUG)) { \
+            helper::logDebug(message);             \
+        }                                          \
+    } while (0)
+
 /**
  * @brief Convenience function for calling RaceLog::logInfo. Provides a common, default plugin name
  * so that logging is consistent throughout the code base.
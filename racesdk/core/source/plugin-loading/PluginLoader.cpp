@@ -21,6 +21,7 @@
 
 #include <fstream>
 #include <nlohmann/json.hpp>
+#include <type_traits>
 
 #include "ArtifactManager.h"
 #include "ArtifactManagerWrapper.h"
@@ -81,6 +82,12 @@ static IPluginLoader::PluginList<Wrapper> loadPlugins(std::vector<PluginDef> plu
                         std::string name = pluginToLoad.filePath;
                         auto plugin = std::make_unique<Plugin>(fullPluginPath, sdk, name,
                                                                pluginToLoad.configPath);
+                        if constexpr (!std::is_same_v<Wrapper, ArtifactManagerWrapper>) {
+                            // calls into the plugin don't need to be serialized
+                            if (pluginToLoad.threadSafe) {
+                                plugin->setNumWorkers(sdk.getRaceConfig().wrapperMaxWorkers);
+                            }
+                        }
                         plugins.emplace_back(std::move(plugin));
                     } catch (const std::exception &e) {
                         // Log and Ignore any exceptions encountered loading the plugin
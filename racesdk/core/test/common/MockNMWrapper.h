@@ -174,6 +174,10 @@ public:
     MOCK_METHOD(SdkResponse, sendEncryptedPackage,
                 (EncPkg ePkg, ConnectionID connectionId, uint64_t batchId, int32_t timeout),
                 (override));
+    MOCK_METHOD(std::vector<SdkResponse>, sendEncryptedPackages,
+                ((std::vector<std::pair<EncPkg, ConnectionID>> packages), uint64_t batchId,
+                 int32_t timeout),
+                (override));
     MOCK_METHOD(SdkResponse, presentCleartextMessage, (ClrMsg msg), (override));
     MOCK_METHOD(SdkResponse, onPluginStatusChanged, (PluginStatus status), (override));
     MOCK_METHOD(SdkResponse, openConnection,
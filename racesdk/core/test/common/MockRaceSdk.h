@@ -59,6 +59,10 @@ public:
                 (NMWrapper & plugin, EncPkg ePkg, ConnectionID connectionId, uint64_t batchId,
                  int32_t timeout),
                 (override));
+    MOCK_METHOD(std::vector<SdkResponse>, sendEncryptedPackages,
+                (NMWrapper & plugin, (std::vector<std::pair<EncPkg, ConnectionID>> packages),
+                 uint64_t batchId, int32_t timeout),
+                (override));
     MOCK_METHOD(SdkResponse, presentCleartextMessage, (NMWrapper & plugin, ClrMsg msg), (override));
 
     MOCK_METHOD(std::vector<LinkID>, getLinksForPersonas,
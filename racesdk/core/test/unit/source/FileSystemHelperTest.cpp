@@ -0,0 +1,97 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "FileSystemHelper.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "filesystem.h"
+#include "gtest/gtest.h"
+
+static std::vector<std::uint8_t> readFile(const fs::path &path) {
+    std::ifstream file(path.string(), std::ios::binary);
+    return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(file),
+                                     std::istreambuf_iterator<char>());
+}
+
+class FileSystemHelperTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        root = fs::temp_directory_path() / "FileSystemHelperTest";
+        fs::remove_all(root);
+        fs::create_directories(root / "src" / "nested");
+        storageEncryption.init(RaceEnums::StorageEncryptionType::ENC_AES, "passphrase",
+                               (root / "keys").string());
+    }
+
+    void TearDown() override {
+        fs::remove_all(root);
+    }
+
+    fs::path root;
+    StorageEncryption storageEncryption;
+};
+
+TEST_F(FileSystemHelperTest, copyAndDecryptDir_decrypts_every_file) {
+    std::vector<std::string> names;
+    for (int i = 0; i < 20; ++i) {
+        names.push_back((i % 2 ? "nested/file-" : "file-") + std::to_string(i));
+        std::vector<std::uint8_t> data(static_cast<size_t>(i) * 10000, static_cast<uint8_t>(i));
+        storageEncryption.write((root / "src" / names.back()).string(), data);
+    }
+    // unencrypted files are copied as they are
+    std::ofstream((root / "src" / "deployment.txt").string()) << "deployment";
+
+    FileSystemHelper helper;
+    ASSERT_TRUE(helper.copyAndDecryptDir((root / "src").string(), (root / "dest").string(),
+                                         storageEncryption));
+
+    for (int i = 0; i < 20; ++i) {
+        std::vector<std::uint8_t> expected(static_cast<size_t>(i) * 10000,
+                                           static_cast<uint8_t>(i));
+        EXPECT_EQ(readFile(root / "dest" / names[static_cast<size_t>(i)]), expected)
+            << names[static_cast<size_t>(i)];
+    }
+    auto deployment = readFile(root / "dest" / "deployment.txt");
+    EXPECT_EQ(std::string(deployment.begin(), deployment.end()), "deployment");
+}
+
+TEST_F(FileSystemHelperTest, copyAndDecryptDir_missing_source) {
+    FileSystemHelper helper;
+    EXPECT_FALSE(helper.copyAndDecryptDir((root / "missing").string(), (root / "dest").string(),
+                                          storageEncryption));
+}
+
+TEST_F(FileSystemHelperTest, copyAndDecryptDir_corrupt_file) {
+    storageEncryption.write((root / "src" / "good").string(), std::vector<std::uint8_t>(100, 1));
+    const auto badPath = root / "src" / "bad";
+    storageEncryption.write(badPath.string(), std::vector<std::uint8_t>(200000, 2));
+    auto bad = readFile(badPath);
+    bad.back() ^= 0xff;
+    std::ofstream(badPath.string(), std::ios::binary | std::ios::trunc)
+        .write(reinterpret_cast<const char *>(bad.data()),
+               static_cast<std::streamsize>(bad.size()));
+
+    FileSystemHelper helper;
+    EXPECT_FALSE(helper.copyAndDecryptDir((root / "src").string(), (root / "dest").string(),
+                                          storageEncryption));
+    EXPECT_EQ(readFile(root / "dest" / "good"), std::vector<std::uint8_t>(100, 1));
+    EXPECT_FALSE(fs::exists(root / "dest" / "bad"));
+    EXPECT_FALSE(fs::exists(root / "dest" / "bad.tmp"));
+}
@@ -0,0 +1,106 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+// Measures Handler post throughput and enqueue latency, both for post (which returns a future)
+// and for post_detached (which doesn't), with a number of threads posting concurrently.
+//
+// Usage: benchmarkHandler [posts per thread] [threads]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../../source/Handler.h"
+
+using Clock = std::chrono::steady_clock;
+
+template <typename PostFunc>
+static void run(const std::string &name, size_t posts, size_t threads, PostFunc post) {
+    // large enough that posts never have to wait for space
+    Handler handler("benchmark", posts * threads, posts * threads);
+    handler.create_queue("queue", 0);
+    handler.start();
+
+    std::atomic<size_t> executed{0};
+    std::vector<std::vector<double>> latencies(threads);
+    std::vector<std::thread> posters;
+
+    auto start = Clock::now();
+    for (size_t t = 0; t < threads; ++t) {
+        posters.emplace_back([&, t] {
+            auto &threadLatencies = latencies[t];
+            threadLatencies.reserve(posts);
+            for (size_t i = 0; i < posts; ++i) {
+                auto postStart = Clock::now();
+                post(handler, [&executed] {
+                    executed.fetch_add(1, std::memory_order_relaxed);
+                    return std::make_optional(true);
+                });
+                threadLatencies.push_back(
+                    std::chrono::duration<double, std::nano>(Clock::now() - postStart).count());
+            }
+        });
+    }
+    for (auto &poster : posters) {
+        poster.join();
+    }
+    handler.stop();
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<double> all;
+    for (auto &threadLatencies : latencies) {
+        all.insert(all.end(), threadLatencies.begin(), threadLatencies.end());
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&all](double p) {
+        return all[static_cast<size_t>(p * static_cast<double>(all.size() - 1))];
+    };
+
+    std::cout << name << ": " << static_cast<double>(executed.load()) / elapsed
+              << " posts/s, enqueue p50 " << percentile(0.5) << " ns, p99 " << percentile(0.99)
+              << " ns" << std::endl;
+}
+
+int main(int argc, char **argv) {
+    size_t posts = 200000;
+    size_t threads = 4;
+    if (argc > 1) {
+        posts = std::strtoull(argv[1], nullptr, 10);
+    }
+    if (argc > 2) {
+        threads = std::strtoull(argv[2], nullptr, 10);
+    }
+
+    std::cout << threads << " threads, " << posts << " posts each" << std::endl;
+    run("post         ", posts, threads, [](Handler &handler, auto &&callback) {
+        auto [status, queueSize, future] = handler.post("queue", 0, -1, callback);
+        (void)status;
+        (void)queueSize;
+        (void)future;
+    });
+    run("post_detached", posts, threads, [](Handler &handler, auto &&callback) {
+        auto [status, queueSize] = handler.post_detached("queue", 0, -1, callback);
+        (void)status;
+        (void)queueSize;
+    });
+    return 0;
+}
@@ -18,8 +18,10 @@
 #include <gtest/gtest.h>
 #include <valgrind/valgrind.h>  // RUNNING_ON_VALGRIND
 
+#include <atomic>
 #include <chrono>
 #include <memory>
+#include <numeric>
 
 #include "../../../source/Handler.h"
 #include "../../common/race_printers.h"
@@ -2355,4 +2357,326 @@ TEST(HandlerTest, test_post_work_finished_no_timeout) {
     EXPECT_EQ(finished, true);
     EXPECT_EQ(*value1, true);
     EXPECT_EQ(*value2, true);
-}
\ No newline at end of file
+}
+
+TEST(HandlerTest, test_create_queue_returns_id) {
+    Handler handler("test-handler", max_queue_size, max_total_size);
+    Handler::QueueId id1 = handler.create_queue("1", 0);
+    Handler::QueueId id2 = handler.create_queue("2", 0);
+
+    EXPECT_NE(id1, Handler::DEFAULT_QUEUE);
+    EXPECT_NE(id1, id2);
+    EXPECT_EQ(handler.get_queue_id(""), Handler::DEFAULT_QUEUE);
+    EXPECT_EQ(handler.get_queue_id("1"), id1);
+    EXPECT_EQ(handler.get_queue_id("2"), id2);
+    EXPECT_THROW(handler.get_queue_id("3"), std::out_of_range);
+}
+
+TEST(HandlerTest, test_queue_id_not_reused) {
+    Handler handler("test-handler", max_queue_size, max_total_size);
+    Handler::QueueId id1 = handler.create_queue("1", 0);
+    handler.remove_queue("1");
+    Handler::QueueId id2 = handler.create_queue("2", 0);
+
+    EXPECT_NE(id1, id2);
+    EXPECT_THROW(handler.post(id1 + 100, 0, 0, [] { return std::make_optional(true); }),
+                 std::out_of_range);
+}
+
+TEST(HandlerTest, test_post_by_queue_id) {
+    auto value1 = std::make_shared<bool>(false);
+
+    bool finished = run_with_timeout([=] {
+        Handler handler("test-handler", max_queue_size, max_total_size);
+        handler.start();
+        Handler::QueueId id = handler.create_queue("1", 0);
+        auto [success, queueSize, future] =
+            handler.post(id, 0, 0, [] { return std::make_optional(true); });
+        (void)queueSize;
+        EXPECT_EQ(success, Handler::PostStatus::OK);
+
+        future.wait();
+        *value1 = future.get();
+        handler.stop();
+    });
+
+    EXPECT_EQ(finished, true);
+    EXPECT_EQ(*value1, true);
+}
+
+TEST(HandlerTest, test_post_detached) {
+    auto count = std::make_shared<std::atomic<int>>(0);
+
+    bool finished = run_with_timeout([=] {
+        Handler handler("test-handler", max_queue_size, max_total_size);
+        handler.create_queue("1", 0);
+        for (int i = 0; i < 100; ++i) {
+            auto [success, queueSize] = handler.post_detached("1", 1, 0, [count] {
+                (*count)++;
+                return std::make_optional(true);
+            });
+            EXPECT_EQ(success, Handler::PostStatus::OK);
+            EXPECT_EQ(queueSize, static_cast<size_t>(i + 1));
+        }
+
+        handler.start();
+        handler.stop();
+    });
+
+    EXPECT_EQ(finished, true);
+    EXPECT_EQ(*count, 100);
+}
+
+TEST(HandlerTest, test_post_detached_work_timeout_timedout) {
+    auto value1 = std::make_shared<bool>(false);
+
+    bool finished = run_with_timeout([=] {
+        Handler handler("test-handler", max_queue_size, max_total_size);
+        auto promise_ptr = std::make_shared<std::promise<void>>();
+        std::shared_future<void> timedOut = promise_ptr->get_future().share();
+
+        handler.post_detached("", 0, 0, [timedOut] {
+            // wait for the work timeout of the next work
+            timedOut.wait();
+            return std::make_optional(true);
+        });
+
+        std::chrono::duration<double> now = std::chrono::system_clock::now().time_since_epoch();
+        auto [success, queueSize] = handler.post_detached(
+            Handler::DEFAULT_QUEUE, 0, 0, [] { return std::make_optional(true); },
+            now.count() + 0.005 * TIME_MULTIPLIER, [value1, promise_ptr] {
+                *value1 = true;
+                promise_ptr->set_value();
+            });
+        (void)queueSize;
+        EXPECT_EQ(success, Handler::PostStatus::OK);
+
+        handler.start();
+        timedOut.wait();
+        handler.stop();
+    });
+
+    EXPECT_EQ(finished, true);
+    EXPECT_EQ(*value1, true);
+}
+
+TEST(HandlerTest, test_timeout_callback_can_post_to_same_handler) {
+    auto value1 = std::make_shared<bool>(false);
+
+    bool finished = run_with_timeout([=] {
+        Handler handler("test-handler", max_queue_size, max_total_size);
+        auto promise_ptr = std::make_shared<std::promise<void>>();
+        std::shared_future<void> posted = promise_ptr->get_future().share();
+
+        handler.post_detached("", 0, 0, [posted] {
+            // wait for the timeout callback to post
+            posted.wait();
+            return std::make_optional(true);
+        });
+
+        std::chrono::duration<double> now = std::chrono::system_clock::now().time_since_epoch();
+        handler.post_detached(
+            "", 0, 0, [] { return std::make_optional(true); },
+            now.count() + 0.005 * TIME_MULTIPLIER, [&handler, value1, promise_ptr] {
+                auto [success, queueSize] = handler.post_detached("", 0, 0, [value1] {
+                    *value1 = true;
+                    return std::make_optional(true);
+                });
+                (void)success;
+                (void)queueSize;
+                promise_ptr->set_value();
+            });
+
+        handler.start();
+        posted.wait();
+        handler.stop();
+    });
+
+    EXPECT_EQ(finished, true);
+    EXPECT_EQ(*value1, true);
+}
+
+TEST(HandlerTest, test_work_times_out_in_timeout_order) {
+    auto order = std::make_shared<std::vector<int>>();
+
+    bool finished = run_with_timeout([=] {
+        Handler handler("test-handler", max_queue_size, max_total_size);
+        auto promise_ptr = std::make_shared<std::promise<void>>();
+        std::shared_future<void> timedOut = promise_ptr->get_future().share();
+
+        handler.post_detached("", 0, 0, [timedOut] {
+            // wait for all the other work to time out
+            timedOut.wait();
+            return std::make_optional(true);
+        });
+
+        std::chrono::duration<double> now = std::chrono::system_clock::now().time_since_epoch();
+        const double timeouts[] = {0.015, 0.005, 0.010, 0.005};
+        for (int i = 0; i < 4; ++i) {
+            handler.post_detached(
+                "", 0, 0, [] { return std::make_optional(true); },
+                now.count() + timeouts[i] * TIME_MULTIPLIER, [order, promise_ptr, i] {
+                    order->push_back(i);
+                    if (order->size() == 4) {
+                        promise_ptr->set_value();
+                    }
+                });
+        }
+
+        handler.start();
+        timedOut.wait();
+        handler.stop();
+    });
+
+    EXPECT_EQ(finished, true);
+    EXPECT_EQ(*order, std::vector<int>({1, 3, 2, 0}));
+}
+
+TEST(HandlerTest, test_set_num_workers_invalid) {
+    Handler handler("test-handler", max_queue_size, max_total_size);
+    EXPECT_THROW(handler.set_num_workers(0), std::invalid_argument);
+
+    handler.start();
+    EXPECT_THROW(handler.set_num_workers(2), std::logic_error);
+    handler.stop();
+}
+
+TEST(HandlerTest, test_multiple_workers_run_queues_in_parallel) {
+    bool finished = run_with_timeout([=] {
+        Handler handler("test-handler", max_queue_size, max_total_size);
+        handler.set_num_workers(2);
+        handler.create_queue("queue1", 0);
+        handler.create_queue("queue2", 0);
+
+        // each callback waits for the other to start, so this only finishes if they run in
+        // parallel
+        auto promise1 = std::make_shared<std::promise<void>>();
+        auto promise2 = std::make_shared<std::promise<void>>();
+        std::shared_future<void> started1 = promise1->get_future().share();
+        std::shared_future<void> started2 = promise2->get_future().share();
+
+        handler.post_detached("queue1", 0, 0, [promise1, started2] {
+            promise1->set_value();
+            started2.wait();
+            return std::make_optional(true);
+        });
+        handler.post_detached("queue2", 0, 0, [promise2, started1] {
+            promise2->set_value();
+            started1.wait();
+            return std::make_optional(true);
+        });
+
+        handler.start();
+        handler.stop();
+    });
+
+    EXPECT_EQ(finished, true);
+}
+
+TEST(HandlerTest, test_multiple_workers_preserve_queue_order) {
+    const int num_queues = 4;
+    const int posts_per_queue = 200;
+    auto orders = std::make_shared<std::vector<std::vector<int>>>(num_queues);
+    auto overlapped = std::make_shared<std::atomic<bool>>(false);
+
+    bool finished = run_with_timeout([=] {
+        Handler handler("test-handler", max_queue_size, max_total_size);
+        handler.set_num_workers(num_queues);
+        auto running = std::make_shared<std::vector<std::atomic<int>>>(num_queues);
+
+        for (int q = 0; q < num_queues; ++q) {
+            handler.create_queue("queue" + std::to_string(q), 0);
+        }
+        handler.start();
+
+        for (int i = 0; i < posts_per_queue; ++i) {
+            for (int q = 0; q < num_queues; ++q) {
+                handler.post_detached("queue" + std::to_string(q), 1, -1,
+                                      [orders, overlapped, running, q, i] {
+                                          if ((*running)[q]++ != 0) {
+                                              *overlapped = true;
+                                          }
+                                          (*orders)[q].push_back(i);
+                                          (*running)[q]--;
+                                          return std::make_optional(true);
+                                      });
+            }
+        }
+
+        handler.stop();
+    });
+
+    EXPECT_EQ(finished, true);
+    EXPECT_EQ(*overlapped, false);
+    std::vector<int> expected(posts_per_queue);
+    std::iota(expected.begin(), expected.end(), 0);
+    for (auto &order : *orders) {
+        EXPECT_EQ(order, expected);
+    }
+}
+
+TEST(HandlerTest, test_multiple_workers_lower_priority_waits_for_running_callback) {
+    auto value = std::make_shared<std::atomic<int>>(0);
+    auto lowerRanAfter = std::make_shared<bool>(false);
+
+    bool finished = run_with_timeout([=] {
+        Handler handler("test-handler", max_queue_size, max_total_size);
+        handler.set_num_workers(2);
+        handler.create_queue("high", 1);
+        auto promise_ptr = std::make_shared<std::promise<void>>();
+        std::shared_future<void> started = promise_ptr->get_future().share();
+
+        handler.post_detached("high", 0, 0, [value, promise_ptr] {
+            promise_ptr->set_value();
+            std::this_thread::sleep_for(20ms * TIME_MULTIPLIER);
+            *value = 1;
+            return std::make_optional(true);
+        });
+
+        handler.start();
+        started.wait();
+
+        // the default queue has a lower priority, so this must not start until the work above is
+        // finished, even though there's an idle worker
+        auto [success, queueSize, future] = handler.post("", 0, 0, [value] {
+            return std::make_optional(value->load() == 1);
+        });
+        (void)queueSize;
+        EXPECT_EQ(success, Handler::PostStatus::OK);
+        *lowerRanAfter = future.get();
+        handler.stop();
+    });
+
+    EXPECT_EQ(finished, true);
+    EXPECT_EQ(*lowerRanAfter, true);
+}
+
+TEST(HandlerTest, test_multiple_workers_unblock_during_callback) {
+    auto calls = std::make_shared<int>(0);
+
+    bool finished = run_with_timeout([=] {
+        Handler handler("test-handler", max_queue_size, max_total_size);
+        handler.set_num_workers(2);
+        Handler *handler_ptr = &handler;
+
+        auto [success, queueSize, future] = handler.post("", 0, 0, [calls, handler_ptr] {
+            if ((*calls)++ == 0) {
+                // unblocked before the callback returns, so it should be retried rather than
+                // leaving the queue blocked
+                handler_ptr->unblock_queue("");
+                std::this_thread::sleep_for(10ms * TIME_MULTIPLIER);
+                return std::optional<bool>();
+            }
+            return std::make_optional(true);
+        });
+        (void)success;
+        (void)queueSize;
+
+        handler.start();
+        future.wait();
+        handler.stop();
+    });
+
+    EXPECT_EQ(finished, true);
+    EXPECT_EQ(*calls, 2);
+}
@@ -172,3 +172,24 @@ TEST(PluginDef, plugin_throws_if_invalid_node_type) {
         ASSERT_THROW(PluginDef::pluginJsonToPluginDef(input), parsing_error);
     }
 }
+
+/**
+ * @brief The optional thread_safe key should default to false.
+ *
+ */
+TEST(PluginDef, plugin_parses_thread_safe) {
+    json input = nlohmann::json::parse(R"(
+            {
+                "file_path": "libPluginNMServerTwoSixStub.so",
+                "plugin_type": "network-manager",
+                "file_type": "shared_library",
+                "node_type": "server",
+                "platform": "linux"
+            }
+        )");
+
+    EXPECT_FALSE(PluginDef::pluginJsonToPluginDef(input).threadSafe);
+
+    input["thread_safe"] = true;
+    EXPECT_TRUE(PluginDef::pluginJsonToPluginDef(input).threadSafe);
+}
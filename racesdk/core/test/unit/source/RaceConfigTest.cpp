@@ -388,13 +388,18 @@ TEST(RaceConfig, default_values) {
     EXPECT_EQ(raceConfig.channels.size(), 0);
     EXPECT_EQ(raceConfig.isPluginFetchOnStartEnabled, false);
     EXPECT_EQ(raceConfig.isVoaEnabled, true);
+    EXPECT_EQ(raceConfig.voaMaxQueuedBytes, 64 * 1024 * 1024);
     EXPECT_EQ(raceConfig.wrapperQueueMaxSize, 10 * 1024 * 1024);
     EXPECT_EQ(raceConfig.wrapperTotalMaxSize, 2048u * 1024 * 1024);
+    EXPECT_GE(raceConfig.wrapperMaxWorkers, 1);
     EXPECT_EQ(raceConfig.logLevel, RaceLog::LL_DEBUG);
     EXPECT_EQ(raceConfig.logRaceConfig, true);
     EXPECT_EQ(raceConfig.logNMConfig, true);
     EXPECT_EQ(raceConfig.logCommsConfig, true);
     EXPECT_EQ(raceConfig.msgLogLength, 256);
+    EXPECT_EQ(raceConfig.traceSampleRate, 0.01);
+    EXPECT_EQ(raceConfig.traceChannelSampleRates.size(), 0);
+    EXPECT_EQ(raceConfig.traceExportQueueSize, 4096);
 }
 
 TEST(RaceConfigWrap, parseMaxQueueSize) {
@@ -419,6 +424,48 @@ TEST(RaceConfigWrap, parseMaxQueueSize2) {
     ASSERT_EQ(raceConfig.wrapperQueueMaxSize, 1234567890);
 }
 
+TEST(RaceConfigWrap, parseMaxWorkers) {
+    RaceConfigWrap raceConfig = RaceConfigWrap();
+    json raceJson = base;
+    raceJson["max_workers"] = "8";
+    std::string jsonString = raceJson.dump();
+    raceConfig.wrapParseConfigString(jsonString);
+    ASSERT_EQ(raceConfig.wrapperMaxWorkers, 8);
+}
+
+TEST(RaceConfigWrap, parseVoaMaxQueuedBytes) {
+    RaceConfigWrap raceConfig = RaceConfigWrap();
+    json raceJson = base;
+    raceJson["voa-max-queued-bytes"] = "1024";
+    std::string jsonString = raceJson.dump();
+    raceConfig.wrapParseConfigString(jsonString);
+    ASSERT_EQ(raceConfig.voaMaxQueuedBytes, 1024);
+}
+
+TEST(RaceConfigWrap, parseTraceSampleRates) {
+    RaceConfigWrap raceConfig = RaceConfigWrap();
+    json raceJson = base;
+    raceJson["trace-sample-rate"] = "0.25";
+    raceJson["trace-channel-sample-rates"] = {{"twoSixDirectCpp", 0}, {"twoSixIndirectCpp", "1"}};
+    raceJson["trace-export-queue-size"] = "100";
+    std::string jsonString = raceJson.dump();
+    raceConfig.wrapParseConfigString(jsonString);
+    EXPECT_EQ(raceConfig.traceSampleRate, 0.25);
+    ASSERT_EQ(raceConfig.traceChannelSampleRates.size(), 2);
+    EXPECT_EQ(raceConfig.traceChannelSampleRates.at("twoSixDirectCpp"), 0.0);
+    EXPECT_EQ(raceConfig.traceChannelSampleRates.at("twoSixIndirectCpp"), 1.0);
+    EXPECT_EQ(raceConfig.traceExportQueueSize, 100);
+}
+
+TEST(RaceConfigWrap, parseTraceSampleRate_throws_if_out_of_range) {
+    RaceConfigWrap raceConfig = RaceConfigWrap();
+    json raceJson = base;
+    raceJson["trace-sample-rate"] = "1.5";
+    std::string jsonString = raceJson.dump();
+    ASSERT_THROW(raceConfig.wrapParseConfigString(jsonString),
+                 RaceConfig::race_config_parsing_exception);
+}
+
 /**
  * @brief If the plugins section is missing then parsing should throw an error.
  *
@@ -376,3 +376,13 @@ TEST(RaceLinks, cached_package_handles) {
     handles = links.getCachedPackageHandles(c2);
     EXPECT_EQ(handles.size(), 0);
 }
+
+TEST(RaceLinks, getChannelFromLinkID) {
+    EXPECT_EQ(RaceLinks::getChannelFromLinkID("MockComms/twoSixDirectCpp/LinkID_1"),
+              "twoSixDirectCpp");
+    EXPECT_EQ(RaceLinks::getChannelFromLinkID("MockComms/twoSixDirectCpp/LinkID_1/Connection_2"),
+              "twoSixDirectCpp");
+    EXPECT_THROW(RaceLinks::getChannelFromLinkID("MockComms"), std::invalid_argument);
+    EXPECT_THROW(RaceLinks::getChannelFromLinkID("MockComms/twoSixDirectCpp"),
+                 std::invalid_argument);
+}
@@ -582,6 +582,60 @@ TEST_F(RaceSdkTestFixture, sendEncryptedPackage_should_call_comms) {
     EXPECT_EQ(handle, sdkResponse.handle);
 }
 
+/**
+ * @brief sendEncryptedPackages should forward each package to the comms plugin in order and return
+ * a response for every package, including those on connections that don't exist.
+ *
+ */
+TEST_F(RaceSdkTestFixture, sendEncryptedPackages_should_call_comms_in_order) {
+    const std::string cipherText1 = "first";
+    const std::string cipherText2 = "second";
+    EncPkg package1(0, 0, {cipherText1.begin(), cipherText1.end()});
+    EncPkg package2(0, 0, {cipherText2.begin(), cipherText2.end()});
+
+    // create a dummy connection
+    const LinkID linkId =
+        createLinkForTesting(mockComms.get(), &sdk, "MockComms-0", channelGid, {"my persona"});
+    RaceHandle connHandle =
+        sdk.openConnection(*sdk.getNM(), LT_RECV, linkId, "", 0, RACE_UNLIMITED, 0).handle;
+    const ConnectionID connectionId =
+        sdk.getCommsWrapper("MockComms-0")->generateConnectionId(linkId);
+    sdk.getCommsWrapper("MockComms-0")
+        ->onConnectionStatusChanged(connHandle, connectionId, CONNECTION_OPEN,
+                                    getDefaultLinkProperties(), 0);
+
+    std::vector<RaceHandle> handles;
+    std::vector<RawData> sent;
+    EXPECT_CALL(*mockComms, sendPackage(::testing::_, connectionId, ::testing::_, ::testing::_,
+                                        ::testing::_))
+        .Times(2)
+        .WillRepeatedly([&](RaceHandle handle, ConnectionID, EncPkg pkg, double, uint64_t) {
+            handles.push_back(handle);
+            sent.push_back(pkg.getCipherText());
+            return PLUGIN_OK;
+        });
+
+    const uint64_t batchId = 0;
+    auto sdkResponses = sdk.sendEncryptedPackages(
+        *sdk.getNM(),
+        {{package1, connectionId}, {package1, "MockComms/Invalid"}, {package2, connectionId}},
+        batchId, 0);
+
+    // make sure the plugins get the call before the expect
+    sdk.getCommsWrapper("MockComms-0")->waitForCallbacks();
+    sdk.getNM()->waitForCallbacks();
+    sdk.cleanShutdown();
+
+    ASSERT_EQ(sdkResponses.size(), 3u);
+    EXPECT_EQ(sdkResponses[0].status, SDK_OK);
+    EXPECT_EQ(sdkResponses[1].status, SDK_INVALID_ARGUMENT);
+    EXPECT_EQ(sdkResponses[2].status, SDK_OK);
+    ASSERT_EQ(handles.size(), 2u);
+    EXPECT_EQ(handles[0], sdkResponses[0].handle);
+    EXPECT_EQ(handles[1], sdkResponses[2].handle);
+    EXPECT_EQ(sent, std::vector<RawData>({package1.getCipherText(), package2.getCipherText()}));
+}
+
 /**
  * @brief sendEncryptedPackage should return queue full if the package is small enough to fit in the
  * queue, but too large to fit in the remaining space.
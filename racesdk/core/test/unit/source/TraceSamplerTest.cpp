@@ -0,0 +1,57 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+#include "../../../source/TraceSampler.h"
+#include "gtest/gtest.h"
+
+TEST(TraceSampler, samples_one_percent_by_default) {
+    TraceSampler sampler;
+    EXPECT_EQ(sampler.getSampleRate("MockComms/channel/LinkID_0/Connection_0"), 0.01);
+}
+
+TEST(TraceSampler, rate_one_samples_everything) {
+    TraceSampler sampler(1.0);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_TRUE(sampler.sample("MockComms/channel/LinkID_0/Connection_0"));
+    }
+}
+
+TEST(TraceSampler, rate_zero_samples_nothing) {
+    TraceSampler sampler(0.0);
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_FALSE(sampler.sample("MockComms/channel/LinkID_0/Connection_0"));
+    }
+}
+
+TEST(TraceSampler, samples_roughly_the_rate) {
+    TraceSampler sampler(0.25);
+    int sampled = 0;
+    for (int i = 0; i < 10000; ++i) {
+        sampled += sampler.sample("MockComms/channel/LinkID_0/Connection_0") ? 1 : 0;
+    }
+    EXPECT_GT(sampled, 2000);
+    EXPECT_LT(sampled, 3000);
+}
+
+TEST(TraceSampler, channel_rates_override_default) {
+    TraceSampler sampler(0.5, {{"quiet", 0.0}, {"loud", 1.0}});
+    EXPECT_EQ(sampler.getSampleRate("MockComms/quiet/LinkID_0/Connection_0"), 0.0);
+    EXPECT_EQ(sampler.getSampleRate("MockComms/loud/LinkID_1/Connection_1"), 1.0);
+    EXPECT_EQ(sampler.getSampleRate("MockComms/other/LinkID_2/Connection_2"), 0.5);
+    // not a generated connection ID
+    EXPECT_EQ(sampler.getSampleRate("connection"), 0.5);
+}
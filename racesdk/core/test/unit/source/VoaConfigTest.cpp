@@ -0,0 +1,136 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include <limits>
+
+#include "../../../source/VoaConfig.h"
+#include "gtest/gtest.h"
+
+static const double NOW = std::numeric_limits<double>::max();
+
+static VoaConfig::VoaRulePtr findRule(VoaConfig &config, const LinkID &linkId,
+                                      const std::string &channelGid,
+                                      const personas::PersonaSet &personas = {}) {
+    return config.findTriggeredRule("race-client-00001", linkId, channelGid, personas, NOW);
+}
+
+TEST(VoaConfig, no_rules) {
+    VoaConfig config("");
+    EXPECT_FALSE(config.hasRules());
+    EXPECT_EQ(findRule(config, "MockComms/channel/LinkID_0", "channel"), nullptr);
+}
+
+TEST(VoaConfig, matches_rules_by_target) {
+    VoaConfig config("");
+    ASSERT_TRUE(config.addRules({
+        {"link", {{"to", {{"type", "link"}, {"matchid", "MockComms/channel1/LinkID_0"}}}}},
+        {"channel", {{"to", {{"type", "channel"}, {"matchid", "channel2"}}}}},
+        {"persona", {{"to", {{"type", "persona"}, {"matchid", "race-server-00001"}}}}},
+        {"other-node",
+         {{"persona", "race-client-00002"}, {"to", {{"type", "link"}, {"matchid", "all"}}}}},
+        {"no-target", {{"action", "drop"}}},
+    }));
+    EXPECT_TRUE(config.hasRules());
+
+    EXPECT_EQ(findRule(config, "MockComms/channel1/LinkID_0", "channel1")->ruleId, "link");
+    EXPECT_EQ(findRule(config, "MockComms/channel2/LinkID_1", "channel2")->ruleId, "channel");
+    EXPECT_EQ(
+        findRule(config, "MockComms/channel3/LinkID_2", "channel3", {"race-server-00001"})->ruleId,
+        "persona");
+    EXPECT_EQ(findRule(config, "MockComms/channel3/LinkID_2", "channel3", {"race-server-00002"}),
+              nullptr);
+}
+
+TEST(VoaConfig, first_rule_in_config_order_applies) {
+    VoaConfig config("");
+    ASSERT_TRUE(
+        config.addRules({{"b-channel", {{"to", {{"type", "channel"}, {"matchid", "ch"}}}}}}));
+    // added later, so checked after b-channel despite its ID
+    ASSERT_TRUE(config.addRules({{"a-all", {{"to", {{"type", "link"}, {"matchid", "all"}}}}}}));
+
+    EXPECT_EQ(findRule(config, "MockComms/ch/LinkID_0", "ch")->ruleId, "b-channel");
+    EXPECT_EQ(findRule(config, "MockComms/other/LinkID_0", "other")->ruleId, "a-all");
+}
+
+TEST(VoaConfig, count_window_falls_through_to_next_rule) {
+    VoaConfig config("");
+    ASSERT_TRUE(config.addRules({
+        // rules in a config object are ordered by ID
+        {"a-limited",
+         {{"to", {{"matchid", "all"}, {"type", "link"}}}, {"window", {{"count", "2"}}}}},
+        {"b-fallback", {{"to", {{"matchid", "all"}, {"type", "link"}}}}},
+    }));
+
+    EXPECT_EQ(findRule(config, "MockComms/ch/LinkID_0", "ch")->ruleId, "a-limited");
+    EXPECT_EQ(findRule(config, "MockComms/ch/LinkID_0", "ch")->ruleId, "a-limited");
+    EXPECT_EQ(findRule(config, "MockComms/ch/LinkID_0", "ch")->ruleId, "b-fallback");
+}
+
+TEST(VoaConfig, skipN_triggers_every_nth_package) {
+    VoaConfig config("");
+    ASSERT_TRUE(config.addRules({{"skip",
+                                  {{"to", {{"matchid", "all"}, {"type", "link"}}},
+                                   {"trigger", {{"skipN", "3"}}}}}}));
+
+    std::vector<bool> triggered;
+    for (int i = 0; i < 7; ++i) {
+        triggered.push_back(findRule(config, "MockComms/ch/LinkID_0", "ch") != nullptr);
+    }
+    EXPECT_EQ(triggered, std::vector<bool>({true, false, false, true, false, false, true}));
+}
+
+TEST(VoaConfig, parses_params_once) {
+    VoaConfig config("");
+    ASSERT_TRUE(config.addRules({{"replay",
+                                  {{"action", "replay"},
+                                   {"startupdelay", "1.5"},
+                                   {"params", {{"holdtime", "0.25"}, {"replaytimes", "3"}}}}}}));
+
+    auto rule = config.getRuleForId("replay");
+    ASSERT_NE(rule, nullptr);
+    EXPECT_EQ(rule->startupDelay, 1.5);
+    EXPECT_EQ(rule->replayTimes, 3u);
+    EXPECT_EQ(rule->getHoldTimeParam(0.5), 0.25);
+    EXPECT_EQ(rule->targetType, VoaConfig::VoaRule::TargetType::NONE);
+}
+
+TEST(VoaConfig, invalid_rule_adds_nothing) {
+    VoaConfig config("");
+    EXPECT_FALSE(config.addRules({
+        {"good", {{"to", {{"matchid", "all"}, {"type", "link"}}}}},
+        {"bad", {{"to", {{"matchid", "all"}, {"type", "link"}}}, {"window", {{"count", "x"}}}}},
+    }));
+    EXPECT_FALSE(config.hasRules());
+    EXPECT_EQ(config.getRuleForId("good"), nullptr);
+}
+
+TEST(VoaConfig, delete_rules) {
+    VoaConfig config("");
+    ASSERT_TRUE(config.addRules({
+        {"first", {{"to", {{"type", "channel"}, {"matchid", "ch"}}}}},
+        {"second", {{"to", {{"type", "channel"}, {"matchid", "ch"}}}}},
+    }));
+
+    EXPECT_FALSE(config.deleteRules({{"rule_ids", nlohmann::json::array({"missing"})}}));
+    EXPECT_TRUE(config.deleteRules({{"rule_ids", nlohmann::json::array({"first"})}}));
+    EXPECT_EQ(findRule(config, "MockComms/ch/LinkID_0", "ch")->ruleId, "second");
+
+    EXPECT_TRUE(config.deleteRules({{"rule_ids", nlohmann::json::array()}}));
+    EXPECT_FALSE(config.hasRules());
+    EXPECT_EQ(findRule(config, "MockComms/ch/LinkID_0", "ch"), nullptr);
+}
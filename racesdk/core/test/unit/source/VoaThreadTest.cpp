@@ -0,0 +1,135 @@
+
+//
+// Copyright 2023 Two Six Technologies
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+
+
+#include <atomic>
+#include <chrono>
+#include <future>
+
+#include "../../../source/VoaThread.h"
+#include "../../common/MockRaceSdk.h"
+#include "gtest/gtest.h"
+
+using namespace std::chrono_literals;
+
+static double now() {
+    std::chrono::duration<double> time = std::chrono::system_clock::now().time_since_epoch();
+    return time.count();
+}
+
+static std::shared_ptr<const EncPkg> makePkg(size_t size) {
+    return std::make_shared<const EncPkg>(0, 0, RawData(size, 0x42));
+}
+
+TEST(VoaThread, process_sends_after_hold_time) {
+    MockRaceSdk sdk;
+    VoaThread voa(sdk, "", 1024);
+    voa.startThread();
+
+    std::promise<double> promise;
+    double holdTimestamp = now() + 0.020;
+    auto status = voa.process("conn", {{makePkg(10), holdTimestamp}}, [&](const EncPkg &pkg) {
+        EXPECT_EQ(pkg.getCipherText().size(), 10u);
+        promise.set_value(now());
+        return SdkResponse(SDK_OK);
+    });
+    ASSERT_EQ(status, SDK_OK);
+
+    auto future = promise.get_future();
+    ASSERT_EQ(future.wait_for(5s), std::future_status::ready);
+    EXPECT_GE(future.get(), holdTimestamp);
+    voa.stopThread();
+    EXPECT_EQ(voa.getQueuedBytes(), 0u);
+}
+
+TEST(VoaThread, shared_package_counted_once) {
+    MockRaceSdk sdk;
+    auto pkg = makePkg(60);
+    VoaThread voa(sdk, "", pkg->getSize());
+    voa.startThread();
+
+    // a replay of three copies of the same package
+    double later = now() + 60;
+    ASSERT_EQ(voa.process("conn", {{pkg, later}, {pkg, later}, {pkg, later}},
+                          [](const EncPkg &) { return SdkResponse(SDK_OK); }),
+              SDK_OK);
+    EXPECT_EQ(voa.getQueuedBytes(), pkg->getSize());
+    voa.stopThread();
+}
+
+TEST(VoaThread, process_refuses_packages_over_budget) {
+    MockRaceSdk sdk;
+    auto pkg1 = makePkg(60);
+    auto pkg2 = makePkg(50);
+    VoaThread voa(sdk, "", pkg1->getSize() + pkg2->getSize() - 1);
+    voa.startThread();
+
+    std::atomic<int> sent{0};
+    auto send = [&sent](const EncPkg &) {
+        ++sent;
+        return SdkResponse(SDK_OK);
+    };
+    double later = now() + 60;
+    ASSERT_EQ(voa.process("conn", {{pkg1, later}}, send), SDK_OK);
+    EXPECT_EQ(voa.process("conn", {{pkg2, later}}, send), SDK_QUEUE_FULL);
+    EXPECT_EQ(voa.getQueuedBytes(), pkg1->getSize());
+    voa.stopThread();
+    EXPECT_EQ(sent, 0);
+}
+
+TEST(VoaThread, cancel_connection_discards_its_sends) {
+    MockRaceSdk sdk;
+    VoaThread voa(sdk, "", 1024);
+    voa.startThread();
+
+    std::atomic<int> closedSent{0};
+    std::promise<void> openSent;
+    auto openPkg = makePkg(30);
+    double soon = now() + 0.050;
+    ASSERT_EQ(voa.process("closed", {{makePkg(10), soon}, {makePkg(20), soon}},
+                          [&closedSent](const EncPkg &) {
+                              ++closedSent;
+                              return SdkResponse(SDK_OK);
+                          }),
+              SDK_OK);
+    ASSERT_EQ(voa.process("open", {{openPkg, soon + 0.010}},
+                          [&openSent](const EncPkg &) {
+                              openSent.set_value();
+                              return SdkResponse(SDK_OK);
+                          }),
+              SDK_OK);
+    EXPECT_GT(voa.getQueuedBytes(), openPkg->getSize());
+
+    EXPECT_EQ(voa.cancelConnection("closed"), 2u);
+    EXPECT_EQ(voa.cancelConnection("closed"), 0u);
+    EXPECT_EQ(voa.getQueuedBytes(), openPkg->getSize());
+
+    ASSERT_EQ(openSent.get_future().wait_for(5s), std::future_status::ready);
+    voa.stopThread();
+    EXPECT_EQ(closedSent, 0);
+}
+
+TEST(VoaThread, process_after_stop_fails) {
+    MockRaceSdk sdk;
+    VoaThread voa(sdk, "", 1024);
+    voa.startThread();
+    voa.stopThread();
+
+    EXPECT_EQ(voa.process("conn", {{makePkg(10), now()}},
+                          [](const EncPkg &) { return SdkResponse(SDK_OK); }),
+              SDK_SHUTTING_DOWN);
+}
@@ -462,7 +462,8 @@ JNIEXPORT jobject JNICALL Java_ShimsJava_JRaceSdkComms_receiveEncPkg(JNIEnv *env
     EncPkg encPkg = JavaShimUtils::jobjectToEncPkg(env, jEncPkg);
     RaceLog::logDebug(
         logLabel,
-        "receiveEncPkg: called. Package size = " + std::to_string(encPkg.getCipherText().size()),
+        "receiveEncPkg: called. Package size = " +
+            std::to_string(encPkg.getCipherTextView().size()),
         "");
 
     std::vector<ConnectionID> connectionIds =
@@ -20,15 +20,34 @@
 
 #include <RaceEnums.h>  // StorageEncryptionType
 
-#include <string>  // std::string
-#include <vector>  // std::vector
+#include <cstdint>     // std::uint64_t
+#include <functional>  // std::function
+#include <iosfwd>      // std::istream
+#include <optional>    // std::optional
+#include <string>      // std::string
+#include <vector>      // std::vector
 
 // TODO: move `racesdk/core/source/filesystem.h` to `racesdk/common/include/` instead so this isn't
 // duplicated?
 #include "filesystem.h"
 
+/**
+ * @brief Reads and writes files encrypted with a key derived from a user passphrase.
+ *
+ * Encrypted files are stored as a header followed by fixed-size chunks, each encrypted and
+ * authenticated independently with AES-256-GCM. The chunk index, and whether it is the last chunk,
+ * are part of each chunk's additional authenticated data, so chunks can't be reordered, and the
+ * file can't be truncated at a chunk boundary, without detection. This lets a range of a file be
+ * read by decrypting only the chunks it covers, and lets data be appended by rewriting only the
+ * last chunk.
+ *
+ * Files in the older format (a single AES-256-CBC ciphertext) can still be read. They are rewritten
+ * in the chunked format the first time they are appended to, or by calling migrate().
+ */
 class StorageEncryption {
 public:
+    using ReadCallback = std::function<void(const std::uint8_t *data, size_t size)>;
+
     StorageEncryption() = default;
 
     /**
@@ -43,23 +62,61 @@ public:
               const std::string &keyDir);
 
     /**
-     * @brief
+     * @brief Read and decrypt a whole file
      *
-     * @param fullFilePath
-     * @return std::vector<std::uint8_t>
+     * @param fullFilePath The file to read
+     * @return std::vector<std::uint8_t> The contents of the file
      */
     std::vector<std::uint8_t> read(const std::string &fullFilePath);
 
     /**
-     * @brief
+     * @brief Read and decrypt part of a file. Only the chunks covering the range are decrypted.
+     *
+     * @param fullFilePath The file to read
+     * @param offset The offset of the first byte to read
+     * @param length The most bytes to read
+     * @return std::vector<std::uint8_t> The bytes read. Shorter than length if the range extends
+     * past the end of the file.
+     */
+    std::vector<std::uint8_t> read(const std::string &fullFilePath, std::uint64_t offset,
+                                   size_t length);
+
+    /**
+     * @brief Read and decrypt a file a chunk at a time, without holding the whole file in memory
      *
-     * @param fullFilePath
-     * @param data
+     * @param fullFilePath The file to read
+     * @param callback Called with each piece of the file, in order. The data is only valid during
+     * the call.
+     */
+    void readStream(const std::string &fullFilePath, const ReadCallback &callback);
+
+    /**
+     * @brief Encrypt and write a file, replacing any existing contents
+     *
+     * @param fullFilePath The file to write
+     * @param data The contents of the file
      */
     void write(const std::string &fullFilePath, const std::vector<std::uint8_t> &data);
 
+    /**
+     * @brief Encrypt and append data to a file, creating it if it doesn't exist. Only the last
+     * chunk of the existing file is rewritten. The original last chunk is journaled while it is
+     * rewritten, so if the append is interrupted the file is rolled back to its previous contents
+     * the next time it is accessed.
+     *
+     * @param fullFilePath The file to append to
+     * @param data The data to append
+     */
     void append(const std::string &fullFilePath, const std::vector<std::uint8_t> &data);
 
+    /**
+     * @brief Rewrite a file encrypted in the older single-ciphertext format in the chunked format
+     *
+     * @param fullFilePath The file to migrate
+     * @return true if the file was rewritten, false if it didn't need to be
+     */
+    bool migrate(const std::string &fullFilePath);
+
     /**
      * @brief Helper function that determines if a file is encryptable. Files are not encrytable if
      * they exist for testing purposes only
@@ -89,6 +146,70 @@ protected:
     std::vector<std::uint8_t> encrypt(const std::vector<std::uint8_t> &plaintext,
                                       const std::vector<std::uint8_t> &iv);
 
+    /**
+     * @brief Encrypt one chunk of a chunked file
+     *
+     * @param fileId The random identifier from the file header
+     * @param index The index of the chunk in the file
+     * @param isLast Whether this is the last chunk of the file
+     * @param plaintext The plaintext of the chunk
+     * @param size The size of the plaintext
+     * @return std::vector<std::uint8_t> The nonce, ciphertext, and tag
+     */
+    std::vector<std::uint8_t> encryptChunk(const std::vector<std::uint8_t> &fileId,
+                                           std::uint64_t index, bool isLast,
+                                           const std::uint8_t *plaintext, size_t size);
+
+    /**
+     * @brief Decrypt and authenticate one chunk of a chunked file
+     *
+     * @param fileId The random identifier from the file header
+     * @param index The index of the chunk in the file
+     * @param isLast Whether this is the last chunk of the file
+     * @param chunk The nonce, ciphertext, and tag
+     * @return std::vector<std::uint8_t> The plaintext of the chunk
+     */
+    std::vector<std::uint8_t> decryptChunk(const std::vector<std::uint8_t> &fileId,
+                                           std::uint64_t index, bool isLast,
+                                           const std::vector<std::uint8_t> &chunk);
+
+    /**
+     * @brief Read and decrypt a range of a chunked file
+     *
+     * @param file The file, positioned anywhere
+     * @param fileSize The size of the file
+     * @param offset The offset of the first plaintext byte to read
+     * @param length The most plaintext bytes to read
+     * @param callback Called with the plaintext of each chunk in the range
+     * @return false if the file is not in the chunked format
+     */
+    bool readChunked(std::istream &file, std::uint64_t fileSize, std::uint64_t offset,
+                     std::uint64_t length, const ReadCallback &callback);
+
+    /**
+     * @brief Write data as a chunked file, replacing any existing contents
+     *
+     * @param fullFilePath The file to write
+     * @param data The plaintext to write
+     */
+    void writeChunked(const std::string &fullFilePath, const std::vector<std::uint8_t> &data);
+
+    /**
+     * @brief Restore a chunked file whose last append was interrupted, using the journal the
+     * append left behind. Does nothing if there is no journal.
+     *
+     * @param fullFilePath The file to restore
+     */
+    static void rollBackAppend(const std::string &fullFilePath);
+
+    /**
+     * @brief Read a whole file as stored on disk, without decrypting it
+     *
+     * @param fullFilePath The file to read
+     * @return std::vector<std::uint8_t> The contents of the file
+     */
+    static std::vector<std::uint8_t> readRaw(const std::string &fullFilePath);
+
 protected:
     // TODO: not sure if we really care about preventing copying. might remove these
     StorageEncryption(const StorageEncryption &) {}
@@ -114,6 +235,12 @@ private:
      */
     std::vector<std::uint8_t> fileKey;
 
+    /**
+     * @brief The encryption type chosen when the key was created. Unset until init is called.
+     *
+     */
+    std::optional<RaceEnums::StorageEncryptionType> encryptionType;
+
 public:
     class InvalidPassphrase : public std::runtime_error {
     public:
@@ -20,8 +20,14 @@
 #include <openssl/err.h>  // ERR_get_error
 #include <openssl/evp.h>  // EVP_DecryptInit_ex, EVP_DecryptUpdate, EVP_DecryptFinal_ex, EVP_EncryptInit_ex, EVP_EncryptUpdate, EVP_EncryptFinal_ex
 #include <openssl/rand.h>  // RAND_bytes
+#include <openssl/sha.h>   // SHA256_DIGEST_LENGTH
 
+#include <algorithm>  // std::min
+#include <cstring>    // std::memcmp
 #include <fstream>
+#include <limits>   // std::numeric_limits
+#include <map>      // std::map
+#include <mutex>    // std::mutex
 #include <sstream>  // std::stringstream
 #include <vector>   // std::vector
 
@@ -30,6 +36,23 @@
 
 #define FILE_KEY_LENGTH 32  // 256 bits
 #define IV_LENGTH 16        // 128 bits
+#define PBKDF2_ITERATIONS 10000
+
+// Chunked file format. The header is the magic, a version byte, three reserved bytes, the chunk
+// size (plaintext bytes per chunk, little-endian), and a random file ID. Each chunk is a random
+// nonce, the ciphertext, and the GCM tag. All chunks but the last hold exactly chunk size bytes.
+#define CHUNKED_MAGIC "RACEAEAD"
+#define CHUNKED_MAGIC_LENGTH 8
+#define CHUNKED_VERSION 1
+#define CHUNKED_HEADER_LENGTH 32
+#define FILE_ID_LENGTH 16
+#define CHUNK_SIZE (64 * 1024)
+#define GCM_NONCE_LENGTH 12  // 96 bits
+#define GCM_TAG_LENGTH 16    // 128 bits
+#define CHUNK_OVERHEAD (GCM_NONCE_LENGTH + GCM_TAG_LENGTH)
+// While append rewrites the end of a chunked file, this file beside it holds the original file size
+// (8 bytes, little-endian) followed by the original last chunk
+#define APPEND_JOURNAL_SUFFIX ".appending"
 
 /**
  * @brief
@@ -45,6 +68,140 @@ static void handleOpensslError() {
     throw std::logic_error("Error with OpenSSL call: " + errorMessage);
 }
 
+struct ChunkedHeader {
+    std::uint32_t chunkSize;
+    std::vector<std::uint8_t> fileId;
+};
+
+/**
+ * @brief Where the chunks of a chunked file are, worked out from its size
+ *
+ */
+struct ChunkLayout {
+    // bytes from the start of one chunk to the next
+    std::uint64_t stride;
+    std::uint64_t chunkCount;
+    std::uint64_t plaintextSize;
+    // bytes of the last chunk on disk
+    std::uint64_t lastChunkSize;
+
+    ChunkLayout(const ChunkedHeader &header, std::uint64_t fileSize) {
+        std::uint64_t body = fileSize - CHUNKED_HEADER_LENGTH;
+        stride = header.chunkSize + CHUNK_OVERHEAD;
+        chunkCount = (body + stride - 1) / stride;
+        lastChunkSize = body - (chunkCount - 1) * stride;
+        if (chunkCount == 0 || lastChunkSize < CHUNK_OVERHEAD) {
+            throw std::runtime_error("StorageEncryption: malformed chunked file of size " +
+                                     std::to_string(fileSize));
+        }
+        plaintextSize = body - chunkCount * CHUNK_OVERHEAD;
+    }
+
+    std::uint64_t chunkOffset(std::uint64_t index) const {
+        return CHUNKED_HEADER_LENGTH + index * stride;
+    }
+
+    std::uint64_t chunkSize(std::uint64_t index) const {
+        return index == chunkCount - 1 ? lastChunkSize : stride;
+    }
+};
+
+/**
+ * @brief Read the header of a chunked file
+ *
+ * @param file The file to read. Left positioned after the header.
+ * @param fileSize The size of the file
+ * @param header Set to the header, if the file is chunked
+ * @return false if the file is not in the chunked format
+ */
+static bool readChunkedHeader(std::istream &file, std::uint64_t fileSize, ChunkedHeader &header) {
+    if (fileSize < CHUNKED_HEADER_LENGTH) {
+        return false;
+    }
+
+    std::uint8_t buffer[CHUNKED_HEADER_LENGTH];
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(buffer), CHUNKED_HEADER_LENGTH);
+    if (file.fail()) {
+        throw std::runtime_error("StorageEncryption: failed to read file header");
+    }
+    if (std::memcmp(buffer, CHUNKED_MAGIC, CHUNKED_MAGIC_LENGTH) != 0) {
+        return false;
+    }
+    if (buffer[CHUNKED_MAGIC_LENGTH] != CHUNKED_VERSION) {
+        const unsigned version = buffer[CHUNKED_MAGIC_LENGTH];
+        throw std::runtime_error("StorageEncryption: unsupported chunked file version " +
+                                 std::to_string(version));
+    }
+
+    header.chunkSize = 0;
+    for (int i = 3; i >= 0; --i) {
+        header.chunkSize = (header.chunkSize << 8) | buffer[12 + i];
+    }
+    if (header.chunkSize == 0) {
+        throw std::runtime_error("StorageEncryption: malformed chunked file header");
+    }
+    header.fileId.assign(buffer + 16, buffer + 16 + FILE_ID_LENGTH);
+    return true;
+}
+
+/**
+ * @brief Get the additional authenticated data for a chunk: the file ID, the chunk index, and
+ * whether it is the last chunk.
+ *
+ */
+static std::vector<std::uint8_t> chunkAad(const std::vector<std::uint8_t> &fileId,
+                                          std::uint64_t index, bool isLast) {
+    std::vector<std::uint8_t> aad(fileId);
+    for (int i = 0; i < 8; ++i) {
+        aad.push_back(static_cast<std::uint8_t>(index >> (8 * i)));
+    }
+    aad.push_back(isLast ? 1 : 0);
+    return aad;
+}
+
+static std::uint64_t getFileSize(std::istream &file) {
+    file.seekg(0, std::ios::end);
+    return static_cast<std::uint64_t>(file.tellg());
+}
+
+/**
+ * @brief Derive the file key from a passphrase and salt. Key derivation is deliberately slow, and
+ * the SDK and every plugin storage object derive the same key at startup, so keys are cached for
+ * the life of the process. The cache is keyed by a hash of the salt and passphrase, rather than
+ * the passphrase itself.
+ *
+ */
+static std::vector<std::uint8_t> deriveFileKey(const std::string &passphrase,
+                                               const std::vector<std::uint8_t> &salt) {
+    static std::mutex cacheMutex;
+    static std::map<std::vector<std::uint8_t>, std::vector<std::uint8_t>> keyCache;
+
+    std::vector<std::uint8_t> hashInput(salt);
+    hashInput.insert(hashInput.end(), passphrase.begin(), passphrase.end());
+    std::vector<std::uint8_t> cacheKey(SHA256_DIGEST_LENGTH);
+    if (1 != EVP_Digest(hashInput.data(), hashInput.size(), cacheKey.data(), NULL, EVP_sha256(),
+                        NULL)) {
+        handleOpensslError();
+    }
+
+    // hold the lock while deriving, so concurrent callers with the same passphrase derive it once
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto iter = keyCache.find(cacheKey);
+    if (iter != keyCache.end()) {
+        return iter->second;
+    }
+
+    std::vector<std::uint8_t> fileKey(FILE_KEY_LENGTH);
+    if (1 != PKCS5_PBKDF2_HMAC(passphrase.c_str(), static_cast<int>(passphrase.size()),
+                               salt.data(), static_cast<int>(salt.size()), PBKDF2_ITERATIONS,
+                               EVP_sha256(), static_cast<int>(fileKey.size()), fileKey.data())) {
+        handleOpensslError();
+    }
+    keyCache.emplace(std::move(cacheKey), fileKey);
+    return fileKey;
+}
+
 void StorageEncryption::init(RaceEnums::StorageEncryptionType encType,
                              const std::string &passphrase, const std::string &keyDir) {
     workingDirectory = keyDir;
@@ -67,13 +224,12 @@ void StorageEncryption::createKey(RaceEnums::StorageEncryptionType encType,
             passphraseHash.create(passphrase, salt);
         }
 
-        fileKey = std::vector<std::uint8_t>(FILE_KEY_LENGTH);
-        PKCS5_PBKDF2_HMAC(passphrase.c_str(), passphrase.size(), salt.data(), salt.size(), 10000,
-                          EVP_sha256(), fileKey.size(), fileKey.data());
-
+        fileKey = deriveFileKey(passphrase, salt);
+        encryptionType = encType;
     } else if (encType == RaceEnums::StorageEncryptionType::ENC_NONE) {
         // Create an empty hash file to signal that encryption is disabled.
         passphraseHash.create("", {});
+        encryptionType = encType;
     } else {
         throw std::runtime_error("StorageEncryption::createKey: ERROR: invalid encryption type: " +
                                  RaceEnums::storageEncryptionTypeToString(encType));
@@ -81,47 +237,155 @@ void StorageEncryption::createKey(RaceEnums::StorageEncryptionType encType,
 }
 
 RaceEnums::StorageEncryptionType StorageEncryption::getEncryptionType() {
-    // NOTE: if we support multiple encryption types then we will need to come up with a better
-    // scheme than this.
-    // If the passphrase hash file exists and is empty then encryption is disabled.
-    PassphraseHash passphraseHash(workingDirectory.string());
-    if (passphraseHash.get().empty()) {
-        return RaceEnums::StorageEncryptionType::ENC_NONE;
-    } else {
-        return RaceEnums::StorageEncryptionType::ENC_AES;
+    // The type is recorded in the working directory by createKey (an empty passphrase hash means
+    // encryption is disabled), so it's remembered there rather than re-read for every file.
+    if (!encryptionType) {
+        throw std::runtime_error("StorageEncryption: no key, init has not been called");
     }
+    return *encryptionType;
 }
 
 std::vector<std::uint8_t> StorageEncryption::read(const std::string &fullFilePath) {
+    std::vector<std::uint8_t> result;
+    fs::path filepath(fullFilePath);
+    if (fs::exists(filepath)) {
+        result.reserve(fs::file_size(filepath));
+    }
+    readStream(fullFilePath, [&result](const std::uint8_t *data, size_t size) {
+        result.insert(result.end(), data, data + size);
+    });
+    return result;
+}
+
+std::vector<std::uint8_t> StorageEncryption::read(const std::string &fullFilePath,
+                                                  std::uint64_t offset, size_t length) {
     // Check the encryption type, and raise an exception if key does not exist.
     const auto encType = getEncryptionType();
+    const bool encrypted =
+        encType == RaceEnums::StorageEncryptionType::ENC_AES && isFileEncryptable(fullFilePath);
+    if (encrypted) {
+        rollBackAppend(fullFilePath);
+    }
+
+    std::ifstream file(fullFilePath, std::ios::binary);
+    if (file.fail()) {
+        throw std::runtime_error("StorageEncryption: failed to open file to read: " +
+                                 fullFilePath);
+    }
+    std::uint64_t fileSize = getFileSize(file);
+
+    std::vector<std::uint8_t> result;
+    if (encrypted) {
+        auto append = [&result](const std::uint8_t *data, size_t size) {
+            result.insert(result.end(), data, data + size);
+        };
+        if (!readChunked(file, fileSize, offset, length, append)) {
+            // older format, so the whole file has to be decrypted
+            std::vector<std::uint8_t> plaintext = decrypt(readRaw(fullFilePath));
+            if (offset < plaintext.size()) {
+                size_t start = static_cast<size_t>(offset);
+                size_t count = std::min(length, plaintext.size() - start);
+                result.assign(plaintext.begin() + static_cast<std::ptrdiff_t>(start),
+                              plaintext.begin() + static_cast<std::ptrdiff_t>(start + count));
+            }
+        }
+        return result;
+    }
+
+    if (offset < fileSize) {
+        result.resize(static_cast<size_t>(std::min<std::uint64_t>(length, fileSize - offset)));
+        file.seekg(static_cast<std::streamoff>(offset));
+        file.read(reinterpret_cast<char *>(result.data()),
+                  static_cast<std::streamsize>(result.size()));
+        if (file.fail()) {
+            throw std::runtime_error(
+                "StorageEncryption: an error occurred while trying read file: " + fullFilePath);
+        }
+    }
+    return result;
+}
+
+void StorageEncryption::readStream(const std::string &fullFilePath, const ReadCallback &callback) {
+    // Check the encryption type, and raise an exception if key does not exist.
+    const auto encType = getEncryptionType();
+
+    const bool encrypted =
+        encType == RaceEnums::StorageEncryptionType::ENC_AES && isFileEncryptable(fullFilePath);
 
     fs::path filepath(fullFilePath);
     if (!fs::exists(filepath)) {
         throw std::runtime_error("StorageEncryption: failed to read file, does not exist: " +
                                  fullFilePath);
-    } else {
-        size_t fileSize = fs::file_size(filepath);
-        std::ifstream file(filepath.native());
-        if (file.fail()) {
-            throw std::runtime_error(
-                "StorageEncryption: an error occurred while trying to open file to read: " +
-                fullFilePath);
+    }
+    if (encrypted) {
+        rollBackAppend(fullFilePath);
+    }
+    std::ifstream file(filepath.native(), std::ios::binary);
+    if (file.fail()) {
+        throw std::runtime_error(
+            "StorageEncryption: an error occurred while trying to open file to read: " +
+            fullFilePath);
+    }
+    std::uint64_t fileSize = getFileSize(file);
+
+    if (encrypted) {
+        if (!readChunked(file, fileSize, 0, std::numeric_limits<std::uint64_t>::max(), callback)) {
+            std::vector<std::uint8_t> plaintext = decrypt(readRaw(fullFilePath));
+            callback(plaintext.data(), plaintext.size());
         }
-        std::vector<std::uint8_t> result(fileSize);
-        file.read(reinterpret_cast<char *>(result.data()),
-                  static_cast<int64_t>(static_cast<std::int64_t>(fileSize)));
+        return;
+    }
+
+    std::vector<std::uint8_t> buffer(CHUNK_SIZE);
+    file.seekg(0);
+    for (std::uint64_t remaining = fileSize; remaining > 0;) {
+        size_t count = static_cast<size_t>(std::min<std::uint64_t>(remaining, buffer.size()));
+        file.read(reinterpret_cast<char *>(buffer.data()), static_cast<std::streamsize>(count));
         if (file.fail()) {
             throw std::runtime_error(
                 "StorageEncryption: an error occurred while trying read file: " + fullFilePath);
         }
-        if (encType == RaceEnums::StorageEncryptionType::ENC_AES &&
-            isFileEncryptable(fullFilePath)) {
-            return decrypt(result);
-        } else {
-            return result;
+        callback(buffer.data(), count);
+        remaining -= count;
+    }
+}
+
+bool StorageEncryption::readChunked(std::istream &file, std::uint64_t fileSize,
+                                    std::uint64_t offset, std::uint64_t length,
+                                    const ReadCallback &callback) {
+    ChunkedHeader header;
+    if (!readChunkedHeader(file, fileSize, header)) {
+        return false;
+    }
+    ChunkLayout layout(header, fileSize);
+    if (offset >= layout.plaintextSize || length == 0) {
+        return true;
+    }
+
+    std::uint64_t end = offset + std::min(length, layout.plaintextSize - offset);
+    std::uint64_t firstChunk = offset / header.chunkSize;
+    std::uint64_t lastChunk = (end - 1) / header.chunkSize;
+
+    std::vector<std::uint8_t> chunk;
+    file.seekg(static_cast<std::streamoff>(layout.chunkOffset(firstChunk)));
+    for (std::uint64_t index = firstChunk; index <= lastChunk; ++index) {
+        chunk.resize(static_cast<size_t>(layout.chunkSize(index)));
+        file.read(reinterpret_cast<char *>(chunk.data()),
+                  static_cast<std::streamsize>(chunk.size()));
+        if (file.fail()) {
+            throw std::runtime_error("StorageEncryption: failed to read chunk " +
+                                     std::to_string(index));
         }
+        std::vector<std::uint8_t> plaintext =
+            decryptChunk(header.fileId, index, index == layout.chunkCount - 1, chunk);
+
+        // only pass on the part of the chunk within the range
+        std::uint64_t chunkStart = index * header.chunkSize;
+        size_t from = static_cast<size_t>(std::max(offset, chunkStart) - chunkStart);
+        size_t to = static_cast<size_t>(std::min(end, chunkStart + plaintext.size()) - chunkStart);
+        callback(plaintext.data() + from, to - from);
     }
+    return true;
 }
 
 void StorageEncryption::write(const std::string &fullFilePath,
@@ -132,22 +396,59 @@ void StorageEncryption::write(const std::string &fullFilePath,
     fs::path filepath(fullFilePath);
     fs::create_directories(filepath.parent_path());
 
+    if (encType == RaceEnums::StorageEncryptionType::ENC_AES && isFileEncryptable(fullFilePath)) {
+        writeChunked(fullFilePath, data);
+        // the contents were replaced, so an interrupted append must not be rolled back onto them
+        fs::remove(fs::path(fullFilePath + APPEND_JOURNAL_SUFFIX));
+        return;
+    }
+
     // Open the file in truncate mode. This will overwrite any existing file content.
-    std::ofstream file(filepath.native(), std::ofstream::trunc);
+    std::ofstream file(filepath.native(), std::ofstream::trunc | std::ofstream::binary);
     if (file.fail()) {
         throw std::runtime_error("StorageEncryption::write: failed to open output file: " +
                                  fullFilePath);
     }
 
-    std::vector<std::uint8_t> writeData;
-    if (encType == RaceEnums::StorageEncryptionType::ENC_AES && isFileEncryptable(fullFilePath)) {
-        writeData = encrypt(data);
-    } else {
-        writeData = data;
+    file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::int64_t>(data.size()));
+    if (file.fail()) {
+        throw std::runtime_error("StorageEncryption::write: failed to write file: " + fullFilePath);
+    }
+}
+
+void StorageEncryption::writeChunked(const std::string &fullFilePath,
+                                     const std::vector<std::uint8_t> &data) {
+    std::vector<std::uint8_t> fileId(FILE_ID_LENGTH);
+    if (1 != RAND_bytes(fileId.data(), FILE_ID_LENGTH)) {
+        handleOpensslError();
     }
 
-    file.write(reinterpret_cast<const char *>(writeData.data()),
-               static_cast<std::int64_t>(writeData.size()));
+    // Open the file in truncate mode. This will overwrite any existing file content.
+    std::ofstream file(fullFilePath, std::ofstream::trunc | std::ofstream::binary);
+    if (file.fail()) {
+        throw std::runtime_error("StorageEncryption::write: failed to open output file: " +
+                                 fullFilePath);
+    }
+
+    std::uint8_t header[CHUNKED_HEADER_LENGTH] = {};
+    std::memcpy(header, CHUNKED_MAGIC, CHUNKED_MAGIC_LENGTH);
+    header[CHUNKED_MAGIC_LENGTH] = CHUNKED_VERSION;
+    for (int i = 0; i < 4; ++i) {
+        header[12 + i] = static_cast<std::uint8_t>(CHUNK_SIZE >> (8 * i));
+    }
+    std::memcpy(header + 16, fileId.data(), FILE_ID_LENGTH);
+    file.write(reinterpret_cast<const char *>(header), CHUNKED_HEADER_LENGTH);
+
+    // there is always at least one chunk, so the end of the file is authenticated
+    size_t chunkCount = std::max<size_t>(1, (data.size() + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    for (size_t index = 0; index < chunkCount; ++index) {
+        size_t start = index * CHUNK_SIZE;
+        size_t size = std::min<size_t>(CHUNK_SIZE, data.size() - start);
+        auto chunk =
+            encryptChunk(fileId, index, index == chunkCount - 1, data.data() + start, size);
+        file.write(reinterpret_cast<const char *>(chunk.data()),
+                   static_cast<std::streamsize>(chunk.size()));
+    }
     if (file.fail()) {
         throw std::runtime_error("StorageEncryption::write: failed to write file: " + fullFilePath);
     }
@@ -159,79 +460,177 @@ void StorageEncryption::append(const std::string &fullFilePath,
     const auto encType = getEncryptionType();
 
     fs::path filepath(fullFilePath);
-    std::vector<std::uint8_t> writeData;
-    std::fstream file;
     if (!fs::exists(filepath)) {  // no existing file, just call writeFile
         return this->write(fullFilePath, data);
     }
 
-    // existing file
-    if (encType == RaceEnums::StorageEncryptionType::ENC_AES) {
-        // deal with decryption end of file for appending
-        size_t fileSize = fs::file_size(filepath);
-        std::ifstream ifile(filepath.native());
-        if (ifile.fail()) {
+    if (encType != RaceEnums::StorageEncryptionType::ENC_AES || !isFileEncryptable(fullFilePath)) {
+        // existing file but no encryption, just set to "append" mode.
+        std::ofstream file(filepath.native(), std::ofstream::app | std::ofstream::binary);
+        if (file.fail()) {
             throw std::runtime_error("appendFile could not open file: " + filepath.string());
         }
-        // Seek to last two blocks
-        long seekPos = static_cast<long>(fileSize) - (2 * IV_LENGTH);
-        if (seekPos < 0) {
-            throw std::runtime_error(
-                "appendFile called with encryption key on an existing file of insufficient "
-                "length " +
-                std::to_string(fileSize) + ". Aborting append operation");
+        file.write(reinterpret_cast<const char *>(data.data()),
+                   static_cast<std::int64_t>(data.size()));
+        if (file.fail()) {
+            throw std::runtime_error("appendFile error appending to file: " + filepath.string());
         }
-        ifile.seekg(static_cast<std::streamoff>(seekPos));
-
-        // Read penultimate block as the IV. Since we are using cipher-block-chaining, the previous
-        // block is the IV of the current. We are rewriting the last block because it may have been
-        // padded, so the IV is the second-to-last.
-        std::vector<std::uint8_t> iv;
-        iv.resize(IV_LENGTH);
-        ifile.read(reinterpret_cast<char *>(iv.data()), IV_LENGTH);
-
-        // read last block to remove padding before the new data
-        std::vector<std::uint8_t> lastBlock;
-        lastBlock.resize(IV_LENGTH);
-        ifile.read(reinterpret_cast<char *>(lastBlock.data()), IV_LENGTH);
-        ifile.close();
-        try {
-            lastBlock = decrypt(lastBlock, iv);
-        } catch (const std::logic_error &error) {
-            throw std::runtime_error("appendFile could not decrypt last block from file: " +
-                                     filepath.string() + " : " + std::string(error.what()));
+        return;
+    }
+
+    if (data.empty()) {
+        return;
+    }
+
+    rollBackAppend(fullFilePath);
+    // Files in the older format can't be appended to without rewriting them, so convert them
+    // first. Later appends are then cheap.
+    migrate(fullFilePath);
+
+    std::fstream file(filepath.native(),
+                      std::fstream::in | std::fstream::out | std::fstream::binary);
+    if (file.fail()) {
+        throw std::runtime_error("appendFile could not open file: " + filepath.string());
+    }
+    std::uint64_t fileSize = getFileSize(file);
+    ChunkedHeader header;
+    if (!readChunkedHeader(file, fileSize, header)) {
+        throw std::runtime_error("appendFile found an unrecognized file format: " +
+                                 filepath.string());
+    }
+    ChunkLayout layout(header, fileSize);
+
+    // Decrypt the last chunk. It is rewritten with the start of the new data, as it may not be
+    // full, and is no longer the last chunk.
+    std::uint64_t index = layout.chunkCount - 1;
+    std::vector<std::uint8_t> lastChunk(static_cast<size_t>(layout.lastChunkSize));
+    file.seekg(static_cast<std::streamoff>(layout.chunkOffset(index)));
+    file.read(reinterpret_cast<char *>(lastChunk.data()),
+              static_cast<std::streamsize>(lastChunk.size()));
+    if (file.fail()) {
+        throw std::runtime_error("appendFile could not read last chunk from file: " +
+                                 filepath.string());
+    }
+    std::vector<std::uint8_t> combinedData = decryptChunk(header.fileId, index, true, lastChunk);
+    combinedData.insert(combinedData.end(), data.begin(), data.end());
+
+    // Journal the last chunk before overwriting it, so an interrupted append can be rolled back
+    // rather than leaving it torn. Like migrate, the journal is written alongside and renamed into
+    // place, so it is only ever seen complete.
+    const std::string journalPath = fullFilePath + APPEND_JOURNAL_SUFFIX;
+    {
+        std::ofstream journal(journalPath + ".tmp", std::ofstream::trunc | std::ofstream::binary);
+        std::uint8_t originalSize[8];
+        for (int i = 0; i < 8; ++i) {
+            originalSize[i] = static_cast<std::uint8_t>(fileSize >> (8 * i));
+        }
+        journal.write(reinterpret_cast<const char *>(originalSize), sizeof(originalSize));
+        journal.write(reinterpret_cast<const char *>(lastChunk.data()),
+                      static_cast<std::streamsize>(lastChunk.size()));
+        journal.close();
+        if (journal.fail()) {
+            throw std::runtime_error("appendFile could not write journal for file: " +
+                                     filepath.string());
         }
+    }
+    fs::rename(fs::path(journalPath + ".tmp"), fs::path(journalPath));
+
+    file.seekp(static_cast<std::streamoff>(layout.chunkOffset(index)));
+    for (size_t start = 0; start < combinedData.size(); start += header.chunkSize, ++index) {
+        size_t size = std::min<size_t>(header.chunkSize, combinedData.size() - start);
+        bool isLast = start + size == combinedData.size();
+        auto chunk = encryptChunk(header.fileId, index, isLast, combinedData.data() + start, size);
+        file.write(reinterpret_cast<const char *>(chunk.data()),
+                   static_cast<std::streamsize>(chunk.size()));
+    }
+    // the new chunks must be in the file before the journal is dropped
+    file.close();
+    if (file.fail()) {
+        throw std::runtime_error("appendFile error appending to file: " + filepath.string());
+    }
+    fs::remove(fs::path(journalPath));
+}
+
+void StorageEncryption::rollBackAppend(const std::string &fullFilePath) {
+    const std::string journalPath = fullFilePath + APPEND_JOURNAL_SUFFIX;
+    if (!fs::exists(fs::path(journalPath))) {
+        return;
+    }
 
-        // combine last block of data with data to be appended
-        std::vector<std::uint8_t> combinedData;
-        combinedData.insert(combinedData.end(), lastBlock.begin(), lastBlock.end());
-        combinedData.insert(combinedData.end(), data.begin(), data.end());
-        try {
-            writeData = encrypt(combinedData, iv);
-        } catch (const std::logic_error &error) {
-            throw std::runtime_error("appendFile failed to encrypt combined data: " +
-                                     filepath.string() + " : " + std::string(error.what()));
+    std::vector<std::uint8_t> journal = readRaw(journalPath);
+    std::uint64_t fileSize = 0;
+    if (journal.size() >= 8) {
+        for (int i = 7; i >= 0; --i) {
+            fileSize = (fileSize << 8) | journal[static_cast<size_t>(i)];
         }
+    }
+    if (journal.size() < 8 || journal.size() - 8 > fileSize) {
+        throw std::runtime_error("StorageEncryption: malformed append journal: " + journalPath);
+    }
 
-        // re-open as io to seek to last block
-        file.open(filepath.native(), std::fstream::in | std::fstream::out);
+    // Put back the original last chunk, and drop anything the interrupted append wrote after it
+    const std::uint64_t lastChunkSize = journal.size() - 8;
+    {
+        std::fstream file(fullFilePath,
+                          std::fstream::in | std::fstream::out | std::fstream::binary);
+        file.seekp(static_cast<std::streamoff>(fileSize - lastChunkSize));
+        file.write(reinterpret_cast<const char *>(journal.data() + 8),
+                   static_cast<std::streamsize>(lastChunkSize));
+        file.close();
+        if (file.fail()) {
+            throw std::runtime_error("StorageEncryption: failed to roll back append to file: " +
+                                     fullFilePath);
+        }
+    }
+    fs::resize_file(fs::path(fullFilePath), fileSize);
+    fs::remove(fs::path(journalPath));
+}
 
-        // Seek to last block to rewrite it to avoid padding in between new and old blocks
-        file.seekg(static_cast<std::streamoff>(fileSize - IV_LENGTH));
-    } else {
-        // existing file but no encryption, just set to "append" mode.
-        file.open(filepath.native(), std::fstream::app);
-        writeData = data;
+bool StorageEncryption::migrate(const std::string &fullFilePath) {
+    // Check the encryption type, and raise an exception if key does not exist.
+    if (getEncryptionType() != RaceEnums::StorageEncryptionType::ENC_AES ||
+        !isFileEncryptable(fullFilePath) || !fs::exists(fs::path(fullFilePath))) {
+        return false;
     }
-    if (file.fail()) {
-        throw std::runtime_error("appendFile could not open file: " + filepath.string());
+
+    {
+        std::ifstream file(fullFilePath, std::ios::binary);
+        ChunkedHeader header;
+        if (file.fail() || readChunkedHeader(file, getFileSize(file), header)) {
+            return false;
+        }
+    }
+
+    std::vector<std::uint8_t> plaintext;
+    try {
+        plaintext = decrypt(readRaw(fullFilePath));
+    } catch (const std::logic_error &error) {
+        throw std::runtime_error("StorageEncryption::migrate could not decrypt file: " +
+                                 fullFilePath + " : " + std::string(error.what()));
     }
 
-    file.write(reinterpret_cast<const char *>(writeData.data()),
-               static_cast<std::int64_t>(writeData.size()));
+    // Write the new file alongside the old one, so the data isn't lost if writing fails
+    const std::string migratedFilePath = fullFilePath + ".migrating";
+    writeChunked(migratedFilePath, plaintext);
+    fs::rename(fs::path(migratedFilePath), fs::path(fullFilePath));
+    return true;
+}
+
+std::vector<std::uint8_t> StorageEncryption::readRaw(const std::string &fullFilePath) {
+    std::ifstream file(fullFilePath, std::ios::binary);
     if (file.fail()) {
-        throw std::runtime_error("appendFile error appending to file: " + filepath.string());
+        throw std::runtime_error(
+            "StorageEncryption: an error occurred while trying to open file to read: " +
+            fullFilePath);
+    }
+    std::vector<std::uint8_t> result(static_cast<size_t>(getFileSize(file)));
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(result.data()), static_cast<std::streamsize>(result.size()));
+    if (file.fail()) {
+        throw std::runtime_error("StorageEncryption: an error occurred while trying read file: " +
+                                 fullFilePath);
     }
+    return result;
 }
 
 std::vector<std::uint8_t> StorageEncryption::decrypt(const std::vector<std::uint8_t> &ciphertext) {
@@ -358,6 +757,87 @@ std::vector<std::uint8_t> StorageEncryption::encrypt(const std::vector<std::uint
     return std::vector<std::uint8_t>(ciphertext.get(), ciphertext.get() + ciphertext_len);
 }
 
+std::vector<std::uint8_t> StorageEncryption::encryptChunk(const std::vector<std::uint8_t> &fileId,
+                                                          std::uint64_t index, bool isLast,
+                                                          const std::uint8_t *plaintext,
+                                                          size_t size) {
+    std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> ctx(EVP_CIPHER_CTX_new(),
+                                                                        &EVP_CIPHER_CTX_free);
+    if (!ctx) {
+        handleOpensslError();
+    }
+
+    // nonce, then ciphertext (the same size as the plaintext for GCM), then tag
+    std::vector<std::uint8_t> output(GCM_NONCE_LENGTH + size + GCM_TAG_LENGTH);
+    std::uint8_t *nonce = output.data();
+    std::uint8_t *ciphertext = nonce + GCM_NONCE_LENGTH;
+    std::uint8_t *tag = ciphertext + size;
+    if (1 != RAND_bytes(nonce, GCM_NONCE_LENGTH)) {
+        handleOpensslError();
+    }
+
+    const std::vector<std::uint8_t> aad = chunkAad(fileId, index, isLast);
+    int len = 0;
+    if (1 != EVP_EncryptInit_ex(ctx.get(), EVP_aes_256_gcm(), NULL, fileKey.data(), nonce)) {
+        handleOpensslError();
+    }
+    if (1 != EVP_EncryptUpdate(ctx.get(), NULL, &len, aad.data(), static_cast<int>(aad.size()))) {
+        handleOpensslError();
+    }
+    if (size > 0 &&
+        1 != EVP_EncryptUpdate(ctx.get(), ciphertext, &len, plaintext, static_cast<int>(size))) {
+        handleOpensslError();
+    }
+    if (1 != EVP_EncryptFinal_ex(ctx.get(), ciphertext + size, &len)) {
+        handleOpensslError();
+    }
+    if (1 != EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_GET_TAG, GCM_TAG_LENGTH, tag)) {
+        handleOpensslError();
+    }
+    return output;
+}
+
+std::vector<std::uint8_t> StorageEncryption::decryptChunk(const std::vector<std::uint8_t> &fileId,
+                                                          std::uint64_t index, bool isLast,
+                                                          const std::vector<std::uint8_t> &chunk) {
+    if (chunk.size() < CHUNK_OVERHEAD) {
+        throw std::runtime_error("Attempted to decrypt a malformed chunk");
+    }
+    std::unique_ptr<EVP_CIPHER_CTX, decltype(&EVP_CIPHER_CTX_free)> ctx(EVP_CIPHER_CTX_new(),
+                                                                        &EVP_CIPHER_CTX_free);
+    if (!ctx) {
+        handleOpensslError();
+    }
+
+    size_t size = chunk.size() - CHUNK_OVERHEAD;
+    const std::uint8_t *nonce = chunk.data();
+    const std::uint8_t *ciphertext = nonce + GCM_NONCE_LENGTH;
+    std::vector<std::uint8_t> tag(ciphertext + size, ciphertext + size + GCM_TAG_LENGTH);
+    std::vector<std::uint8_t> plaintext(size);
+
+    const std::vector<std::uint8_t> aad = chunkAad(fileId, index, isLast);
+    int len = 0;
+    if (1 != EVP_DecryptInit_ex(ctx.get(), EVP_aes_256_gcm(), NULL, fileKey.data(), nonce)) {
+        handleOpensslError();
+    }
+    if (1 != EVP_DecryptUpdate(ctx.get(), NULL, &len, aad.data(), static_cast<int>(aad.size()))) {
+        handleOpensslError();
+    }
+    if (size > 0 && 1 != EVP_DecryptUpdate(ctx.get(), plaintext.data(), &len, ciphertext,
+                                           static_cast<int>(size))) {
+        handleOpensslError();
+    }
+    if (1 != EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_TAG, GCM_TAG_LENGTH, tag.data())) {
+        handleOpensslError();
+    }
+    // fails if the chunk was modified, moved, or is not the last chunk when it should be
+    if (1 != EVP_DecryptFinal_ex(ctx.get(), plaintext.data() + size, &len)) {
+        throw std::runtime_error("StorageEncryption: chunk " + std::to_string(index) +
+                                 " failed authentication");
+    }
+    return plaintext;
+}
+
 /**
  * @brief Helper function that determines if a file is encryptable. Files are not encrytable if
  * they exist for testing purposes only
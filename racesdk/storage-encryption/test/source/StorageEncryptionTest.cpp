@@ -15,6 +15,9 @@
 // limitations under the License.
 //
 
+#include <fstream>
+#include <iterator>
+
 #include "../../include/StorageEncryption.h"
 #include "../../include/filesystem.h"
 #include "gmock/gmock.h"
@@ -35,3 +38,221 @@ TEST(decrypt, decrypt_of_encrypt) {
 
     EXPECT_THAT(dataToWrite, ::testing::ContainerEq(dataReadFromFile));
 }
+
+class TestStorageEncryption : public StorageEncryption {
+public:
+    TestStorageEncryption() {
+        init(RaceEnums::StorageEncryptionType::ENC_AES, "myWeakPassphrase", "/tmp/race");
+    }
+
+    // Write a file in the format used before files were split into chunks
+    void writeLegacy(const std::string &fullFilePath, const std::vector<std::uint8_t> &data) {
+        std::vector<std::uint8_t> ciphertext = encrypt(data);
+        std::ofstream file(fullFilePath, std::ofstream::trunc | std::ofstream::binary);
+        file.write(reinterpret_cast<const char *>(ciphertext.data()),
+                   static_cast<std::streamsize>(ciphertext.size()));
+    }
+};
+
+static std::vector<std::uint8_t> makeData(size_t size) {
+    std::vector<std::uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<std::uint8_t>(i * 7 + i / 256);
+    }
+    return data;
+}
+
+static std::string testFilePath(const std::string &name) {
+    fs::path path = fs::current_path() / name;
+    fs::remove(path);
+    return path.string();
+}
+
+TEST(chunked, multi_chunk_round_trip) {
+    TestStorageEncryption storageEncryption;
+    const std::string path = testFilePath("chunked-round-trip");
+    const std::vector<std::uint8_t> data = makeData(3 * 64 * 1024 + 123);
+
+    storageEncryption.write(path, data);
+
+    EXPECT_THAT(storageEncryption.read(path), ::testing::ContainerEq(data));
+    // the plaintext isn't stored anywhere in the file
+    EXPECT_GT(fs::file_size(path), data.size());
+}
+
+TEST(chunked, empty_file) {
+    TestStorageEncryption storageEncryption;
+    const std::string path = testFilePath("chunked-empty");
+
+    storageEncryption.write(path, {});
+
+    EXPECT_TRUE(storageEncryption.read(path).empty());
+    EXPECT_TRUE(storageEncryption.read(path, 0, 10).empty());
+}
+
+TEST(chunked, range_read) {
+    TestStorageEncryption storageEncryption;
+    const std::string path = testFilePath("chunked-range");
+    const std::vector<std::uint8_t> data = makeData(2 * 64 * 1024 + 10);
+    storageEncryption.write(path, data);
+
+    // spans the boundary between the first two chunks
+    auto result = storageEncryption.read(path, 64 * 1024 - 5, 10);
+    EXPECT_THAT(result, ::testing::ElementsAreArray(data.data() + 64 * 1024 - 5, 10));
+
+    // runs past the end of the file
+    result = storageEncryption.read(path, data.size() - 4, 100);
+    EXPECT_THAT(result, ::testing::ElementsAreArray(data.data() + data.size() - 4, 4));
+
+    EXPECT_TRUE(storageEncryption.read(path, data.size(), 100).empty());
+}
+
+TEST(chunked, read_stream) {
+    TestStorageEncryption storageEncryption;
+    const std::string path = testFilePath("chunked-stream");
+    const std::vector<std::uint8_t> data = makeData(2 * 64 * 1024 + 10);
+    storageEncryption.write(path, data);
+
+    std::vector<std::uint8_t> result;
+    int calls = 0;
+    storageEncryption.readStream(path, [&](const std::uint8_t *chunk, size_t size) {
+        result.insert(result.end(), chunk, chunk + size);
+        ++calls;
+    });
+
+    EXPECT_EQ(calls, 3);
+    EXPECT_THAT(result, ::testing::ContainerEq(data));
+}
+
+TEST(chunked, repeated_append) {
+    TestStorageEncryption storageEncryption;
+    const std::string path = testFilePath("chunked-append");
+
+    std::vector<std::uint8_t> expected;
+    for (size_t size : {10u, 64u * 1024 - 10, 1u, 100000u, 0u, 5u}) {
+        std::vector<std::uint8_t> data = makeData(size);
+        storageEncryption.append(path, data);
+        expected.insert(expected.end(), data.begin(), data.end());
+        ASSERT_THAT(storageEncryption.read(path), ::testing::ContainerEq(expected));
+    }
+}
+
+static std::vector<std::uint8_t> readFile(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(file), {});
+}
+
+TEST(chunked, interrupted_append_is_rolled_back) {
+    TestStorageEncryption storageEncryption;
+    const std::string path = testFilePath("chunked-interrupted-append");
+    const std::vector<std::uint8_t> data = makeData(64 * 1024 + 10);
+    storageEncryption.write(path, data);
+    const std::vector<std::uint8_t> original = readFile(path);
+    storageEncryption.append(path, makeData(1000));
+    EXPECT_FALSE(fs::exists(path + ".appending"));
+
+    // Recreate what an append leaves behind if it is interrupted while rewriting the last chunk:
+    // the journal of the original last chunk, and a torn end of file
+    const size_t lastChunkSize = 10 + 28;
+    std::vector<std::uint8_t> torn = readFile(path);
+    torn.resize(original.size() - lastChunkSize + 100);
+    {
+        std::ofstream file(path, std::ofstream::trunc | std::ofstream::binary);
+        file.write(reinterpret_cast<const char *>(torn.data()),
+                   static_cast<std::streamsize>(torn.size()));
+        std::ofstream journal(path + ".appending", std::ofstream::trunc | std::ofstream::binary);
+        for (int i = 0; i < 8; ++i) {
+            journal.put(static_cast<char>(static_cast<std::uint64_t>(original.size()) >> (8 * i)));
+        }
+        journal.write(reinterpret_cast<const char *>(original.data()) + original.size() -
+                          lastChunkSize,
+                      lastChunkSize);
+    }
+
+    EXPECT_THAT(storageEncryption.read(path), ::testing::ContainerEq(data));
+    EXPECT_THAT(readFile(path), ::testing::ContainerEq(original));
+    EXPECT_FALSE(fs::exists(path + ".appending"));
+
+    // and the file can be appended to again
+    std::vector<std::uint8_t> expected = data;
+    std::vector<std::uint8_t> more = makeData(20);
+    storageEncryption.append(path, more);
+    expected.insert(expected.end(), more.begin(), more.end());
+    EXPECT_THAT(storageEncryption.read(path), ::testing::ContainerEq(expected));
+}
+
+TEST(chunked, append_migrates_legacy_file) {
+    TestStorageEncryption storageEncryption;
+    const std::string path = testFilePath("chunked-legacy");
+    std::vector<std::uint8_t> expected = makeData(1000);
+    storageEncryption.writeLegacy(path, expected);
+
+    // legacy files are still readable
+    EXPECT_THAT(storageEncryption.read(path), ::testing::ContainerEq(expected));
+    EXPECT_THAT(storageEncryption.read(path, 10, 5),
+                ::testing::ElementsAreArray(expected.data() + 10, 5));
+
+    std::vector<std::uint8_t> data = makeData(20);
+    storageEncryption.append(path, data);
+    expected.insert(expected.end(), data.begin(), data.end());
+
+    EXPECT_THAT(storageEncryption.read(path), ::testing::ContainerEq(expected));
+    EXPECT_FALSE(storageEncryption.migrate(path));
+}
+
+TEST(chunked, migrate) {
+    TestStorageEncryption storageEncryption;
+    const std::string path = testFilePath("chunked-migrate");
+    const std::vector<std::uint8_t> data = makeData(100);
+    storageEncryption.writeLegacy(path, data);
+
+    EXPECT_TRUE(storageEncryption.migrate(path));
+    EXPECT_FALSE(storageEncryption.migrate(path));
+    EXPECT_THAT(storageEncryption.read(path), ::testing::ContainerEq(data));
+}
+
+TEST(chunked, tampering_is_detected) {
+    TestStorageEncryption storageEncryption;
+    const std::string path = testFilePath("chunked-tamper");
+    const std::vector<std::uint8_t> data = makeData(2 * 64 * 1024);
+    storageEncryption.write(path, data);
+
+    {
+        std::fstream file(path, std::fstream::in | std::fstream::out | std::fstream::binary);
+        file.seekp(100);
+        file.put(0x42);
+    }
+
+    EXPECT_THROW(storageEncryption.read(path), std::runtime_error);
+    // chunks that weren't modified can still be read
+    EXPECT_THAT(storageEncryption.read(path, 64 * 1024, 10),
+                ::testing::ElementsAreArray(data.data() + 64 * 1024, 10));
+}
+
+TEST(chunked, truncation_is_detected) {
+    TestStorageEncryption storageEncryption;
+    const std::string path = testFilePath("chunked-truncate");
+    storageEncryption.write(path, makeData(2 * 64 * 1024 + 10));
+
+    // drop the last chunk, leaving a file that ends on a chunk boundary
+    fs::resize_file(path, fs::file_size(path) - (10 + 28));
+
+    EXPECT_THROW(storageEncryption.read(path), std::runtime_error);
+}
+
+TEST(init, second_instance_reads_files_of_first) {
+    TestStorageEncryption first;
+    const std::string path = testFilePath("init-second-instance");
+    const std::vector<std::uint8_t> data = makeData(100);
+    first.write(path, data);
+
+    // the key is derived from the same passphrase and salt, so it's the same key
+    TestStorageEncryption second;
+    EXPECT_THAT(second.read(path), ::testing::ContainerEq(data));
+}
+
+TEST(init, uninitialized_throws) {
+    StorageEncryption storageEncryption;
+    EXPECT_THROW(storageEncryption.write(testFilePath("init-uninitialized"), {1, 2, 3}),
+                 std::runtime_error);
+}
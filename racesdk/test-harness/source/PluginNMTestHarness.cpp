@@ -436,7 +436,7 @@ void PluginNMTestHarness::logError(const std::string &message, const std::string
 
 void PluginNMTestHarness::logMessageOverhead(const ClrMsg &message, const EncPkg &package) {
     const size_t messageSizeInBytes = message.getMsg().size();
-    const size_t packageSizeInBytes = package.getRawData().size();
+    const size_t packageSizeInBytes = package.getSize();
     const size_t overhead = packageSizeInBytes - messageSizeInBytes;
 
     std::stringstream logMessage;
@@ -34,6 +34,8 @@ public:
     MOCK_METHOD(LinkProperties, getLinkProperties, (LinkID), (override));
     MOCK_METHOD(SdkResponse, sendEncryptedPackage, (EncPkg, ConnectionID, uint64_t, int32_t),
                 (override));
+    MOCK_METHOD(std::vector<SdkResponse>, sendEncryptedPackages,
+                ((std::vector<std::pair<EncPkg, ConnectionID>>), uint64_t, int32_t), (override));
     MOCK_METHOD(SdkResponse, presentCleartextMessage, (ClrMsg), (override));
     MOCK_METHOD(std::vector<LinkID>, getLinksForPersonas, (std::vector<std::string>, LinkType),
                 (override));
@@ -33,6 +33,9 @@
   meta:<list key>:timestamp-index : tracks the time a post was created and allows searching for posts
         by time
 
+  A message containing the index of the post is published on the channel notify:<list key>, to wake
+  up clients waiting for posts with the wait route
+
   param KEYS[1] string category: the category to append to
   param ARGV[1] bytes value: the value to append to the category
   return int index: the index of the category
@@ -61,4 +64,7 @@ local time = redis.call('TIME')
 local timestamp = time[1] .. '.' .. string.format("%06d", time[2])
 redis.call('ZADD', 'meta:' .. key .. ':timestamp-index', timestamp, index)
 
+-- wake up anyone waiting for new posts in this category
+redis.call('PUBLISH', 'notify:' .. key, index)
+
 return {index, timestamp}
\ No newline at end of file
@@ -27,6 +27,8 @@ import json
 import redis
 import logging
 import os
+import threading
+import time
 
 
 def create_app():
@@ -42,6 +44,14 @@ def create_app():
         flask_app.logger.info(f"log_level: {logging.getLevelName(flask_app.logger.getEffectiveLevel())}")
         resize_threshold = config["resize_threshold"]
         flask_app.logger.info(f"resize_threshold: {resize_threshold}")
+        max_wait_timeout = config.get("max_wait_timeout", 20)
+        flask_app.logger.info(f"max_wait_timeout: {max_wait_timeout}")
+        max_waiters = config.get("max_waiters", 16)
+        flask_app.logger.info(f"max_waiters: {max_waiters}")
+
+    # Each wait request holds a gunicorn thread for up to max_wait_timeout, so limit how many may
+    # wait at once to leave threads free for the other routes
+    wait_slots = threading.BoundedSemaphore(max_waiters)
 
     redis_hostname = os.getenv('REDIS_HOSTNAME')
     if not redis_hostname:
@@ -147,6 +157,72 @@ def create_app():
             flask_app.logger.error(f"redis.exceptions.ResponseError: {e}")
             abort(404)
 
+    @flask_app.route('/wait/<string:category>/<int:start_index>', methods=['GET'])
+    def wait(category: str, start_index: int):
+        """
+        Purpose
+            This route allows a client to long-poll for posts. It behaves like get_range with a
+            stop index of -1, except that if there are no posts at or after start_index, it waits
+            for one to be made, or for the timeout to pass, before responding. This lets a client
+            receive posts as soon as they're made without repeatedly polling.
+        Args
+            category (String): The category to fetch from
+            start_index (int): The index of the first post to fetch
+        Query Parameters
+            timeout (float): The longest time to wait, in seconds. Defaults to, and is limited to,
+            max_wait_timeout from the config
+        Return
+            flask.Response object containing the http response. The body is the same as for
+            get_range. If the timeout passed without any posts, 'data' is empty. If max_waiters
+            requests are already waiting, the status is 503 and the client should retry later.
+        """
+        flask_app.logger.info(f"Got request: {request.path}")
+
+        if not wait_slots.acquire(blocking=False):
+            flask_app.logger.info("too many waiting requests, rejecting")
+            return Response(status=503, headers={'Retry-After': '1'})
+        try:
+            return wait_for_posts(category, start_index)
+        finally:
+            wait_slots.release()
+
+    def wait_for_posts(category: str, start_index: int):
+        """
+        Purpose
+            Implements the wait route once the request holds one of the wait slots
+        """
+
+        timeout = min(request.args.get("timeout", max_wait_timeout, type=float), max_wait_timeout)
+        deadline = time.monotonic() + max(timeout, 0)
+
+        key = "category:" + category
+        pubsub = rdb.pubsub(ignore_subscribe_messages=True)
+        try:
+            # subscribe before checking for posts, so a post made in between isn't missed
+            pubsub.subscribe("notify:" + key)
+            while True:
+                script_return = get_range_script(keys=[key], args=[start_index, -1])
+                length = script_return[1]
+                remaining = deadline - time.monotonic()
+                if length > start_index or remaining <= 0:
+                    break
+                pubsub.get_message(timeout=remaining)
+
+            timestamp = script_return[0].decode("utf-8", "replace")
+            str_list = [x.decode("utf-8", "replace") for x in script_return[2]]
+            flask_app.logger.info(f"got length: {length}")
+
+            return Response(
+                json.dumps({'data':str_list, 'length':length, 'timestamp':timestamp}),
+                status=200,
+                mimetype='application/json'
+            )
+        except redis.exceptions.ResponseError as e:
+            flask_app.logger.error(f"redis.exceptions.ResponseError: {e}")
+            abort(404)
+        finally:
+            pubsub.close()
+
     @flask_app.route('/latest/<string:category>', methods=['GET'])
     def get_latest(category: str):
         """